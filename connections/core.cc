@@ -169,7 +169,11 @@ void Core::StopAllEndpoints(ResultCallback callback) {
 }
 
 std::string Core::Dump() {
-  return client_.Dump();
+  return client_.Dump() + MetricsRegistry::GetInstance().Dump();
+}
+
+MetricsSnapshot Core::GetMetricsSnapshot() {
+  return MetricsRegistry::GetInstance().GetSnapshot();
 }
 
 }  // namespace connections
@@ -26,6 +26,7 @@
 #include "connections/listeners.h"
 #include "connections/params.h"
 #include "internal/analytics/event_logger.h"
+#include "internal/platform/metrics_registry.h"
 
 namespace location {
 namespace nearby {
@@ -238,8 +239,13 @@ class Core {
   // Gets the local endpoint generated by Nearby Connections.
   std::string GetLocalEndpointId() { return client_.GetLocalEndpointId(); }
 
+  // Returns the state of the client, followed by MetricsRegistry::Dump().
   std::string Dump();
 
+  // Returns the counters and latency histograms of the process, including
+  // those of every endpoint's transfers; see TransferMetrics.
+  MetricsSnapshot GetMetricsSnapshot();
+
  private:
   ClientProxy client_;
   ServiceControllerRouter* router_ = nullptr;
@@ -454,7 +454,8 @@ void AnalyticsRecorder::OnIncomingPayloadStarted(
 
 void AnalyticsRecorder::OnPayloadChunkReceived(const std::string &endpoint_id,
                                                std::int64_t payload_id,
-                                               std::int64_t chunk_size_bytes) {
+                                               std::int64_t chunk_size_bytes,
+                                               int num_chunks) {
   MutexLock lock(&mutex_);
   if (!CanRecordAnalyticsLocked("OnPayloadChunkReceived")) {
     return;
@@ -464,7 +465,7 @@ void AnalyticsRecorder::OnPayloadChunkReceived(const std::string &endpoint_id,
     return;
   }
   const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
-  logical_connection->ChunkReceived(payload_id, chunk_size_bytes);
+  logical_connection->ChunkReceived(payload_id, chunk_size_bytes, num_chunks);
 }
 
 void AnalyticsRecorder::OnIncomingPayloadDone(const std::string &endpoint_id,
@@ -482,6 +483,20 @@ void AnalyticsRecorder::OnIncomingPayloadDone(const std::string &endpoint_id,
   logical_connection->IncomingPayloadDone(payload_id, status);
 }
 
+std::shared_ptr<AnalyticsRecorder::ChunkCounter>
+AnalyticsRecorder::GetIncomingChunkCounter(const std::string &endpoint_id,
+                                           std::int64_t payload_id) {
+  MutexLock lock(&mutex_);
+  if (!CanRecordAnalyticsLocked("GetIncomingChunkCounter")) {
+    return nullptr;
+  }
+  auto it = active_connections_.find(endpoint_id);
+  if (it == active_connections_.end()) {
+    return nullptr;
+  }
+  return it->second->GetIncomingChunkCounter(payload_id);
+}
+
 void AnalyticsRecorder::OnOutgoingPayloadStarted(
     const std::vector<std::string> &endpoint_ids, std::int64_t payload_id,
     connections::PayloadType type, std::int64_t total_size_bytes) {
@@ -502,7 +517,8 @@ void AnalyticsRecorder::OnOutgoingPayloadStarted(
 
 void AnalyticsRecorder::OnPayloadChunkSent(const std::string &endpoint_id,
                                            std::int64_t payload_id,
-                                           std::int64_t chunk_size_bytes) {
+                                           std::int64_t chunk_size_bytes,
+                                           int num_chunks) {
   MutexLock lock(&mutex_);
   if (!CanRecordAnalyticsLocked("OnPayloadChunkSent")) {
     return;
@@ -512,7 +528,22 @@ void AnalyticsRecorder::OnPayloadChunkSent(const std::string &endpoint_id,
     return;
   }
   const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
-  logical_connection->ChunkSent(payload_id, chunk_size_bytes);
+  logical_connection->ChunkSent(payload_id, chunk_size_bytes, num_chunks);
+}
+
+void AnalyticsRecorder::OnPayloadChunkSizeSelected(
+    const std::string &endpoint_id, std::int64_t payload_id,
+    std::int32_t chunk_size_bytes) {
+  MutexLock lock(&mutex_);
+  if (!CanRecordAnalyticsLocked("OnPayloadChunkSizeSelected")) {
+    return;
+  }
+  auto it = active_connections_.find(endpoint_id);
+  if (it == active_connections_.end()) {
+    return;
+  }
+  const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
+  logical_connection->ChunkSizeSelected(payload_id, chunk_size_bytes);
 }
 
 void AnalyticsRecorder::OnOutgoingPayloadDone(const std::string &endpoint_id,
@@ -530,6 +561,20 @@ void AnalyticsRecorder::OnOutgoingPayloadDone(const std::string &endpoint_id,
   logical_connection->OutgoingPayloadDone(payload_id, status);
 }
 
+std::shared_ptr<AnalyticsRecorder::ChunkCounter>
+AnalyticsRecorder::GetOutgoingChunkCounter(const std::string &endpoint_id,
+                                           std::int64_t payload_id) {
+  MutexLock lock(&mutex_);
+  if (!CanRecordAnalyticsLocked("GetOutgoingChunkCounter")) {
+    return nullptr;
+  }
+  auto it = active_connections_.find(endpoint_id);
+  if (it == active_connections_.end()) {
+    return nullptr;
+  }
+  return it->second->GetOutgoingChunkCounter(payload_id);
+}
+
 void AnalyticsRecorder::OnBandwidthUpgradeStarted(
     const std::string &endpoint_id, Medium from_medium, Medium to_medium,
     ConnectionAttemptDirection direction, const std::string &connection_token) {
@@ -982,12 +1027,6 @@ PayloadType AnalyticsRecorder::PayloadTypeToProtoPayloadType(
   }
 }
 
-void AnalyticsRecorder::PendingPayload::AddChunk(
-    std::int64_t chunk_size_bytes) {
-  num_bytes_transferred_ += chunk_size_bytes;
-  num_chunks_++;
-}
-
 ConnectionsLog::Payload AnalyticsRecorder::PendingPayload::GetProtoPayload(
     PayloadStatus status) {
   ConnectionsLog::Payload payload;
@@ -995,9 +1034,12 @@ ConnectionsLog::Payload AnalyticsRecorder::PendingPayload::GetProtoPayload(
       absl::ToInt64Milliseconds(SystemClock::ElapsedRealtime() - start_time_));
   payload.set_type(type_);
   payload.set_total_size_bytes(total_size_bytes_);
-  payload.set_num_bytes_transferred(num_bytes_transferred_);
-  payload.set_num_chunks(num_chunks_);
+  payload.set_num_bytes_transferred(chunks_->num_bytes() - initial_num_bytes_);
+  payload.set_num_chunks(chunks_->num_chunks() - initial_num_chunks_);
   payload.set_status(status);
+  if (selected_chunk_size_bytes_ > 0) {
+    payload.set_selected_chunk_size_bytes(selected_chunk_size_bytes_);
+  }
 
   return payload;
 }
@@ -1096,13 +1138,13 @@ void AnalyticsRecorder::LogicalConnection::IncomingPayloadStarted(
 }
 
 void AnalyticsRecorder::LogicalConnection::ChunkReceived(
-    std::int64_t payload_id, std::int64_t size_bytes) {
+    std::int64_t payload_id, std::int64_t size_bytes, int num_chunks) {
   auto it = incoming_payloads_.find(payload_id);
   if (it == incoming_payloads_.end()) {
     return;
   }
   PendingPayload *pending_payload = it->second.get();
-  pending_payload->AddChunk(size_bytes);
+  pending_payload->AddChunks(size_bytes, num_chunks);
 }
 
 void AnalyticsRecorder::LogicalConnection::IncomingPayloadDone(
@@ -1132,13 +1174,23 @@ void AnalyticsRecorder::LogicalConnection::OutgoingPayloadStarted(
 }
 
 void AnalyticsRecorder::LogicalConnection::ChunkSent(std::int64_t payload_id,
-                                                     std::int64_t size_bytes) {
+                                                     std::int64_t size_bytes,
+                                                     int num_chunks) {
   auto it = outgoing_payloads_.find(payload_id);
   if (it == outgoing_payloads_.end()) {
     return;
   }
   PendingPayload *payload = it->second.get();
-  payload->AddChunk(size_bytes);
+  payload->AddChunks(size_bytes, num_chunks);
+}
+
+void AnalyticsRecorder::LogicalConnection::ChunkSizeSelected(
+    std::int64_t payload_id, std::int32_t chunk_size_bytes) {
+  auto it = outgoing_payloads_.find(payload_id);
+  if (it == outgoing_payloads_.end()) {
+    return;
+  }
+  it->second->set_selected_chunk_size_bytes(chunk_size_bytes);
 }
 
 void AnalyticsRecorder::LogicalConnection::OutgoingPayloadDone(
@@ -1161,6 +1213,20 @@ void AnalyticsRecorder::LogicalConnection::OutgoingPayloadDone(
   }
 }
 
+std::shared_ptr<AnalyticsRecorder::ChunkCounter>
+AnalyticsRecorder::LogicalConnection::GetIncomingChunkCounter(
+    std::int64_t payload_id) const {
+  auto it = incoming_payloads_.find(payload_id);
+  return it != incoming_payloads_.end() ? it->second->chunks() : nullptr;
+}
+
+std::shared_ptr<AnalyticsRecorder::ChunkCounter>
+AnalyticsRecorder::LogicalConnection::GetOutgoingChunkCounter(
+    std::int64_t payload_id) const {
+  auto it = outgoing_payloads_.find(payload_id);
+  return it != outgoing_payloads_.end() ? it->second->chunks() : nullptr;
+}
+
 void AnalyticsRecorder::LogicalConnection::FinishPhysicalConnection(
     ConnectionsLog::EstablishedConnection *established_connection,
     DisconnectionReason reason) {
@@ -1201,7 +1267,8 @@ AnalyticsRecorder::LogicalConnection::ResolvePendingPayloads(
       upgraded_payloads.insert(
           {item.first,
            std::make_unique<PendingPayload>(
-               pending_payload->type(), pending_payload->total_size_bytes())});
+               pending_payload->type(), pending_payload->total_size_bytes(),
+               pending_payload->chunks())});
     }
   }
   pending_payloads.clear();
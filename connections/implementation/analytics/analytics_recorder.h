@@ -15,6 +15,7 @@
 #ifndef ANALYTICS_ANALYTICS_RECORDER_H_
 #define ANALYTICS_ANALYTICS_RECORDER_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <utility>
@@ -37,6 +38,28 @@ namespace analytics {
 
 class AnalyticsRecorder {
  public:
+  // Chunks of a payload transferred to or from one endpoint, counted without
+  // taking the recorder's lock. The counts are read into the Payload proto once
+  // the payload is done, or its connection closed.
+  class ChunkCounter {
+   public:
+    void Add(std::int64_t chunk_size_bytes, int num_chunks = 1) {
+      num_bytes_.fetch_add(chunk_size_bytes, std::memory_order_relaxed);
+      num_chunks_.fetch_add(num_chunks, std::memory_order_relaxed);
+    }
+
+    std::int64_t num_bytes() const {
+      return num_bytes_.load(std::memory_order_relaxed);
+    }
+    int num_chunks() const {
+      return num_chunks_.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<std::int64_t> num_bytes_ = 0;
+    std::atomic<int> num_chunks_ = 0;
+  };
+
   explicit AnalyticsRecorder(::nearby::analytics::EventLogger *event_logger);
   virtual ~AnalyticsRecorder();
 
@@ -123,27 +146,45 @@ class AnalyticsRecorder {
                                 connections::PayloadType type,
                                 std::int64_t total_size_bytes)
       ABSL_LOCKS_EXCLUDED(mutex_);
+  // Records |num_chunks| chunks, of |chunk_size_bytes| bytes all together.
   void OnPayloadChunkReceived(const std::string &endpoint_id,
                               std::int64_t payload_id,
-                              std::int64_t chunk_size_bytes)
-      ABSL_LOCKS_EXCLUDED(mutex_);
+                              std::int64_t chunk_size_bytes,
+                              int num_chunks = 1) ABSL_LOCKS_EXCLUDED(mutex_);
   void OnIncomingPayloadDone(
       const std::string &endpoint_id, std::int64_t payload_id,
       location::nearby::proto::connections::PayloadStatus status)
       ABSL_LOCKS_EXCLUDED(mutex_);
+  // Returns the counter that chunks of the incoming payload can be added to
+  // instead of calling OnPayloadChunkReceived(), or nullptr if the payload
+  // isn't recorded. The counter stays valid across bandwidth upgrades.
+  std::shared_ptr<ChunkCounter> GetIncomingChunkCounter(
+      const std::string &endpoint_id, std::int64_t payload_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
   void OnOutgoingPayloadStarted(const std::vector<std::string> &endpoint_ids,
                                 std::int64_t payload_id,
                                 connections::PayloadType type,
                                 std::int64_t total_size_bytes)
       ABSL_LOCKS_EXCLUDED(mutex_);
+  // Records |num_chunks| chunks, of |chunk_size_bytes| bytes all together.
   void OnPayloadChunkSent(const std::string &endpoint_id,
                           std::int64_t payload_id,
-                          std::int64_t chunk_size_bytes)
+                          std::int64_t chunk_size_bytes, int num_chunks = 1)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Records the chunk size currently picked for sending to the endpoint.
+  void OnPayloadChunkSizeSelected(const std::string &endpoint_id,
+                                  std::int64_t payload_id,
+                                  std::int32_t chunk_size_bytes)
       ABSL_LOCKS_EXCLUDED(mutex_);
   void OnOutgoingPayloadDone(
       const std::string &endpoint_id, std::int64_t payload_id,
       location::nearby::proto::connections::PayloadStatus status)
       ABSL_LOCKS_EXCLUDED(mutex_);
+  // Like GetIncomingChunkCounter(), for chunks that OnPayloadChunkSent() would
+  // record.
+  std::shared_ptr<ChunkCounter> GetOutgoingChunkCounter(
+      const std::string &endpoint_id, std::int64_t payload_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
 
   // BandwidthUpgrade
   void OnBandwidthUpgradeStarted(
@@ -175,14 +216,27 @@ class AnalyticsRecorder {
    public:
     PendingPayload(location::nearby::proto::connections::PayloadType type,
                    std::int64_t total_size_bytes)
+        : PendingPayload(type, total_size_bytes,
+                         std::make_shared<ChunkCounter>()) {}
+    // Counts the chunks added to |chunks| from now on.
+    PendingPayload(location::nearby::proto::connections::PayloadType type,
+                   std::int64_t total_size_bytes,
+                   std::shared_ptr<ChunkCounter> chunks)
         : start_time_(SystemClock::ElapsedRealtime()),
           type_(type),
           total_size_bytes_(total_size_bytes),
-          num_bytes_transferred_(0),
-          num_chunks_(0) {}
+          chunks_(std::move(chunks)),
+          initial_num_bytes_(chunks_->num_bytes()),
+          initial_num_chunks_(chunks_->num_chunks()) {}
     ~PendingPayload() = default;
 
-    void AddChunk(std::int64_t chunk_size_bytes);
+    void AddChunks(std::int64_t chunk_size_bytes, int num_chunks) {
+      chunks_->Add(chunk_size_bytes, num_chunks);
+    }
+    const std::shared_ptr<ChunkCounter> &chunks() const { return chunks_; }
+    void set_selected_chunk_size_bytes(std::int32_t chunk_size_bytes) {
+      selected_chunk_size_bytes_ = chunk_size_bytes;
+    }
 
     proto::ConnectionsLog::Payload GetProtoPayload(
         location::nearby::proto::connections::PayloadStatus status);
@@ -197,8 +251,11 @@ class AnalyticsRecorder {
     absl::Time start_time_;
     location::nearby::proto::connections::PayloadType type_;
     std::int64_t total_size_bytes_;
-    std::int64_t num_bytes_transferred_;
-    int num_chunks_;
+    // Shared with whoever adds chunks without the recorder's lock.
+    std::shared_ptr<ChunkCounter> chunks_;
+    std::int64_t initial_num_bytes_;
+    int initial_num_chunks_;
+    std::int32_t selected_chunk_size_bytes_ = 0;
   };
 
   class LogicalConnection {
@@ -230,7 +287,8 @@ class AnalyticsRecorder {
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadType type,
         std::int64_t total_size_bytes);
-    void ChunkReceived(std::int64_t payload_id, std::int64_t size_bytes);
+    void ChunkReceived(std::int64_t payload_id, std::int64_t size_bytes,
+                       int num_chunks);
     void IncomingPayloadDone(
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadStatus status);
@@ -238,10 +296,17 @@ class AnalyticsRecorder {
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadType type,
         std::int64_t total_size_bytes);
-    void ChunkSent(std::int64_t payload_id, std::int64_t size_bytes);
+    void ChunkSent(std::int64_t payload_id, std::int64_t size_bytes,
+                   int num_chunks);
+    void ChunkSizeSelected(std::int64_t payload_id,
+                           std::int32_t chunk_size_bytes);
     void OutgoingPayloadDone(
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadStatus status);
+    std::shared_ptr<ChunkCounter> GetIncomingChunkCounter(
+        std::int64_t payload_id) const;
+    std::shared_ptr<ChunkCounter> GetOutgoingChunkCounter(
+        std::int64_t payload_id) const;
 
     std::vector<proto::ConnectionsLog::EstablishedConnection>
     GetEstablisedConnections();
@@ -14,6 +14,7 @@
 
 #include "connections/implementation/analytics/analytics_recorder.h"
 
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -786,6 +787,72 @@ TEST(AnalyticsRecorderTest, OutgoingPayloadUpgraded) {
                 >)pb")));
 }
 
+TEST(AnalyticsRecorderTest, IncomingPayloadChunkCounterKeptAcrossUpgrade) {
+  connections::Strategy strategy = connections::Strategy::kP2pStar;
+  std::vector<Medium> mediums = {BLE, BLUETOOTH};
+  std::string endpoint_id = "endpoint_id";
+  std::int64_t payload_id = 123456789;
+  std::string connection_token = "connection_token";
+
+  CountDownLatch client_session_done_latch(1);
+  FakeEventLogger event_logger(client_session_done_latch);
+  AnalyticsRecorder analytics_recorder(&event_logger);
+
+  analytics_recorder.OnStartDiscovery(strategy, mediums);
+  analytics_recorder.OnConnectionEstablished(endpoint_id, BLUETOOTH,
+                                             connection_token);
+  EXPECT_EQ(analytics_recorder.GetIncomingChunkCounter(endpoint_id, payload_id),
+            nullptr);
+  analytics_recorder.OnIncomingPayloadStarted(
+      endpoint_id, payload_id, connections::PayloadType::kFile, 50);
+  std::shared_ptr<AnalyticsRecorder::ChunkCounter> counter =
+      analytics_recorder.GetIncomingChunkCounter(endpoint_id, payload_id);
+  ASSERT_NE(counter, nullptr);
+  counter->Add(10);
+  counter->Add(10);
+  analytics_recorder.OnConnectionClosed(endpoint_id, BLUETOOTH, UPGRADED);
+  analytics_recorder.OnConnectionEstablished(endpoint_id, WIFI_LAN,
+                                             connection_token);
+  counter->Add(10);
+  analytics_recorder.OnPayloadChunkReceived(endpoint_id, payload_id, 20, 2);
+  analytics_recorder.OnIncomingPayloadDone(endpoint_id, payload_id, SUCCESS);
+  analytics_recorder.OnConnectionClosed(endpoint_id, WIFI_LAN,
+                                        LOCAL_DISCONNECTION);
+
+  analytics_recorder.LogSession();
+  ASSERT_TRUE(client_session_done_latch.Await(kDefaultTimeout).result());
+
+  EXPECT_THAT(event_logger.GetLoggedClientSession(), Partially(EqualsProto(R"pb(
+                strategy_session <
+                  strategy: P2P_STAR
+                  role: DISCOVERER
+                  established_connection <
+                    medium: BLUETOOTH
+                    received_payload <
+                      type: FILE
+                      total_size_bytes: 50
+                      num_bytes_transferred: 20
+                      num_chunks: 2
+                      status: MOVED_TO_NEW_MEDIUM
+                    >
+                    disconnection_reason: UPGRADED
+                    connection_token: "connection_token"
+                  >
+                  established_connection <
+                    medium: WIFI_LAN
+                    received_payload <
+                      type: FILE
+                      total_size_bytes: 50
+                      num_bytes_transferred: 30
+                      num_chunks: 3
+                      status: SUCCESS
+                    >
+                    disconnection_reason: LOCAL_DISCONNECTION
+                    connection_token: "connection_token"
+                  >
+                >)pb")));
+}
+
 TEST(AnalyticsRecorderTest, UpgradeAttemptWorks) {
   connections::Strategy strategy = connections::Strategy::kP2pStar;
   std::vector<Medium> mediums = {BLE, BLUETOOTH};
@@ -15,7 +15,9 @@
 #include "connections/implementation/base_endpoint_channel.h"
 
 #include <cassert>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
@@ -55,8 +57,24 @@ ByteArray IntToBytes(std::int32_t value) {
 }
 
 ExceptionOr<ByteArray> ReadExactly(InputStream* reader, std::int64_t size) {
+  if (size == 0) {
+    return ExceptionOr<ByteArray>(ByteArray());
+  }
+
+  // Most reads are satisfied in one go; hand that chunk back as is instead of
+  // copying it into a freshly allocated buffer.
+  ExceptionOr<ByteArray> first_read = reader->Read(size);
+  if (!first_read.ok() || first_read.result().size() == size) {
+    return first_read;
+  }
+  if (first_read.result().Empty()) {
+    NEARBY_LOGS(WARNING) << __func__ << ": Empty result when reading bytes.";
+    return ExceptionOr<ByteArray>(Exception::kIo);
+  }
+
   ByteArray buffer(size);
-  std::int64_t current_pos = 0;
+  buffer.CopyAt(0, first_read.result());
+  std::int64_t current_pos = first_read.result().size();
 
   while (current_pos < size) {
     ExceptionOr<ByteArray> read_bytes = reader->Read(size - current_pos);
@@ -85,10 +103,6 @@ ExceptionOr<std::int32_t> ReadInt(InputStream* reader) {
   return ExceptionOr<std::int32_t>(BytesToInt(std::move(read_bytes.result())));
 }
 
-Exception WriteInt(OutputStream* writer, std::int32_t value) {
-  return writer->Write(IntToBytes(value));
-}
-
 }  // namespace
 
 BaseEndpointChannel::BaseEndpointChannel(const std::string& service_id,
@@ -123,6 +137,7 @@ BaseEndpointChannel::BaseEndpointChannel(
 
 ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
   ByteArray result;
+  std::shared_ptr<TransferMetrics> transfer_metrics;
   {
     MutexLock lock(&reader_mutex_);
 
@@ -137,11 +152,20 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
       return ExceptionOr<ByteArray>(Exception::kIo);
     }
 
+    // Waiting for the length prefix is idle time; the read is timed from when
+    // the frame started to arrive.
+    absl::Time start_time = SystemClock::ElapsedRealtime();
     ExceptionOr<ByteArray> read_bytes = ReadExactly(reader_, read_int.result());
     if (!read_bytes.ok()) {
       return read_bytes;
     }
     result = std::move(read_bytes.result());
+    transfer_metrics = GetTransferMetrics();
+    if (transfer_metrics) {
+      transfer_metrics->Record(TransferMetrics::Stage::kRead,
+                               SystemClock::ElapsedRealtime() - start_time);
+      transfer_metrics->AddBytesRead(sizeof(std::int32_t) + result.size());
+    }
   }
 
   {
@@ -149,8 +173,13 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
     if (IsEncryptionEnabledLocked()) {
       // If encryption is enabled, decode the message.
       std::string input(std::move(result));
+      absl::Time start_time = SystemClock::ElapsedRealtime();
       std::unique_ptr<std::string> decrypted_data =
           crypto_context_->DecodeMessageFromPeer(input);
+      if (transfer_metrics) {
+        transfer_metrics->Record(TransferMetrics::Stage::kDecrypt,
+                                 SystemClock::ElapsedRealtime() - start_time);
+      }
       if (decrypted_data) {
         result = ByteArray(std::move(*decrypted_data));
       } else {
@@ -167,7 +196,7 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
             NEARBY_LOGS(INFO)
                 << __func__
                 << ": Read unencrypted KEEP_ALIVE on encrypted channel.";
-            result = ByteArray(input);
+            result = ByteArray(std::move(input));
           } else {
             NEARBY_LOGS(WARNING)
                 << __func__ << ": Read unexpected unencrypted frame of type "
@@ -193,6 +222,10 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
 }
 
 Exception BaseEndpointChannel::Write(const ByteArray& data) {
+  return WriteBatch(absl::MakeConstSpan(&data, 1));
+}
+
+Exception BaseEndpointChannel::WriteBatch(absl::Span<const ByteArray> frames) {
   {
     MutexLock pause_lock(&is_paused_mutex_);
     if (is_paused_) {
@@ -200,53 +233,92 @@ Exception BaseEndpointChannel::Write(const ByteArray& data) {
     }
   }
 
-  ByteArray encrypted_data;
-  const ByteArray* data_to_write = &data;
+  // Frames that fit in one packet together go out in a single IO; a frame
+  // larger than that is written on its own.
+  std::shared_ptr<TransferMetrics> transfer_metrics = GetTransferMetrics();
+  const size_t max_io_size = GetMaxTransmitPacketSize();
+  size_t begin = 0;
+  while (begin < frames.size()) {
+    size_t end = begin + 1;
+    size_t io_size = sizeof(std::int32_t) + frames[begin].size();
+    while (end < frames.size() &&
+           io_size + sizeof(std::int32_t) + frames[end].size() <=
+               max_io_size) {
+      io_size += sizeof(std::int32_t) + frames[end].size();
+      ++end;
+    }
+    Exception exception = WriteRecords(frames.subspan(begin, end - begin),
+                                       transfer_metrics.get());
+    if (!exception.Ok()) return exception;
+    begin = end;
+  }
+
+  {
+    MutexLock lock(&last_write_mutex_);
+    last_write_timestamp_ = SystemClock::ElapsedRealtime();
+  }
+  return {Exception::kSuccess};
+}
+
+Exception BaseEndpointChannel::WriteRecords(absl::Span<const ByteArray> frames,
+                                            TransferMetrics* transfer_metrics) {
+  // Length prefixes interleaved with the frames, as they go on the wire.
+  std::vector<ByteArray> io;
+  io.reserve(frames.size() * 2);
+  size_t io_size = 0;
+
+  // Holding both mutexes is necessary to prevent the keep alive and payload
+  // threads from writing encrypted messages out of order which causes a
+  // failure to decrypt on the reader side. However we need to release the
+  // crypto lock after encrypting to ensure read decryption is not blocked.
+  MutexLock lock(&writer_mutex_);
   {
-    // Holding both mutexes is necessary to prevent the keep alive and payload
-    // threads from writing encrypted messages out of order which causes a
-    // failure to decrypt on the reader side. However we need to release the
-    // crypto lock after encrypting to ensure read decryption is not blocked.
-    MutexLock lock(&writer_mutex_);
-    {
-      MutexLock crypto_lock(&crypto_mutex_);
-      if (IsEncryptionEnabledLocked()) {
-        // If encryption is enabled, encode the message.
+    MutexLock crypto_lock(&crypto_mutex_);
+    bool encrypt = IsEncryptionEnabledLocked();
+    for (const ByteArray& frame : frames) {
+      ByteArray record = frame;
+      if (encrypt) {
+        absl::Time start_time = SystemClock::ElapsedRealtime();
+        const std::string* whole = frame.GetWholeString();
         std::unique_ptr<std::string> encrypted =
-            crypto_context_->EncodeMessageToPeer(std::string(data));
+            whole ? crypto_context_->EncodeMessageToPeer(*whole)
+                  : crypto_context_->EncodeMessageToPeer(std::string(frame));
+        if (transfer_metrics) {
+          transfer_metrics->Record(
+              TransferMetrics::Stage::kEncrypt,
+              SystemClock::ElapsedRealtime() - start_time);
+        }
         if (!encrypted) {
           NEARBY_LOGS(WARNING) << __func__ << ": Failed to encrypt data.";
           return {Exception::kIo};
         }
-        encrypted_data = ByteArray(std::move(*encrypted));
-        data_to_write = &encrypted_data;
+        record = ByteArray(std::move(*encrypted));
       }
-    }
-
-    Exception write_exception =
-        WriteInt(writer_, static_cast<std::int32_t>(data_to_write->size()));
-    if (write_exception.Raised()) {
-      NEARBY_LOGS(WARNING) << __func__ << ": Failed to write header: "
-                           << write_exception.value;
-      return write_exception;
-    }
-    write_exception = writer_->Write(*data_to_write);
-    if (write_exception.Raised()) {
-      NEARBY_LOGS(WARNING) << __func__ << ": Failed to write data: "
-                           << write_exception.value;
-      return write_exception;
-    }
-    Exception flush_exception = writer_->Flush();
-    if (flush_exception.Raised()) {
-      NEARBY_LOGS(WARNING) << __func__ << ": Failed to flush writer: "
-                           << flush_exception.value;
-      return flush_exception;
+      io_size += sizeof(std::int32_t) + record.size();
+      io.push_back(IntToBytes(static_cast<std::int32_t>(record.size())));
+      io.push_back(std::move(record));
     }
   }
 
-  {
-    MutexLock lock(&last_write_mutex_);
-    last_write_timestamp_ = SystemClock::ElapsedRealtime();
+  // Hand the length prefixes and the records to the writer in one call, so
+  // the stream can put all of them on the wire in a single IO operation.
+  absl::Time start_time = SystemClock::ElapsedRealtime();
+  Exception write_exception = writer_->WriteV(io);
+  if (write_exception.Raised()) {
+    NEARBY_LOGS(WARNING) << __func__ << ": Failed to write data: "
+                         << write_exception.value;
+    return write_exception;
+  }
+  Exception flush_exception = writer_->Flush();
+  if (flush_exception.Raised()) {
+    NEARBY_LOGS(WARNING) << __func__ << ": Failed to flush writer: "
+                         << flush_exception.value;
+    return flush_exception;
+  }
+  if (transfer_metrics) {
+    transfer_metrics->Record(TransferMetrics::Stage::kWrite,
+                             SystemClock::ElapsedRealtime() - start_time);
+    transfer_metrics->AddBytesWritten(io_size);
   }
   return {Exception::kSuccess};
 }
@@ -290,6 +362,21 @@ void BaseEndpointChannel::SetAnalyticsRecorder(
     const std::string& endpoint_id) {
   analytics_recorder_ = analytics_recorder;
   endpoint_id_ = endpoint_id;
+  auto transfer_metrics =
+      std::make_shared<TransferMetrics>(endpoint_id, GetMedium());
+  MutexLock lock(&metrics_mutex_);
+  transfer_metrics_ = std::move(transfer_metrics);
+}
+
+std::shared_ptr<TransferMetrics> BaseEndpointChannel::GetTransferMetrics() {
+  MutexLock lock(&metrics_mutex_);
+  return transfer_metrics_;
+}
+
+int BaseEndpointChannel::GetReadinessFd() {
+  // Not under reader_mutex_, which a blocked Read() holds; |reader_| itself
+  // never changes.
+  return reader_ ? reader_->GetReadinessFd() : -1;
 }
 
 void BaseEndpointChannel::Close(
@@ -21,8 +21,10 @@
 
 #include "securegcm/d2d_connection_context_v1.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/types/span.h"
 #include "connections/implementation/analytics/analytics_recorder.h"
 #include "connections/implementation/endpoint_channel.h"
+#include "connections/implementation/transfer_metrics.h"
 #include "internal/platform/atomic_reference.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/condition_variable.h"
@@ -37,6 +39,10 @@ namespace connections {
 
 class BaseEndpointChannel : public EndpointChannel {
  public:
+  // Used to sanity check that our frame sizes are reasonable. Peers reject
+  // larger frames, so senders must not exceed it either.
+  static constexpr std::int32_t kMaxAllowedReadBytes = 1048576;  // 1MB
+
   BaseEndpointChannel(const std::string& service_id,
                       const std::string& channel_name, InputStream* reader,
                       OutputStream* writer);
@@ -54,6 +60,10 @@ class BaseEndpointChannel : public EndpointChannel {
                           last_read_mutex_) override;
   Exception Write(const ByteArray& data)
       ABSL_LOCKS_EXCLUDED(writer_mutex_, crypto_mutex_) override;
+  // Seals the frames that fit in GetMaxTransmitPacketSize() together and
+  // writes them with one WriteV() and Flush().
+  Exception WriteBatch(absl::Span<const ByteArray> frames)
+      ABSL_LOCKS_EXCLUDED(writer_mutex_, crypto_mutex_) override;
   void Close() ABSL_LOCKS_EXCLUDED(is_paused_mutex_) override;
   void Close(proto::connections::DisconnectionReason reason) override;
   std::string GetType() const override;
@@ -75,19 +85,24 @@ class BaseEndpointChannel : public EndpointChannel {
       ABSL_LOCKS_EXCLUDED(last_write_mutex_) override;
   void SetAnalyticsRecorder(analytics::AnalyticsRecorder* analytics_recorder,
                             const std::string& endpoint_id) override;
+  int GetReadinessFd() ABSL_NO_THREAD_SAFETY_ANALYSIS override;
+  std::shared_ptr<TransferMetrics> GetTransferMetrics()
+      ABSL_LOCKS_EXCLUDED(metrics_mutex_) override;
 
  protected:
   virtual void CloseImpl() = 0;
 
  private:
-  // Used to sanity check that our frame sizes are reasonable.
-  static constexpr std::int32_t kMaxAllowedReadBytes = 1048576;  // 1MB
-
   // The default maximum transmit unit/packet size.
   static constexpr int kDefaultMaxTransmitPacketSize = 65536;  // 64 KB
 
   bool IsEncryptionEnabledLocked() const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(crypto_mutex_);
+  // Writes |frames|, which go out in one IO.
+  Exception WriteRecords(absl::Span<const ByteArray> frames,
+                         TransferMetrics* transfer_metrics)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mutex_)
+          ABSL_LOCKS_EXCLUDED(crypto_mutex_);
   void UnblockPausedWriter() ABSL_EXCLUSIVE_LOCKS_REQUIRED(is_paused_mutex_);
   void BlockUntilUnpaused() ABSL_EXCLUSIVE_LOCKS_REQUIRED(is_paused_mutex_);
   void CloseIo() ABSL_NO_THREAD_SAFETY_ANALYSIS;
@@ -133,6 +148,12 @@ class BaseEndpointChannel : public EndpointChannel {
 
   analytics::AnalyticsRecorder* analytics_recorder_ = nullptr;
   std::string endpoint_id_ = "";
+
+  // Set along with the endpoint, so frames of the handshake before that
+  // aren't timed.
+  mutable Mutex metrics_mutex_;
+  std::shared_ptr<TransferMetrics> transfer_metrics_
+      ABSL_GUARDED_BY(metrics_mutex_);
 };
 
 }  // namespace connections
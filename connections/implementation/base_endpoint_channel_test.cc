@@ -17,6 +17,7 @@
 #include <functional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "securegcm/d2d_connection_context_v1.h"
 #include "securegcm/ukey2_handshake.h"
@@ -33,6 +34,7 @@
 #include "internal/platform/output_stream.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/metrics_registry.h"
 #include "internal/platform/multi_thread_executor.h"
 #include "internal/platform/pipe.h"
 #include "internal/platform/single_thread_executor.h"
@@ -179,6 +181,101 @@ TEST(BaseEndpointChannelTest, ReadWrite) {
   EXPECT_EQ(rx_message, tx_message);
 }
 
+TEST(BaseEndpointChannelTest, TimesFramesOnceGivenToEndpoint) {
+  Pipe pipe_a;  // channel_a writes to pipe_a, reads from pipe_b.
+  Pipe pipe_b;  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(&pipe_b.GetInputStream(),
+                                &pipe_a.GetOutputStream());
+  TestEndpointChannel channel_b(&pipe_a.GetInputStream(),
+                                &pipe_b.GetOutputStream());
+  ON_CALL(channel_a, GetMedium).WillByDefault([]() {
+    return Medium::BLUETOOTH;
+  });
+  ON_CALL(channel_b, GetMedium).WillByDefault([]() {
+    return Medium::BLUETOOTH;
+  });
+  ByteArray tx_message{"data message"};
+  channel_a.Write(tx_message);
+  channel_b.Read();
+  EXPECT_EQ(channel_a.GetTransferMetrics(), nullptr);
+
+  channel_a.SetAnalyticsRecorder(nullptr, "TIMA");
+  channel_b.SetAnalyticsRecorder(nullptr, "TIMB");
+  ASSERT_NE(channel_a.GetTransferMetrics(), nullptr);
+  channel_a.Write(tx_message);
+  channel_b.Read();
+
+  const MetricLabels labels_a{{"endpoint_id", "TIMA"},
+                              {"medium", "BLUETOOTH"}};
+  const MetricLabels labels_b{{"endpoint_id", "TIMB"},
+                              {"medium", "BLUETOOTH"}};
+  MetricsSnapshot snapshot = MetricsRegistry::GetInstance().GetSnapshot();
+  int found = 0;
+  for (const auto& histogram : snapshot.histograms) {
+    if (histogram.labels == labels_a &&
+        histogram.name == "connections/transfer/write") {
+      EXPECT_EQ(histogram.value.count, 1);
+      ++found;
+    }
+    if (histogram.labels == labels_b &&
+        histogram.name == "connections/transfer/read") {
+      EXPECT_EQ(histogram.value.count, 1);
+      ++found;
+    }
+  }
+  for (const auto& counter : snapshot.counters) {
+    if (counter.labels == labels_a &&
+        counter.name == "connections/transfer/bytes_written") {
+      EXPECT_EQ(counter.value, 4 + tx_message.size());
+      ++found;
+    }
+  }
+  EXPECT_EQ(found, 3);
+}
+
+TEST(BaseEndpointChannelTest, WritesBatchInPacketSizedIos) {
+  Pipe pipe_a;  // channel_a writes to pipe_a, reads from pipe_b.
+  Pipe pipe_b;  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(&pipe_b.GetInputStream(),
+                                &pipe_a.GetOutputStream());
+  TestEndpointChannel channel_b(&pipe_a.GetInputStream(),
+                                &pipe_b.GetOutputStream());
+  ON_CALL(channel_a, GetMedium).WillByDefault([]() {
+    return Medium::BLUETOOTH;
+  });
+  channel_a.SetAnalyticsRecorder(nullptr, "BATA");
+
+  // The first three frames fit in one 64 KB packet, the last one does not.
+  std::vector<ByteArray> tx_messages{
+      ByteArray{"first"}, ByteArray{"second"},
+      ByteArray{std::string(40000, 'x')}, ByteArray{std::string(40000, 'y')}};
+  ASSERT_TRUE(channel_a.WriteBatch(tx_messages).Ok());
+  std::int64_t bytes_written = 0;
+  for (const ByteArray& tx_message : tx_messages) {
+    EXPECT_EQ(channel_b.Read().result(), tx_message);
+    bytes_written += 4 + tx_message.size();
+  }
+
+  const MetricLabels labels{{"endpoint_id", "BATA"}, {"medium", "BLUETOOTH"}};
+  MetricsSnapshot snapshot = MetricsRegistry::GetInstance().GetSnapshot();
+  int found = 0;
+  for (const auto& histogram : snapshot.histograms) {
+    if (histogram.labels == labels &&
+        histogram.name == "connections/transfer/write") {
+      EXPECT_EQ(histogram.value.count, 2);
+      ++found;
+    }
+  }
+  for (const auto& counter : snapshot.counters) {
+    if (counter.labels == labels &&
+        counter.name == "connections/transfer/bytes_written") {
+      EXPECT_EQ(counter.value, bytes_written);
+      ++found;
+    }
+  }
+  EXPECT_EQ(found, 2);
+}
+
 TEST(BaseEndpointChannelTest, NotEncryptedReadWriteCanBeIntercepted) {
   // Not encrypted IO; MITM scenario.
 
@@ -404,6 +501,34 @@ TEST(BaseEndpointChannelTest, ReadUnencryptedFrameOnEncryptedChannel) {
   channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
 }
 
+TEST(BaseEndpointChannelTest, EncryptedBatchCanBeRead) {
+  Pipe pipe_a;  // channel_a writes to pipe_a, reads from pipe_b.
+  Pipe pipe_b;  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(&pipe_b.GetInputStream(),
+                                &pipe_a.GetOutputStream());
+  TestEndpointChannel channel_b(&pipe_a.GetInputStream(),
+                                &pipe_b.GetOutputStream());
+  auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
+  ASSERT_NE(context_a, nullptr);
+  ASSERT_NE(context_b, nullptr);
+  channel_a.EnableEncryption(context_a);
+  channel_b.EnableEncryption(context_b);
+
+  // A slice of a larger ByteArray is sealed as well as a whole one.
+  ByteArray whole{"first message, second message"};
+  std::vector<ByteArray> tx_messages{whole.Slice(0, 13),
+                                     whole.Slice(15, 14), whole};
+  ASSERT_TRUE(channel_a.WriteBatch(tx_messages).Ok());
+  for (const ByteArray& tx_message : tx_messages) {
+    ExceptionOr<ByteArray> result = channel_b.Read();
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(result.result(), tx_message);
+  }
+
+  channel_a.Close(DisconnectionReason::LOCAL_DISCONNECTION);
+  channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
@@ -32,14 +32,31 @@
 #include "connections/implementation/offline_frames.h"
 #include "internal/platform/base64_utils.h"
 #include "internal/platform/bluetooth_utils.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/tracing.h"
 
 namespace location {
 namespace nearby {
 namespace connections {
 
+using ::securegcm::D2DConnectionContextV1;
 using ::securegcm::UKey2Handshake;
 
+namespace {
+
+constexpr char kTraceCategory[] = "connections";
+
+TraceArgs GetConnectionTraceArgs(const std::string& endpoint_id,
+                                 proto::connections::Medium medium,
+                                 bool is_incoming) {
+  return {{"endpoint_id", endpoint_id},
+          {"medium", proto::connections::Medium_Name(medium)},
+          {"direction", is_incoming ? "incoming" : "outgoing"}};
+}
+
+}  // namespace
+
 constexpr absl::Duration BasePcpHandler::kConnectionRequestReadTimeout;
 constexpr absl::Duration BasePcpHandler::kRejectedConnectionCloseDelay;
 
@@ -249,6 +266,8 @@ Status BasePcpHandler::StartDiscovery(ClientProxy* client,
         client->StartedDiscovery(service_id, GetStrategy(), listener,
                                  absl::MakeSpan(result.mediums),
                                  discovery_options);
+        NEARBY_TRACE_ASYNC_BEGIN(kTraceCategory, "discovery", service_id,
+                                 {{"service_id", service_id}});
         response.Set({Status::kSuccess});
       });
   return WaitForResult(absl::StrCat("StartDiscovery(", service_id, ")"),
@@ -259,6 +278,9 @@ void BasePcpHandler::StopDiscovery(ClientProxy* client) {
   CountDownLatch latch(1);
   RunOnPcpHandlerThread("stop-discovery",
                         [this, client, &latch]() RUN_ON_PCP_HANDLER_THREAD() {
+                          NEARBY_TRACE_ASYNC_END(
+                              kTraceCategory, "discovery",
+                              client->GetDiscoveryServiceId());
                           StopDiscoveryImpl(client);
                           client->StoppedDiscovery();
                           latch.CountDown();
@@ -328,6 +350,22 @@ EncryptionRunner::ResultListener BasePcpHandler::GetResultListener() {
                  raw_auth_token]() RUN_ON_PCP_HANDLER_THREAD() mutable {
                   OnEncryptionSuccessRunnable(
                       endpoint_id, std::unique_ptr<UKey2Handshake>(raw_ukey2),
+                      nullptr, auth_token, raw_auth_token);
+                });
+          },
+      .on_resumed_cb =
+          [this](const std::string& endpoint_id,
+                 std::unique_ptr<D2DConnectionContextV1> context,
+                 const std::string& auth_token,
+                 const ByteArray& raw_auth_token) {
+            RunOnPcpHandlerThread(
+                "encryption-resumed",
+                [this, endpoint_id, raw_context = context.release(),
+                 auth_token,
+                 raw_auth_token]() RUN_ON_PCP_HANDLER_THREAD() mutable {
+                  OnEncryptionSuccessRunnable(
+                      endpoint_id, nullptr,
+                      std::unique_ptr<D2DConnectionContextV1>(raw_context),
                       auth_token, raw_auth_token);
                 });
           },
@@ -348,6 +386,7 @@ EncryptionRunner::ResultListener BasePcpHandler::GetResultListener() {
 
 void BasePcpHandler::OnEncryptionSuccessRunnable(
     const std::string& endpoint_id, std::unique_ptr<UKey2Handshake> ukey2,
+    std::unique_ptr<D2DConnectionContextV1> resumed_context,
     const std::string& auth_token, const ByteArray& raw_auth_token) {
   // Quick fail if we've been removed from pending connections while we were
   // busy running UKEY2.
@@ -362,7 +401,7 @@ void BasePcpHandler::OnEncryptionSuccessRunnable(
   BasePcpHandler::PendingConnectionInfo& connection_info = it->second;
   Medium medium = connection_info.channel->GetMedium();
 
-  if (!ukey2) {
+  if (!ukey2 && !resumed_context) {
     // Fail early, if there is no crypto context.
     ProcessPreConnectionInitiationFailure(
         connection_info.client, medium, endpoint_id,
@@ -372,7 +411,16 @@ void BasePcpHandler::OnEncryptionSuccessRunnable(
     return;
   }
 
-  connection_info.SetCryptoContext(std::move(ukey2));
+  if (resumed_context) {
+    connection_info.SetCryptoContext(std::move(resumed_context));
+  } else {
+    connection_info.SetCryptoContext(std::move(ukey2));
+  }
+  connection_info.auth_token = auth_token;
+  connection_info.raw_auth_token = raw_auth_token;
+  // Both sides now have to accept the connection.
+  NEARBY_TRACE_ASYNC_BEGIN(kTraceCategory, "accept", endpoint_id,
+                           {{"endpoint_id", endpoint_id}});
   connection_info.connection_token = GetHashedConnectionToken(raw_auth_token);
   NEARBY_LOGS(INFO)
       << "Register encrypted connection; wait for response; endpoint_id="
@@ -553,7 +601,15 @@ Status BasePcpHandler::RequestConnection(
           if (!MediumSupportedByClientOptions(connect_endpoint->medium,
                                               connection_options))
             continue;
+          NEARBY_TRACE_ASYNC_BEGIN(
+              kTraceCategory, "medium_connect", endpoint_id,
+              {{"endpoint_id", endpoint_id},
+               {"medium",
+                proto::connections::Medium_Name(connect_endpoint->medium)}});
           connect_impl_result = ConnectImpl(client, connect_endpoint);
+          NEARBY_TRACE_ASYNC_END(
+              kTraceCategory, "medium_connect", endpoint_id,
+              {{"status", connect_impl_result.status.ToString()}});
           if (connect_impl_result.status.Ok()) {
             channel = std::move(connect_impl_result.endpoint_channel);
             break;
@@ -618,6 +674,10 @@ Status BasePcpHandler::RequestConnection(
             pending_connections_
                 .emplace(endpoint_id, std::move(pendingConnectionInfo))
                 .first->second.channel.get();
+        NEARBY_TRACE_ASYNC_BEGIN(
+            kTraceCategory, "connection", endpoint_id,
+            GetConnectionTraceArgs(endpoint_id, channel_medium,
+                                   /* is_incoming = */ false));
 
         NEARBY_LOGS(INFO) << "Initiating secure connection: endpoint_id="
                           << endpoint_id;
@@ -758,12 +818,25 @@ void BasePcpHandler::ProcessPreConnectionInitiationFailure(
   // result is hold inside a swapper, and saved in PendingConnectionInfo.
   // PendingConnectionInfo destructor will clear the memory of SettableFuture
   // shared_ptr for result.
-  pending_connections_.erase(endpoint_id);
+  auto it = pending_connections_.find(endpoint_id);
+  if (it != pending_connections_.end()) {
+    if (it->second.ukey2 || it->second.resumed_context) {
+      NEARBY_TRACE_ASYNC_END(kTraceCategory, "accept", endpoint_id);
+    }
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, "connection", endpoint_id,
+                           {{"status", status.ToString()}});
+    pending_connections_.erase(it);
+  }
 }
 
 void BasePcpHandler::ProcessPreConnectionResultFailure(
     ClientProxy* client, const std::string& endpoint_id) {
   auto item = pending_connections_.extract(endpoint_id);
+  if (item) {
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, "accept", endpoint_id);
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, "connection", endpoint_id,
+                           {{"status", Status{Status::kError}.ToString()}});
+  }
   endpoint_manager_->DiscardEndpoint(client, endpoint_id);
   client->OnConnectionRejected(endpoint_id, {Status::kError});
 }
@@ -823,7 +896,10 @@ Status BasePcpHandler::AcceptConnection(
         }
 
         Exception write_exception =
-            channel->Write(parser::ForConnectionResponse(Status::kSuccess));
+            channel->Write(parser::ForConnectionResponse(
+                Status::kSuccess, FeatureFlags::GetInstance()
+                                      .GetFlags()
+                                      .enable_session_resumption));
         if (!write_exception.Ok()) {
           NEARBY_LOGS(INFO)
               << "AcceptConnection: failed to send response: endpoint_id="
@@ -837,6 +913,8 @@ Status BasePcpHandler::AcceptConnection(
                           << endpoint_id;
         connection_info.LocalEndpointAcceptedConnection(endpoint_id,
                                                         payload_listener);
+        NEARBY_TRACE_INSTANT(kTraceCategory, "local_accepted",
+                             {{"endpoint_id", endpoint_id}});
         EvaluateConnectionResult(client, endpoint_id,
                                  false /* can_close_immediately */);
         response.Set({Status::kSuccess});
@@ -922,6 +1000,11 @@ void BasePcpHandler::OnIncomingFrame(OfflineFrame& frame,
 
         const ConnectionResponseFrame& connection_response =
             frame.v1().connection_response();
+        if (auto it = pending_connections_.find(endpoint_id);
+            it != pending_connections_.end()) {
+          it->second.remote_supports_session_resumption =
+              connection_response.supports_session_resumption();
+        }
 
         // For backward compatible, here still check both status and
         // response parameters until the response feature is roll out in all
@@ -938,11 +1021,15 @@ void BasePcpHandler::OnIncomingFrame(OfflineFrame& frame,
               << "OnConnectionResponse: remote accepted; endpoint_id="
               << endpoint_id;
           client->RemoteEndpointAcceptedConnection(endpoint_id);
+          NEARBY_TRACE_INSTANT(kTraceCategory, "remote_accepted",
+                               {{"endpoint_id", endpoint_id}});
         } else {
           NEARBY_LOGS(INFO)
               << "OnConnectionResponse: remote rejected; endpoint_id="
               << endpoint_id << "; status=" << connection_response.status();
           client->RemoteEndpointRejectedConnection(endpoint_id);
+          NEARBY_TRACE_INSTANT(kTraceCategory, "remote_rejected",
+                               {{"endpoint_id", endpoint_id}});
         }
 
         EvaluateConnectionResult(client, endpoint_id,
@@ -1015,6 +1102,10 @@ void BasePcpHandler::OnEndpointFound(
 
   // Range is empty: this is the first endpoint we discovered so far.
   // Report this endpoint_id to client.
+  NEARBY_TRACE_INSTANT(
+      kTraceCategory, "endpoint_found",
+      {{"endpoint_id", endpoint_id},
+       {"medium", proto::connections::Medium_Name(owned_endpoint->medium)}});
   if (range.first == range.second) {
     NEARBY_LOGS(INFO) << "Adding new endpoint: endpoint_id=" << endpoint_id;
     // And, as it's the first time, report it to the client.
@@ -1215,6 +1306,10 @@ Exception BasePcpHandler::OnIncomingConnection(
                             .emplace(connection_request.endpoint_id(),
                                      std::move(pendingConnectionInfo))
                             .first->second.channel.get();
+  NEARBY_TRACE_ASYNC_BEGIN(
+      kTraceCategory, "connection", connection_request.endpoint_id(),
+      GetConnectionTraceArgs(connection_request.endpoint_id(), medium,
+                             /* is_incoming= */ true));
 
   // Next, we'll set up encryption.
   encryption_runner_.StartServer(client, connection_request.endpoint_id(),
@@ -1398,6 +1493,9 @@ void BasePcpHandler::EvaluateConnectionResult(ClientProxy* client,
   auto pair = pending_connections_.extract(it);
   BasePcpHandler::PendingConnectionInfo& connection_info = pair.mapped();
   bool is_connection_accepted = client->IsConnectionAccepted(endpoint_id);
+  NEARBY_TRACE_ASYNC_END(kTraceCategory, "accept", endpoint_id,
+                         {{"accepted", is_connection_accepted ? "true"
+                                                              : "false"}});
 
   Status response_code;
   if (is_connection_accepted) {
@@ -1409,12 +1507,25 @@ void BasePcpHandler::EvaluateConnectionResult(ClientProxy* client,
     // channels
     // Now, after both parties accepted connection (presumably after verifying &
     // matching security tokens), we are allowed to extract the shared key.
-    auto ukey2 = std::move(connection_info.ukey2);
-    bool succeeded = ukey2->VerifyHandshake();
-    CHECK(succeeded);  // If this fails, it's a UKEY2 protocol bug.
-    auto context = ukey2->ToConnectionContext();
-    CHECK(context);  // there is no way how this can fail, if Verify succeeded.
-    // If it did, it's a UKEY2 protocol bug.
+    std::unique_ptr<D2DConnectionContextV1> context;
+    if (connection_info.resumed_context) {
+      context = std::move(connection_info.resumed_context);
+    } else {
+      auto ukey2 = std::move(connection_info.ukey2);
+      bool succeeded = ukey2->VerifyHandshake();
+      CHECK(succeeded);  // If this fails, it's a UKEY2 protocol bug.
+      context = ukey2->ToConnectionContext();
+      CHECK(context);  // there is no way how this can fail, if Verify
+                       // succeeded. If it did, it's a UKEY2 protocol bug.
+    }
+
+    // Keep a ticket to resume this session with on our next connection to
+    // the endpoint; the remote endpoint keeps the same one.
+    if (FeatureFlags::GetInstance().GetFlags().enable_session_resumption &&
+        connection_info.remote_supports_session_resumption) {
+      session_tickets_.Issue(endpoint_id, *context, connection_info.auth_token,
+                             connection_info.raw_auth_token);
+    }
 
     if (!channel_manager_->EncryptChannelForEndpoint(endpoint_id,
                                                      std::move(context))) {
@@ -1424,8 +1535,13 @@ void BasePcpHandler::EvaluateConnectionResult(ClientProxy* client,
     NEARBY_LOGS(INFO) << "Pending connection rejected; endpoint_id="
                       << endpoint_id;
     response_code = {Status::kConnectionRejected};
+    // Don't resume an earlier session with an endpoint that was rejected.
+    session_tickets_.Revoke(endpoint_id);
   }
 
+  NEARBY_TRACE_ASYNC_END(kTraceCategory, "connection", endpoint_id,
+                         {{"status", response_code.ToString()}});
+
   // If the connection failed, clean everything up and short circuit.
   if (!response_code.Ok()) {
     client->OnConnectionRejected(endpoint_id, response_code);
@@ -1586,6 +1702,11 @@ void BasePcpHandler::PendingConnectionInfo::SetCryptoContext(
   this->ukey2 = std::move(ukey2);
 }
 
+void BasePcpHandler::PendingConnectionInfo::SetCryptoContext(
+    std::unique_ptr<D2DConnectionContextV1> context) {
+  this->resumed_context = std::move(context);
+}
+
 BasePcpHandler::PendingConnectionInfo::~PendingConnectionInfo() {
   auto future_status = result.lock();
   if (future_status && !future_status->IsSet()) {
@@ -21,6 +21,7 @@
 #include <utility>
 #include <vector>
 
+#include "securegcm/d2d_connection_context_v1.h"
 #include "securegcm/ukey2_handshake.h"
 #include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
@@ -37,6 +38,7 @@
 #endif
 #include "connections/implementation/pcp.h"
 #include "connections/implementation/pcp_handler.h"
+#include "connections/implementation/session_ticket_cache.h"
 #include "connections/listeners.h"
 #include "connections/status.h"
 #include "internal/platform/atomic_boolean.h"
@@ -326,6 +328,9 @@ class BasePcpHandler : public PcpHandler,
     // Passes crypto context that we acquired in DH session for temporary
     // ownership here.
     void SetCryptoContext(std::unique_ptr<securegcm::UKey2Handshake> ukey2);
+    // Passes the context of a session resumed with a session ticket.
+    void SetCryptoContext(
+        std::unique_ptr<securegcm::D2DConnectionContextV1> context);
 
     // Pass Accept notification to client.
     void LocalEndpointAcceptedConnection(
@@ -363,6 +368,16 @@ class BasePcpHandler : public PcpHandler,
     // accepted. Crypto context is passed over to channel_manager_ before
     // switching to connected state, where Payload may be exchanged.
     std::unique_ptr<securegcm::UKey2Handshake> ukey2;
+    // Set instead of ukey2 when the session was resumed with a session ticket.
+    std::unique_ptr<securegcm::D2DConnectionContextV1> resumed_context;
+
+    // The authentication token of the connection, which a session ticket
+    // issued for it is bound to.
+    std::string auth_token;
+    ByteArray raw_auth_token;
+    // Whether the remote endpoint's ConnectionResponse said it keeps session
+    // tickets too.
+    bool remote_supports_session_resumption = false;
 
     // Used in AnalyticsRecorder for devices connection tracking.
     std::string connection_token;
@@ -382,9 +397,11 @@ class BasePcpHandler : public PcpHandler,
 
   EncryptionRunner::ResultListener GetResultListener();
 
+  // Exactly one of |ukey2| and |resumed_context| is set on success.
   void OnEncryptionSuccessRunnable(
       const std::string& endpoint_id,
       std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+      std::unique_ptr<securegcm::D2DConnectionContextV1> resumed_context,
       const std::string& auth_token, const ByteArray& raw_auth_token);
   void OnEncryptionFailureRunnable(const std::string& endpoint_id,
                                    EndpointChannel* endpoint_channel);
@@ -534,7 +551,10 @@ class BasePcpHandler : public PcpHandler,
   Pcp pcp_;
   Strategy strategy_{PcpToStrategy(pcp_)};
   Prng prng_;
-  EncryptionRunner encryption_runner_;
+  // Session tickets of the endpoints we connected to, used with
+  // FeatureFlags::enable_session_resumption.
+  SessionTicketCache session_tickets_;
+  EncryptionRunner encryption_runner_{&session_tickets_};
   BwuManager* bwu_manager_;
 };
 
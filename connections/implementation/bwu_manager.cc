@@ -36,6 +36,7 @@
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/feature_flags.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/tracing.h"
 
 namespace location {
 namespace nearby {
@@ -43,6 +44,12 @@ namespace connections {
 
 using ::location::nearby::proto::connections::DisconnectionReason;
 
+namespace {
+
+constexpr char kTraceCategory[] = "bwu";
+
+}  // namespace
+
 // Required for C++ 14 support in Chrome
 constexpr absl::Duration BwuManager::kReadClientIntroductionFrameTimeout;
 
@@ -243,8 +250,14 @@ void BwuManager::InitiateBwuForEndpoint(ClientProxy* client,
     }
 
     std::string service_id = channel->GetServiceId();
+    NEARBY_TRACE_ASYNC_BEGIN(
+        kTraceCategory, "initialize_medium", endpoint_id,
+        {{"endpoint_id", endpoint_id},
+         {"medium", proto::connections::Medium_Name(proposed_medium)}});
     ByteArray bytes = handler->InitializeUpgradedMediumForEndpoint(
         client, service_id, endpoint_id);
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, "initialize_medium", endpoint_id,
+                           {{"result", bytes.Empty() ? "failure" : "success"}});
 
     // Because we grab the endpointChannel first thing, it is possible the
     // endpointChannel is stale by the time we attempt to write over it.
@@ -280,6 +293,10 @@ void BwuManager::InitiateBwuForEndpoint(ClientProxy* client,
            "upgrading endpoint "
         << endpoint_id << " to medium "
         << proto::connections::Medium_Name(proposed_medium);
+    NEARBY_TRACE_INSTANT(
+        kTraceCategory, "path_available_sent",
+        {{"endpoint_id", endpoint_id},
+         {"medium", proto::connections::Medium_Name(proposed_medium)}});
     in_progress_upgrades_.emplace(endpoint_id, client);
   });
 }
@@ -561,6 +578,10 @@ void BwuManager::RunUpgradeProtocol(
   // on the new channel and control messages on the old channel cause the other
   // side to read messages out of sequence
   new_channel->Pause();
+  NEARBY_TRACE_ASYNC_BEGIN(
+      kTraceCategory, "switch_channel", endpoint_id,
+      {{"endpoint_id", endpoint_id},
+       {"medium", proto::connections::Medium_Name(new_channel->GetMedium())}});
   auto old_channel = channel_manager_->GetChannelForEndpoint(endpoint_id);
   if (!old_channel) {
     NEARBY_LOGS(INFO)
@@ -571,6 +592,8 @@ void BwuManager::RunUpgradeProtocol(
     client->GetAnalyticsRecorder().OnBandwidthUpgradeError(
         endpoint_id, proto::connections::CHANNEL_ERROR,
         proto::connections::PRIOR_ENDPOINT_CHANNEL);
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, "switch_channel", endpoint_id,
+                           {{"result", "failure"}});
     return;
   }
   channel_manager_->ReplaceChannelForEndpoint(client, endpoint_id,
@@ -588,6 +611,8 @@ void BwuManager::RunUpgradeProtocol(
     client->GetAnalyticsRecorder().OnBandwidthUpgradeError(
         endpoint_id, proto::connections::RESULT_IO_ERROR,
         proto::connections::LAST_WRITE_TO_PRIOR_CHANNEL);
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, "switch_channel", endpoint_id,
+                           {{"result", "failure"}});
     return;
   }
   NEARBY_LOGS(VERBOSE) << "BwuManager successfully wrote "
@@ -672,8 +697,14 @@ void BwuManager::ProcessBwuPathAvailableEvent(
       client->GetConnectionToken(endpoint_id));
 
   absl::Time connection_attempt_start_time = SystemClock::ElapsedRealtime();
+  NEARBY_TRACE_ASYNC_BEGIN(
+      kTraceCategory, "connect_medium", endpoint_id,
+      {{"endpoint_id", endpoint_id},
+       {"medium", proto::connections::Medium_Name(upgrade_medium)}});
   auto channel = ProcessBwuPathAvailableEventInternal(client, endpoint_id,
                                                       upgrade_path_info);
+  NEARBY_TRACE_ASYNC_END(kTraceCategory, "connect_medium", endpoint_id,
+                         {{"result", channel ? "success" : "failure"}});
   proto::connections::ConnectionAttemptResult connection_attempt_result;
   if (channel != nullptr) {
     connection_attempt_result = proto::connections::RESULT_SUCCESS;
@@ -825,6 +856,11 @@ void BwuManager::RunUpgradeFailedProtocol(
   // We attempted to connect to the new medium that the remote device has set up
   // for us but we failed. We need to let the remote device know so that they
   // can pick another medium for us to try.
+  NEARBY_TRACE_INSTANT(kTraceCategory, "upgrade_failed",
+                       {{"endpoint_id", endpoint_id},
+                        {"medium", proto::connections::Medium_Name(
+                                       parser::UpgradePathInfoMediumToMedium(
+                                           upgrade_path_info.medium()))}});
   std::shared_ptr<EndpointChannel> channel =
       channel_manager_->GetChannelForEndpoint(endpoint_id);
   if (!channel) {
@@ -978,6 +1014,8 @@ void BwuManager::ProcessLastWriteToPriorChannelEvent(
                     << ", endpoint_id=" << endpoint_id << ", medium="
                     << proto::connections::Medium_Name(
                            previous_endpoint_channel->GetMedium());
+  NEARBY_TRACE_INSTANT(kTraceCategory, "last_write_received",
+                       {{"endpoint_id", endpoint_id}});
 
   if (!previous_endpoint_channel->Write(parser::ForBwuSafeToClose()).Ok()) {
     previous_endpoint_channel->Close(DisconnectionReason::IO_ERROR);
@@ -993,6 +1031,8 @@ void BwuManager::ProcessLastWriteToPriorChannelEvent(
     client->GetAnalyticsRecorder().OnBandwidthUpgradeError(
         endpoint_id, proto::connections::RESULT_IO_ERROR,
         proto::connections::SAFE_TO_CLOSE_PRIOR_CHANNEL);
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, "switch_channel", endpoint_id,
+                           {{"result", "failure"}});
     return;
   }
   NEARBY_LOGS(VERBOSE) << "BwuManager successfully wrote "
@@ -1082,6 +1122,8 @@ void BwuManager::ProcessSafeToClosePriorChannelEvent(
   // Report the success to the client
   client->OnBandwidthChanged(endpoint_id, channel->GetMedium());
   in_progress_upgrades_.erase(endpoint_id);
+  NEARBY_TRACE_ASYNC_END(kTraceCategory, "switch_channel", endpoint_id,
+                         {{"result", "success"}});
 }
 
 void BwuManager::ProcessUpgradeFailureEvent(
@@ -1094,6 +1136,11 @@ void BwuManager::ProcessUpgradeFailureEvent(
                                upgrade_info.medium()));
   // The remote device failed to upgrade to the new medium we set up for them.
   // That's alright! We'll just try the next available medium (if there is one).
+  NEARBY_TRACE_INSTANT(kTraceCategory, "remote_upgrade_failed",
+                       {{"endpoint_id", endpoint_id},
+                        {"medium", proto::connections::Medium_Name(
+                                       parser::UpgradePathInfoMediumToMedium(
+                                           upgrade_info.medium()))}});
   in_progress_upgrades_.erase(endpoint_id);
 
   // The first thing we have to do is to replace our currentBwuMedium with the
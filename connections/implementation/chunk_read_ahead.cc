@@ -0,0 +1,103 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_read_ahead.h"
+
+#include <utility>
+
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+ChunkReadAhead::ChunkReadAhead(InternalPayload& payload,
+                               SubmittableExecutor& executor, int max_chunks)
+    : payload_(payload),
+      executor_(executor),
+      max_chunks_(max_chunks > 0 ? max_chunks : 1) {}
+
+ChunkReadAhead::~ChunkReadAhead() { Stop(); }
+
+ByteArray ChunkReadAhead::Next(int chunk_size) {
+  MutexLock lock(&mutex_);
+  chunk_size_ = chunk_size;
+  if (!started_ && !stopped_) {
+    started_ = true;
+    executor_.Execute("read-ahead", [this]() { ReadLoop(); });
+  }
+  while (chunks_.empty() && !reader_done_ && started_) {
+    cond_.Wait();
+  }
+  if (chunks_.empty()) return {};
+
+  ByteArray chunk = std::move(chunks_.front());
+  chunks_.pop_front();
+  // Wake up the reader, in case it was waiting for a free slot.
+  cond_.Notify();
+  return chunk;
+}
+
+void ChunkReadAhead::Stop() {
+  bool reader_busy;
+  {
+    MutexLock lock(&mutex_);
+    if (stopped_) return;
+    stopped_ = true;
+    if (!started_) return;
+    reader_busy = !reader_done_;
+    cond_.Notify();
+  }
+  if (reader_busy) {
+    NEARBY_LOGS(VERBOSE) << "ChunkReadAhead: closing payload "
+                         << payload_.GetId() << " to stop the reader.";
+    payload_.Close();
+  }
+  reader_exited_.Await();
+}
+
+void ChunkReadAhead::ReadLoop() {
+  while (true) {
+    int chunk_size;
+    {
+      MutexLock lock(&mutex_);
+      while (!stopped_ && static_cast<int>(chunks_.size()) >= max_chunks_) {
+        cond_.Wait();
+      }
+      if (stopped_) break;
+      chunk_size = chunk_size_;
+    }
+
+    // This will block if there is no data to transfer.
+    ByteArray chunk = payload_.DetachNextChunk(chunk_size);
+    bool last_chunk = chunk.Empty();
+    {
+      MutexLock lock(&mutex_);
+      chunks_.push_back(std::move(chunk));
+      cond_.Notify();
+    }
+    if (last_chunk) break;
+  }
+  {
+    MutexLock lock(&mutex_);
+    reader_done_ = true;
+    cond_.Notify();
+  }
+  reader_exited_.CountDown();
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
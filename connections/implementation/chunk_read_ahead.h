@@ -0,0 +1,80 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_CHUNK_READ_AHEAD_H_
+#define CORE_INTERNAL_CHUNK_READ_AHEAD_H_
+
+#include <deque>
+
+#include "absl/base/thread_annotations.h"
+#include "connections/implementation/internal_payload.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/condition_variable.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/submittable_executor.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Detaches chunks of an outgoing payload on a separate executor, keeping up to
+// |max_chunks| of them buffered ahead of the sender. This lets the blocking
+// file/stream read of the next chunk overlap with the serialization and
+// socket writes of the current one.
+//
+// The reader is started by the first call to Next(), so any SkipToOffset() on
+// the payload must happen before that. Stop() (or the destructor) must run
+// before the payload is destroyed.
+class ChunkReadAhead {
+ public:
+  ChunkReadAhead(InternalPayload& payload, SubmittableExecutor& executor,
+                 int max_chunks);
+  ~ChunkReadAhead();
+
+  ChunkReadAhead(const ChunkReadAhead&) = delete;
+  ChunkReadAhead& operator=(const ChunkReadAhead&) = delete;
+
+  // Returns the next chunk, in payload order. Chunks read from now on are at
+  // most |chunk_size| bytes. Blocks until a chunk is available; an empty
+  // ByteArray signals the end of the payload, same as
+  // InternalPayload::DetachNextChunk().
+  ByteArray Next(int chunk_size) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Stops the reader and waits for it to exit. If the reader is still busy
+  // with the payload, the payload is closed to unblock it.
+  void Stop() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void ReadLoop() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  InternalPayload& payload_;
+  SubmittableExecutor& executor_;
+  const int max_chunks_;
+
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  bool started_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  bool reader_done_ ABSL_GUARDED_BY(mutex_) = false;
+  int chunk_size_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::deque<ByteArray> chunks_ ABSL_GUARDED_BY(mutex_);
+  CountDownLatch reader_exited_{1};
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_CHUNK_READ_AHEAD_H_
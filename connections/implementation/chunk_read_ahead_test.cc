@@ -0,0 +1,115 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_read_ahead.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "connections/implementation/internal_payload_factory.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/pipe.h"
+#include "internal/platform/single_thread_executor.h"
+#include "internal/platform/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr int kChunkSize = 4;
+
+std::unique_ptr<InternalPayload> CreateStreamPayload(
+    std::shared_ptr<Pipe> pipe) {
+  return CreateOutgoingInternalPayload(
+      Payload{[pipe]() -> InputStream& {
+        return pipe->GetInputStream();  // NOLINT
+      }});
+}
+
+TEST(ChunkReadAheadTest, ReturnsChunksInOrder) {
+  auto pipe = std::make_shared<Pipe>();
+  std::unique_ptr<InternalPayload> payload = CreateStreamPayload(pipe);
+  SingleThreadExecutor executor;
+  ChunkReadAhead read_ahead(*payload, executor, 2);
+
+  OutputStream& output = pipe->GetOutputStream();
+  EXPECT_TRUE(output.Write(ByteArray("ABCD")).Ok());
+  EXPECT_TRUE(output.Write(ByteArray("EFGH")).Ok());
+  EXPECT_TRUE(output.Write(ByteArray("IJ")).Ok());
+  output.Close();
+
+  EXPECT_EQ(std::string(read_ahead.Next(kChunkSize)), "ABCD");
+  EXPECT_EQ(std::string(read_ahead.Next(kChunkSize)), "EFGH");
+  EXPECT_EQ(std::string(read_ahead.Next(kChunkSize)), "IJ");
+  EXPECT_TRUE(read_ahead.Next(kChunkSize).Empty());
+  // The end of the payload is sticky.
+  EXPECT_TRUE(read_ahead.Next(kChunkSize).Empty());
+}
+
+TEST(ChunkReadAheadTest, ReadsAheadOfTheSender) {
+  auto pipe = std::make_shared<Pipe>();
+  std::unique_ptr<InternalPayload> payload = CreateStreamPayload(pipe);
+  SingleThreadExecutor executor;
+  ChunkReadAhead read_ahead(*payload, executor, 2);
+
+  OutputStream& output = pipe->GetOutputStream();
+  EXPECT_TRUE(output.Write(ByteArray("ABCD")).Ok());
+  EXPECT_TRUE(output.Write(ByteArray("EFGH")).Ok());
+  EXPECT_TRUE(output.Write(ByteArray("IJKL")).Ok());
+  EXPECT_TRUE(output.Write(ByteArray("MNOP")).Ok());
+
+  EXPECT_EQ(std::string(read_ahead.Next(kChunkSize)), "ABCD");
+  // Give the reader time to fill its buffer; it must stop at |max_chunks|,
+  // leaving the last chunk in the pipe.
+  SystemClock::Sleep(absl::Milliseconds(100));
+  ExceptionOr<ByteArray> rest = pipe->GetInputStream().Read(kChunkSize);
+  EXPECT_TRUE(rest.ok());
+  EXPECT_EQ(std::string(rest.result()), "MNOP");
+
+  EXPECT_EQ(std::string(read_ahead.Next(kChunkSize)), "EFGH");
+  EXPECT_EQ(std::string(read_ahead.Next(kChunkSize)), "IJKL");
+}
+
+TEST(ChunkReadAheadTest, StopUnblocksReaderWaitingForData) {
+  auto pipe = std::make_shared<Pipe>();
+  std::unique_ptr<InternalPayload> payload = CreateStreamPayload(pipe);
+  SingleThreadExecutor executor;
+  ChunkReadAhead read_ahead(*payload, executor, 2);
+
+  EXPECT_TRUE(pipe->GetOutputStream().Write(ByteArray("ABCD")).Ok());
+  EXPECT_EQ(std::string(read_ahead.Next(kChunkSize)), "ABCD");
+
+  // The reader is now blocked on the empty pipe; Stop() must not hang.
+  read_ahead.Stop();
+  EXPECT_TRUE(read_ahead.Next(kChunkSize).Empty());
+}
+
+TEST(ChunkReadAheadTest, StopWithoutStartDoesNotTouchPayload) {
+  auto pipe = std::make_shared<Pipe>();
+  std::unique_ptr<InternalPayload> payload = CreateStreamPayload(pipe);
+  SingleThreadExecutor executor;
+  ChunkReadAhead read_ahead(*payload, executor, 2);
+
+  read_ahead.Stop();
+  EXPECT_TRUE(read_ahead.Next(kChunkSize).Empty());
+  EXPECT_TRUE(pipe->GetOutputStream().Write(ByteArray("ABCD")).Ok());
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,107 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_size_controller.h"
+
+#include <algorithm>
+
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+constexpr int ChunkSizeController::kMinChunkSize;
+constexpr int ChunkSizeController::kMaxChunkSize;
+constexpr int ChunkSizeController::kWindowSamples;
+constexpr absl::Duration ChunkSizeController::kMaxWriteLatency;
+constexpr double ChunkSizeController::kThroughputTolerance;
+
+ChunkSizeController::ChunkSizeController(int max_chunk_size) {
+  MutexLock lock(&mutex_);
+  ResetLocked(max_chunk_size);
+}
+
+int ChunkSizeController::GetChunkSize() const {
+  MutexLock lock(&mutex_);
+  return chunk_size_;
+}
+
+void ChunkSizeController::SetMaxChunkSize(int max_chunk_size) {
+  MutexLock lock(&mutex_);
+  if (max_chunk_size == requested_max_chunk_size_) return;
+  ResetLocked(max_chunk_size);
+}
+
+void ChunkSizeController::OnChunkWritten(std::int64_t size_bytes,
+                                         absl::Duration elapsed) {
+  MutexLock lock(&mutex_);
+  window_samples_++;
+  window_bytes_ += size_bytes;
+  window_time_ += elapsed;
+  if (window_samples_ < kWindowSamples) return;
+
+  const absl::Duration average_latency = window_time_ / window_samples_;
+  const double throughput =
+      window_bytes_ /
+      std::max(absl::ToDoubleSeconds(window_time_),
+               absl::ToDoubleSeconds(absl::Microseconds(1)));
+
+  int next_chunk_size = chunk_size_;
+  if (average_latency > kMaxWriteLatency) {
+    // The link can't keep up; back off and allow probing upwards again once
+    // it recovers.
+    next_chunk_size = std::max(min_chunk_size_, chunk_size_ / 2);
+    growth_limit_ = max_chunk_size_;
+  } else if (last_chunk_size_ > 0 && last_chunk_size_ < chunk_size_ &&
+             throughput < last_throughput_ * (1 - kThroughputTolerance)) {
+    // The last doubling made things worse; go back and stay there.
+    next_chunk_size = last_chunk_size_;
+    growth_limit_ = last_chunk_size_;
+  } else if (average_latency < kMaxWriteLatency / 2) {
+    next_chunk_size = std::min(growth_limit_, chunk_size_ * 2);
+  }
+
+  if (next_chunk_size != chunk_size_) {
+    NEARBY_LOGS(VERBOSE) << "ChunkSizeController: chunk size " << chunk_size_
+                         << " -> " << next_chunk_size << "; average latency "
+                         << absl::ToInt64Milliseconds(average_latency)
+                         << "ms, throughput "
+                         << static_cast<std::int64_t>(throughput) << "B/s";
+  }
+  last_chunk_size_ = chunk_size_;
+  last_throughput_ = throughput;
+  chunk_size_ = next_chunk_size;
+  window_samples_ = 0;
+  window_bytes_ = 0;
+  window_time_ = absl::ZeroDuration();
+}
+
+void ChunkSizeController::ResetLocked(int max_chunk_size) {
+  requested_max_chunk_size_ = max_chunk_size;
+  max_chunk_size_ = std::max(1, std::min(max_chunk_size, kMaxChunkSize));
+  min_chunk_size_ = std::min(kMinChunkSize, max_chunk_size_);
+  chunk_size_ = max_chunk_size_;
+  growth_limit_ = max_chunk_size_;
+  window_samples_ = 0;
+  window_bytes_ = 0;
+  window_time_ = absl::ZeroDuration();
+  last_chunk_size_ = 0;
+  last_throughput_ = 0;
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
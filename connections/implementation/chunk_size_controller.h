@@ -0,0 +1,92 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_CHUNK_SIZE_CONTROLLER_H_
+#define CORE_INTERNAL_CHUNK_SIZE_CONTROLLER_H_
+
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/time/time.h"
+#include "connections/implementation/base_endpoint_channel.h"
+#include "internal/platform/mutex.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Picks the payload chunk size for one endpoint from the observed write
+// latency and throughput of its channel.
+//
+// The controller starts at the channel's maximum and judges every window of
+// kWindowSamples writes: if writes take longer than kMaxWriteLatency on
+// average, the chunk size is halved; if they are comfortably fast, it is
+// doubled again, unless the previous doubling lowered the throughput, in which
+// case it settles on the previous size. The chunk size always stays within
+// [kMinChunkSize, max], where max is the channel's maximum transmit packet
+// size capped to what the peer accepts in a single frame.
+class ChunkSizeController {
+ public:
+  // Smallest chunk size the controller shrinks to, unless the channel's
+  // maximum is smaller than that.
+  static constexpr int kMinChunkSize = 4096;  // 4 KB
+  // Largest chunk size, leaving room for the frame header and encryption
+  // within the largest frame the peer accepts.
+  static constexpr int kMaxChunkSize =
+      BaseEndpointChannel::kMaxAllowedReadBytes - 4096;
+  static constexpr int kWindowSamples = 4;
+  static constexpr absl::Duration kMaxWriteLatency = absl::Milliseconds(250);
+  // How much lower the throughput after a doubling has to be to undo it.
+  static constexpr double kThroughputTolerance = 0.1;
+
+  explicit ChunkSizeController(int max_chunk_size);
+
+  // Returns the chunk size to use for the next chunk.
+  int GetChunkSize() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Updates the channel's maximum, e.g. after a bandwidth upgrade. A changed
+  // maximum restarts the controller from it.
+  void SetMaxChunkSize(int max_chunk_size) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Records that a frame of |size_bytes| took |elapsed| to write.
+  void OnChunkWritten(std::int64_t size_bytes, absl::Duration elapsed)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void ResetLocked(int max_chunk_size) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable Mutex mutex_;
+  int requested_max_chunk_size_ ABSL_GUARDED_BY(mutex_);
+  int max_chunk_size_ ABSL_GUARDED_BY(mutex_);
+  int min_chunk_size_ ABSL_GUARDED_BY(mutex_);
+  int chunk_size_ ABSL_GUARDED_BY(mutex_);
+  // The chunk size is not grown past this. Lowered when a doubling did not
+  // pay off, raised again when the link slows down and we start over.
+  int growth_limit_ ABSL_GUARDED_BY(mutex_);
+
+  // Stats of the window in progress.
+  int window_samples_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::int64_t window_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::Duration window_time_ ABSL_GUARDED_BY(mutex_);
+
+  // Chunk size and throughput (bytes/sec) of the last finished window.
+  int last_chunk_size_ ABSL_GUARDED_BY(mutex_) = 0;
+  double last_throughput_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_CHUNK_SIZE_CONTROLLER_H_
@@ -0,0 +1,111 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_size_controller.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr int kMaxChunkSize = 65536;
+
+// Feeds one full window of writes of the current chunk size, each taking
+// |latency|.
+void WriteWindow(ChunkSizeController& controller, absl::Duration latency) {
+  for (int i = 0; i < ChunkSizeController::kWindowSamples; ++i) {
+    controller.OnChunkWritten(controller.GetChunkSize(), latency);
+  }
+}
+
+TEST(ChunkSizeControllerTest, StartsAtChannelMaximum) {
+  ChunkSizeController controller(kMaxChunkSize);
+
+  EXPECT_EQ(controller.GetChunkSize(), kMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, CapsMaximumToPeerFrameLimit) {
+  ChunkSizeController controller(4 * 1048576);
+
+  EXPECT_EQ(controller.GetChunkSize(), ChunkSizeController::kMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, SlowWritesShrinkChunkSizeDownToMinimum) {
+  ChunkSizeController controller(kMaxChunkSize);
+
+  WriteWindow(controller, absl::Seconds(1));
+  EXPECT_EQ(controller.GetChunkSize(), kMaxChunkSize / 2);
+
+  for (int i = 0; i < 10; ++i) WriteWindow(controller, absl::Seconds(1));
+  EXPECT_EQ(controller.GetChunkSize(), ChunkSizeController::kMinChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, NeverGoesBelowSmallChannelMaximum) {
+  ChunkSizeController controller(512);
+
+  WriteWindow(controller, absl::Seconds(1));
+
+  EXPECT_EQ(controller.GetChunkSize(), 512);
+}
+
+TEST(ChunkSizeControllerTest, FastWritesGrowChunkSizeBackUpToMaximum) {
+  ChunkSizeController controller(kMaxChunkSize);
+  WriteWindow(controller, absl::Seconds(1));
+  WriteWindow(controller, absl::Seconds(1));
+  ASSERT_EQ(controller.GetChunkSize(), kMaxChunkSize / 4);
+
+  // Writes take time proportional to their size, so throughput holds.
+  WriteWindow(controller, absl::Milliseconds(10));
+  EXPECT_EQ(controller.GetChunkSize(), kMaxChunkSize / 2);
+  WriteWindow(controller, absl::Milliseconds(20));
+  EXPECT_EQ(controller.GetChunkSize(), kMaxChunkSize);
+  WriteWindow(controller, absl::Milliseconds(40));
+  EXPECT_EQ(controller.GetChunkSize(), kMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, SettlesWhenGrowingLowersThroughput) {
+  ChunkSizeController controller(kMaxChunkSize);
+  WriteWindow(controller, absl::Seconds(1));
+  WriteWindow(controller, absl::Seconds(1));
+  ASSERT_EQ(controller.GetChunkSize(), kMaxChunkSize / 4);
+
+  WriteWindow(controller, absl::Milliseconds(10));
+  ASSERT_EQ(controller.GetChunkSize(), kMaxChunkSize / 2);
+  // Twice the bytes in four times the time: worse, so go back and stay.
+  WriteWindow(controller, absl::Milliseconds(40));
+  EXPECT_EQ(controller.GetChunkSize(), kMaxChunkSize / 4);
+  WriteWindow(controller, absl::Milliseconds(10));
+  EXPECT_EQ(controller.GetChunkSize(), kMaxChunkSize / 4);
+}
+
+TEST(ChunkSizeControllerTest, NewMaximumRestartsController) {
+  ChunkSizeController controller(512);
+
+  controller.SetMaxChunkSize(kMaxChunkSize);
+  EXPECT_EQ(controller.GetChunkSize(), kMaxChunkSize);
+
+  WriteWindow(controller, absl::Seconds(1));
+  controller.SetMaxChunkSize(kMaxChunkSize);
+  EXPECT_EQ(controller.GetChunkSize(), kMaxChunkSize / 2);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
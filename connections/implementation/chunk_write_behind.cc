@@ -0,0 +1,115 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_write_behind.h"
+
+#include <utility>
+
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+ChunkWriteBehind::ChunkWriteBehind(OutputStream& output,
+                                   SubmittableExecutor& executor,
+                                   std::int64_t max_queued_bytes)
+    : output_(output),
+      executor_(executor),
+      max_queued_bytes_(max_queued_bytes > 0 ? max_queued_bytes : 1) {}
+
+ChunkWriteBehind::~ChunkWriteBehind() { Stop(); }
+
+Exception ChunkWriteBehind::Write(ByteArray chunk) {
+  MutexLock lock(&mutex_);
+  const std::int64_t size = chunk.size();
+  while (!stopped_ && !error_.Raised() && queued_bytes_ > 0 &&
+         queued_bytes_ + size > max_queued_bytes_) {
+    cond_.Wait();
+  }
+  if (stopped_) return {Exception::kIo};
+  if (error_.Raised()) return error_;
+
+  chunks_.push_back(std::move(chunk));
+  queued_bytes_ += size;
+  if (!writing_) {
+    writing_ = true;
+    executor_.Execute("write-behind", [this]() { WriteLoop(); });
+  }
+  return {Exception::kSuccess};
+}
+
+Exception ChunkWriteBehind::Finish() {
+  Exception error{Exception::kSuccess};
+  {
+    MutexLock lock(&mutex_);
+    while (writing_) {
+      cond_.Wait();
+    }
+    if (stopped_) return {Exception::kIo};
+    error = error_;
+  }
+  Exception close_result = output_.Close();
+  return error.Raised() ? error : close_result;
+}
+
+void ChunkWriteBehind::Stop() {
+  MutexLock lock(&mutex_);
+  stopped_ = true;
+  chunks_.clear();
+  queued_bytes_ = 0;
+  cond_.Notify();
+  while (writing_) {
+    cond_.Wait();
+  }
+}
+
+void ChunkWriteBehind::WriteLoop() {
+  while (true) {
+    ByteArray chunk;
+    {
+      MutexLock lock(&mutex_);
+      if (stopped_ || chunks_.empty()) {
+        writing_ = false;
+        cond_.Notify();
+        return;
+      }
+      chunk = std::move(chunks_.front());
+      chunks_.pop_front();
+    }
+
+    // This will block on the disk.
+    Exception result = output_.Write(chunk);
+    {
+      MutexLock lock(&mutex_);
+      if (stopped_) continue;
+      queued_bytes_ -= chunk.size();
+      if (result.Raised()) {
+        NEARBY_LOGS(WARNING) << "ChunkWriteBehind: write failed: "
+                             << result.value << "; dropping "
+                             << chunks_.size() << " queued chunks.";
+        error_ = result;
+        chunks_.clear();
+        queued_bytes_ = 0;
+      }
+      // Wake up the writer, in case it was waiting for room.
+      cond_.Notify();
+    }
+  }
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
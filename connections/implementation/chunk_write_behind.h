@@ -0,0 +1,84 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_CHUNK_WRITE_BEHIND_H_
+#define CORE_INTERNAL_CHUNK_WRITE_BEHIND_H_
+
+#include <cstdint>
+#include <deque>
+
+#include "absl/base/thread_annotations.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/condition_variable.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/output_stream.h"
+#include "internal/platform/submittable_executor.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Writes the chunks of an incoming payload to its output on a separate
+// executor, keeping up to |max_queued_bytes| of them queued. This keeps the
+// endpoint's reader thread, which receives the chunks, from blocking on disk.
+//
+// A failed write is reported by the next call to Write() or Finish(); the
+// chunks queued after it are dropped. Stop() (or the destructor) must run
+// before the output is destroyed.
+class ChunkWriteBehind {
+ public:
+  ChunkWriteBehind(OutputStream& output, SubmittableExecutor& executor,
+                   std::int64_t max_queued_bytes);
+  ~ChunkWriteBehind();
+
+  ChunkWriteBehind(const ChunkWriteBehind&) = delete;
+  ChunkWriteBehind& operator=(const ChunkWriteBehind&) = delete;
+
+  // Queues |chunk| to be written. Blocks while |max_queued_bytes| are queued
+  // already; a chunk larger than that is queued once the queue is empty.
+  // Returns the error of an earlier write, if one failed, or Exception::kIo
+  // after Stop().
+  Exception Write(ByteArray chunk) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Waits for all queued chunks to be written, then closes the output.
+  // Returns the first write error, or else the result of closing.
+  Exception Finish() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Drops the queued chunks and waits for the one being written, if any.
+  void Stop() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void WriteLoop() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  OutputStream& output_;
+  SubmittableExecutor& executor_;
+  const std::int64_t max_queued_bytes_;
+
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  // Whether WriteLoop() is scheduled or running.
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  Exception error_ ABSL_GUARDED_BY(mutex_){Exception::kSuccess};
+  std::deque<ByteArray> chunks_ ABSL_GUARDED_BY(mutex_);
+  // Bytes queued, including the chunk being written.
+  std::int64_t queued_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_CHUNK_WRITE_BEHIND_H_
@@ -0,0 +1,165 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_write_behind.h"
+
+#include <atomic>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/condition_variable.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/mutex_lock.h"
+#include "internal/platform/output_stream.h"
+#include "internal/platform/single_thread_executor.h"
+#include "internal/platform/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+// Records what is written to it; writes block while it's paused.
+class FakeOutputStream : public OutputStream {
+ public:
+  Exception Write(const ByteArray& data) override {
+    MutexLock lock(&mutex_);
+    while (paused_) cond_.Wait();
+    if (fail_writes_) return {Exception::kIo};
+    contents_ += std::string(data);
+    return {Exception::kSuccess};
+  }
+  Exception Flush() override { return {Exception::kSuccess}; }
+  Exception Close() override {
+    MutexLock lock(&mutex_);
+    closed_ = true;
+    return {Exception::kSuccess};
+  }
+
+  void SetPaused(bool paused) {
+    MutexLock lock(&mutex_);
+    paused_ = paused;
+    cond_.Notify();
+  }
+  void FailWrites() {
+    MutexLock lock(&mutex_);
+    fail_writes_ = true;
+  }
+  std::string contents() {
+    MutexLock lock(&mutex_);
+    return contents_;
+  }
+  bool closed() {
+    MutexLock lock(&mutex_);
+    return closed_;
+  }
+
+ private:
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  bool paused_ = false;
+  bool fail_writes_ = false;
+  bool closed_ = false;
+  std::string contents_;
+};
+
+TEST(ChunkWriteBehindTest, WritesChunksInOrderAndCloses) {
+  FakeOutputStream output;
+  SingleThreadExecutor executor;
+  ChunkWriteBehind write_behind(output, executor, 1024);
+
+  EXPECT_TRUE(write_behind.Write(ByteArray("ABCD")).Ok());
+  EXPECT_TRUE(write_behind.Write(ByteArray("EFGH")).Ok());
+  EXPECT_TRUE(write_behind.Write(ByteArray("IJ")).Ok());
+  EXPECT_TRUE(write_behind.Finish().Ok());
+
+  EXPECT_EQ(output.contents(), "ABCDEFGHIJ");
+  EXPECT_TRUE(output.closed());
+}
+
+TEST(ChunkWriteBehindTest, BlocksWhileQueueIsFull) {
+  FakeOutputStream output;
+  output.SetPaused(true);
+  SingleThreadExecutor writer_executor;
+  ChunkWriteBehind write_behind(output, writer_executor, 8);
+  EXPECT_TRUE(write_behind.Write(ByteArray("ABCD")).Ok());
+  EXPECT_TRUE(write_behind.Write(ByteArray("EFGH")).Ok());
+
+  std::atomic_bool written = false;
+  CountDownLatch done(1);
+  SingleThreadExecutor executor;
+  executor.Execute([&]() {
+    EXPECT_TRUE(write_behind.Write(ByteArray("IJ")).Ok());
+    written = true;
+    done.CountDown();
+  });
+  SystemClock::Sleep(absl::Milliseconds(100));
+  EXPECT_FALSE(written);
+
+  output.SetPaused(false);
+  EXPECT_TRUE(done.Await(absl::Seconds(1)).result());
+  EXPECT_TRUE(write_behind.Finish().Ok());
+  EXPECT_EQ(output.contents(), "ABCDEFGHIJ");
+}
+
+TEST(ChunkWriteBehindTest, ReportsFailedWrite) {
+  FakeOutputStream output;
+  output.FailWrites();
+  SingleThreadExecutor executor;
+  ChunkWriteBehind write_behind(output, executor, 1024);
+
+  EXPECT_TRUE(write_behind.Write(ByteArray("ABCD")).Ok());
+  Exception result = write_behind.Finish();
+
+  EXPECT_TRUE(result.Raised(Exception::kIo));
+  EXPECT_TRUE(output.closed());
+  // Later chunks are refused.
+  EXPECT_TRUE(write_behind.Write(ByteArray("EFGH")).Raised(Exception::kIo));
+}
+
+TEST(ChunkWriteBehindTest, StopUnblocksWriter) {
+  FakeOutputStream output;
+  output.SetPaused(true);
+  SingleThreadExecutor writer_executor;
+  ChunkWriteBehind write_behind(output, writer_executor, 4);
+  EXPECT_TRUE(write_behind.Write(ByteArray("ABCD")).Ok());
+
+  CountDownLatch done(1);
+  SingleThreadExecutor executor;
+  executor.Execute([&]() {
+    EXPECT_TRUE(write_behind.Write(ByteArray("EFGH")).Raised(Exception::kIo));
+    done.CountDown();
+  });
+  SystemClock::Sleep(absl::Milliseconds(50));
+
+  // Stop() waits for the write in flight, so let it finish.
+  SingleThreadExecutor unpause_executor;
+  unpause_executor.Execute([&output]() {
+    SystemClock::Sleep(absl::Milliseconds(50));
+    output.SetPaused(false);
+  });
+  write_behind.Stop();
+  EXPECT_TRUE(done.Await(absl::Seconds(1)).result());
+  EXPECT_EQ(output.contents(), "ABCD");
+  EXPECT_FALSE(output.closed());
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
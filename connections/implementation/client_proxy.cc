@@ -623,6 +623,15 @@ ClientProxy::Connection* ClientProxy::LookupConnection(
   return item != connections_.end() ? &item->second : nullptr;
 }
 
+PayloadProgressPolicy ClientProxy::GetPayloadProgressPolicy(
+    const std::string& endpoint_id) const {
+  MutexLock lock(&mutex_);
+
+  const Connection* item = LookupConnection(endpoint_id);
+  return item != nullptr ? item->payload_listener.progress_policy
+                         : PayloadProgressPolicy{};
+}
+
 void ClientProxy::OnPayloadProgress(const std::string& endpoint_id,
                                     const PayloadProgressInfo& info) {
   MutexLock lock(&mutex_);
@@ -162,6 +162,10 @@ class ClientProxy final {
 
   // Proxies to the client's PayloadListener::OnPayload() callback.
   void OnPayload(const std::string& endpoint_id, Payload payload);
+  // Returns how the client wants to hear about the progress of payloads to or
+  // from the endpoint, as set with its PayloadListener.
+  PayloadProgressPolicy GetPayloadProgressPolicy(
+      const std::string& endpoint_id) const;
   // Proxies to the client's PayloadListener::OnPayloadProgress() callback.
   void OnPayloadProgress(const std::string& endpoint_id,
                          const PayloadProgressInfo& info);
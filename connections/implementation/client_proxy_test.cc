@@ -515,6 +515,26 @@ TEST_F(ClientProxyTest, OnPayloadProgressChangesState) {
   OnPayloadProgress(&client2_, advertising_endpoint);
 }
 
+TEST_F(ClientProxyTest, GetPayloadProgressPolicyReturnsAcceptedPolicy) {
+  Endpoint advertising_endpoint =
+      StartAdvertising(&client1_, advertising_connection_listener_);
+  StartDiscovery(&client2_, discovery_listener_);
+  OnDiscoveryEndpointFound(&client2_, advertising_endpoint);
+  OnDiscoveryConnectionInitiated(&client2_, advertising_endpoint);
+  EXPECT_EQ(
+      client2_.GetPayloadProgressPolicy(advertising_endpoint.id).min_bytes, 0);
+
+  PayloadListener payload_listener = payload_listener_;
+  payload_listener.progress_policy = {.min_interval = absl::Milliseconds(100),
+                                      .min_bytes = 4096};
+  client2_.LocalEndpointAcceptedConnection(advertising_endpoint.id,
+                                           payload_listener);
+  PayloadProgressPolicy policy =
+      client2_.GetPayloadProgressPolicy(advertising_endpoint.id);
+  EXPECT_EQ(policy.min_interval, absl::Milliseconds(100));
+  EXPECT_EQ(policy.min_bytes, 4096);
+}
+
 TEST_F(ClientProxyTest,
        EndpointIdCacheWhenHighVizAdvertisementAgainImmediately) {
   BooleanMediumSelector booleanMediumSelector;
@@ -17,16 +17,22 @@
 #include <cinttypes>
 #include <cstdint>
 #include <memory>
+#include <optional>
 
+#include "securegcm/d2d_connection_context_v1.h"
 #include "securegcm/ukey2_handshake.h"
 #include "absl/strings/ascii.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "connections/implementation/mediums/utils.h"
+#include "connections/implementation/offline_frames.h"
 #include "internal/platform/base64_utils.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/cancelable_alarm.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/tracing.h"
 
 namespace location {
 namespace nearby {
@@ -36,8 +42,8 @@ namespace {
 constexpr absl::Duration kTimeout = absl::Seconds(15);
 constexpr std::int32_t kMaxUkey2VerificationStringLength = 32;
 constexpr std::int32_t kTokenLength = 5;
-constexpr securegcm::UKey2Handshake::HandshakeCipher kCipher =
-    securegcm::UKey2Handshake::HandshakeCipher::P256_SHA512;
+constexpr char kTraceCategory[] = "connections";
+constexpr char kTraceName[] = "ukey2_handshake";
 
 // Transforms a raw UKEY2 token (which is a random ByteArray that's
 // kMaxUkey2VerificationStringLength long) into a kTokenLength string that only
@@ -50,9 +56,12 @@ std::string ToHumanReadableString(const ByteArray& token) {
 
 bool HandleEncryptionSuccess(const std::string& endpoint_id,
                              std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+                             Ukey2CryptoPool* crypto_pool,
                              const EncryptionRunner::ResultListener& listener) {
   std::unique_ptr<std::string> verification_string =
-      ukey2->GetVerificationString(kMaxUkey2VerificationStringLength);
+      crypto_pool->Run([&ukey2]() {
+        return ukey2->GetVerificationString(kMaxUkey2VerificationStringLength);
+      });
   if (verification_string == nullptr) {
     return false;
   }
@@ -66,6 +75,13 @@ bool HandleEncryptionSuccess(const std::string& endpoint_id,
   return true;
 }
 
+enum class ResumeResult {
+  kResumed,
+  // The server has no matching ticket; the client goes on with UKEY2.
+  kRejected,
+  kFailed,
+};
+
 void CancelableAlarmRunnable(ClientProxy* client,
                              const std::string& endpoint_id,
                              EndpointChannel* endpoint_channel) {
@@ -79,22 +95,31 @@ void CancelableAlarmRunnable(ClientProxy* client,
 class ServerRunnable final {
  public:
   ServerRunnable(ClientProxy* client, ScheduledExecutor* alarm_executor,
-                 const std::string& endpoint_id, EndpointChannel* channel,
+                 SessionTicketCache* session_tickets,
+                 Ukey2CryptoPool* crypto_pool, const std::string& endpoint_id,
+                 EndpointChannel* channel,
                  EncryptionRunner::ResultListener&& listener)
       : client_(client),
         alarm_executor_(alarm_executor),
+        session_tickets_(session_tickets),
+        crypto_pool_(crypto_pool),
         endpoint_id_(endpoint_id),
         channel_(channel),
         listener_(std::move(listener)) {}
 
   void operator()() const {
+    NEARBY_TRACE_ASYNC_BEGIN(
+        kTraceCategory, kTraceName, endpoint_id_,
+        {{"endpoint_id", endpoint_id_},
+         {"medium", proto::connections::Medium_Name(channel_->GetMedium())},
+         {"role", "responder"}});
     CancelableAlarm timeout_alarm(
         "EncryptionRunner.StartServer() timeout",
         [this]() { CancelableAlarmRunnable(client_, endpoint_id_, channel_); },
         kTimeout, alarm_executor_);
 
     std::unique_ptr<securegcm::UKey2Handshake> server =
-        securegcm::UKey2Handshake::ForResponder(kCipher);
+        crypto_pool_->TakeResponder();
     if (server == nullptr) {
       LogException();
       HandleHandshakeOrIoException(&timeout_alarm);
@@ -109,8 +134,36 @@ class ServerRunnable final {
       return;
     }
 
+    // A client that holds a session ticket sends a resumption request in place
+    // of Message 1, and sends Message 1 if we reject it.
+    ExceptionOr<OfflineFrame> resumption =
+        parser::FromBytes(client_init.result());
+    if (resumption.ok() && parser::GetFrameType(resumption.result()) ==
+                               V1Frame::SESSION_RESUMPTION) {
+      switch (TryResume(resumption.result().v1().session_resumption(),
+                        &timeout_alarm)) {
+        case ResumeResult::kResumed:
+          return;
+        case ResumeResult::kRejected:
+          break;
+        case ResumeResult::kFailed:
+          LogException();
+          HandleHandshakeOrIoException(&timeout_alarm);
+          return;
+      }
+      client_init = channel_->Read();
+      if (!client_init.ok()) {
+        LogException();
+        HandleHandshakeOrIoException(&timeout_alarm);
+        return;
+      }
+    }
+
     securegcm::UKey2Handshake::ParseResult parse_result =
-        server->ParseHandshakeMessage(std::string(client_init.result()));
+        crypto_pool_->Run([&server, &client_init]() {
+          return server->ParseHandshakeMessage(
+              std::string(std::move(client_init.result())));
+        });
 
     // Java code throws a HandshakeException / AlertException.
     if (!parse_result.success) {
@@ -127,8 +180,8 @@ class ServerRunnable final {
         << endpoint_id_ << ").";
 
     // Message 2 (Server Init)
-    std::unique_ptr<std::string> server_init =
-        server->GetNextHandshakeMessage();
+    std::unique_ptr<std::string> server_init = crypto_pool_->Run(
+        [&server]() { return server->GetNextHandshakeMessage(); });
 
     // Java code throws a HandshakeException.
     if (server_init == nullptr) {
@@ -158,8 +211,10 @@ class ServerRunnable final {
       return;
     }
 
-    parse_result =
-        server->ParseHandshakeMessage(std::string(client_finish.result()));
+    parse_result = crypto_pool_->Run([&server, &client_finish]() {
+      return server->ParseHandshakeMessage(
+          std::string(std::move(client_finish.result())));
+    });
 
     // Java code throws an AlertException or a HandshakeException.
     if (!parse_result.success) {
@@ -177,14 +232,60 @@ class ServerRunnable final {
 
     timeout_alarm.Cancel();
 
-    if (!HandleEncryptionSuccess(endpoint_id_, std::move(server), listener_)) {
+    if (!HandleEncryptionSuccess(endpoint_id_, std::move(server), crypto_pool_,
+                                 listener_)) {
       LogException();
       HandleHandshakeOrIoException(&timeout_alarm);
       return;
     }
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, kTraceName, endpoint_id_,
+                           {{"result", "success"}});
   }
 
  private:
+  ResumeResult TryResume(const SessionResumptionFrame& request,
+                         CancelableAlarm* timeout_alarm) const {
+    std::optional<SessionTicketCache::Ticket> ticket;
+    if (session_tickets_ != nullptr &&
+        request.type() == SessionResumptionFrame::REQUEST) {
+      ticket = session_tickets_->Take(endpoint_id_);
+    }
+    ByteArray client_nonce(request.nonce());
+    if (!ticket || std::string(ticket->id) != request.ticket_id() ||
+        !SessionTicketCache::MacsEqual(
+            SessionTicketCache::GetRequestMac(*ticket, client_nonce),
+            ByteArray(request.mac()))) {
+      NEARBY_LOGS(INFO) << "In StartServer(), rejecting session resumption "
+                           "by endpoint(id="
+                        << endpoint_id_ << ").";
+      return channel_->Write(parser::ForSessionResumptionReject()).Ok()
+                 ? ResumeResult::kRejected
+                 : ResumeResult::kFailed;
+    }
+
+    ByteArray server_nonce =
+        Utils::GenerateRandomBytes(SessionTicketCache::kNonceLength);
+    std::unique_ptr<securegcm::D2DConnectionContextV1> context =
+        SessionTicketCache::Resume(*ticket, client_nonce, server_nonce,
+                                   /*is_client=*/false);
+    if (context == nullptr) return ResumeResult::kFailed;
+    Exception write_exception =
+        channel_->Write(parser::ForSessionResumptionAccept(
+            ticket->id, server_nonce,
+            SessionTicketCache::GetAcceptMac(*ticket, client_nonce,
+                                             server_nonce)));
+    if (!write_exception.Ok()) return ResumeResult::kFailed;
+
+    NEARBY_LOGS(INFO) << "In StartServer(), resumed session with endpoint(id="
+                      << endpoint_id_ << ").";
+    timeout_alarm->Cancel();
+    listener_.on_resumed_cb(endpoint_id_, std::move(context),
+                            ticket->auth_token, ticket->raw_auth_token);
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, kTraceName, endpoint_id_,
+                           {{"result", "resumed"}});
+    return ResumeResult::kResumed;
+  }
+
   void LogException() const {
     NEARBY_LOGS(ERROR) << "In StartServer(), UKEY2 failed with endpoint(id="
                        << endpoint_id_ << ").";
@@ -192,6 +293,8 @@ class ServerRunnable final {
 
   void HandleHandshakeOrIoException(CancelableAlarm* timeout_alarm) const {
     timeout_alarm->Cancel();
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, kTraceName, endpoint_id_,
+                           {{"result", "failure"}});
     listener_.on_failure_cb(endpoint_id_, channel_);
   }
 
@@ -209,6 +312,8 @@ class ServerRunnable final {
 
   ClientProxy* client_;
   ScheduledExecutor* alarm_executor_;
+  SessionTicketCache* session_tickets_;
+  Ukey2CryptoPool* crypto_pool_;
   const std::string endpoint_id_;
   EndpointChannel* channel_;
   EncryptionRunner::ResultListener listener_;
@@ -217,22 +322,49 @@ class ServerRunnable final {
 class ClientRunnable final {
  public:
   ClientRunnable(ClientProxy* client, ScheduledExecutor* alarm_executor,
-                 const std::string& endpoint_id, EndpointChannel* channel,
+                 SessionTicketCache* session_tickets,
+                 Ukey2CryptoPool* crypto_pool, const std::string& endpoint_id,
+                 EndpointChannel* channel,
                  EncryptionRunner::ResultListener&& listener)
       : client_(client),
         alarm_executor_(alarm_executor),
+        session_tickets_(session_tickets),
+        crypto_pool_(crypto_pool),
         endpoint_id_(endpoint_id),
         channel_(channel),
         listener_(std::move(listener)) {}
 
   void operator()() const {
+    NEARBY_TRACE_ASYNC_BEGIN(
+        kTraceCategory, kTraceName, endpoint_id_,
+        {{"endpoint_id", endpoint_id_},
+         {"medium", proto::connections::Medium_Name(channel_->GetMedium())},
+         {"role", "initiator"}});
     CancelableAlarm timeout_alarm(
         "EncryptionRunner.StartClient() timeout",
         [this]() { CancelableAlarmRunnable(client_, endpoint_id_, channel_); },
         kTimeout, alarm_executor_);
 
+    std::optional<SessionTicketCache::Ticket> ticket;
+    if (session_tickets_ != nullptr &&
+        FeatureFlags::GetInstance().GetFlags().enable_session_resumption) {
+      ticket = session_tickets_->Take(endpoint_id_);
+    }
+    if (ticket) {
+      switch (TryResume(*ticket, &timeout_alarm)) {
+        case ResumeResult::kResumed:
+          return;
+        case ResumeResult::kRejected:
+          break;
+        case ResumeResult::kFailed:
+          LogException();
+          HandleHandshakeOrIoException(&timeout_alarm);
+          return;
+      }
+    }
+
     std::unique_ptr<securegcm::UKey2Handshake> crypto =
-        securegcm::UKey2Handshake::ForInitiator(kCipher);
+        crypto_pool_->TakeInitiator();
 
     // Java code throws a HandshakeException.
     if (crypto == nullptr) {
@@ -242,8 +374,8 @@ class ClientRunnable final {
     }
 
     // Message 1 (Client Init)
-    std::unique_ptr<std::string> client_init =
-        crypto->GetNextHandshakeMessage();
+    std::unique_ptr<std::string> client_init = crypto_pool_->Run(
+        [&crypto]() { return crypto->GetNextHandshakeMessage(); });
 
     // Java code throws a HandshakeException.
     if (client_init == nullptr) {
@@ -273,7 +405,10 @@ class ClientRunnable final {
     }
 
     securegcm::UKey2Handshake::ParseResult parse_result =
-        crypto->ParseHandshakeMessage(std::string(server_init.result()));
+        crypto_pool_->Run([&crypto, &server_init]() {
+          return crypto->ParseHandshakeMessage(
+              std::string(std::move(server_init.result())));
+        });
 
     // Java code throws an AlertException or a HandshakeException.
     if (!parse_result.success) {
@@ -290,8 +425,8 @@ class ClientRunnable final {
         << endpoint_id_ << ").";
 
     // Message 3 (Client Finish)
-    std::unique_ptr<std::string> client_finish =
-        crypto->GetNextHandshakeMessage();
+    std::unique_ptr<std::string> client_finish = crypto_pool_->Run(
+        [&crypto]() { return crypto->GetNextHandshakeMessage(); });
 
     // Java code throws a HandshakeException.
     if (client_finish == nullptr) {
@@ -314,14 +449,66 @@ class ClientRunnable final {
 
     timeout_alarm.Cancel();
 
-    if (!HandleEncryptionSuccess(endpoint_id_, std::move(crypto), listener_)) {
+    if (!HandleEncryptionSuccess(endpoint_id_, std::move(crypto), crypto_pool_,
+                                 listener_)) {
       LogException();
       HandleHandshakeOrIoException(&timeout_alarm);
       return;
     }
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, kTraceName, endpoint_id_,
+                           {{"result", "success"}});
   }
 
  private:
+  ResumeResult TryResume(const SessionTicketCache::Ticket& ticket,
+                         CancelableAlarm* timeout_alarm) const {
+    ByteArray client_nonce =
+        Utils::GenerateRandomBytes(SessionTicketCache::kNonceLength);
+    Exception write_exception =
+        channel_->Write(parser::ForSessionResumptionRequest(
+            ticket.id, client_nonce,
+            SessionTicketCache::GetRequestMac(ticket, client_nonce)));
+    if (!write_exception.Ok()) return ResumeResult::kFailed;
+
+    ExceptionOr<ByteArray> bytes = channel_->Read();
+    if (!bytes.ok()) return ResumeResult::kFailed;
+    ExceptionOr<OfflineFrame> response = parser::FromBytes(bytes.result());
+    if (!response.ok() || parser::GetFrameType(response.result()) !=
+                              V1Frame::SESSION_RESUMPTION) {
+      return ResumeResult::kFailed;
+    }
+    const SessionResumptionFrame& accept =
+        response.result().v1().session_resumption();
+    if (accept.type() == SessionResumptionFrame::REJECT) {
+      NEARBY_LOGS(INFO) << "In StartClient(), endpoint(id=" << endpoint_id_
+                        << ") rejected session resumption.";
+      return ResumeResult::kRejected;
+    }
+
+    ByteArray server_nonce(accept.nonce());
+    if (accept.type() != SessionResumptionFrame::ACCEPT ||
+        std::string(ticket.id) != accept.ticket_id() ||
+        !SessionTicketCache::MacsEqual(
+            SessionTicketCache::GetAcceptMac(ticket, client_nonce,
+                                             server_nonce),
+            ByteArray(accept.mac()))) {
+      return ResumeResult::kFailed;
+    }
+    std::unique_ptr<securegcm::D2DConnectionContextV1> context =
+        SessionTicketCache::Resume(ticket, client_nonce, server_nonce,
+                                   /*is_client=*/true);
+    if (context == nullptr) return ResumeResult::kFailed;
+
+    NEARBY_LOGS(INFO) << "In StartClient(), resumed session with endpoint(id="
+                      << endpoint_id_ << ").";
+    timeout_alarm->Cancel();
+    listener_.on_resumed_cb(endpoint_id_, std::move(context), ticket.auth_token,
+                            ticket.raw_auth_token);
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, kTraceName, endpoint_id_,
+                           {{"result", "resumed"}});
+    return ResumeResult::kResumed;
+  }
+
   void LogException() const {
     NEARBY_LOGS(ERROR) << "In StartClient(), UKEY2 failed with endpoint(id="
                        << endpoint_id_ << ").";
@@ -329,6 +516,8 @@ class ClientRunnable final {
 
   void HandleHandshakeOrIoException(CancelableAlarm* timeout_alarm) const {
     timeout_alarm->Cancel();
+    NEARBY_TRACE_ASYNC_END(kTraceCategory, kTraceName, endpoint_id_,
+                           {{"result", "failure"}});
     listener_.on_failure_cb(endpoint_id_, channel_);
   }
 
@@ -346,6 +535,8 @@ class ClientRunnable final {
 
   ClientProxy* client_;
   ScheduledExecutor* alarm_executor_;
+  SessionTicketCache* session_tickets_;
+  Ukey2CryptoPool* crypto_pool_;
   const std::string endpoint_id_;
   EndpointChannel* channel_;
   EncryptionRunner::ResultListener listener_;
@@ -366,8 +557,9 @@ void EncryptionRunner::StartServer(
     EncryptionRunner::ResultListener&& listener) {
   server_executor_.Execute(
       "encryption-server",
-      [runnable{ServerRunnable(client, &alarm_executor_, endpoint_id,
-                               endpoint_channel, std::move(listener))}]() {
+      [runnable{ServerRunnable(client, &alarm_executor_, session_tickets_,
+                               crypto_pool_, endpoint_id, endpoint_channel,
+                               std::move(listener))}]() {
         runnable();
       });
 }
@@ -378,8 +570,9 @@ void EncryptionRunner::StartClient(
     EncryptionRunner::ResultListener&& listener) {
   client_executor_.Execute(
       "encryption-client",
-      [runnable{ClientRunnable(client, &alarm_executor_, endpoint_id,
-                               endpoint_channel, std::move(listener))}]() {
+      [runnable{ClientRunnable(client, &alarm_executor_, session_tickets_,
+                               crypto_pool_, endpoint_id, endpoint_channel,
+                               std::move(listener))}]() {
         runnable();
       });
 }
@@ -15,15 +15,19 @@
 #ifndef CORE_INTERNAL_ENCRYPTION_RUNNER_H_
 #define CORE_INTERNAL_ENCRYPTION_RUNNER_H_
 
+#include <memory>
 #include <string>
 
+#include "securegcm/d2d_connection_context_v1.h"
 #include "securegcm/ukey2_handshake.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_channel.h"
+#include "connections/implementation/session_ticket_cache.h"
+#include "connections/implementation/ukey2_crypto_pool.h"
 #include "connections/listeners.h"
 #include "internal/platform/byte_array.h"
+#include "internal/platform/multi_thread_executor.h"
 #include "internal/platform/scheduled_executor.h"
-#include "internal/platform/single_thread_executor.h"
 
 namespace location {
 namespace nearby {
@@ -34,9 +38,22 @@ namespace connections {
 // NOTE: Stalled EndpointChannels will be disconnected after kTimeout.
 // This is to prevent unverified endpoints from maintaining an
 // indefinite connection to us.
+//
+// Up to kMaxConcurrentHandshakes handshakes of each role run at once, so that
+// a stalled endpoint doesn't hold up the others. Their EC math runs on the
+// shared Ukey2CryptoPool.
+//
+// Given a SessionTicketCache, a client that holds a ticket for the server
+// resumes the session with it in one round trip instead, if
+// FeatureFlags::enable_session_resumption is set. Servers answer resumption
+// requests either way, and fall back to UKEY2 when they can't resume.
 class EncryptionRunner {
  public:
+  static constexpr int kMaxConcurrentHandshakes = 16;
+
   EncryptionRunner() = default;
+  explicit EncryptionRunner(SessionTicketCache* session_tickets)
+      : session_tickets_(session_tickets) {}
   ~EncryptionRunner();
 
   struct ResultListener {
@@ -50,6 +67,19 @@ class EncryptionRunner {
                             std::unique_ptr<securegcm::UKey2Handshake>,
                             const std::string&, const ByteArray&>();
 
+    // The session was resumed with a session ticket. The authentication token
+    // is the one of the session the ticket was issued for.
+    //
+    // @EncryptionRunnerThread
+    std::function<void(
+        const std::string& endpoint_id,
+        std::unique_ptr<securegcm::D2DConnectionContextV1> context,
+        const std::string& auth_token, const ByteArray& raw_auth_token)>
+        on_resumed_cb = DefaultCallback<
+            const std::string&,
+            std::unique_ptr<securegcm::D2DConnectionContextV1>,
+            const std::string&, const ByteArray&>();
+
     // Encryption has failed. The remote_endpoint_id and channel are given so
     // that any pending state can be cleaned up.
     //
@@ -74,9 +104,11 @@ class EncryptionRunner {
                    ResultListener&& result_listener);
 
  private:
+  SessionTicketCache* const session_tickets_ = nullptr;
+  Ukey2CryptoPool* const crypto_pool_ = &Ukey2CryptoPool::GetInstance();
   ScheduledExecutor alarm_executor_;
-  SingleThreadExecutor server_executor_;
-  SingleThreadExecutor client_executor_;
+  MultiThreadExecutor server_executor_{kMaxConcurrentHandshakes};
+  MultiThreadExecutor client_executor_{kMaxConcurrentHandshakes};
 };
 
 }  // namespace connections
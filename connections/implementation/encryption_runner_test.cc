@@ -20,8 +20,10 @@
 #include "absl/time/clock.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_channel.h"
+#include "connections/implementation/session_ticket_cache.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/count_down_latch.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/pipe.h"
 #include "internal/platform/system_clock.h"
 #include "proto/connections_enums.pb.h"
@@ -89,7 +91,8 @@ struct User {
       : channel(&reader->GetInputStream(), &writer->GetOutputStream()) {}
 
   FakeEndpointChannel channel;
-  EncryptionRunner crypto;
+  SessionTicketCache tickets;
+  EncryptionRunner crypto{&tickets};
   ClientProxy client;
 };
 
@@ -105,6 +108,80 @@ struct Response {
   Status client_status = Status::kUnknown;
 };
 
+// Runs a UKEY2 handshake in memory and issues its session ticket to both
+// users.
+void IssueTickets(User& client, User& server) {
+  constexpr securegcm::UKey2Handshake::HandshakeCipher kCipher =
+      securegcm::UKey2Handshake::HandshakeCipher::P256_SHA512;
+  auto initiator = securegcm::UKey2Handshake::ForInitiator(kCipher);
+  auto responder = securegcm::UKey2Handshake::ForResponder(kCipher);
+  responder->ParseHandshakeMessage(*initiator->GetNextHandshakeMessage());
+  initiator->ParseHandshakeMessage(*responder->GetNextHandshakeMessage());
+  responder->ParseHandshakeMessage(*initiator->GetNextHandshakeMessage());
+  initiator->GetVerificationString(32);
+  responder->GetVerificationString(32);
+  initiator->VerifyHandshake();
+  responder->VerifyHandshake();
+  client.tickets.Issue("endpoint_id", *initiator->ToConnectionContext(),
+                       "TOKEN", ByteArray("raw"));
+  server.tickets.Issue("endpoint_id", *responder->ToConnectionContext(),
+                       "TOKEN", ByteArray("raw"));
+}
+
+struct ResumptionResponse {
+  enum class Status {
+    kUnknown = 0,
+    kResumed = 1,
+    kUkey2Done = 2,
+    kFailed = 3,
+  };
+
+  CountDownLatch latch{2};
+  Status server_status = Status::kUnknown;
+  Status client_status = Status::kUnknown;
+};
+
+// Starts encryption between |server| and |client|, and records how it ended
+// on each side in |response|.
+void StartResumption(User& server, User& client,
+                     ResumptionResponse& response) {
+  auto listener = [&response](ResumptionResponse::Status* status) {
+    return EncryptionRunner::ResultListener{
+        .on_success_cb =
+            [&response, status](
+                const std::string& endpoint_id,
+                std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+                const std::string& auth_token,
+                const ByteArray& raw_auth_token) {
+              *status = ResumptionResponse::Status::kUkey2Done;
+              response.latch.CountDown();
+            },
+        .on_resumed_cb =
+            [&response, status](
+                const std::string& endpoint_id,
+                std::unique_ptr<securegcm::D2DConnectionContextV1> context,
+                const std::string& auth_token,
+                const ByteArray& raw_auth_token) {
+              EXPECT_EQ(auth_token, "TOKEN");
+              EXPECT_EQ(raw_auth_token, ByteArray("raw"));
+              *status = context ? ResumptionResponse::Status::kResumed
+                                : ResumptionResponse::Status::kFailed;
+              response.latch.CountDown();
+            },
+        .on_failure_cb =
+            [&response, status](const std::string& endpoint_id,
+                                EndpointChannel* channel) {
+              *status = ResumptionResponse::Status::kFailed;
+              response.latch.CountDown();
+            },
+    };
+  };
+  server.crypto.StartServer(&server.client, "endpoint_id", &server.channel,
+                            listener(&response.server_status));
+  client.crypto.StartClient(&client.client, "endpoint_id", &client.channel,
+                            listener(&response.client_status));
+}
+
 TEST(EncryptionRunnerTest, ConstructorDestructorWorks) { EncryptionRunner enc; }
 
 TEST(EncryptionRunnerTest, ReadWrite) {
@@ -155,6 +232,110 @@ TEST(EncryptionRunnerTest, ReadWrite) {
   EXPECT_EQ(response.client_status, Response::Status::kDone);
 }
 
+TEST(EncryptionRunnerTest, StalledHandshakeDoesNotHoldUpOthers) {
+  // The peer of |stalled| never sends its first message.
+  Pipe unused;
+  Pipe from_a_to_stalled;
+  FakeEndpointChannel stalled(&unused.GetInputStream(),
+                              &from_a_to_stalled.GetOutputStream());
+  CountDownLatch stalled_latch(1);
+  Pipe from_a_to_b;
+  Pipe from_b_to_a;
+  User user_a(/*reader=*/&from_b_to_a, /*writer=*/&from_a_to_b);
+  User user_b(/*reader=*/&from_a_to_b, /*writer=*/&from_b_to_a);
+  Response response;
+
+  user_a.crypto.StartServer(
+      &user_a.client, "stalled_id", &stalled,
+      {
+          .on_failure_cb =
+              [&stalled_latch](const std::string& endpoint_id,
+                               EndpointChannel* channel) {
+                stalled_latch.CountDown();
+              },
+      });
+  user_a.crypto.StartServer(
+      &user_a.client, "endpoint_id", &user_a.channel,
+      {
+          .on_success_cb =
+              [&response](const std::string& endpoint_id,
+                          std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+                          const std::string& auth_token,
+                          const ByteArray& raw_auth_token) {
+                response.server_status = Response::Status::kDone;
+                response.latch.CountDown();
+              },
+          .on_failure_cb =
+              [&response](const std::string& endpoint_id,
+                          EndpointChannel* channel) {
+                response.server_status = Response::Status::kFailed;
+                response.latch.CountDown();
+              },
+      });
+  user_b.crypto.StartClient(
+      &user_b.client, "endpoint_id", &user_b.channel,
+      {
+          .on_success_cb =
+              [&response](const std::string& endpoint_id,
+                          std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+                          const std::string& auth_token,
+                          const ByteArray& raw_auth_token) {
+                response.client_status = Response::Status::kDone;
+                response.latch.CountDown();
+              },
+          .on_failure_cb =
+              [&response](const std::string& endpoint_id,
+                          EndpointChannel* channel) {
+                response.client_status = Response::Status::kFailed;
+                response.latch.CountDown();
+              },
+      });
+  EXPECT_TRUE(response.latch.Await(absl::Milliseconds(5000)).result());
+  EXPECT_EQ(response.server_status, Response::Status::kDone);
+  EXPECT_EQ(response.client_status, Response::Status::kDone);
+
+  stalled.Close();
+  EXPECT_TRUE(stalled_latch.Await(absl::Milliseconds(5000)).result());
+}
+
+TEST(EncryptionRunnerTest, ResumesSessionWithTicket) {
+  FeatureFlags::GetMutableFlagsForTesting().enable_session_resumption = true;
+  Pipe from_a_to_b;
+  Pipe from_b_to_a;
+  User user_a(/*reader=*/&from_b_to_a, /*writer=*/&from_a_to_b);
+  User user_b(/*reader=*/&from_a_to_b, /*writer=*/&from_b_to_a);
+  IssueTickets(/*client=*/user_b, /*server=*/user_a);
+  ResumptionResponse response;
+
+  StartResumption(/*server=*/user_a, /*client=*/user_b, response);
+
+  EXPECT_TRUE(response.latch.Await(absl::Milliseconds(5000)).result());
+  EXPECT_EQ(response.server_status, ResumptionResponse::Status::kResumed);
+  EXPECT_EQ(response.client_status, ResumptionResponse::Status::kResumed);
+  // Tickets are single use.
+  EXPECT_EQ(user_a.tickets.GetSize(), 0);
+  EXPECT_EQ(user_b.tickets.GetSize(), 0);
+  FeatureFlags::GetMutableFlagsForTesting().enable_session_resumption = false;
+}
+
+TEST(EncryptionRunnerTest, FallsBackToUkey2WithoutServerTicket) {
+  FeatureFlags::GetMutableFlagsForTesting().enable_session_resumption = true;
+  Pipe from_a_to_b;
+  Pipe from_b_to_a;
+  User user_a(/*reader=*/&from_b_to_a, /*writer=*/&from_a_to_b);
+  User user_b(/*reader=*/&from_a_to_b, /*writer=*/&from_b_to_a);
+  IssueTickets(/*client=*/user_b, /*server=*/user_a);
+  user_a.tickets.Revoke("endpoint_id");
+  ResumptionResponse response;
+
+  StartResumption(/*server=*/user_a, /*client=*/user_b, response);
+
+  EXPECT_TRUE(response.latch.Await(absl::Milliseconds(5000)).result());
+  EXPECT_EQ(response.server_status, ResumptionResponse::Status::kUkey2Done);
+  EXPECT_EQ(response.client_status, ResumptionResponse::Status::kUkey2Done);
+  FeatureFlags::GetMutableFlagsForTesting().enable_session_resumption = false;
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
@@ -16,11 +16,14 @@
 #define CORE_INTERNAL_ENDPOINT_CHANNEL_H_
 
 #include <cstdint>
+#include <memory>
 #include <string>
 
 #include "securegcm/d2d_connection_context_v1.h"
 #include "absl/time/clock.h"
+#include "absl/types/span.h"
 #include "connections/implementation/analytics/analytics_recorder.h"
+#include "connections/implementation/transfer_metrics.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/mutex.h"
@@ -41,6 +44,16 @@ class EndpointChannel {
 
   virtual Exception Write(const ByteArray& data) = 0;  // throws Exception::IO
 
+  // Writes |frames| back to back, as many Write() calls would, and stops at the
+  // first one that fails. Channels may put several frames on the wire at once.
+  virtual Exception WriteBatch(absl::Span<const ByteArray> frames) {
+    for (const ByteArray& frame : frames) {
+      Exception exception = Write(frame);
+      if (!exception.Ok()) return exception;
+    }
+    return {Exception::kSuccess};
+  }
+
   // Closes this EndpointChannel, without tracking the closure in analytics.
   virtual void Close() = 0;
 
@@ -100,10 +113,21 @@ class EndpointChannel {
   // writes have occurred.
   virtual absl::Time GetLastWriteTimestamp() const = 0;
 
+  // Returns a file descriptor that polls readable while there is data for
+  // Read() to start on, or -1 if the channel can't tell; see
+  // InputStream::GetReadinessFd().
+  virtual int GetReadinessFd() { return -1; }
+
   // Sets the AnalyticsRecorder instance for analytics.
   virtual void SetAnalyticsRecorder(
       analytics::AnalyticsRecorder* analytics_recorder,
       const std::string& endpoint_id) = 0;
+
+  // Returns the metrics the traffic of this channel is timed in, or null
+  // before the channel was given to an endpoint, or if it doesn't keep any.
+  virtual std::shared_ptr<TransferMetrics> GetTransferMetrics() {
+    return nullptr;
+  }
 };
 
 inline bool operator==(const EndpointChannel& lhs, const EndpointChannel& rhs) {
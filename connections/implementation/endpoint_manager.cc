@@ -19,13 +19,19 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/container/btree_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "connections/implementation/endpoint_channel.h"
 #include "connections/implementation/offline_frames.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/implementation/service_id_constants.h"
+#include "internal/platform/cancelable.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/mutex_lock.h"
 
@@ -33,6 +39,30 @@ namespace location {
 namespace nearby {
 namespace connections {
 
+namespace {
+
+// Serializes |payload_chunk| as DATA frames whose bodies are at most
+// |frame_size| bytes.
+std::vector<ByteArray> ForDataPayloadTransferFrames(
+    const PayloadTransferFrame::PayloadHeader& payload_header,
+    const PayloadTransferFrame::PayloadChunk& payload_chunk, int frame_size) {
+  const std::string& body = payload_chunk.body();
+  if (frame_size <= 0 || body.size() <= static_cast<size_t>(frame_size)) {
+    return {parser::ForDataPayloadTransfer(payload_header, payload_chunk)};
+  }
+
+  std::vector<ByteArray> frames;
+  frames.reserve((body.size() + frame_size - 1) / frame_size);
+  for (size_t pos = 0; pos < body.size(); pos += frame_size) {
+    frames.push_back(parser::ForDataPayloadTransfer(
+        payload_header, payload_chunk.offset() + pos, payload_chunk.flags(),
+        absl::string_view(body).substr(pos, frame_size)));
+  }
+  return frames;
+}
+
+}  // namespace
+
 constexpr absl::Duration EndpointManager::kProcessEndpointDisconnectionTimeout;
 constexpr absl::Time EndpointManager::kInvalidTimestamp;
 
@@ -70,6 +100,212 @@ class EndpointManager::LockedFrameProcessor {
   FrameProcessorWithMutex* frame_processor_with_mutex_ = nullptr;
 };
 
+// Reads the frames of an endpoint on reactor_ threads, one per readiness event,
+// and hands them to the FrameProcessors like HandleData() does. A frame that
+// has only partly arrived still blocks its reactor thread until the rest does.
+//
+// Follows the endpoint to replacement channels, like
+// EndpointChannelLoopRunnable() does. Once on a channel that can't report
+// readiness, it gives the endpoint a reader thread of its own, running
+// EndpointChannelLoopRunnable().
+class EndpointManager::ReactorReader
+    : public std::enable_shared_from_this<ReactorReader> {
+ public:
+  ReactorReader(EndpointManager* manager, ClientProxy* client,
+                const std::string& endpoint_id)
+      : manager_(manager), client_(client), endpoint_id_(endpoint_id) {}
+
+  void Start() ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    std::shared_ptr<EndpointChannel> channel =
+        manager_->GetWorkerChannel(endpoint_id_, last_failed_medium_);
+    if (channel == nullptr) {
+      manager_->DiscardEndpoint(client_, endpoint_id_);
+      return;
+    }
+    ReadFromLocked(std::move(channel));
+  }
+
+  // Returns once no frame is being handled anymore, and none will be. The
+  // endpoint's channel must be closed first, to unblock a pending read.
+  void Stop() ABSL_LOCKS_EXCLUDED(mutex_) {
+    std::unique_ptr<SingleThreadExecutor> thread;
+    int fd;
+    {
+      MutexLock lock(&mutex_);
+      stopped_ = true;
+      fd = fd_;
+      thread = std::move(thread_);
+    }
+    if (fd >= 0) manager_->reactor_->Unwatch(fd);
+    // Waits for the thread to finish, if there's one.
+    thread.reset();
+  }
+
+ private:
+  void ReadFromLocked(std::shared_ptr<EndpointChannel> channel)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    channel_ = std::move(channel);
+    fd_ = channel_->GetReadinessFd();
+    if (fd_ >= 0 &&
+        manager_->reactor_->Watch(fd_, [self = shared_from_this()]() {
+          return self->OnReadable();
+        })) {
+      return;
+    }
+
+    NEARBY_LOGS(INFO) << "Channel " << channel_->GetType()
+                      << " can't report readiness; reading endpoint "
+                      << endpoint_id_ << " on a dedicated thread";
+    fd_ = -1;
+    thread_ = std::make_unique<SingleThreadExecutor>();
+    thread_->Execute("reader", [manager = manager_, client = client_,
+                                endpoint_id = endpoint_id_]() {
+      manager->EndpointChannelLoopRunnable(
+          "Read", client, endpoint_id,
+          [manager, client, endpoint_id](EndpointChannel* channel) {
+            return manager->HandleData(endpoint_id, client, channel);
+          });
+    });
+  }
+
+  // Runs on a reactor thread, never concurrently with itself.
+  bool OnReadable() ABSL_LOCKS_EXCLUDED(mutex_) {
+    std::shared_ptr<EndpointChannel> channel;
+    {
+      MutexLock lock(&mutex_);
+      if (stopped_) return false;
+      channel = channel_;
+    }
+
+    ExceptionOr<bool> result =
+        manager_->HandleFrame(endpoint_id_, client_, channel.get());
+    if (result.ok() && result.result()) return true;
+
+    MutexLock lock(&mutex_);
+    if (stopped_) return false;
+    std::shared_ptr<EndpointChannel> next_channel;
+    if (ShouldRetryChannel(result, *channel, &last_failed_medium_)) {
+      next_channel =
+          manager_->GetWorkerChannel(endpoint_id_, last_failed_medium_);
+    }
+    // Let go of the old channel's descriptor before watching the new one,
+    // which may well reuse its number.
+    manager_->reactor_->Unwatch(fd_);
+    fd_ = -1;
+    if (next_channel == nullptr) {
+      NEARBY_LOGS(INFO) << "Reactor reader done; endpoint_id=" << endpoint_id_;
+      manager_->DiscardEndpoint(client_, endpoint_id_);
+      return false;
+    }
+    ReadFromLocked(std::move(next_channel));
+    return false;
+  }
+
+  EndpointManager* const manager_;
+  ClientProxy* const client_;
+  const std::string endpoint_id_;
+
+  Mutex mutex_;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  Medium last_failed_medium_ ABSL_GUARDED_BY(mutex_) = Medium::UNKNOWN_MEDIUM;
+  std::shared_ptr<EndpointChannel> channel_ ABSL_GUARDED_BY(mutex_);
+  // The descriptor watched for |channel_|, if any.
+  int fd_ ABSL_GUARDED_BY(mutex_) = -1;
+  // Reads instead of the reactor once on a channel without readiness.
+  std::unique_ptr<SingleThreadExecutor> thread_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Sends the KeepAlive frames of an endpoint, and watches it for silence. Each
+// check schedules the next one on the shared keep_alive_executor_, so that
+// waiting for it costs a timer rather than a thread.
+class EndpointManager::KeepAliveTimer
+    : public std::enable_shared_from_this<KeepAliveTimer> {
+ public:
+  KeepAliveTimer(EndpointManager* manager, ClientProxy* client,
+                 const std::string& endpoint_id,
+                 absl::Duration keep_alive_interval,
+                 absl::Duration keep_alive_timeout)
+      : manager_(manager),
+        client_(client),
+        endpoint_id_(endpoint_id),
+        keep_alive_interval_(keep_alive_interval),
+        keep_alive_timeout_(keep_alive_timeout) {}
+
+  void Start() ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    ScheduleLocked(absl::ZeroDuration());
+  }
+
+  // Returns once no check is running anymore, and none will.
+  void Stop() ABSL_LOCKS_EXCLUDED(mutex_) {
+    Cancelable next_check;
+    {
+      MutexLock lock(&mutex_);
+      stopped_ = true;
+      next_check = next_check_;
+    }
+    // Waits for the check to finish if it's running already.
+    next_check.Cancel();
+  }
+
+ private:
+  void ScheduleLocked(absl::Duration delay)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    next_check_ = manager_->keep_alive_executor_.Schedule(
+        [self = shared_from_this()]() { self->Check(); }, delay);
+  }
+
+  void Check() ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    if (stopped_) return;
+
+    std::shared_ptr<EndpointChannel> channel =
+        manager_->GetWorkerChannel(endpoint_id_, last_failed_medium_);
+    if (channel == nullptr) {
+      Finish();
+      return;
+    }
+    // A write to a paused channel blocks until it's resumed, which would hold
+    // up the checks of all the other endpoints.
+    if (channel->IsPaused()) {
+      ScheduleLocked(keep_alive_interval_);
+      return;
+    }
+
+    ExceptionOr<absl::Duration> wait_for = manager_->SendKeepAliveIfDue(
+        channel.get(), keep_alive_interval_, keep_alive_timeout_);
+    if (wait_for.ok()) {
+      ScheduleLocked(wait_for.result());
+      return;
+    }
+    if (!wait_for.GetException().Raised(Exception::kTimeout) &&
+        ShouldRetryChannel(ExceptionOr<bool>(wait_for.exception()), *channel,
+                           &last_failed_medium_)) {
+      ScheduleLocked(absl::ZeroDuration());
+      return;
+    }
+    Finish();
+  }
+
+  void Finish() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    NEARBY_LOGS(INFO) << "KeepAlive timer done; endpoint_id=" << endpoint_id_;
+    stopped_ = true;
+    manager_->DiscardEndpoint(client_, endpoint_id_);
+  }
+
+  EndpointManager* const manager_;
+  ClientProxy* const client_;
+  const std::string endpoint_id_;
+  const absl::Duration keep_alive_interval_;
+  const absl::Duration keep_alive_timeout_;
+
+  Mutex mutex_;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  Medium last_failed_medium_ ABSL_GUARDED_BY(mutex_) = Medium::UNKNOWN_MEDIUM;
+  Cancelable next_check_ ABSL_GUARDED_BY(mutex_);
+};
+
 // A Runnable that continuously grabs the most recent EndpointChannel available
 // for an endpoint.
 //
@@ -94,56 +330,13 @@ void EndpointManager::EndpointChannelLoopRunnable(
              runnable_name.c_str(), endpoint_id.c_str());
   Medium last_failed_medium = Medium::UNKNOWN_MEDIUM;
   while (true) {
-    // It's important to keep re-fetching the EndpointChannel for an endpoint
-    // because it can be changed out from under us (for example, when we
-    // upgrade from Bluetooth to Wifi).
     std::shared_ptr<EndpointChannel> channel =
-        channel_manager_->GetChannelForEndpoint(endpoint_id);
-    if (channel == nullptr) {
-      NEARBY_LOG(INFO, "Endpoint channel is nullptr, bail out.");
-      break;
-    }
-
-    // If we're looping back around after a failure, and there's not a new
-    // EndpointChannel for this endpoint, there's nothing more to do here.
-    if ((last_failed_medium != Medium::UNKNOWN_MEDIUM) &&
-        (channel->GetMedium() == last_failed_medium)) {
-      NEARBY_LOG(
-          INFO, "No new endpoint channel is found after a failure, exit loop.");
-      break;
-    }
+        GetWorkerChannel(endpoint_id, last_failed_medium);
+    if (channel == nullptr) break;
 
     ExceptionOr<bool> keep_using_channel = handler(channel.get());
-
-    if (!keep_using_channel.ok()) {
-      Exception exception = keep_using_channel.GetException();
-      // An "invalid proto" may be a final payload on a channel we're about to
-      // close, so we'll loop back around once. We set |last_failed_medium| to
-      // ensure we don't loop indefinitely. See crbug.com/1182031 for more
-      // detail.
-      if (exception.Raised(Exception::kInvalidProtocolBuffer)) {
-        last_failed_medium = channel->GetMedium();
-        NEARBY_LOGS(INFO)
-            << "Received invalid protobuf message, re-fetching endpoint "
-               "channel; last_failed_medium="
-            << proto::connections::Medium_Name(last_failed_medium);
-        continue;
-      }
-      if (exception.Raised(Exception::kIo)) {
-        last_failed_medium = channel->GetMedium();
-        NEARBY_LOGS(INFO)
-            << "Endpoint channel IO exception; last_failed_medium="
-            << proto::connections::Medium_Name(last_failed_medium);
-        continue;
-      }
-      if (exception.Raised(Exception::kInterrupted)) {
-        break;
-      }
-    }
-
-    if (!keep_using_channel.result()) {
-      NEARBY_LOGS(INFO) << "Dropping current channel: last medium="
-                        << proto::connections::Medium_Name(last_failed_medium);
+    if (!ShouldRetryChannel(keep_using_channel, *channel,
+                            &last_failed_medium)) {
       break;
     }
   }
@@ -158,6 +351,65 @@ void EndpointManager::EndpointChannelLoopRunnable(
                     << "; endpoint_id=" << endpoint_id;
 }
 
+std::shared_ptr<EndpointChannel> EndpointManager::GetWorkerChannel(
+    const std::string& endpoint_id, Medium last_failed_medium) {
+  // It's important to keep re-fetching the EndpointChannel for an endpoint
+  // because it can be changed out from under us (for example, when we
+  // upgrade from Bluetooth to Wifi).
+  std::shared_ptr<EndpointChannel> channel =
+      channel_manager_->GetChannelForEndpoint(endpoint_id);
+  if (channel == nullptr) {
+    NEARBY_LOG(INFO, "Endpoint channel is nullptr, bail out.");
+    return nullptr;
+  }
+
+  // If we're looping back around after a failure, and there's not a new
+  // EndpointChannel for this endpoint, there's nothing more to do here.
+  if ((last_failed_medium != Medium::UNKNOWN_MEDIUM) &&
+      (channel->GetMedium() == last_failed_medium)) {
+    NEARBY_LOG(INFO,
+               "No new endpoint channel is found after a failure, exit loop.");
+    return nullptr;
+  }
+  return channel;
+}
+
+bool EndpointManager::ShouldRetryChannel(const ExceptionOr<bool>& result,
+                                         const EndpointChannel& channel,
+                                         Medium* last_failed_medium) {
+  if (!result.ok()) {
+    Exception exception = result.GetException();
+    // An "invalid proto" may be a final payload on a channel we're about to
+    // close, so we'll loop back around once. We set |last_failed_medium| to
+    // ensure we don't loop indefinitely. See crbug.com/1182031 for more
+    // detail.
+    if (exception.Raised(Exception::kInvalidProtocolBuffer)) {
+      *last_failed_medium = channel.GetMedium();
+      NEARBY_LOGS(INFO)
+          << "Received invalid protobuf message, re-fetching endpoint "
+             "channel; last_failed_medium="
+          << proto::connections::Medium_Name(*last_failed_medium);
+      return true;
+    }
+    if (exception.Raised(Exception::kIo)) {
+      *last_failed_medium = channel.GetMedium();
+      NEARBY_LOGS(INFO) << "Endpoint channel IO exception; last_failed_medium="
+                        << proto::connections::Medium_Name(*last_failed_medium);
+      return true;
+    }
+    if (exception.Raised(Exception::kInterrupted)) {
+      return false;
+    }
+  }
+
+  if (!result.result()) {
+    NEARBY_LOGS(INFO) << "Dropping current channel: last medium="
+                      << proto::connections::Medium_Name(*last_failed_medium);
+    return false;
+  }
+  return true;
+}
+
 ExceptionOr<bool> EndpointManager::HandleData(
     const std::string& endpoint_id, ClientProxy* client,
     EndpointChannel* endpoint_channel) {
@@ -167,57 +419,92 @@ ExceptionOr<bool> EndpointManager::HandleData(
   // a replacement for this endpoint since we last checked with the
   // EndpointChannelManager.
   while (true) {
-    ExceptionOr<ByteArray> bytes = endpoint_channel->Read();
-    if (!bytes.ok()) {
-      NEARBY_LOG(INFO, "Stop reading on read-time exception: %d",
-                 bytes.exception());
-      return ExceptionOr<bool>(bytes.exception());
-    }
-    ExceptionOr<OfflineFrame> wrapped_frame = parser::FromBytes(bytes.result());
-    if (!wrapped_frame.ok()) {
-      if (wrapped_frame.GetException().Raised(
-              Exception::kInvalidProtocolBuffer)) {
-        NEARBY_LOG(INFO, "Failed to decode; endpoint=%s; channel=%s; skip",
-                   endpoint_id.c_str(), endpoint_channel->GetType().c_str());
-        continue;
-      } else {
-        NEARBY_LOG(INFO, "Stop reading on parse-time exception: %d",
-                   wrapped_frame.exception());
-        return ExceptionOr<bool>(wrapped_frame.exception());
-      }
-    }
-    OfflineFrame& frame = wrapped_frame.result();
+    ExceptionOr<bool> keep_reading =
+        HandleFrame(endpoint_id, client, endpoint_channel);
+    if (!keep_reading.ok() || !keep_reading.result()) return keep_reading;
+  }
+}
 
-    // Route the incoming offlineFrame to its registered processor.
-    V1Frame::FrameType frame_type = parser::GetFrameType(frame);
-    LockedFrameProcessor frame_processor = GetFrameProcessor(frame_type);
+ExceptionOr<bool> EndpointManager::HandleFrame(
+    const std::string& endpoint_id, ClientProxy* client,
+    EndpointChannel* endpoint_channel) {
+  ExceptionOr<ByteArray> bytes = endpoint_channel->Read();
+  if (!bytes.ok()) {
+    NEARBY_LOG(INFO, "Stop reading on read-time exception: %d",
+               bytes.exception());
+    return ExceptionOr<bool>(bytes.exception());
+  }
+  absl::Time start_time = SystemClock::ElapsedRealtime();
+  std::shared_ptr<TransferMetrics> transfer_metrics =
+      endpoint_channel->GetTransferMetrics();
+  // DATA frames, which carry the bulk of the traffic, skip the OfflineFrame.
+  absl::optional<parser::DataFrame> data_frame =
+      parser::DataFrameFromBytes(bytes.result());
+  if (data_frame) {
+    if (transfer_metrics) {
+      transfer_metrics->Record(TransferMetrics::Stage::kParseFrame,
+                               SystemClock::ElapsedRealtime() - start_time);
+    }
+    LockedFrameProcessor frame_processor =
+        GetFrameProcessor(V1Frame::PAYLOAD_TRANSFER);
     if (!frame_processor) {
-      // report messages without handlers, except KEEP_ALIVE, which has
-      // no explicit handler.
-      if (frame_type == V1Frame::KEEP_ALIVE) {
-        NEARBY_LOG(INFO, "KeepAlive message for endpoint %s",
-                   endpoint_id.c_str());
-      } else if (frame_type == V1Frame::DISCONNECTION) {
-        NEARBY_LOG(INFO, "Disconnect message for endpoint %s",
-                   endpoint_id.c_str());
-        endpoint_channel->Close();
-      } else {
-        NEARBY_LOGS(ERROR) << "Unhandled message: endpoint_id=" << endpoint_id
-                           << ", frame type="
-                           << V1Frame::FrameType_Name(frame_type);
-      }
-      continue;
+      NEARBY_LOGS(ERROR) << "Unhandled message: endpoint_id=" << endpoint_id
+                         << ", frame type="
+                         << V1Frame::FrameType_Name(V1Frame::PAYLOAD_TRANSFER);
+      return ExceptionOr<bool>(true);
+    }
+    frame_processor->OnIncomingDataFrame(*data_frame, endpoint_id, client,
+                                         endpoint_channel->GetMedium());
+    return ExceptionOr<bool>(true);
+  }
+  ExceptionOr<OfflineFrame> wrapped_frame = parser::FromBytes(bytes.result());
+  if (transfer_metrics) {
+    transfer_metrics->Record(TransferMetrics::Stage::kParseFrame,
+                             SystemClock::ElapsedRealtime() - start_time);
+  }
+  if (!wrapped_frame.ok()) {
+    if (wrapped_frame.GetException().Raised(
+            Exception::kInvalidProtocolBuffer)) {
+      NEARBY_LOG(INFO, "Failed to decode; endpoint=%s; channel=%s; skip",
+                 endpoint_id.c_str(), endpoint_channel->GetType().c_str());
+      return ExceptionOr<bool>(true);
+    } else {
+      NEARBY_LOG(INFO, "Stop reading on parse-time exception: %d",
+                 wrapped_frame.exception());
+      return ExceptionOr<bool>(wrapped_frame.exception());
     }
-
-    frame_processor->OnIncomingFrame(frame, endpoint_id, client,
-                                     endpoint_channel->GetMedium());
   }
+  OfflineFrame& frame = wrapped_frame.result();
+
+  // Route the incoming offlineFrame to its registered processor.
+  V1Frame::FrameType frame_type = parser::GetFrameType(frame);
+  LockedFrameProcessor frame_processor = GetFrameProcessor(frame_type);
+  if (!frame_processor) {
+    // report messages without handlers, except KEEP_ALIVE, which has
+    // no explicit handler.
+    if (frame_type == V1Frame::KEEP_ALIVE) {
+      NEARBY_LOG(INFO, "KeepAlive message for endpoint %s",
+                 endpoint_id.c_str());
+    } else if (frame_type == V1Frame::DISCONNECTION) {
+      NEARBY_LOG(INFO, "Disconnect message for endpoint %s",
+                 endpoint_id.c_str());
+      endpoint_channel->Close();
+    } else {
+      NEARBY_LOGS(ERROR) << "Unhandled message: endpoint_id=" << endpoint_id
+                         << ", frame type="
+                         << V1Frame::FrameType_Name(frame_type);
+    }
+    return ExceptionOr<bool>(true);
+  }
+
+  frame_processor->OnIncomingFrame(frame, endpoint_id, client,
+                                   endpoint_channel->GetMedium());
+  return ExceptionOr<bool>(true);
 }
 
-ExceptionOr<bool> EndpointManager::HandleKeepAlive(
+ExceptionOr<absl::Duration> EndpointManager::SendKeepAliveIfDue(
     EndpointChannel* endpoint_channel, absl::Duration keep_alive_interval,
-    absl::Duration keep_alive_timeout, Mutex* keep_alive_waiter_mutex,
-    ConditionVariable* keep_alive_waiter) {
+    absl::Duration keep_alive_timeout) {
   // Check if it has been too long since we received a frame from our endpoint.
   absl::Time last_read_time = endpoint_channel->GetLastReadTimestamp();
   absl::Duration duration_until_timeout =
@@ -226,7 +513,7 @@ ExceptionOr<bool> EndpointManager::HandleKeepAlive(
           : last_read_time + keep_alive_timeout -
                 SystemClock::ElapsedRealtime();
   if (duration_until_timeout <= absl::ZeroDuration()) {
-    return ExceptionOr<bool>(false);
+    return ExceptionOr<absl::Duration>(Exception::kTimeout);
   }
 
   // If we haven't written anything to the endpoint for a while, attempt to send
@@ -242,22 +529,29 @@ ExceptionOr<bool> EndpointManager::HandleKeepAlive(
   if (duration_until_write_keep_alive <= absl::ZeroDuration()) {
     Exception write_exception = endpoint_channel->Write(parser::ForKeepAlive());
     if (!write_exception.Ok()) {
-      return ExceptionOr<bool>(write_exception);
+      return ExceptionOr<absl::Duration>(write_exception);
     }
     duration_until_write_keep_alive = keep_alive_interval;
   }
 
-  absl::Duration wait_for =
-      std::min(duration_until_timeout, duration_until_write_keep_alive);
-  {
-    MutexLock lock(keep_alive_waiter_mutex);
-    Exception wait_exception = keep_alive_waiter->Wait(wait_for);
-    if (!wait_exception.Ok()) {
-      return ExceptionOr<bool>(wait_exception);
-    }
-  }
+  return ExceptionOr<absl::Duration>(
+      std::min(duration_until_timeout, duration_until_write_keep_alive));
+}
 
-  return ExceptionOr<bool>(true);
+void EndpointManager::FrameProcessor::OnIncomingDataFrame(
+    parser::DataFrame& data_frame, const std::string& from_endpoint_id,
+    ClientProxy* to_client, proto::connections::Medium current_medium) {
+  OfflineFrame offline_frame;
+  offline_frame.set_version(OfflineFrame::V1);
+  V1Frame* v1_frame = offline_frame.mutable_v1();
+  v1_frame->set_type(V1Frame::PAYLOAD_TRANSFER);
+  PayloadTransferFrame* frame = v1_frame->mutable_payload_transfer();
+  *frame = std::move(data_frame.frame);
+  if (!data_frame.body.Empty()) {
+    frame->mutable_payload_chunk()->set_body(
+        std::string(std::move(data_frame.body)));
+  }
+  OnIncomingFrame(offline_frame, from_endpoint_id, to_client, current_medium);
 }
 
 bool operator==(const EndpointManager::FrameProcessor& lhs,
@@ -275,7 +569,23 @@ bool operator<(const EndpointManager::FrameProcessor& lhs,
 }
 
 EndpointManager::EndpointManager(EndpointChannelManager* manager)
-    : channel_manager_(manager) {}
+    : channel_manager_(manager),
+      fan_out_writer_(
+          manager,
+          FeatureFlags::GetInstance()
+              .GetFlags()
+              .payload_fan_out_max_lag_chunks,
+          [this](const std::string& endpoint_id, std::int64_t size_bytes,
+                 absl::Duration elapsed) {
+            OnDataFrameWritten(endpoint_id, size_bytes, elapsed);
+          }) {
+  const FeatureFlags::Flags& flags = FeatureFlags::GetInstance().GetFlags();
+  if (flags.enable_endpoint_reactor && IoReactor::IsSupported()) {
+    NEARBY_LOGS(INFO) << "EndpointManager serving endpoints from a reactor of "
+                      << flags.endpoint_reactor_threads << " threads";
+    reactor_ = std::make_unique<IoReactor>(flags.endpoint_reactor_threads);
+  }
+}
 
 EndpointManager::~EndpointManager() {
   NEARBY_LOG(INFO, "Initiating shutdown of EndpointManager.");
@@ -286,6 +596,7 @@ EndpointManager::~EndpointManager() {
     latch.CountDown();
   });
   latch.Await();
+  if (reactor_) reactor_->Shutdown();
 
   NEARBY_LOG(INFO, "Bringing down control thread");
   serial_executor_.Shutdown();
@@ -361,6 +672,9 @@ void EndpointManager::RemoveEndpointState(const std::string& endpoint_id) {
   } else {
     NEARBY_LOGS(INFO) << "EndpointState not found for endpoint " << endpoint_id;
   }
+  fan_out_writer_.RemoveEndpoint(endpoint_id);
+  MutexLock lock(&chunk_size_mutex_);
+  chunk_size_controllers_.erase(endpoint_id);
 }
 
 void EndpointManager::RegisterEndpoint(
@@ -420,19 +734,24 @@ void EndpointManager::RegisterEndpoint(
     // the next frame. If the handler fails its read and no other
     // EndpointChannels are available for this endpoint, a disconnection
     // will be initiated.
-    endpoint_state.StartEndpointReader([this, client, endpoint_id]() {
-      EndpointChannelLoopRunnable(
-          "Read", client, endpoint_id,
-          [this, client, endpoint_id](EndpointChannel* channel) {
-            return HandleData(endpoint_id, client, channel);
-          });
-    });
+    if (reactor_) {
+      endpoint_state.StartReactorReader(
+          std::make_shared<ReactorReader>(this, client, endpoint_id));
+    } else {
+      endpoint_state.StartEndpointReader([this, client, endpoint_id]() {
+        EndpointChannelLoopRunnable(
+            "Read", client, endpoint_id,
+            [this, client, endpoint_id](EndpointChannel* channel) {
+              return HandleData(endpoint_id, client, channel);
+            });
+      });
+    }
 
-    // For every endpoint, there's only one KeepAliveManager instance running on
-    // a dedicated thread. This instance will periodically send out a ping* to
-    // the endpoint while listening for an incoming pong**. If it fails to send
-    // the ping, or if no pong is heard within keep_alive_timeout, it initiates
-    // a disconnection.
+    // For every endpoint, there's only one KeepAliveTimer instance, whose
+    // checks run on the shared keep_alive_executor_. It will periodically send
+    // out a ping* to the endpoint while listening for an incoming pong**. If
+    // it fails to send the ping, or if no pong is heard within
+    // keep_alive_timeout, it initiates a disconnection.
     //
     // (*) Bluetooth requires a constant outgoing stream of messages. If
     // there's silence, Android will break the socket. This is why we ping.
@@ -441,20 +760,8 @@ void EndpointManager::RegisterEndpoint(
     // for the pong.
     NEARBY_LOGS(VERBOSE) << "EndpointManager enabling KeepAlive for endpoint "
                          << endpoint_id;
-    endpoint_state.StartEndpointKeepAliveManager(
-        [this, client, endpoint_id, keep_alive_interval, keep_alive_timeout](
-            Mutex* keep_alive_waiter_mutex,
-            ConditionVariable* keep_alive_waiter) {
-          EndpointChannelLoopRunnable(
-              "KeepAliveManager", client, endpoint_id,
-              [this, keep_alive_interval, keep_alive_timeout,
-               keep_alive_waiter_mutex,
-               keep_alive_waiter](EndpointChannel* channel) {
-                return HandleKeepAlive(
-                    channel, keep_alive_interval, keep_alive_timeout,
-                    keep_alive_waiter_mutex, keep_alive_waiter);
-              });
-        });
+    endpoint_state.StartKeepAliveTimer(std::make_shared<KeepAliveTimer>(
+        this, client, endpoint_id, keep_alive_interval, keep_alive_timeout));
     NEARBY_LOGS(INFO) << "Registering endpoint " << endpoint_id
                       << ", workers started and notifying client.";
 
@@ -490,18 +797,95 @@ int EndpointManager::GetMaxTransmitPacketSize(const std::string& endpoint_id) {
   return channel->GetMaxTransmitPacketSize();
 }
 
+int EndpointManager::GetChunkSize(const std::string& endpoint_id) {
+  std::shared_ptr<EndpointChannel> channel =
+      channel_manager_->GetChannelForEndpoint(endpoint_id);
+  if (channel == nullptr) {
+    return 0;
+  }
+
+  std::shared_ptr<ChunkSizeController> controller;
+  {
+    MutexLock lock(&chunk_size_mutex_);
+    auto item = chunk_size_controllers_.find(endpoint_id);
+    if (item == chunk_size_controllers_.end()) {
+      item = chunk_size_controllers_
+                 .emplace(endpoint_id,
+                          std::make_shared<ChunkSizeController>(
+                              channel->GetMaxTransmitPacketSize()))
+                 .first;
+    }
+    controller = item->second;
+  }
+  // Starts over if the endpoint has been upgraded to another medium since.
+  controller->SetMaxChunkSize(channel->GetMaxTransmitPacketSize());
+  return controller->GetChunkSize();
+}
+
+void EndpointManager::RecordTransferStage(
+    absl::Span<const std::string> endpoint_ids, TransferMetrics::Stage stage,
+    absl::Duration elapsed) {
+  for (const std::string& endpoint_id : endpoint_ids) {
+    std::shared_ptr<EndpointChannel> channel =
+        channel_manager_->GetChannelForEndpoint(endpoint_id);
+    if (channel == nullptr) continue;
+    std::shared_ptr<TransferMetrics> transfer_metrics =
+        channel->GetTransferMetrics();
+    if (transfer_metrics) transfer_metrics->Record(stage, elapsed);
+  }
+}
+
 std::vector<std::string> EndpointManager::SendPayloadChunk(
     const PayloadTransferFrame::PayloadHeader& payload_header,
     const PayloadTransferFrame::PayloadChunk& payload_chunk,
     const std::vector<std::string>& endpoint_ids) {
-  ByteArray bytes =
-      parser::ForDataPayloadTransfer(payload_header, payload_chunk);
+  const bool last_chunk = (payload_chunk.flags() &
+                           PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
+  const bool fan_out = endpoint_ids.size() > 1 &&
+                       FeatureFlags::GetInstance()
+                           .GetFlags()
+                           .enable_concurrent_payload_fan_out;
+
+  // Endpoints that take the whole chunk in one frame share its serialization;
+  // the others are grouped by the frame size they get it split into.
+  const int body_size = payload_chunk.body().size();
+  absl::btree_map<int, std::vector<std::string>> endpoint_ids_by_frame_size;
+  for (const std::string& endpoint_id : endpoint_ids) {
+    int chunk_size = GetChunkSize(endpoint_id);
+    int frame_size =
+        chunk_size > 0 && chunk_size < body_size ? chunk_size : body_size;
+    endpoint_ids_by_frame_size[frame_size].push_back(endpoint_id);
+  }
 
-  return SendTransferFrameBytes(
-      endpoint_ids, bytes, payload_header.id(),
-      /*offset=*/payload_chunk.offset(),
-      /*packet_type=*/
-      PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::DATA));
+  std::vector<std::string> failed_endpoint_ids;
+  for (auto& item : endpoint_ids_by_frame_size) {
+    absl::Time start_time = SystemClock::ElapsedRealtime();
+    std::vector<ByteArray> frames =
+        ForDataPayloadTransferFrames(payload_header, payload_chunk, item.first);
+    std::vector<std::string>& group_endpoint_ids = item.second;
+    // The frames are shared, so each endpoint is charged the whole time.
+    RecordTransferStage(group_endpoint_ids,
+                        TransferMetrics::Stage::kSerializeFrame,
+                        SystemClock::ElapsedRealtime() - start_time);
+    if (fan_out) {
+      for (const std::string& endpoint_id :
+           FanOutTransferFrameBytes(group_endpoint_ids, std::move(frames),
+                                    payload_header.id(), last_chunk)) {
+        failed_endpoint_ids.push_back(endpoint_id);
+      }
+      continue;
+    }
+
+    for (const std::string& endpoint_id : SendTransferFrameBytes(
+             group_endpoint_ids, frames, payload_header.id(),
+             payload_chunk.offset(),
+             /*packet_type=*/
+             PayloadTransferFrame::PacketType_Name(
+                 PayloadTransferFrame::DATA))) {
+      failed_endpoint_ids.push_back(endpoint_id);
+    }
+  }
+  return failed_endpoint_ids;
 }
 
 // Designed to run asynchronously. It is called from IO thread pools, and
@@ -523,7 +907,7 @@ std::vector<std::string> EndpointManager::SendControlMessage(
   ByteArray bytes = parser::ForControlPayloadTransfer(header, control);
 
   return SendTransferFrameBytes(
-      endpoint_ids, bytes, header.id(),
+      endpoint_ids, absl::MakeConstSpan(&bytes, 1), header.id(),
       /*offset=*/control.offset(),
       /*packet_type=*/
       PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::CONTROL));
@@ -614,11 +998,21 @@ CountDownLatch EndpointManager::NotifyFrameProcessorsOnEndpointDisconnect(
 }
 
 std::vector<std::string> EndpointManager::SendTransferFrameBytes(
-    const std::vector<std::string>& endpoint_ids, const ByteArray& bytes,
-    std::int64_t payload_id, std::int64_t offset,
-    const std::string& packet_type) {
-  std::vector<std::string> failed_endpoint_ids;
+    const std::vector<std::string>& endpoint_ids,
+    absl::Span<const ByteArray> frames, std::int64_t payload_id,
+    std::int64_t offset, const std::string& packet_type) {
+  // Anything still queued for these endpoints by an earlier fan-out goes out
+  // first, so that frames are never reordered.
+  std::vector<std::string> failed_endpoint_ids =
+      fan_out_writer_.Flush(endpoint_ids, payload_id);
+  const bool is_data =
+      packet_type ==
+      PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::DATA);
   for (const std::string& endpoint_id : endpoint_ids) {
+    if (std::find(failed_endpoint_ids.begin(), failed_endpoint_ids.end(),
+                  endpoint_id) != failed_endpoint_ids.end()) {
+      continue;
+    }
     std::shared_ptr<EndpointChannel> channel =
         channel_manager_->GetChannelForEndpoint(endpoint_id);
 
@@ -635,17 +1029,61 @@ std::vector<std::string> EndpointManager::SendTransferFrameBytes(
       continue;
     }
 
-    Exception write_exception = channel->Write(bytes);
+    absl::Time start_time = SystemClock::ElapsedRealtime();
+    Exception write_exception = channel->WriteBatch(frames);
     if (!write_exception.Ok()) {
       failed_endpoint_ids.push_back(endpoint_id);
       NEARBY_LOGS(INFO) << "Failed to send packet; endpoint_id=" << endpoint_id;
       continue;
     }
+    if (is_data) {
+      // The frames went out together, so each is charged an equal share.
+      absl::Duration elapsed =
+          (SystemClock::ElapsedRealtime() - start_time) / frames.size();
+      for (const ByteArray& bytes : frames) {
+        OnDataFrameWritten(endpoint_id, bytes.size(), elapsed);
+      }
+    }
   }
 
   return failed_endpoint_ids;
 }
 
+std::vector<std::string> EndpointManager::FanOutTransferFrameBytes(
+    const std::vector<std::string>& endpoint_ids,
+    std::vector<ByteArray> frames, std::int64_t payload_id, bool last_chunk) {
+  std::vector<std::string> failed_endpoint_ids =
+      fan_out_writer_.Write(endpoint_ids, payload_id, std::move(frames));
+  if (!last_chunk) return failed_endpoint_ids;
+
+  // The payload only counts as sent once every endpoint has written it.
+  std::vector<std::string> queued_endpoint_ids;
+  for (const std::string& endpoint_id : endpoint_ids) {
+    if (std::find(failed_endpoint_ids.begin(), failed_endpoint_ids.end(),
+                  endpoint_id) == failed_endpoint_ids.end()) {
+      queued_endpoint_ids.push_back(endpoint_id);
+    }
+  }
+  for (const std::string& endpoint_id :
+       fan_out_writer_.Flush(queued_endpoint_ids, payload_id)) {
+    failed_endpoint_ids.push_back(endpoint_id);
+  }
+  return failed_endpoint_ids;
+}
+
+void EndpointManager::OnDataFrameWritten(const std::string& endpoint_id,
+                                         std::int64_t size_bytes,
+                                         absl::Duration elapsed) {
+  std::shared_ptr<ChunkSizeController> controller;
+  {
+    MutexLock lock(&chunk_size_mutex_);
+    auto item = chunk_size_controllers_.find(endpoint_id);
+    if (item == chunk_size_controllers_.end()) return;
+    controller = item->second;
+  }
+  controller->OnChunkWritten(size_bytes, elapsed);
+}
+
 EndpointManager::EndpointState::~EndpointState() {
   // We must unregister the endpoint first to signal the runnables that they
   // should exit their loops. SingleThreadExecutor destructors will wait for the
@@ -656,25 +1094,28 @@ EndpointManager::EndpointState::~EndpointState() {
     channel_manager_->UnregisterChannelForEndpoint(endpoint_id_);
   }
 
-  // Make sure the KeepAlive thread isn't blocking shutdown.
-  if (keep_alive_waiter_mutex_ && keep_alive_waiter_) {
-    MutexLock lock(keep_alive_waiter_mutex_.get());
-    keep_alive_waiter_->Notify();
-  }
+  // Now that the channel is closed, the timer and the reactor mode reader
+  // finish quickly too; like the thread, they must be done before the
+  // endpoint state goes.
+  if (reactor_reader_) reactor_reader_->Stop();
+  if (keep_alive_timer_) keep_alive_timer_->Stop();
 }
 
 void EndpointManager::EndpointState::StartEndpointReader(Runnable&& runnable) {
-  reader_thread_.Execute("reader", std::move(runnable));
+  reader_thread_ = std::make_unique<SingleThreadExecutor>();
+  reader_thread_->Execute("reader", std::move(runnable));
 }
 
-void EndpointManager::EndpointState::StartEndpointKeepAliveManager(
-    std::function<void(Mutex*, ConditionVariable*)> runnable) {
-  keep_alive_thread_.Execute(
-      "keep-alive",
-      [runnable, keep_alive_waiter_mutex = keep_alive_waiter_mutex_.get(),
-       keep_alive_waiter = keep_alive_waiter_.get()]() {
-        runnable(keep_alive_waiter_mutex, keep_alive_waiter);
-      });
+void EndpointManager::EndpointState::StartReactorReader(
+    std::shared_ptr<ReactorReader> reader) {
+  reactor_reader_ = std::move(reader);
+  reactor_reader_->Start();
+}
+
+void EndpointManager::EndpointState::StartKeepAliveTimer(
+    std::shared_ptr<KeepAliveTimer> timer) {
+  keep_alive_timer_ = std::move(timer);
+  keep_alive_timer_->Start();
 }
 
 void EndpointManager::RunOnEndpointManagerThread(const std::string& name,
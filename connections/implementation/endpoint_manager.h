@@ -25,16 +25,24 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "connections/implementation/chunk_size_controller.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_channel.h"
 #include "connections/implementation/endpoint_channel_manager.h"
+#include "connections/implementation/fan_out_writer.h"
+#include "connections/implementation/offline_frames.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
+#include "connections/implementation/transfer_metrics.h"
 #include "connections/listeners.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/condition_variable.h"
 #include "internal/platform/count_down_latch.h"
+#include "internal/platform/io_reactor.h"
 #include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
 #include "internal/platform/runnable.h"
+#include "internal/platform/scheduled_executor.h"
 #include "internal/platform/single_thread_executor.h"
 #include "internal/platform/system_clock.h"
 
@@ -59,6 +67,13 @@ namespace connections {
 // chunks) originates on one of those threads before control is transferred over
 // to PayloadManager::ProcessFrame() (still running on that
 // same dedicated reader thread).
+//
+// KeepAlive frames for all endpoints are sent from one shared timer.
+//
+// With FeatureFlags::enable_endpoint_reactor, endpoints whose channels can
+// report readiness are read on the threads of a shared IoReactor instead, one
+// frame per readiness event. Endpoints on channels that can't report readiness
+// still get a dedicated reader thread.
 
 class EndpointManager {
  public:
@@ -67,7 +82,8 @@ class EndpointManager {
     virtual ~FrameProcessor() = default;
 
     // @EndpointManagerReaderThread
-    // Called for every incoming frame of registered type.
+    // Called for every incoming frame of registered type. In reactor mode this
+    // runs on an IoReactor thread, shared with other endpoints.
     // NOTE(OfflineFrame& frame):
     // For large payload in data phase, resources may be saved if data is moved,
     // rather than copied (if passing data by reference is not an option).
@@ -79,6 +95,16 @@ class EndpointManager {
                                  ClientProxy* to_client,
                                  proto::connections::Medium current_medium) = 0;
 
+    // @EndpointManagerReaderThread
+    // Called instead of OnIncomingFrame() for DATA PayloadTransferFrames,
+    // which are decoded without an OfflineFrame; the body of the chunk may be
+    // moved out of |data_frame|. By default, the frame is wrapped into an
+    // OfflineFrame and handed to OnIncomingFrame().
+    virtual void OnIncomingDataFrame(parser::DataFrame& data_frame,
+                                     const std::string& from_endpoint_id,
+                                     ClientProxy* to_client,
+                                     proto::connections::Medium current_medium);
+
     // Implementations must call barrier.CountDown() once
     // they're done. This parallelizes the disconnection event across all frame
     // processors.
@@ -119,8 +145,23 @@ class EndpointManager {
   // transport.
   int GetMaxTransmitPacketSize(const std::string& endpoint_id);
 
+  // Returns the payload chunk size currently picked for the endpoint, based on
+  // how fast its channel has been taking DATA frames; at most
+  // GetMaxTransmitPacketSize(). Returns 0 if the endpoint has no channel.
+  int GetChunkSize(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(chunk_size_mutex_);
+
+  // Records |elapsed| as the time |stage| took for each of |endpoint_ids|, in
+  // the TransferMetrics of its channel.
+  void RecordTransferStage(absl::Span<const std::string> endpoint_ids,
+                           TransferMetrics::Stage stage,
+                           absl::Duration elapsed);
+
   // Returns the list of endpoints to which sending this chunk failed.
   //
+  // A chunk larger than GetChunkSize() of an endpoint is sent to that
+  // endpoint as several DATA frames of at most that size.
+  //
   // Invoked from the PayloadManager's sendPayload() method.
   std::vector<std::string> SendPayloadChunk(
       const PayloadTransferFrame::PayloadHeader& payload_header,
@@ -136,7 +177,7 @@ class EndpointManager {
   //    a) We failed to read from the endpoint in its dedicated reader thread.
   //    b) We failed to write to the endpoint in PayloadManager.
   //    c) The connection was rejected in PCPHandler.
-  //    d) The dedicated KeepAlive thread exceeded its period of inactivity.
+  //    d) The KeepAlive timer exceeded its period of inactivity.
   // Or in the numerous other cases where a failure occurred and we no longer
   // believe the endpoint is in a healthy state.
   //
@@ -147,15 +188,16 @@ class EndpointManager {
   void DiscardEndpoint(ClientProxy* client, const std::string& endpoint_id);
 
  private:
+  // Reactor mode counterpart of the reader thread of an endpoint.
+  class ReactorReader;
+  // Sends the KeepAlive frames of an endpoint from keep_alive_executor_.
+  class KeepAliveTimer;
+
   class EndpointState {
    public:
     EndpointState(const std::string& endpoint_id,
                   EndpointChannelManager* channel_manager)
-        : endpoint_id_{endpoint_id},
-          channel_manager_{channel_manager},
-          keep_alive_waiter_mutex_{std::make_unique<Mutex>()},
-          keep_alive_waiter_{std::make_unique<ConditionVariable>(
-              keep_alive_waiter_mutex_.get())} {}
+        : endpoint_id_{endpoint_id}, channel_manager_{channel_manager} {}
 
     EndpointState(const EndpointState&) = delete;
     // The default move constructor would not reset |channel_manager_|, for
@@ -165,31 +207,25 @@ class EndpointManager {
         : endpoint_id_{std::move(other.endpoint_id_)},
           channel_manager_{std::exchange(other.channel_manager_, nullptr)},
           reader_thread_{std::move(other.reader_thread_)},
-          keep_alive_waiter_mutex_{
-              std::exchange(other.keep_alive_waiter_mutex_, nullptr)},
-          keep_alive_waiter_{std::exchange(other.keep_alive_waiter_, nullptr)},
-          keep_alive_thread_{std::move(other.keep_alive_thread_)} {}
+          reactor_reader_{std::move(other.reactor_reader_)},
+          keep_alive_timer_{std::move(other.keep_alive_timer_)} {}
     EndpointState& operator=(const EndpointState&) = delete;
     EndpointState&& operator=(EndpointState&&) = delete;
     ~EndpointState();
 
     void StartEndpointReader(Runnable&& runnable);
-    void StartEndpointKeepAliveManager(
-        std::function<void(Mutex*, ConditionVariable*)> runnable);
+    // Reactor mode counterpart of the above.
+    void StartReactorReader(std::shared_ptr<ReactorReader> reader);
+    void StartKeepAliveTimer(std::shared_ptr<KeepAliveTimer> timer);
 
    private:
     const std::string endpoint_id_;
     EndpointChannelManager* channel_manager_;
-    SingleThreadExecutor reader_thread_;
-
-    // Use a condition variable so we can wait on the thread but still be able
-    // to wake it up before shutting down. We don't want to just sleep and risk
-    // blocking shutdown. Note: Create the mutex/condition variable on the heap
-    // so raw pointers sent to HandleKeepAlive() aren't invalidated during
-    // std::move operations.
-    mutable std::unique_ptr<Mutex> keep_alive_waiter_mutex_;
-    std::unique_ptr<ConditionVariable> keep_alive_waiter_;
-    SingleThreadExecutor keep_alive_thread_;
+    // The thread is only created when started, so that endpoints served by
+    // the reactor don't cost any.
+    std::unique_ptr<SingleThreadExecutor> reader_thread_;
+    std::shared_ptr<ReactorReader> reactor_reader_;
+    std::shared_ptr<KeepAliveTimer> keep_alive_timer_;
   };
 
   // RAII accessor for FrameProcessor
@@ -214,11 +250,19 @@ class EndpointManager {
                                ClientProxy* client_proxy,
                                EndpointChannel* endpoint_channel);
 
-  ExceptionOr<bool> HandleKeepAlive(EndpointChannel* endpoint_channel,
-                                    absl::Duration keep_alive_interval,
-                                    absl::Duration keep_alive_timeout,
-                                    Mutex* keep_alive_waiter_mutex,
-                                    ConditionVariable* keep_alive_waiter);
+  // Reads one frame from |endpoint_channel| and routes it to its
+  // FrameProcessor. Returns true unless the channel can't be read anymore.
+  ExceptionOr<bool> HandleFrame(const std::string& endpoint_id,
+                                ClientProxy* client_proxy,
+                                EndpointChannel* endpoint_channel);
+
+  // Sends a KeepAlive frame if nothing has been written to the endpoint for
+  // |keep_alive_interval|. Returns how long until it's worth checking again,
+  // or Exception::kTimeout if nothing has been read from the endpoint for
+  // |keep_alive_timeout|.
+  ExceptionOr<absl::Duration> SendKeepAliveIfDue(
+      EndpointChannel* endpoint_channel, absl::Duration keep_alive_interval,
+      absl::Duration keep_alive_timeout);
 
   // Waits for a given endpoint EndpointChannelLoopRunnable() workers to
   // terminate.
@@ -232,6 +276,19 @@ class EndpointManager {
       const std::string& endpoint_id,
       std::function<ExceptionOr<bool>(EndpointChannel*)> handler);
 
+  // The steps of EndpointChannelLoopRunnable(), shared with the reactor mode
+  // workers, which can't loop.
+  // Returns the channel a worker should use for |endpoint_id|, or nullptr if
+  // there's none but one on |last_failed_medium|.
+  std::shared_ptr<EndpointChannel> GetWorkerChannel(
+      const std::string& endpoint_id,
+      proto::connections::Medium last_failed_medium);
+  // Returns whether a worker should go on after its handler returned |result|
+  // for |channel|; records the medium of |channel| if it failed.
+  static bool ShouldRetryChannel(
+      const ExceptionOr<bool>& result, const EndpointChannel& channel,
+      proto::connections::Medium* last_failed_medium);
+
   static void WaitForLatch(const std::string& method_name,
                            CountDownLatch* latch);
   static void WaitForLatch(const std::string& method_name,
@@ -243,9 +300,9 @@ class EndpointManager {
 
   // It should be noted that this method may be called multiple times (because
   // invoking this method closes the endpoint channel, which causes the
-  // dedicated reader and KeepAlive threads to terminate, which in turn leads to
-  // this method being called), but that's alright because the implementation of
-  // this method is idempotent.
+  // dedicated reader thread and the KeepAlive timer to terminate, which in turn
+  // leads to this method being called), but that's alright because the
+  // implementation of this method is idempotent.
   // @EndpointManagerThread
   void RemoveEndpoint(ClientProxy* client, const std::string& endpoint_id,
                       bool notify);
@@ -258,10 +315,27 @@ class EndpointManager {
       ClientProxy* client, const std::string& service_id,
       const std::string& endpoint_id);
 
+  // Writes |payload_transfer_frames| to each endpoint with one
+  // EndpointChannel::WriteBatch() call.
   std::vector<std::string> SendTransferFrameBytes(
       const std::vector<std::string>& endpoint_ids,
-      const ByteArray& payload_transfer_frame_bytes, std::int64_t payload_id,
-      std::int64_t offset, const std::string& packet_type);
+      absl::Span<const ByteArray> payload_transfer_frames,
+      std::int64_t payload_id, std::int64_t offset,
+      const std::string& packet_type);
+
+  // Queues the DATA frames of one chunk for several endpoints on
+  // fan_out_writer_. Waits for the queues to drain if this is the last chunk of
+  // the payload.
+  std::vector<std::string> FanOutTransferFrameBytes(
+      const std::vector<std::string>& endpoint_ids,
+      std::vector<ByteArray> payload_transfer_frames, std::int64_t payload_id,
+      bool last_chunk);
+
+  // Feeds the write time of a DATA frame to the endpoint's chunk size
+  // controller.
+  void OnDataFrameWritten(const std::string& endpoint_id,
+                          std::int64_t size_bytes, absl::Duration elapsed)
+      ABSL_LOCKS_EXCLUDED(chunk_size_mutex_);
 
   // Executes all jobs sequentially, on a serial_executor_.
   void RunOnEndpointManagerThread(const std::string& name, Runnable runnable);
@@ -275,6 +349,20 @@ class EndpointManager {
   // We keep track of all registered channel endpoints here.
   absl::flat_hash_map<std::string, EndpointState> endpoints_;
 
+  Mutex chunk_size_mutex_;
+  absl::flat_hash_map<std::string, std::shared_ptr<ChunkSizeController>>
+      chunk_size_controllers_ ABSL_GUARDED_BY(chunk_size_mutex_);
+
+  // Per-endpoint outbound queues for payloads sent to several endpoints.
+  // Declared after chunk_size_controllers_, which its writer threads report
+  // to.
+  FanOutWriter fan_out_writer_;
+
+  // Only set up in reactor mode, where it serves all endpoints.
+  std::unique_ptr<IoReactor> reactor_;
+  // Runs the KeepAlive checks of all endpoints, as their timers expire.
+  ScheduledExecutor keep_alive_executor_;
+
   SingleThreadExecutor serial_executor_;
 };
 
@@ -18,6 +18,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
@@ -32,6 +33,8 @@
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/count_down_latch.h"
+#include "internal/platform/feature_flags.h"
+#include "internal/platform/io_reactor.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/pipe.h"
 #include "proto/connections_enums.pb.h"
@@ -75,6 +78,7 @@ class MockEndpointChannel : public EndpointChannel {
   MOCK_METHOD(absl::Time, GetLastWriteTimestamp, (), (const override));
   MOCK_METHOD(void, SetAnalyticsRecorder,
               (analytics::AnalyticsRecorder*, const std::string&), (override));
+  MOCK_METHOD(int, GetReadinessFd, (), (override));
 
   bool IsClosed() const {
     absl::MutexLock lock(&mutex_);
@@ -283,6 +287,60 @@ TEST_F(EndpointManagerTest, SendControlMessageWorks) {
   NEARBY_LOG(INFO, "Will call destructors now");
 }
 
+TEST_F(EndpointManagerTest, SendPayloadChunkSplitsChunkToEndpointChunkSize) {
+  auto endpoint_channel = std::make_unique<MockEndpointChannel>();
+  PayloadTransferFrame::PayloadHeader header;
+  PayloadTransferFrame::PayloadChunk chunk;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(10);
+  chunk.set_offset(0);
+  chunk.set_flags(0);
+  chunk.set_body("0123456789");
+
+  ON_CALL(*endpoint_channel, Read())
+      .WillByDefault([channel = endpoint_channel.get()]() {
+        if (channel->IsClosed()) return ExceptionOr<ByteArray>(Exception::kIo);
+        absl::SleepFor(absl::Milliseconds(100));
+        if (channel->IsClosed()) return ExceptionOr<ByteArray>(Exception::kIo);
+        return ExceptionOr<ByteArray>(ByteArray{});
+      });
+  ON_CALL(*endpoint_channel, Close(_))
+      .WillByDefault(
+          [channel = endpoint_channel.get()](DisconnectionReason reason) {
+            channel->DoClose();
+          });
+  EXPECT_CALL(*endpoint_channel, GetMaxTransmitPacketSize())
+      .WillRepeatedly(Return(4));
+  absl::Mutex mutex;
+  std::vector<std::pair<std::int64_t, std::string>> chunks;
+  EXPECT_CALL(*endpoint_channel, Write(_))
+      .WillRepeatedly([&](const ByteArray& data) {
+        auto frame = parser::FromBytes(data);
+        if (frame.ok() &&
+            frame.result().v1().payload_transfer().packet_type() ==
+                PayloadTransferFrame::DATA) {
+          const auto& payload_chunk =
+              frame.result().v1().payload_transfer().payload_chunk();
+          absl::MutexLock lock(&mutex);
+          chunks.emplace_back(payload_chunk.offset(), payload_chunk.body());
+        }
+        return Exception{Exception::kSuccess};
+      });
+
+  RegisterEndpoint(std::move(endpoint_channel), false);
+  EXPECT_EQ(em_.GetChunkSize(endpoint_id_), 4);
+  auto failed_ids =
+      em_.SendPayloadChunk(header, chunk, std::vector{endpoint_id_});
+  EXPECT_EQ(failed_ids, std::vector<std::string>{});
+  {
+    absl::MutexLock lock(&mutex);
+    EXPECT_EQ(chunks, (std::vector<std::pair<std::int64_t, std::string>>{
+                          {0, "0123"}, {4, "4567"}, {8, "89"}}));
+  }
+  em_.UnregisterEndpoint(&client_, endpoint_id_);
+}
+
 TEST_F(EndpointManagerTest, SingleReadOnInvalidPayload) {
   auto endpoint_channel = std::make_unique<MockEndpointChannel>();
   EXPECT_CALL(*endpoint_channel, Read())
@@ -294,6 +352,126 @@ TEST_F(EndpointManagerTest, SingleReadOnInvalidPayload) {
   RegisterEndpoint(std::move(endpoint_channel));
 }
 
+// Turns reactor mode on for the EndpointManager of the fixture, which is
+// constructed after this base.
+class ReactorModeFlag {
+ protected:
+  ReactorModeFlag() {
+    FeatureFlags::GetMutableFlagsForTesting().enable_endpoint_reactor = true;
+  }
+  ~ReactorModeFlag() {
+    FeatureFlags::GetMutableFlagsForTesting().enable_endpoint_reactor = false;
+  }
+};
+
+class EndpointManagerReactorTest : public ReactorModeFlag,
+                                   public EndpointManagerTest {
+ protected:
+  void SetUp() override {
+    if (!IoReactor::IsSupported()) GTEST_SKIP();
+  }
+
+  // Reads every chunk written to |pipe| as a frame.
+  static void ReadFramesFromPipe(MockEndpointChannel& channel,
+                                 std::shared_ptr<Pipe> pipe) {
+    EXPECT_CALL(channel, GetReadinessFd())
+        .WillRepeatedly(Return(pipe->GetInputStream().GetReadinessFd()));
+    EXPECT_CALL(channel, Read()).WillRepeatedly([pipe]() {
+      ExceptionOr<ByteArray> bytes = pipe->GetInputStream().Read(1024);
+      if (!bytes.ok() || bytes.result().Empty()) {
+        return ExceptionOr<ByteArray>(Exception::kIo);
+      }
+      return bytes;
+    });
+  }
+
+  ByteArray CreateConnectionRequest() {
+    return parser::ForConnectionRequest(ConnectionInfo{
+        endpoint_id_, ByteArray{"endpoint_name"}, 1234 /*nonce*/,
+        false /*supports_5_ghz*/, "" /*bssid*/, 2412 /*ap_frequency*/,
+        "8xqT" /*ip_address in 4 bytes format*/,
+        std::vector<Medium>{Medium::BLE} /*supported_mediums*/,
+        0 /*keep_alive_interval_millis*/, 0 /*keep_alive_timeout_millis*/});
+  }
+
+  // Registers a processor for CONNECTION_REQUEST frames that counts them down
+  // on |frames|.
+  void RegisterConnectionRequestProcessor(CountDownLatch frames) {
+    auto processor = std::make_unique<MockFrameProcessor>();
+    EXPECT_CALL(*processor, OnIncomingFrame)
+        .WillRepeatedly([frames](OfflineFrame&, const std::string&,
+                                 ClientProxy*, Medium) mutable {
+          frames.CountDown();
+        });
+    EXPECT_CALL(*processor, OnEndpointDisconnect)
+        .WillOnce([](ClientProxy*, const std::string&, const std::string&,
+                     CountDownLatch barrier) { barrier.CountDown(); });
+    em_.RegisterFrameProcessor(V1Frame::CONNECTION_REQUEST, processor.get());
+    processors_.emplace_back(std::move(processor));
+  }
+};
+
+TEST_F(EndpointManagerReactorTest, ReadsFramesWhenChannelIsReadable) {
+  auto pipe = std::make_shared<Pipe>();
+  auto endpoint_channel = std::make_unique<MockEndpointChannel>();
+  ReadFramesFromPipe(*endpoint_channel, pipe);
+  EXPECT_CALL(*endpoint_channel, Write(_))
+      .WillRepeatedly(Return(Exception{Exception::kSuccess}));
+  CountDownLatch closed(1);
+  EXPECT_CALL(*endpoint_channel, Close(_))
+      .WillOnce([closed](DisconnectionReason) mutable { closed.CountDown(); });
+  CountDownLatch frames(2);
+  RegisterConnectionRequestProcessor(frames);
+  RegisterEndpoint(std::move(endpoint_channel), /*should_close=*/false);
+
+  OutputStream& output = pipe->GetOutputStream();
+  EXPECT_TRUE(output.Write(CreateConnectionRequest()).Ok());
+  EXPECT_TRUE(output.Write(CreateConnectionRequest()).Ok());
+  EXPECT_TRUE(frames.Await(absl::Seconds(1)).result());
+
+  // The end of the stream fails the read, and disconnects the endpoint.
+  output.Close();
+  EXPECT_TRUE(closed.Await(absl::Seconds(1)).result());
+}
+
+TEST_F(EndpointManagerReactorTest, ReadsOnThreadWhenChannelHasNoReadiness) {
+  auto endpoint_channel = std::make_unique<MockEndpointChannel>();
+  EXPECT_CALL(*endpoint_channel, GetReadinessFd()).WillRepeatedly(Return(-1));
+  EXPECT_CALL(*endpoint_channel, Read())
+      .WillOnce(Return(ExceptionOr<ByteArray>(CreateConnectionRequest())))
+      .WillRepeatedly(Return(ExceptionOr<ByteArray>(Exception::kIo)));
+  EXPECT_CALL(*endpoint_channel, Write(_))
+      .WillRepeatedly(Return(Exception{Exception::kSuccess}));
+  CountDownLatch frames(1);
+  RegisterConnectionRequestProcessor(frames);
+
+  RegisterEndpoint(std::move(endpoint_channel));
+  EXPECT_TRUE(frames.Await(absl::Seconds(1)).result());
+}
+
+TEST_F(EndpointManagerReactorTest, SendsKeepAliveFromTimer) {
+  auto pipe = std::make_shared<Pipe>();
+  auto endpoint_channel = std::make_unique<MockEndpointChannel>();
+  ReadFramesFromPipe(*endpoint_channel, pipe);
+  EXPECT_CALL(*endpoint_channel, IsPaused()).WillRepeatedly(Return(false));
+  CountDownLatch keep_alive_sent(1);
+  EXPECT_CALL(*endpoint_channel, Write(_))
+      .WillRepeatedly([keep_alive_sent](const ByteArray& data) mutable {
+        ExceptionOr<OfflineFrame> frame = parser::FromBytes(data);
+        if (frame.ok() &&
+            parser::GetFrameType(frame.result()) == V1Frame::KEEP_ALIVE) {
+          keep_alive_sent.CountDown();
+        }
+        return Exception{Exception::kSuccess};
+      });
+  connection_options_.keep_alive_interval_millis = 50;
+
+  RegisterEndpoint(std::move(endpoint_channel), /*should_close=*/false);
+
+  EXPECT_TRUE(keep_alive_sent.Await(absl::Seconds(1)).result());
+  em_.UnregisterEndpoint(&client_, endpoint_id_);
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
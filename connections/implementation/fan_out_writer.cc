@@ -0,0 +1,235 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/fan_out_writer.h"
+
+#include <utility>
+
+#include "internal/platform/exception.h"
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+#include "internal/platform/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Outbound queue and writer thread of a single endpoint. Chunks are written in
+// the order they were queued.
+class FanOutWriter::EndpointWriter {
+ public:
+  EndpointWriter(const std::string& endpoint_id,
+                 EndpointChannelManager* channel_manager, int max_lag_chunks,
+                 const FrameWrittenCallback& on_frame_written)
+      : endpoint_id_(endpoint_id),
+        channel_manager_(channel_manager),
+        max_lag_chunks_(max_lag_chunks),
+        on_frame_written_(on_frame_written) {}
+
+  // Queues |frames| as one chunk. Returns false if |payload_id| has failed for
+  // this endpoint.
+  bool Enqueue(std::int64_t payload_id, const std::vector<ByteArray>& frames)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    if (stopped_) return false;
+
+    PayloadState& state = payloads_[payload_id];
+    if (!state.failed && queued_seq_ - written_seq_ >= max_lag_chunks_) {
+      NEARBY_LOGS(WARNING) << "FanOutWriter: endpoint " << endpoint_id_
+                           << " is " << queued_seq_ - written_seq_
+                           << " chunks behind; failing payload " << payload_id;
+      state.failed = true;
+    }
+    if (state.failed) {
+      ReportFailure(payload_id, state);
+      return false;
+    }
+
+    state.queued++;
+    queued_seq_++;
+    writer_thread_.Execute("fan-out-write", [this, payload_id, frames]() {
+      WriteChunk(payload_id, frames);
+    });
+    return true;
+  }
+
+  // Waits for all frames queued so far. Returns false if |payload_id| has
+  // failed for this endpoint.
+  bool Flush(std::int64_t payload_id) ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    const std::int64_t flush_seq = queued_seq_;
+    while (written_seq_ < flush_seq && !stopped_) {
+      cond_.Wait();
+    }
+    if (stopped_) return false;
+
+    auto item = payloads_.find(payload_id);
+    if (item != payloads_.end() && item->second.failed) {
+      ReportFailure(payload_id, item->second);
+      return false;
+    }
+    return true;
+  }
+
+  // Drops whatever is still queued and releases any pending Flush().
+  void Stop() ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    stopped_ = true;
+    cond_.Notify();
+  }
+
+ private:
+  struct PayloadState {
+    // Number of chunks of the payload that are queued but not yet written.
+    int queued = 0;
+    bool failed = false;
+    // Whether the failure has been returned to a caller yet.
+    bool reported = false;
+  };
+
+  void ReportFailure(std::int64_t payload_id, PayloadState& state)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    state.reported = true;
+    if (state.queued == 0) payloads_.erase(payload_id);
+  }
+
+  void WriteChunk(std::int64_t payload_id, const std::vector<ByteArray>& frames)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    bool skip;
+    {
+      MutexLock lock(&mutex_);
+      skip = stopped_ || payloads_[payload_id].failed;
+    }
+
+    Exception write_exception{Exception::kSuccess};
+    if (!skip) {
+      std::shared_ptr<EndpointChannel> channel =
+          channel_manager_->GetChannelForEndpoint(endpoint_id_);
+      if (!channel) write_exception = {Exception::kIo};
+      if (write_exception.Ok() && !frames.empty()) {
+        absl::Time start_time = SystemClock::ElapsedRealtime();
+        write_exception = channel->WriteBatch(frames);
+        if (write_exception.Ok() && on_frame_written_) {
+          // The frames went out together, so each is charged an equal share.
+          absl::Duration elapsed =
+              (SystemClock::ElapsedRealtime() - start_time) / frames.size();
+          for (const ByteArray& bytes : frames) {
+            on_frame_written_(endpoint_id_, bytes.size(), elapsed);
+          }
+        }
+      }
+      if (!write_exception.Ok()) {
+        NEARBY_LOGS(INFO) << "FanOutWriter: failed to send packet of payload "
+                          << payload_id << "; endpoint_id=" << endpoint_id_;
+      }
+    }
+
+    MutexLock lock(&mutex_);
+    PayloadState& state = payloads_[payload_id];
+    if (!write_exception.Ok()) state.failed = true;
+    state.queued--;
+    if (state.queued == 0 && (!state.failed || state.reported)) {
+      payloads_.erase(payload_id);
+    }
+    written_seq_++;
+    cond_.Notify();
+  }
+
+  const std::string endpoint_id_;
+  EndpointChannelManager* const channel_manager_;
+  const int max_lag_chunks_;
+  const FrameWrittenCallback on_frame_written_;
+
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  // Sequence numbers of the last queued and the last written chunk.
+  std::int64_t queued_seq_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::int64_t written_seq_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_map<std::int64_t, PayloadState> payloads_
+      ABSL_GUARDED_BY(mutex_);
+  // Declared last, so it is destroyed (and its in-flight write is finished)
+  // before the state it works on.
+  SingleThreadExecutor writer_thread_;
+};
+
+FanOutWriter::FanOutWriter(EndpointChannelManager* channel_manager,
+                           int max_lag_chunks,
+                           FrameWrittenCallback on_frame_written)
+    : channel_manager_(channel_manager),
+      max_lag_chunks_(max_lag_chunks > 0 ? max_lag_chunks : 1),
+      on_frame_written_(std::move(on_frame_written)) {}
+
+FanOutWriter::~FanOutWriter() {
+  MutexLock lock(&mutex_);
+  for (auto& item : writers_) {
+    item.second->Stop();
+  }
+}
+
+std::vector<std::string> FanOutWriter::Write(
+    const std::vector<std::string>& endpoint_ids, std::int64_t payload_id,
+    std::vector<ByteArray> frames) {
+  std::vector<std::string> failed_endpoint_ids;
+  for (const std::string& endpoint_id : endpoint_ids) {
+    std::shared_ptr<EndpointWriter> writer =
+        GetWriter(endpoint_id, /*create=*/true);
+    if (!writer->Enqueue(payload_id, frames)) {
+      failed_endpoint_ids.push_back(endpoint_id);
+    }
+  }
+  return failed_endpoint_ids;
+}
+
+std::vector<std::string> FanOutWriter::Flush(
+    const std::vector<std::string>& endpoint_ids, std::int64_t payload_id) {
+  std::vector<std::string> failed_endpoint_ids;
+  for (const std::string& endpoint_id : endpoint_ids) {
+    std::shared_ptr<EndpointWriter> writer =
+        GetWriter(endpoint_id, /*create=*/false);
+    if (writer && !writer->Flush(payload_id)) {
+      failed_endpoint_ids.push_back(endpoint_id);
+    }
+  }
+  return failed_endpoint_ids;
+}
+
+void FanOutWriter::RemoveEndpoint(const std::string& endpoint_id) {
+  std::shared_ptr<EndpointWriter> writer;
+  {
+    MutexLock lock(&mutex_);
+    auto item = writers_.find(endpoint_id);
+    if (item == writers_.end()) return;
+    writer = std::move(item->second);
+    writers_.erase(item);
+  }
+  writer->Stop();
+}
+
+std::shared_ptr<FanOutWriter::EndpointWriter> FanOutWriter::GetWriter(
+    const std::string& endpoint_id, bool create) {
+  MutexLock lock(&mutex_);
+  auto item = writers_.find(endpoint_id);
+  if (item != writers_.end()) return item->second;
+  if (!create) return nullptr;
+
+  auto writer = std::make_shared<EndpointWriter>(
+      endpoint_id, channel_manager_, max_lag_chunks_, on_frame_written_);
+  writers_.emplace(endpoint_id, writer);
+  return writer;
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,101 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_FAN_OUT_WRITER_H_
+#define CORE_INTERNAL_FAN_OUT_WRITER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "connections/implementation/endpoint_channel_manager.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/condition_variable.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/single_thread_executor.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Writes the same frames to several endpoints at once. Every endpoint gets its
+// own outbound queue and writer thread, so each EndpointChannel drains at its
+// own speed instead of the whole fan-out moving at the pace of the slowest
+// link.
+//
+// Failures are tracked per endpoint and per payload: once a frame of a payload
+// fails to be written to an endpoint, or the endpoint falls more than
+// |max_lag_chunks| Write() calls behind, the remaining frames of that payload
+// are dropped for that endpoint and the endpoint is reported as failed by the
+// next Write() or Flush() for that payload.
+class FanOutWriter {
+ public:
+  // Called on the writer thread of |endpoint_id| after each frame written to
+  // it, with the frame size and the time the write took.
+  using FrameWrittenCallback =
+      std::function<void(const std::string& endpoint_id,
+                         std::int64_t size_bytes, absl::Duration elapsed)>;
+
+  FanOutWriter(EndpointChannelManager* channel_manager, int max_lag_chunks,
+               FrameWrittenCallback on_frame_written = nullptr);
+  ~FanOutWriter();
+
+  FanOutWriter(const FanOutWriter&) = delete;
+  FanOutWriter& operator=(const FanOutWriter&) = delete;
+
+  // Queues |frames| for every endpoint in |endpoint_ids| and returns without
+  // waiting for the writes. The frames of one call are written back to back
+  // and count as a single chunk against the lag limit. Returns the endpoints
+  // that failed |payload_id|.
+  std::vector<std::string> Write(const std::vector<std::string>& endpoint_ids,
+                                 std::int64_t payload_id,
+                                 std::vector<ByteArray> frames)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Waits until everything queued so far for |endpoint_ids| has been written.
+  // Returns the endpoints that failed |payload_id|.
+  std::vector<std::string> Flush(const std::vector<std::string>& endpoint_ids,
+                                 std::int64_t payload_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Drops the queue of |endpoint_id| and stops its writer thread.
+  void RemoveEndpoint(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  class EndpointWriter;
+
+  std::shared_ptr<EndpointWriter> GetWriter(const std::string& endpoint_id,
+                                            bool create)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  EndpointChannelManager* const channel_manager_;
+  const int max_lag_chunks_;
+  const FrameWrittenCallback on_frame_written_;
+
+  Mutex mutex_;
+  absl::flat_hash_map<std::string, std::shared_ptr<EndpointWriter>> writers_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_FAN_OUT_WRITER_H_
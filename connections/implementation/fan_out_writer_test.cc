@@ -0,0 +1,233 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/fan_out_writer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "connections/implementation/client_proxy.h"
+#include "connections/implementation/endpoint_channel_manager.h"
+#include "connections/implementation/fake_endpoint_channel.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/mutex_lock.h"
+#include "internal/platform/single_thread_executor.h"
+#include "internal/platform/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+constexpr std::int64_t kPayloadId = 1234;
+constexpr std::int64_t kOtherPayloadId = 5678;
+
+// Records every frame written to it. Writes can be held back until Release()
+// is called, to simulate a slow link.
+class RecordingChannel : public FakeEndpointChannel {
+ public:
+  explicit RecordingChannel(bool blocked = false)
+      : FakeEndpointChannel(Medium::WIFI_LAN, "service"),
+        released_(blocked ? 1 : 0) {}
+
+  Exception Write(const ByteArray& data) override {
+    released_.Await();
+    MutexLock lock(&mutex_);
+    writes_.push_back(std::string(data));
+    return write_result_;
+  }
+
+  void Release() { released_.CountDown(); }
+
+  void set_write_result(Exception result) {
+    MutexLock lock(&mutex_);
+    write_result_ = result;
+  }
+
+  std::vector<std::string> writes() {
+    MutexLock lock(&mutex_);
+    return writes_;
+  }
+
+ private:
+  CountDownLatch released_;
+  Mutex mutex_;
+  Exception write_result_{Exception::kSuccess};
+  std::vector<std::string> writes_;
+};
+
+class FanOutWriterTest : public ::testing::Test {
+ protected:
+  RecordingChannel* AddChannel(const std::string& endpoint_id,
+                               bool blocked = false) {
+    auto channel = std::make_unique<RecordingChannel>(blocked);
+    RecordingChannel* result = channel.get();
+    channel_manager_.RegisterChannelForEndpoint(&client_, endpoint_id,
+                                                std::move(channel));
+    return result;
+  }
+
+  ClientProxy client_;
+  EndpointChannelManager channel_manager_;
+};
+
+TEST_F(FanOutWriterTest, WritesFramesInOrderToAllEndpoints) {
+  RecordingChannel* first = AddChannel("A");
+  RecordingChannel* second = AddChannel("B");
+  FanOutWriter writer(&channel_manager_, 8);
+
+  EXPECT_THAT(writer.Write({"A", "B"}, kPayloadId, {ByteArray("one")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Write({"A", "B"}, kPayloadId, {ByteArray("two")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Flush({"A", "B"}, kPayloadId), IsEmpty());
+
+  EXPECT_THAT(first->writes(), ElementsAre("one", "two"));
+  EXPECT_THAT(second->writes(), ElementsAre("one", "two"));
+}
+
+TEST_F(FanOutWriterTest, SlowEndpointDoesNotBlockOthers) {
+  RecordingChannel* fast = AddChannel("fast");
+  RecordingChannel* slow = AddChannel("slow", /*blocked=*/true);
+  FanOutWriter writer(&channel_manager_, 8);
+
+  EXPECT_THAT(writer.Write({"fast", "slow"}, kPayloadId, {ByteArray("one")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Flush({"fast"}, kPayloadId), IsEmpty());
+  EXPECT_THAT(fast->writes(), ElementsAre("one"));
+  EXPECT_THAT(slow->writes(), IsEmpty());
+
+  slow->Release();
+  EXPECT_THAT(writer.Flush({"slow"}, kPayloadId), IsEmpty());
+  EXPECT_THAT(slow->writes(), ElementsAre("one"));
+}
+
+TEST_F(FanOutWriterTest, EndpointTooFarBehindFailsPayload) {
+  AddChannel("fast");
+  RecordingChannel* slow = AddChannel("slow", /*blocked=*/true);
+  FanOutWriter writer(&channel_manager_, 2);
+
+  EXPECT_THAT(writer.Write({"fast", "slow"}, kPayloadId, {ByteArray("one")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Write({"fast", "slow"}, kPayloadId, {ByteArray("two")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Flush({"fast"}, kPayloadId), IsEmpty());
+  EXPECT_THAT(writer.Write({"fast", "slow"}, kPayloadId, {ByteArray("three")}),
+              ElementsAre("slow"));
+
+  // The frames of the failed payload that were still queued are dropped.
+  slow->Release();
+  writer.Flush({"slow"}, kOtherPayloadId);
+  EXPECT_THAT(slow->writes(), ElementsAre("one"));
+}
+
+TEST_F(FanOutWriterTest, WriteErrorIsReportedForThatPayloadOnly) {
+  AddChannel("A");
+  RecordingChannel* broken = AddChannel("B");
+  broken->set_write_result(Exception{Exception::kIo});
+  FanOutWriter writer(&channel_manager_, 8);
+
+  EXPECT_THAT(writer.Write({"A", "B"}, kPayloadId, {ByteArray("one")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Flush({"A", "B"}, kPayloadId), ElementsAre("B"));
+
+  broken->set_write_result(Exception{Exception::kSuccess});
+  EXPECT_THAT(writer.Write({"A", "B"}, kOtherPayloadId, {ByteArray("two")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Flush({"A", "B"}, kOtherPayloadId), IsEmpty());
+}
+
+TEST_F(FanOutWriterTest, FramesOfOneWriteCountAsOneChunk) {
+  AddChannel("fast");
+  RecordingChannel* slow = AddChannel("slow", /*blocked=*/true);
+  FanOutWriter writer(&channel_manager_, 2);
+
+  EXPECT_THAT(writer.Write({"fast", "slow"}, kPayloadId,
+                           {ByteArray("1a"), ByteArray("1b"), ByteArray("1c")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Write({"fast", "slow"}, kPayloadId,
+                           {ByteArray("2a"), ByteArray("2b")}),
+              IsEmpty());
+
+  slow->Release();
+  EXPECT_THAT(writer.Flush({"fast", "slow"}, kPayloadId), IsEmpty());
+  EXPECT_THAT(slow->writes(), ElementsAre("1a", "1b", "1c", "2a", "2b"));
+}
+
+TEST_F(FanOutWriterTest, ReportsWrittenFrames) {
+  AddChannel("A");
+  Mutex mutex;
+  std::vector<std::int64_t> sizes;
+  FanOutWriter writer(&channel_manager_, 8,
+                      [&](const std::string& endpoint_id,
+                          std::int64_t size_bytes, absl::Duration elapsed) {
+                        MutexLock lock(&mutex);
+                        EXPECT_EQ(endpoint_id, "A");
+                        EXPECT_GE(elapsed, absl::ZeroDuration());
+                        sizes.push_back(size_bytes);
+                      });
+
+  EXPECT_THAT(writer.Write({"A"}, kPayloadId,
+                           {ByteArray("one"), ByteArray("three")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Flush({"A"}, kPayloadId), IsEmpty());
+  MutexLock lock(&mutex);
+  EXPECT_THAT(sizes, ElementsAre(3, 5));
+}
+
+TEST_F(FanOutWriterTest, UnknownEndpointFails) {
+  FanOutWriter writer(&channel_manager_, 8);
+
+  EXPECT_THAT(writer.Write({"unknown"}, kPayloadId, {ByteArray("one")}),
+              IsEmpty());
+  EXPECT_THAT(writer.Flush({"unknown"}, kPayloadId), ElementsAre("unknown"));
+}
+
+TEST_F(FanOutWriterTest, RemoveEndpointFailsPendingFlush) {
+  RecordingChannel* slow = AddChannel("slow", /*blocked=*/true);
+  FanOutWriter writer(&channel_manager_, 8);
+  EXPECT_THAT(writer.Write({"slow"}, kPayloadId, {ByteArray("one")}),
+              IsEmpty());
+
+  CountDownLatch flushed(1);
+  std::vector<std::string> failed_endpoint_ids;
+  SingleThreadExecutor flusher;
+  flusher.Execute([&]() {
+    failed_endpoint_ids = writer.Flush({"slow"}, kPayloadId);
+    flushed.CountDown();
+  });
+  SystemClock::Sleep(absl::Milliseconds(50));
+  SingleThreadExecutor remover;
+  remover.Execute([&]() { writer.RemoveEndpoint("slow"); });
+  SystemClock::Sleep(absl::Milliseconds(50));
+
+  // Removing the endpoint waits for the write in flight.
+  slow->Release();
+  EXPECT_TRUE(flushed.Await(absl::Seconds(1)).result());
+  EXPECT_THAT(failed_endpoint_ids, ElementsAre("slow"));
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -20,6 +20,7 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   byte_array.SetData(reinterpret_cast<const char*>(data), size);
 
   location::nearby::connections::parser::FromBytes(byte_array);
+  location::nearby::connections::parser::DataFrameFromBytes(byte_array);
 
   return 0;
 }
@@ -16,6 +16,7 @@
 #define CORE_INTERNAL_INTERNAL_PAYLOAD_H_
 
 #include <cstdint>
+#include <functional>
 
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/payload.h"
@@ -95,6 +96,14 @@ class InternalPayload {
   // early, e.g. after being cancelled or having no more recipients left.
   virtual void Close() {}
 
+  // Registers a listener that is called with true when the application falls
+  // behind on consuming an incoming Payload, and with false once it has caught
+  // up again. Only Payloads that buffer incoming data on behalf of the
+  // application ever call it. The listener must be quick and must not call
+  // back into this object.
+  using BackpressureListener = std::function<void(bool backed_up)>;
+  virtual void SetBackpressureListener(BackpressureListener listener) {}
+
  protected:
   Payload payload_;
   // We're caching the payload ID here because the backing payload will be
@@ -20,6 +20,7 @@
 #include <utility>
 
 #include "absl/memory/memory.h"
+#include "connections/implementation/chunk_write_behind.h"
 #include "connections/implementation/offline_frames_validator.h"
 #include "connections/payload.h"
 #include "internal/platform/byte_array.h"
@@ -33,6 +34,7 @@
 #include "internal/platform/mutex.h"
 #include "internal/platform/os_name.h"
 #include "internal/platform/pipe.h"
+#include "internal/platform/single_thread_executor.h"
 
 namespace location {
 namespace nearby {
@@ -149,8 +151,26 @@ class OutgoingStreamInternalPayload : public InternalPayload {
 
 class IncomingStreamInternalPayload : public InternalPayload {
  public:
-  IncomingStreamInternalPayload(Payload payload, OutputStream& output_stream)
-      : InternalPayload(std::move(payload)), output_stream_(&output_stream) {}
+  // Unread data the pipe holds before the sender is asked to pause, and the
+  // level it must drain to before the sender is asked to resume.
+  static constexpr size_t kPauseWatermark = 2 * 1024 * 1024;  // 2 MB
+  static constexpr size_t kResumeWatermark = 512 * 1024;  // 512 KB
+  // Hard limit on the unread data. Reached only if the sender ignores pause
+  // requests; the endpoint's reader thread then blocks until the application
+  // reads, which pushes back on the sender through the transport.
+  static constexpr size_t kMaxBufferedBytes = 8 * 1024 * 1024;  // 8 MB
+
+  IncomingStreamInternalPayload(Payload payload, std::shared_ptr<Pipe> pipe)
+      : InternalPayload(std::move(payload)),
+        pipe_(std::move(pipe)),
+        output_stream_(&pipe_->GetOutputStream()) {
+    pipe_->SetMaxBufferedBytes(kMaxBufferedBytes);
+  }
+  // The pipe lives on with the application's InputStream; make sure it no
+  // longer calls back into whoever listened to this payload.
+  ~IncomingStreamInternalPayload() override {
+    pipe_->SetBackpressureListener(0, 0, nullptr);
+  }
 
   PayloadTransferFrame::PayloadHeader::PayloadType GetType() const override {
     return PayloadTransferFrame::PayloadHeader::STREAM;
@@ -179,7 +199,13 @@ class IncomingStreamInternalPayload : public InternalPayload {
 
   void Close() override { output_stream_->Close(); }
 
+  void SetBackpressureListener(BackpressureListener listener) override {
+    pipe_->SetBackpressureListener(kPauseWatermark, kResumeWatermark,
+                                   std::move(listener));
+  }
+
  private:
+  std::shared_ptr<Pipe> pipe_;
   OutputStream* output_stream_;
 };
 
@@ -257,7 +283,18 @@ class IncomingFileInternalPayload : public InternalPayload {
                               std::int64_t total_size)
       : InternalPayload(std::move(payload)),
         output_file_(std::move(output_file)),
-        total_size_(total_size) {}
+        total_size_(total_size) {
+    // Reserve the whole file up front, so that it's laid out contiguously and
+    // a full disk is noticed before the transfer rather than halfway through.
+    if (total_size_ > 0) {
+      Exception result = output_file_.Preallocate(total_size_);
+      if (result.Raised()) {
+        NEARBY_LOGS(WARNING) << "Failed to preallocate " << total_size_
+                             << " bytes for incoming file Payload " << this
+                             << ": " << result.value;
+      }
+    }
+  }
 
   PayloadTransferFrame::PayloadHeader::PayloadType GetType() const override {
     return PayloadTransferFrame::PayloadHeader::FILE;
@@ -267,14 +304,16 @@ class IncomingFileInternalPayload : public InternalPayload {
 
   ByteArray DetachNextChunk(int chunk_size) override { return {}; }
 
+  // Chunks are written on writer_executor_, so that the endpoint's reader
+  // can go on receiving while the disk catches up. A failed write is reported
+  // by the next chunk, or by the last one at the latest.
   Exception AttachNextChunk(const ByteArray& chunk) override {
     if (chunk.Empty()) {
       // Received null last chunk for incoming payload.
-      output_file_.Close();
-      return {Exception::kSuccess};
+      return write_behind_.Finish();
     }
 
-    return output_file_.Write(chunk);
+    return write_behind_.Write(chunk);
   }
 
   ExceptionOr<size_t> SkipToOffset(size_t offset) override {
@@ -283,13 +322,24 @@ class IncomingFileInternalPayload : public InternalPayload {
     return {Exception::kIo};
   }
 
-  void Close() override { output_file_.Close(); }
+  void Close() override {
+    write_behind_.Stop();
+    output_file_.Close();
+  }
 
  private:
+  static constexpr std::int64_t kMaxQueuedBytes = 16 * 1024 * 1024;  // 16 MB
+
   OutputFile output_file_;
   const std::int64_t total_size_;
+  SingleThreadExecutor writer_executor_;
+  // Declared last, so that it's stopped before the executor and the file go.
+  ChunkWriteBehind write_behind_{output_file_.GetOutputStream(),
+                                 writer_executor_, kMaxQueuedBytes};
 };
 
+constexpr std::int64_t IncomingFileInternalPayload::kMaxQueuedBytes;
+
 }  // namespace
 
 using location::nearby::api::ImplementationPlatform;
@@ -326,6 +376,12 @@ std::string make_path(std::string& parent_folder, int64_t id) {
 
 std::unique_ptr<InternalPayload> CreateIncomingInternalPayload(
     const PayloadTransferFrame& frame) {
+  return CreateIncomingInternalPayload(
+      frame, ByteArray(frame.payload_chunk().body()));
+}
+
+std::unique_ptr<InternalPayload> CreateIncomingInternalPayload(
+    const PayloadTransferFrame& frame, const ByteArray& body) {
   if (frame.packet_type() != PayloadTransferFrame::DATA) {
     return {};
   }
@@ -334,7 +390,7 @@ std::unique_ptr<InternalPayload> CreateIncomingInternalPayload(
   switch (frame.payload_header().type()) {
     case PayloadTransferFrame::PayloadHeader::BYTES: {
       return absl::make_unique<BytesInternalPayload>(
-          Payload(payload_id, ByteArray(frame.payload_chunk().body())));
+          Payload(payload_id, body));
     }
 
     case PayloadTransferFrame::PayloadHeader::STREAM: {
@@ -345,7 +401,7 @@ std::unique_ptr<InternalPayload> CreateIncomingInternalPayload(
                   [pipe]() -> InputStream& {
                     return pipe->GetInputStream();  // NOLINT
                   }),
-          pipe->GetOutputStream());
+          pipe);
     }
 
     case PayloadTransferFrame::PayloadHeader::FILE: {
@@ -17,6 +17,7 @@
 
 #include "connections/implementation/internal_payload.h"
 #include "connections/payload.h"
+#include "internal/platform/byte_array.h"
 
 namespace location {
 namespace nearby {
@@ -29,6 +30,10 @@ std::unique_ptr<InternalPayload> CreateOutgoingInternalPayload(Payload payload);
 // endpoint.
 std::unique_ptr<InternalPayload> CreateIncomingInternalPayload(
     const PayloadTransferFrame& frame);
+// Same as above, for a frame whose chunk body was left out, see
+// parser::DataFrameFromBytes().
+std::unique_ptr<InternalPayload> CreateIncomingInternalPayload(
+    const PayloadTransferFrame& frame, const ByteArray& body);
 
 }  // namespace connections
 }  // namespace nearby
@@ -16,6 +16,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
@@ -109,6 +110,34 @@ TEST(InternalPayloadFactoryTest, CanCreateInternalPayloadFromStreamMessage) {
   EXPECT_EQ(payload.GetType(), PayloadType::kStream);
 }
 
+TEST(InternalPayloadFactoryTest, IncomingStreamPayloadReportsBackpressure) {
+  PayloadTransferFrame frame;
+  frame.set_packet_type(PayloadTransferFrame::DATA);
+  auto& header = *frame.mutable_payload_header();
+  header.set_type(PayloadTransferFrame::PayloadHeader::STREAM);
+  header.set_id(12345);
+  header.set_total_size(0);
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateIncomingInternalPayload(frame);
+  ASSERT_NE(internal_payload, nullptr);
+  std::vector<bool> events;
+  internal_payload->SetBackpressureListener(
+      [&events](bool backed_up) { events.push_back(backed_up); });
+  Payload payload = internal_payload->ReleasePayload();
+  InputStream* stream = payload.AsStream();
+  ASSERT_NE(stream, nullptr);
+  constexpr size_t kChunkSize = 1024 * 1024;
+
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray(kChunkSize)).Ok());
+  EXPECT_TRUE(events.empty());
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray(kChunkSize)).Ok());
+  EXPECT_EQ(events, std::vector<bool>({true}));
+  EXPECT_TRUE(stream->Read(kChunkSize).ok());
+  EXPECT_EQ(events, std::vector<bool>({true}));
+  EXPECT_TRUE(stream->Read(kChunkSize).ok());
+  EXPECT_EQ(events, std::vector<bool>({true, false}));
+}
+
 TEST(InternalPayloadFactoryTest, CanCreateInternalPayloadFromFileMessage) {
   PayloadTransferFrame frame;
   frame.set_packet_type(PayloadTransferFrame::DATA);
@@ -14,9 +14,13 @@
 
 #include "connections/implementation/offline_frames.h"
 
+#include <cstring>
 #include <memory>
 #include <utility>
 
+#include "google/protobuf/io/coded_stream.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "connections/implementation/message_lite.h"
 #include "connections/implementation/offline_frames_validator.h"
 #include "connections/status.h"
@@ -30,6 +34,16 @@ namespace {
 
 using ExceptionOrOfflineFrame = ExceptionOr<OfflineFrame>;
 using MessageLite = ::google::protobuf::MessageLite;
+using CodedInputStream = ::google::protobuf::io::CodedInputStream;
+using CodedOutputStream = ::google::protobuf::io::CodedOutputStream;
+using PayloadHeader = PayloadTransferFrame::PayloadHeader;
+using PayloadChunk = PayloadTransferFrame::PayloadChunk;
+
+// Wire types of the fields of DATA frames. All their field numbers are below
+// 16, so every tag takes a single byte.
+constexpr int kWireTypeVarint = 0;
+constexpr int kWireTypeLengthDelimited = 2;
+constexpr int kTagSize = 1;
 
 ByteArray ToBytes(OfflineFrame&& frame) {
   ByteArray bytes(frame.ByteSizeLong());
@@ -38,12 +52,156 @@ ByteArray ToBytes(OfflineFrame&& frame) {
   return bytes;
 }
 
+// The fields of a PayloadChunk, as they're written by WriteDataFrame().
+struct DataChunk {
+  absl::optional<std::int32_t> flags;
+  absl::optional<std::int64_t> offset;
+  absl::optional<absl::string_view> body;
+};
+
+std::uint8_t* WriteTag(int field, int wire_type, std::uint8_t* target) {
+  return CodedOutputStream::WriteTagToArray((field << 3) | wire_type, target);
+}
+
+// Enums and int32 fields are encoded as sign extended varints.
+std::uint8_t* WriteInt32Field(int field, std::int32_t value,
+                              std::uint8_t* target) {
+  target = WriteTag(field, kWireTypeVarint, target);
+  return CodedOutputStream::WriteVarint32SignExtendedToArray(value, target);
+}
+
+std::uint8_t* WriteLength(int field, size_t size, std::uint8_t* target) {
+  target = WriteTag(field, kWireTypeLengthDelimited, target);
+  return CodedOutputStream::WriteVarint32ToArray(size, target);
+}
+
+size_t Int32FieldSize(std::int32_t value) {
+  return kTagSize + CodedOutputStream::VarintSize32SignExtended(value);
+}
+
+size_t LengthDelimitedFieldSize(size_t size) {
+  return kTagSize + CodedOutputStream::VarintSize32(size) + size;
+}
+
+size_t DataChunkSize(const DataChunk& chunk) {
+  size_t size = 0;
+  if (chunk.flags) size += Int32FieldSize(*chunk.flags);
+  if (chunk.offset) {
+    size += kTagSize + CodedOutputStream::VarintSize64(*chunk.offset);
+  }
+  if (chunk.body) size += LengthDelimitedFieldSize(chunk.body->size());
+  return size;
+}
+
+// Writes the OfflineFrame of a DATA packet directly into its buffer, field by
+// field in the order protobuf serializes them, so that the bytes are those
+// ToBytes() would return. Only the body is copied, once.
+ByteArray WriteDataFrame(const PayloadHeader& header, const DataChunk& chunk) {
+  const size_t header_size = header.ByteSizeLong();
+  const size_t chunk_size = DataChunkSize(chunk);
+  const size_t transfer_size = Int32FieldSize(PayloadTransferFrame::DATA) +
+                               LengthDelimitedFieldSize(header_size) +
+                               LengthDelimitedFieldSize(chunk_size);
+  const size_t v1_size = Int32FieldSize(V1Frame::PAYLOAD_TRANSFER) +
+                         LengthDelimitedFieldSize(transfer_size);
+  ByteArray bytes(Int32FieldSize(OfflineFrame::V1) +
+                  LengthDelimitedFieldSize(v1_size));
+
+  auto* target = reinterpret_cast<std::uint8_t*>(bytes.data());
+  target = WriteInt32Field(OfflineFrame::kVersionFieldNumber, OfflineFrame::V1,
+                           target);
+  target = WriteLength(OfflineFrame::kV1FieldNumber, v1_size, target);
+  target = WriteInt32Field(V1Frame::kTypeFieldNumber,
+                           V1Frame::PAYLOAD_TRANSFER, target);
+  target =
+      WriteLength(V1Frame::kPayloadTransferFieldNumber, transfer_size, target);
+  target = WriteInt32Field(PayloadTransferFrame::kPacketTypeFieldNumber,
+                           PayloadTransferFrame::DATA, target);
+  target = WriteLength(PayloadTransferFrame::kPayloadHeaderFieldNumber,
+                       header_size, target);
+  target = header.SerializeWithCachedSizesToArray(target);
+  target = WriteLength(PayloadTransferFrame::kPayloadChunkFieldNumber,
+                       chunk_size, target);
+  if (chunk.flags) {
+    target =
+        WriteInt32Field(PayloadChunk::kFlagsFieldNumber, *chunk.flags, target);
+  }
+  if (chunk.offset) {
+    target = WriteTag(PayloadChunk::kOffsetFieldNumber, kWireTypeVarint,
+                      target);
+    target = CodedOutputStream::WriteVarint64ToArray(*chunk.offset, target);
+  }
+  if (chunk.body) {
+    target =
+        WriteLength(PayloadChunk::kBodyFieldNumber, chunk.body->size(), target);
+    std::memcpy(target, chunk.body->data(), chunk.body->size());
+  }
+  return bytes;
+}
+
+// Calls |on_field| with the number, wire type and value of each field of the
+// message in |bytes|; the value of a varint field is in |varint|, that of a
+// length-delimited one in |value|. Returns false if |on_field| does, or if
+// |bytes| don't hold a well formed message of only these two wire types.
+template <typename OnField>
+bool ForEachField(absl::string_view bytes, OnField on_field) {
+  CodedInputStream input(reinterpret_cast<const std::uint8_t*>(bytes.data()),
+                         bytes.size());
+  while (std::uint32_t tag = input.ReadTag()) {
+    const int field = tag >> 3;
+    const int wire_type = tag & 7;
+    std::uint64_t varint = 0;
+    absl::string_view value;
+    if (wire_type == kWireTypeVarint) {
+      if (!input.ReadVarint64(&varint)) return false;
+    } else if (wire_type == kWireTypeLengthDelimited) {
+      std::uint32_t size;
+      if (!input.ReadVarint32(&size) ||
+          size > bytes.size() - input.CurrentPosition()) {
+        return false;
+      }
+      value = bytes.substr(input.CurrentPosition(), size);
+      input.Skip(size);
+    } else {
+      return false;
+    }
+    if (!on_field(field, wire_type, varint, value)) return false;
+  }
+  return input.ConsumedEntireMessage();
+}
+
+// Stores the message field |value| into |message|, unless it was seen before:
+// protobuf would merge both, which DataFrameFromBytes() leaves to it.
+bool SetMessageOnce(absl::string_view value,
+                    absl::optional<absl::string_view>& message) {
+  if (message) return false;
+  message = value;
+  return true;
+}
+
+ByteArray ForSessionResumption(SessionResumptionFrame::Type type,
+                               const ByteArray& ticket_id,
+                               const ByteArray& nonce, const ByteArray& mac) {
+  OfflineFrame frame;
+
+  frame.set_version(OfflineFrame::V1);
+  auto* v1_frame = frame.mutable_v1();
+  v1_frame->set_type(V1Frame::SESSION_RESUMPTION);
+  auto* sub_frame = v1_frame->mutable_session_resumption();
+  sub_frame->set_type(type);
+  if (!ticket_id.Empty()) sub_frame->set_ticket_id(std::string(ticket_id));
+  if (!nonce.Empty()) sub_frame->set_nonce(std::string(nonce));
+  if (!mac.Empty()) sub_frame->set_mac(std::string(mac));
+
+  return ToBytes(std::move(frame));
+}
+
 }  // namespace
 
 ExceptionOrOfflineFrame FromBytes(const ByteArray& bytes) {
   OfflineFrame frame;
 
-  if (frame.ParseFromString(std::string(bytes))) {
+  if (frame.ParseFromArray(bytes.data(), bytes.size())) {
     Exception validation_exception = EnsureValidOfflineFrame(frame);
     if (validation_exception.Raised()) {
       return ExceptionOrOfflineFrame(validation_exception);
@@ -54,6 +212,108 @@ ExceptionOrOfflineFrame FromBytes(const ByteArray& bytes) {
   }
 }
 
+absl::optional<DataFrame> DataFrameFromBytes(const ByteArray& bytes) {
+  const absl::string_view frame_bytes = bytes.AsStringView();
+  // Each level holds only the fields a DATA frame is made of; anything else
+  // is for FromBytes() to deal with.
+  std::uint64_t version = 0;
+  absl::optional<absl::string_view> v1;
+  if (!ForEachField(frame_bytes, [&](int field, int wire_type,
+                                     std::uint64_t varint,
+                                     absl::string_view value) {
+        if (field == OfflineFrame::kVersionFieldNumber &&
+            wire_type == kWireTypeVarint) {
+          version = varint;
+          return true;
+        }
+        return field == OfflineFrame::kV1FieldNumber &&
+               wire_type == kWireTypeLengthDelimited &&
+               SetMessageOnce(value, v1);
+      }) ||
+      version != OfflineFrame::V1 || !v1) {
+    return absl::nullopt;
+  }
+
+  std::uint64_t frame_type = V1Frame::UNKNOWN_FRAME_TYPE;
+  absl::optional<absl::string_view> transfer;
+  if (!ForEachField(*v1, [&](int field, int wire_type, std::uint64_t varint,
+                             absl::string_view value) {
+        if (field == V1Frame::kTypeFieldNumber &&
+            wire_type == kWireTypeVarint) {
+          frame_type = varint;
+          return true;
+        }
+        return field == V1Frame::kPayloadTransferFieldNumber &&
+               wire_type == kWireTypeLengthDelimited &&
+               SetMessageOnce(value, transfer);
+      }) ||
+      frame_type != V1Frame::PAYLOAD_TRANSFER || !transfer) {
+    return absl::nullopt;
+  }
+
+  std::uint64_t packet_type = PayloadTransferFrame::UNKNOWN_PACKET_TYPE;
+  absl::optional<absl::string_view> header;
+  absl::optional<absl::string_view> chunk;
+  if (!ForEachField(*transfer, [&](int field, int wire_type,
+                                   std::uint64_t varint,
+                                   absl::string_view value) {
+        if (field == PayloadTransferFrame::kPacketTypeFieldNumber &&
+            wire_type == kWireTypeVarint) {
+          packet_type = varint;
+          return true;
+        }
+        if (wire_type != kWireTypeLengthDelimited) return false;
+        if (field == PayloadTransferFrame::kPayloadHeaderFieldNumber) {
+          return SetMessageOnce(value, header);
+        }
+        return field == PayloadTransferFrame::kPayloadChunkFieldNumber &&
+               SetMessageOnce(value, chunk);
+      }) ||
+      packet_type != PayloadTransferFrame::DATA || !header || !chunk) {
+    return absl::nullopt;
+  }
+
+  DataChunk data_chunk;
+  if (!ForEachField(*chunk, [&](int field, int wire_type,
+                                std::uint64_t varint, absl::string_view value) {
+        if (wire_type == kWireTypeVarint) {
+          if (field == PayloadChunk::kFlagsFieldNumber) {
+            data_chunk.flags = static_cast<std::int32_t>(varint);
+            return true;
+          }
+          if (field == PayloadChunk::kOffsetFieldNumber) {
+            data_chunk.offset = static_cast<std::int64_t>(varint);
+            return true;
+          }
+          return false;
+        }
+        if (field != PayloadChunk::kBodyFieldNumber) return false;
+        data_chunk.body = value;
+        return true;
+      })) {
+    return absl::nullopt;
+  }
+
+  DataFrame data_frame;
+  PayloadTransferFrame& frame = data_frame.frame;
+  frame.set_packet_type(PayloadTransferFrame::DATA);
+  if (!frame.mutable_payload_header()->ParseFromArray(header->data(),
+                                                      header->size())) {
+    return absl::nullopt;
+  }
+  PayloadChunk* payload_chunk = frame.mutable_payload_chunk();
+  if (data_chunk.flags) payload_chunk->set_flags(*data_chunk.flags);
+  if (data_chunk.offset) payload_chunk->set_offset(*data_chunk.offset);
+  if (EnsureValidDataFrame(frame, data_chunk.body.has_value()).Raised()) {
+    return absl::nullopt;
+  }
+  if (data_chunk.body) {
+    data_frame.body = bytes.Slice(data_chunk.body->data() - frame_bytes.data(),
+                                  data_chunk.body->size());
+  }
+  return data_frame;
+}
+
 V1Frame::FrameType GetFrameType(const OfflineFrame& frame) {
   if ((frame.version() == OfflineFrame::V1) && frame.has_v1()) {
     return frame.v1().type();
@@ -102,7 +362,8 @@ ByteArray ForConnectionRequest(const ConnectionInfo& conection_info) {
   return ToBytes(std::move(frame));
 }
 
-ByteArray ForConnectionResponse(std::int32_t status) {
+ByteArray ForConnectionResponse(std::int32_t status,
+                                bool supports_session_resumption) {
   OfflineFrame frame;
 
   frame.set_version(OfflineFrame::V1);
@@ -117,13 +378,45 @@ ByteArray ForConnectionResponse(std::int32_t status) {
   sub_frame->set_response(status == Status::kSuccess
                               ? ConnectionResponseFrame::ACCEPT
                               : ConnectionResponseFrame::REJECT);
+  if (supports_session_resumption) {
+    sub_frame->set_supports_session_resumption(true);
+  }
 
   return ToBytes(std::move(frame));
 }
 
+ByteArray ForSessionResumptionRequest(const ByteArray& ticket_id,
+                                      const ByteArray& nonce,
+                                      const ByteArray& mac) {
+  return ForSessionResumption(SessionResumptionFrame::REQUEST, ticket_id,
+                              nonce, mac);
+}
+
+ByteArray ForSessionResumptionAccept(const ByteArray& ticket_id,
+                                     const ByteArray& nonce,
+                                     const ByteArray& mac) {
+  return ForSessionResumption(SessionResumptionFrame::ACCEPT, ticket_id, nonce,
+                              mac);
+}
+
+ByteArray ForSessionResumptionReject() {
+  return ForSessionResumption(SessionResumptionFrame::REJECT, ByteArray(),
+                              ByteArray(), ByteArray());
+}
+
 ByteArray ForDataPayloadTransfer(
     const PayloadTransferFrame::PayloadHeader& header,
     const PayloadTransferFrame::PayloadChunk& chunk) {
+  DataChunk data_chunk;
+  if (chunk.has_flags()) data_chunk.flags = chunk.flags();
+  if (chunk.has_offset()) data_chunk.offset = chunk.offset();
+  if (chunk.has_body()) data_chunk.body = chunk.body();
+  // A chunk with more than these fields (e.g. unknown ones, kept from parsing
+  // it) is serialized by protobuf.
+  if (chunk.ByteSizeLong() == DataChunkSize(data_chunk)) {
+    return WriteDataFrame(header, data_chunk);
+  }
+
   OfflineFrame frame;
 
   frame.set_version(OfflineFrame::V1);
@@ -137,6 +430,13 @@ ByteArray ForDataPayloadTransfer(
   return ToBytes(std::move(frame));
 }
 
+ByteArray ForDataPayloadTransfer(
+    const PayloadTransferFrame::PayloadHeader& header, std::int64_t offset,
+    std::int32_t flags, absl::string_view body) {
+  return WriteDataFrame(
+      header, DataChunk{.flags = flags, .offset = offset, .body = body});
+}
+
 ByteArray ForControlPayloadTransfer(
     const PayloadTransferFrame::PayloadHeader& header,
     const PayloadTransferFrame::ControlMessage& control) {
@@ -18,6 +18,8 @@
 #include <cstdint>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/connection_options.h"
 #include "internal/platform/byte_array.h"
@@ -37,18 +39,48 @@ using UpgradePathInfo = BandwidthUpgradeNegotiationFrame::UpgradePathInfo;
 // Exception::kInvalidProtocolBuffer, if parser failed.
 ExceptionOr<OfflineFrame> FromBytes(const ByteArray& offline_frame_bytes);
 
+// A DATA PayloadTransferFrame decoded by DataFrameFromBytes(). The chunk of
+// |frame| holds no body; |body| views it in the decoded bytes instead.
+struct DataFrame {
+  PayloadTransferFrame frame;
+  ByteArray body;
+};
+
+// Decodes a DATA PayloadTransferFrame without building an OfflineFrame or
+// copying the body of its chunk. Returns nothing for other frames, and for
+// those it can't decode as FromBytes() would (e.g. invalid ones, or ones with
+// fields unknown to it); these must go through FromBytes().
+absl::optional<DataFrame> DataFrameFromBytes(
+    const ByteArray& offline_frame_bytes);
+
 // Returns FrameType of a parsed message, or
 // V1Frame::UNKNOWN_FRAME_TYPE, if frame contents is not recognized.
 V1Frame::FrameType GetFrameType(const OfflineFrame& offline_frame);
 
 // Builds Connection Request / Response messages.
 ByteArray ForConnectionRequest(const ConnectionInfo& conection_info);
-ByteArray ForConnectionResponse(std::int32_t status);
-
-// Builds Payload transfer messages.
+ByteArray ForConnectionResponse(std::int32_t status,
+                                bool supports_session_resumption = false);
+
+// Builds Session Resumption messages, sent in place of UKEY2 by peers that
+// hold a session ticket.
+ByteArray ForSessionResumptionRequest(const ByteArray& ticket_id,
+                                      const ByteArray& nonce,
+                                      const ByteArray& mac);
+ByteArray ForSessionResumptionAccept(const ByteArray& ticket_id,
+                                     const ByteArray& nonce,
+                                     const ByteArray& mac);
+ByteArray ForSessionResumptionReject();
+
+// Builds Payload transfer messages. DATA frames are written straight into
+// their buffer, with the same bytes protobuf would serialize them to.
 ByteArray ForDataPayloadTransfer(
     const PayloadTransferFrame::PayloadHeader& header,
     const PayloadTransferFrame::PayloadChunk& chunk);
+// Same as above, for a chunk with |offset|, |flags| and |body|.
+ByteArray ForDataPayloadTransfer(
+    const PayloadTransferFrame::PayloadHeader& header, std::int64_t offset,
+    std::int32_t flags, absl::string_view body);
 ByteArray ForControlPayloadTransfer(
     const PayloadTransferFrame::PayloadHeader& header,
     const PayloadTransferFrame::ControlMessage& control);
@@ -22,7 +22,9 @@
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "internal/platform/byte_array.h"
 
@@ -145,6 +147,61 @@ TEST(OfflineFramesTest, CanGenerateConnectionResponse) {
   EXPECT_THAT(message, EqualsProto(kExpected));
 }
 
+TEST(OfflineFramesTest, CanGenerateConnectionResponseSupportingResumption) {
+  constexpr char kExpected[] =
+      R"pb(
+    version: V1
+    v1: <
+      type: CONNECTION_RESPONSE
+      connection_response: <
+        status: 0
+        response: ACCEPT
+        supports_session_resumption: true
+      >
+    >)pb";
+  ByteArray bytes = ForConnectionResponse(0, true);
+  auto response = FromBytes(bytes);
+  ASSERT_TRUE(response.ok());
+  OfflineFrame message = FromBytes(bytes).result();
+  EXPECT_THAT(message, EqualsProto(kExpected));
+}
+
+TEST(OfflineFramesTest, CanGenerateSessionResumptionRequest) {
+  constexpr char kExpected[] =
+      R"pb(
+    version: V1
+    v1: <
+      type: SESSION_RESUMPTION
+      session_resumption: <
+        type: REQUEST
+        ticket_id: "ticket"
+        nonce: "nonce"
+        mac: "mac"
+      >
+    >)pb";
+  ByteArray bytes = ForSessionResumptionRequest(
+      ByteArray("ticket"), ByteArray("nonce"), ByteArray("mac"));
+  auto response = FromBytes(bytes);
+  ASSERT_TRUE(response.ok());
+  OfflineFrame message = FromBytes(bytes).result();
+  EXPECT_THAT(message, EqualsProto(kExpected));
+}
+
+TEST(OfflineFramesTest, CanGenerateSessionResumptionReject) {
+  constexpr char kExpected[] =
+      R"pb(
+    version: V1
+    v1: <
+      type: SESSION_RESUMPTION
+      session_resumption: < type: REJECT >
+    >)pb";
+  ByteArray bytes = ForSessionResumptionReject();
+  auto response = FromBytes(bytes);
+  ASSERT_TRUE(response.ok());
+  OfflineFrame message = FromBytes(bytes).result();
+  EXPECT_THAT(message, EqualsProto(kExpected));
+}
+
 TEST(OfflineFramesTest, CanGenerateControlPayloadTransfer) {
   PayloadTransferFrame::PayloadHeader header;
   PayloadTransferFrame::ControlMessage control;
@@ -200,6 +257,94 @@ TEST(OfflineFramesTest, CanGenerateDataPayloadTransfer) {
   EXPECT_THAT(message, EqualsProto(kExpected));
 }
 
+// Serializes the DATA frame for |header| and |chunk| with protobuf.
+std::string SerializeDataFrame(
+    const PayloadTransferFrame::PayloadHeader& header,
+    const PayloadTransferFrame::PayloadChunk& chunk) {
+  OfflineFrame frame;
+  frame.set_version(OfflineFrame::V1);
+  frame.mutable_v1()->set_type(V1Frame::PAYLOAD_TRANSFER);
+  auto* payload_transfer = frame.mutable_v1()->mutable_payload_transfer();
+  payload_transfer->set_packet_type(PayloadTransferFrame::DATA);
+  *payload_transfer->mutable_payload_header() = header;
+  *payload_transfer->mutable_payload_chunk() = chunk;
+  return frame.SerializeAsString();
+}
+
+TEST(OfflineFramesTest, DataPayloadTransferHasSameBytesAsProtobuf) {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(-7);
+  header.set_type(PayloadTransferFrame::PayloadHeader::FILE);
+  header.set_total_size(-1);
+  header.set_file_name("file.txt");
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_flags(0);
+  chunk.set_offset(1LL << 40);
+  chunk.set_body(std::string(100 * 1024, 'x'));
+  PayloadTransferFrame::PayloadChunk last_chunk;
+  last_chunk.set_flags(PayloadTransferFrame::PayloadChunk::LAST_CHUNK);
+  last_chunk.set_offset(1LL << 40);
+
+  EXPECT_EQ(std::string(ForDataPayloadTransfer(header, chunk)),
+            SerializeDataFrame(header, chunk));
+  EXPECT_EQ(std::string(ForDataPayloadTransfer(header, chunk.offset(),
+                                               chunk.flags(), chunk.body())),
+            SerializeDataFrame(header, chunk));
+  EXPECT_EQ(std::string(ForDataPayloadTransfer(header, last_chunk)),
+            SerializeDataFrame(header, last_chunk));
+}
+
+TEST(OfflineFramesTest, CanDecodeDataFrameWithoutCopyingBody) {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(1024);
+  const ByteArray bytes =
+      ForDataPayloadTransfer(header, 150, 1, "payload data");
+
+  constexpr char kExpected[] =
+      R"pb(
+    packet_type: DATA,
+    payload_header: < type: BYTES id: 12345 total_size: 1024 >
+    payload_chunk: < flags: 1 offset: 150 >)pb";
+  absl::optional<DataFrame> data_frame = DataFrameFromBytes(bytes);
+  ASSERT_TRUE(data_frame.has_value());
+  EXPECT_THAT(data_frame->frame, EqualsProto(kExpected));
+  const ByteArray& body = data_frame->body;
+  EXPECT_EQ(body, ByteArray("payload data"));
+  EXPECT_GE(body.data(), bytes.data());
+  EXPECT_LE(body.data() + body.size(), bytes.data() + bytes.size());
+}
+
+TEST(OfflineFramesTest, DataFrameFromBytesLeavesOtherFramesToFromBytes) {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(1024);
+  PayloadTransferFrame::ControlMessage control;
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  control.set_offset(150);
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_flags(0);
+  chunk.set_offset(150);
+  chunk.set_body("payload data");
+  PayloadTransferFrame::PayloadChunk no_flags = chunk;
+  no_flags.clear_flags();
+  // Ends with field 3 of OfflineFrame, which isn't known yet.
+  ByteArray unknown_field(
+      absl::StrCat(SerializeDataFrame(header, chunk), "\x18\x01"));
+
+  EXPECT_FALSE(DataFrameFromBytes(ForKeepAlive()).has_value());
+  EXPECT_FALSE(DataFrameFromBytes(ForControlPayloadTransfer(header, control))
+                   .has_value());
+  EXPECT_FALSE(
+      DataFrameFromBytes(ByteArray(SerializeDataFrame(header, no_flags)))
+          .has_value());
+  EXPECT_FALSE(DataFrameFromBytes(ByteArray("\x08\x01\x12\x7f")).has_value());
+  EXPECT_FALSE(DataFrameFromBytes(unknown_field).has_value());
+  EXPECT_TRUE(FromBytes(unknown_field).ok());
+}
+
 TEST(OfflineFramesTest, CanGenerateBwuWifiHotspotPathAvailable) {
   constexpr char kExpected[] =
       R"pb(
@@ -80,7 +80,24 @@ Exception EnsureValidConnectionResponseFrame(
   return {Exception::kSuccess};
 }
 
+Exception EnsureValidSessionResumptionFrame(
+    const SessionResumptionFrame& frame) {
+  switch (frame.type()) {
+    case SessionResumptionFrame::REQUEST:
+    case SessionResumptionFrame::ACCEPT:
+      if (!frame.has_ticket_id() || !frame.has_nonce() || !frame.has_mac())
+        return {Exception::kInvalidProtocolBuffer};
+      break;
+    case SessionResumptionFrame::REJECT:
+      break;
+    default:
+      return {Exception::kInvalidProtocolBuffer};
+  }
+  return {Exception::kSuccess};
+}
+
 Exception EnsureValidPayloadTransferDataFrame(const PayloadChunk& payload_chunk,
+                                              bool has_body,
                                               std::int64_t totalSize) {
   if (!payload_chunk.has_flags()) return {Exception::kInvalidProtocolBuffer};
 
@@ -88,7 +105,7 @@ Exception EnsureValidPayloadTransferDataFrame(const PayloadChunk& payload_chunk,
   // chunk.
   bool is_last_chunk = (payload_chunk.flags() &
                         PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
-  if (!payload_chunk.has_body() && !is_last_chunk)
+  if (!has_body && !is_last_chunk)
     return {Exception::kInvalidProtocolBuffer};
   if (!payload_chunk.has_offset() || payload_chunk.offset() < 0)
     return {Exception::kInvalidProtocolBuffer};
@@ -116,7 +133,11 @@ Exception EnsureValidPayloadTransferControlFrame(
   return {Exception::kSuccess};
 }
 
-Exception EnsureValidPayloadTransferFrame(const PayloadTransferFrame& frame) {
+// |has_data_body| tells whether the chunk of a DATA frame has a body; it is
+// passed separately for frames decoded by DataFrameFromBytes(), which keeps
+// the body out of the proto.
+Exception EnsureValidPayloadTransferFrame(const PayloadTransferFrame& frame,
+                                          bool has_data_body) {
   if (!frame.has_payload_header()) return {Exception::kInvalidProtocolBuffer};
   if (!frame.payload_header().has_total_size() ||
       (frame.payload_header().total_size() < 0 &&
@@ -129,7 +150,8 @@ Exception EnsureValidPayloadTransferFrame(const PayloadTransferFrame& frame) {
     case PayloadTransferFrame::DATA:
       if (frame.has_payload_chunk()) {
         return EnsureValidPayloadTransferDataFrame(
-            frame.payload_chunk(), frame.payload_header().total_size());
+            frame.payload_chunk(), has_data_body,
+            frame.payload_header().total_size());
       }
       return {Exception::kInvalidProtocolBuffer};
 
@@ -356,6 +378,25 @@ bool CheckForIllegalCharacters(std::string toBeValidated,
                      });
 }
 
+Exception EnsureValidPayloadFileNames(
+    const PayloadTransferFrame::PayloadHeader& header) {
+  if (!header.has_type() ||
+      header.type() != PayloadTransferFrame::PayloadHeader::FILE) {
+    return {Exception::kSuccess};
+  }
+  if (header.has_file_name() &&
+      CheckForIllegalCharacters(header.file_name(),
+                                kIllegalFileNamePatterns)) {
+    return {Exception::kIllegalCharacters};
+  }
+  if (header.has_parent_folder() &&
+      CheckForIllegalCharacters(header.parent_folder(),
+                                kIllegalParentFolderPatterns)) {
+    return {Exception::kIllegalCharacters};
+  }
+  return {Exception::kSuccess};
+}
+
 }  // namespace
 
 Exception EnsureValidOfflineFrame(const OfflineFrame& offline_frame) {
@@ -378,39 +419,16 @@ Exception EnsureValidOfflineFrame(const OfflineFrame& offline_frame) {
       return {Exception::kInvalidProtocolBuffer};
 
     case V1Frame::PAYLOAD_TRANSFER:
-      if (offline_frame.has_v1() &&
-          (offline_frame.v1().payload_transfer().payload_header().has_type() &&
-           offline_frame.v1().payload_transfer().payload_header().type() ==
-               PayloadTransferFrame_PayloadHeader_PayloadType::
-                   PayloadTransferFrame_PayloadHeader_PayloadType_FILE)) {
-        if (offline_frame.v1()
-                .payload_transfer()
-                .payload_header()
-                .has_file_name()) {
-          if (CheckForIllegalCharacters(offline_frame.v1()
-                                            .payload_transfer()
-                                            .payload_header()
-                                            .file_name(),
-                                        kIllegalFileNamePatterns)) {
-            return {Exception::kIllegalCharacters};
-          }
-        }
-        if (offline_frame.v1()
-                .payload_transfer()
-                .payload_header()
-                .has_parent_folder()) {
-          if (CheckForIllegalCharacters(offline_frame.v1()
-                                            .payload_transfer()
-                                            .payload_header()
-                                            .parent_folder(),
-                                        kIllegalParentFolderPatterns)) {
-            return {Exception::kIllegalCharacters};
-          }
-        }
+      if (offline_frame.has_v1()) {
+        Exception names_exception = EnsureValidPayloadFileNames(
+            offline_frame.v1().payload_transfer().payload_header());
+        if (names_exception.Raised()) return names_exception;
       }
       if (offline_frame.has_v1() && offline_frame.v1().has_payload_transfer()) {
+        const PayloadTransferFrame& frame =
+            offline_frame.v1().payload_transfer();
         return EnsureValidPayloadTransferFrame(
-            offline_frame.v1().payload_transfer());
+            frame, frame.payload_chunk().has_body());
       }
       return {Exception::kInvalidProtocolBuffer};
 
@@ -422,6 +440,14 @@ Exception EnsureValidOfflineFrame(const OfflineFrame& offline_frame) {
       }
       return {Exception::kInvalidProtocolBuffer};
 
+    case V1Frame::SESSION_RESUMPTION:
+      if (offline_frame.has_v1() &&
+          offline_frame.v1().has_session_resumption()) {
+        return EnsureValidSessionResumptionFrame(
+            offline_frame.v1().session_resumption());
+      }
+      return {Exception::kInvalidProtocolBuffer};
+
     case V1Frame::KEEP_ALIVE:
     case V1Frame::UNKNOWN_FRAME_TYPE:
     default:
@@ -431,6 +457,17 @@ Exception EnsureValidOfflineFrame(const OfflineFrame& offline_frame) {
   return {Exception::kSuccess};
 }
 
+Exception EnsureValidDataFrame(const PayloadTransferFrame& frame,
+                               bool has_body) {
+  Exception names_exception =
+      EnsureValidPayloadFileNames(frame.payload_header());
+  if (names_exception.Raised()) return names_exception;
+  if (frame.packet_type() != PayloadTransferFrame::DATA) {
+    return {Exception::kInvalidProtocolBuffer};
+  }
+  return EnsureValidPayloadTransferFrame(frame, has_body);
+}
+
 }  // namespace parser
 }  // namespace connections
 }  // namespace nearby
@@ -42,6 +42,11 @@ const std::vector<std::string> kIllegalParentFolderPatterns{
 
 Exception EnsureValidOfflineFrame(const OfflineFrame& offline_frame);
 
+// Validates a DATA PayloadTransferFrame decoded by DataFrameFromBytes(), whose
+// chunk holds no body; |has_body| tells whether the frame carried one.
+Exception EnsureValidDataFrame(const PayloadTransferFrame& frame,
+                               bool has_body);
+
 }  // namespace parser
 }  // namespace connections
 }  // namespace nearby
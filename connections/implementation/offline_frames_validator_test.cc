@@ -188,6 +188,33 @@ TEST(OfflineFramesValidatorTest,
   ASSERT_TRUE(ret_value.Ok());
 }
 
+TEST(OfflineFramesValidatorTest,
+     ValidatesAsOkWithValidSessionResumptionFrame) {
+  OfflineFrame offline_frame;
+
+  ByteArray bytes = ForSessionResumptionAccept(
+      ByteArray("ticket"), ByteArray("nonce"), ByteArray("mac"));
+  offline_frame.ParseFromString(std::string(bytes));
+
+  auto ret_value = EnsureValidOfflineFrame(offline_frame);
+
+  ASSERT_TRUE(ret_value.Ok());
+}
+
+TEST(OfflineFramesValidatorTest,
+     ValidatesAsFailWithMissingMacInSessionResumptionFrame) {
+  OfflineFrame offline_frame;
+
+  ByteArray bytes = ForSessionResumptionRequest(
+      ByteArray("ticket"), ByteArray("nonce"), ByteArray("mac"));
+  offline_frame.ParseFromString(std::string(bytes));
+  offline_frame.mutable_v1()->mutable_session_resumption()->clear_mac();
+
+  auto ret_value = EnsureValidOfflineFrame(offline_frame);
+
+  ASSERT_FALSE(ret_value.Ok());
+}
+
 TEST(OfflineFramesValidatorTest, ValidatesAsOkWithValidPayloadTransferFrame) {
   PayloadTransferFrame::PayloadHeader header;
   PayloadTransferFrame::PayloadChunk chunk;
@@ -285,6 +312,27 @@ TEST(OfflineFramesValidatorTest, ValidatesAsFailedTypeFileWithIllegalFilePath) {
   ASSERT_TRUE(ret_value.value == Exception::kIllegalCharacters);
 }
 
+TEST(OfflineFramesValidatorTest, ValidatesDataFrameWithBodyLeftOut) {
+  PayloadTransferFrame frame;
+  frame.set_packet_type(PayloadTransferFrame::DATA);
+  PayloadTransferFrame::PayloadHeader* header = frame.mutable_payload_header();
+  header->set_id(12345);
+  header->set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header->set_total_size(1024);
+  PayloadTransferFrame::PayloadChunk* chunk = frame.mutable_payload_chunk();
+  chunk->set_offset(150);
+  chunk->set_flags(0);
+
+  EXPECT_TRUE(EnsureValidDataFrame(frame, /*has_body=*/true).Ok());
+  EXPECT_FALSE(EnsureValidDataFrame(frame, /*has_body=*/false).Ok());
+  chunk->set_flags(PayloadTransferFrame::PayloadChunk::LAST_CHUNK);
+  EXPECT_TRUE(EnsureValidDataFrame(frame, /*has_body=*/false).Ok());
+  header->set_type(PayloadTransferFrame::PayloadHeader::FILE);
+  header->set_file_name("../file");
+  EXPECT_EQ(EnsureValidDataFrame(frame, /*has_body=*/false).value,
+            Exception::kIllegalCharacters);
+}
+
 TEST(OfflineFramesValidatorTest, ValidatesAsOkTypeFileWithLegalParentFolder) {
   PayloadTransferFrame::PayloadHeader header;
   PayloadTransferFrame::PayloadChunk chunk;
@@ -19,6 +19,7 @@
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "connections/implementation/offline_simulation_user.h"
 #include "internal/platform/medium_environment.h"
 #include "internal/platform/output_stream.h"
@@ -26,6 +27,7 @@
 #include "internal/platform/logging.h"
 #include "internal/platform/pipe.h"
 #include "internal/platform/system_clock.h"
+#include "internal/platform/tracing.h"
 
 namespace location {
 namespace nearby {
@@ -33,6 +35,7 @@ namespace connections {
 namespace {
 
 using ::testing::Eq;
+using ::testing::HasSubstr;
 
 constexpr std::array<char, 6> kFakeMacAddress = {'a', 'b', 'c', 'd', 'e', 'f'};
 constexpr absl::string_view kServiceId = "service-id";
@@ -281,8 +284,8 @@ TEST_P(OfflineServiceControllerTest, CanSendBytePayload) {
   OfflineSimulationUser user_b(kDeviceB, GetParam());
   ASSERT_TRUE(SetupConnection(user_a, user_b));
   ByteArray message(std::string{kMessage});
-  user_a.SendPayload(Payload(message));
   user_b.ExpectPayload(payload_latch_);
+  user_a.SendPayload(Payload(message));
   EXPECT_TRUE(payload_latch_.Await(kDefaultTimeout).result());
   EXPECT_EQ(user_b.GetPayload().AsBytes(), message);
   user_a.Stop();
@@ -399,6 +402,34 @@ TEST_F(OfflineServiceControllerTest, InjectEndpoint) {
   env_.Stop();
 }
 
+TEST_F(OfflineServiceControllerTest, TracesConnectionLifecycle) {
+  Tracer& tracer = Tracer::GetInstance();
+  tracer.Clear();
+  tracer.Enable();
+  env_.Start();
+  OfflineSimulationUser user_a(kDeviceA,
+                               BooleanMediumSelector{.bluetooth = true});
+  OfflineSimulationUser user_b(kDeviceB,
+                               BooleanMediumSelector{.bluetooth = true});
+  ASSERT_TRUE(SetupConnection(user_a, user_b));
+  user_b.ExpectPayload(payload_latch_);
+  user_a.SendPayload(Payload(ByteArray(std::string{kMessage})));
+  EXPECT_TRUE(payload_latch_.Await(kDefaultTimeout).result());
+  user_a.Stop();
+  user_b.Stop();
+  env_.Stop();
+  tracer.Disable();
+
+  std::string trace = tracer.DumpChromeTrace();
+  tracer.Clear();
+  for (absl::string_view name :
+       {"discovery", "endpoint_found", "medium_connect", "connection",
+        "ukey2_handshake", "accept", "outgoing_payload", "incoming_payload"}) {
+    EXPECT_THAT(trace, HasSubstr(absl::StrCat("\"name\":\"", name, "\"")));
+  }
+  EXPECT_THAT(trace, HasSubstr("\"medium\":\"BLUETOOTH\""));
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
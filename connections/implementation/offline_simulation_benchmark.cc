@@ -0,0 +1,488 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the protocol end to end, between OfflineSimulationUsers talking
+// over the simulated mediums of MediumEnvironment. Run with:
+//   bazel run -c opt //connections/implementation:offline_simulation_benchmark
+// and add --benchmark_format=json (or --benchmark_out=<file>) for results
+// that scripts can compare between builds.
+//
+// BM_Connect times a connection from the request until both sides accepted
+// it. BM_BandwidthUpgrade times an upgrade from Bluetooth to WiFi LAN until
+// both sides were told about it. BM_Payload times a payload from the call to
+// SendPayload() until every receiver saw it succeed, so the time per
+// iteration is the latency of the payload; bytes_per_second counts the bytes
+// delivered to all receivers together. BM_Reconnect times reconnects to a
+// known endpoint from the connection request until a first small payload
+// arrived, with and without session resumption.
+//
+// The chunk size is picked by the ChunkSizeController from the medium, so it
+// varies with the medium argument. Encryption can't be turned off; its cost is
+// part of every number here. BM_Connect and BM_BandwidthUpgrade disconnect
+// after each iteration, which takes far longer than the time they report, so
+// a small --benchmark_min_time keeps them quick.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "connections/implementation/offline_simulation_user.h"
+#include "connections/listeners.h"
+#include "connections/medium_selector.h"
+#include "connections/payload.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/feature_flags.h"
+#include "internal/platform/file.h"
+#include "internal/platform/input_stream.h"
+#include "internal/platform/medium_environment.h"
+#include "internal/platform/output_stream.h"
+#include "internal/platform/pipe.h"
+#include "internal/platform/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr absl::string_view kServiceId = "service-id";
+constexpr absl::Duration kTimeout = absl::Seconds(30);
+constexpr absl::Duration kTeardownTime = absl::Milliseconds(100);
+constexpr std::int64_t kWriteSize = 64 * 1024;
+
+enum MediumArg : std::int64_t {
+  kBluetooth = 0,
+  kWifiLan = 1,
+  kBle = 2,
+};
+
+BooleanMediumSelector GetMediums(std::int64_t medium) {
+  switch (medium) {
+    case kWifiLan:
+      return {.wifi_lan = true};
+    case kBle:
+      return {.ble = true};
+    default:
+      return {.bluetooth = true};
+  }
+}
+
+const char* GetMediumName(std::int64_t medium) {
+  switch (medium) {
+    case kWifiLan:
+      return "wifi_lan";
+    case kBle:
+      return "ble";
+    default:
+      return "bluetooth";
+  }
+}
+
+const char* GetPayloadTypeName(PayloadType type) {
+  switch (type) {
+    case PayloadType::kFile:
+      return "file";
+    case PayloadType::kStream:
+      return "stream";
+    default:
+      return "bytes";
+  }
+}
+
+// Starts |env| from a clean state. The environment is enabled at first, but
+// only a restart resets it and turns its notifications on.
+void RestartEnvironment(MediumEnvironment& env) {
+  env.Stop();
+  env.Start();
+}
+
+// Starts discovery on |discoverer| and waits until it found an advertiser.
+// Discovery stays on, because the simulated WiFi LAN doesn't report a service
+// again to a medium that found it before.
+bool Discover(OfflineSimulationUser& discoverer) {
+  CountDownLatch found_latch(1);
+  return discoverer.StartDiscovery(std::string(kServiceId), &found_latch)
+             .Ok() &&
+         found_latch.Await(kTimeout).result();
+}
+
+// Connects |discoverer| to the |advertiser| it discovered. Returns the time
+// from the connection request until both sides accepted the connection, or
+// nothing if they didn't get there.
+absl::optional<absl::Duration> Connect(OfflineSimulationUser& advertiser,
+                                       OfflineSimulationUser& discoverer) {
+  CountDownLatch initiated_latch(2);
+  CountDownLatch accept_latch(2);
+  advertiser.ExpectConnectionInitiated(initiated_latch);
+  const absl::Time start = SystemClock::ElapsedRealtime();
+  if (!discoverer.RequestConnection(&initiated_latch).Ok() ||
+      !initiated_latch.Await(kTimeout).result()) {
+    return absl::nullopt;
+  }
+  advertiser.AcceptConnection(&accept_latch);
+  discoverer.AcceptConnection(&accept_latch);
+  if (!accept_latch.Await(kTimeout).result()) {
+    return absl::nullopt;
+  }
+  return SystemClock::ElapsedRealtime() - start;
+}
+
+// Disconnects |discoverer| from |advertiser| and waits until both sides saw
+// it, so that they can connect again. The endpoint state is torn down after
+// the callbacks ran, so give it some time to finish: a reconnect racing with
+// it may lose its new channel to the old endpoint's teardown.
+bool Disconnect(OfflineSimulationUser& advertiser,
+                OfflineSimulationUser& discoverer) {
+  CountDownLatch disconnect_latch(2);
+  advertiser.ExpectDisconnect(disconnect_latch);
+  discoverer.ExpectDisconnect(disconnect_latch);
+  discoverer.Disconnect();
+  if (!disconnect_latch.Await(kTimeout).result()) return false;
+  SystemClock::Sleep(kTeardownTime);
+  return true;
+}
+
+// The users live across iterations: tearing one down toggles its Bluetooth
+// adapter, which takes seconds.
+void BM_Connect(benchmark::State& state) {
+  const BooleanMediumSelector mediums = GetMediums(state.range(0));
+  MediumEnvironment& env = MediumEnvironment::Instance();
+  state.SetLabel(GetMediumName(state.range(0)));
+  RestartEnvironment(env);
+  {
+    OfflineSimulationUser advertiser("advertiser", mediums);
+    OfflineSimulationUser discoverer("discoverer", mediums);
+    // An upgrade would race the disconnect; BM_BandwidthUpgrade times it.
+    advertiser.SetAutoUpgradeBandwidth(false);
+    advertiser.StartAdvertising(std::string(kServiceId), nullptr);
+    if (!Discover(discoverer)) state.SkipWithError("Failed to discover.");
+    for (auto _ : state) {
+      absl::optional<absl::Duration> elapsed = Connect(advertiser, discoverer);
+      if (!elapsed || !Disconnect(advertiser, discoverer)) {
+        state.SkipWithError("Failed to connect.");
+        break;
+      }
+      state.SetIterationTime(absl::ToDoubleSeconds(*elapsed));
+    }
+    advertiser.Stop();
+    discoverer.Stop();
+  }
+  env.Stop();
+}
+BENCHMARK(BM_Connect)
+    ->ArgNames({"medium"})
+    ->DenseRange(kBluetooth, kBle)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Reconnects |discoverer| to |advertiser| and sends it a 1 byte payload.
+// Returns the time from the connection request until the advertiser received
+// the payload, or nothing if it didn't.
+absl::optional<absl::Duration> ConnectAndSend(
+    OfflineSimulationUser& advertiser, OfflineSimulationUser& discoverer) {
+  const absl::Time start = SystemClock::ElapsedRealtime();
+  if (!Connect(advertiser, discoverer)) return absl::nullopt;
+  CountDownLatch payload_latch(1);
+  advertiser.ExpectPayload(payload_latch);
+  Payload payload(ByteArray(1));
+  const Payload::Id payload_id = payload.GetId();
+  discoverer.SendPayload(std::move(payload));
+  auto sent = [payload_id](const PayloadProgressInfo& info) {
+    return info.payload_id == payload_id &&
+           info.status == PayloadProgressInfo::Status::kSuccess;
+  };
+  if (!advertiser.WaitForProgress(sent, kTimeout)) {
+    return absl::nullopt;
+  }
+  const absl::Duration elapsed = SystemClock::ElapsedRealtime() - start;
+  // Let the sender finish with the payload too before disconnecting.
+  if (!discoverer.WaitForProgress(sent, kTimeout)) return absl::nullopt;
+  return elapsed;
+}
+
+// The first connection, outside the timed loop, runs UKEY2 and leaves both
+// sides with a session ticket when resumption is on.
+void BM_Reconnect(benchmark::State& state) {
+  const BooleanMediumSelector mediums = GetMediums(state.range(0));
+  const bool resumption = state.range(1) != 0;
+  MediumEnvironment& env = MediumEnvironment::Instance();
+  state.SetLabel(absl::StrCat(GetMediumName(state.range(0)),
+                              resumption ? "/resumed" : "/ukey2"));
+  const FeatureFlags::Flags original_flags =
+      FeatureFlags::GetInstance().GetFlags();
+  FeatureFlags::Flags flags = original_flags;
+  flags.enable_session_resumption = resumption;
+  env.SetFeatureFlags(flags);
+  RestartEnvironment(env);
+  {
+    OfflineSimulationUser advertiser("advertiser", mediums);
+    OfflineSimulationUser discoverer("discoverer", mediums);
+    advertiser.SetAutoUpgradeBandwidth(false);
+    advertiser.StartAdvertising(std::string(kServiceId), nullptr);
+    if (!Discover(discoverer) || !Connect(advertiser, discoverer) ||
+        !Disconnect(advertiser, discoverer)) {
+      state.SkipWithError("Failed to connect.");
+    } else {
+      for (auto _ : state) {
+        absl::optional<absl::Duration> elapsed =
+            ConnectAndSend(advertiser, discoverer);
+        if (!elapsed || !Disconnect(advertiser, discoverer)) {
+          state.SkipWithError("Failed to reconnect.");
+          break;
+        }
+        state.SetIterationTime(absl::ToDoubleSeconds(*elapsed));
+      }
+    }
+    advertiser.Stop();
+    discoverer.Stop();
+  }
+  env.Stop();
+  env.SetFeatureFlags(original_flags);
+}
+BENCHMARK(BM_Reconnect)
+    ->ArgNames({"medium", "resumption"})
+    ->ArgsProduct({{kBluetooth, kWifiLan, kBle}, {0, 1}})
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+void BM_BandwidthUpgrade(benchmark::State& state) {
+  MediumEnvironment& env = MediumEnvironment::Instance();
+  RestartEnvironment(env);
+  {
+    // Found and connected over Bluetooth; the connection itself still allows
+    // every medium, so the upgrade picks WiFi LAN.
+    OfflineSimulationUser advertiser("advertiser", {.bluetooth = true});
+    OfflineSimulationUser discoverer("discoverer", {.bluetooth = true});
+    advertiser.SetAutoUpgradeBandwidth(false);
+    advertiser.StartAdvertising(std::string(kServiceId), nullptr);
+    if (!Discover(discoverer)) state.SkipWithError("Failed to discover.");
+    for (auto _ : state) {
+      if (!Connect(advertiser, discoverer)) {
+        state.SkipWithError("Failed to connect.");
+        break;
+      }
+      CountDownLatch bandwidth_changed_latch(2);
+      advertiser.ExpectBandwidthChanged(bandwidth_changed_latch);
+      discoverer.ExpectBandwidthChanged(bandwidth_changed_latch);
+      const absl::Time start = SystemClock::ElapsedRealtime();
+      advertiser.InitiateBandwidthUpgrade();
+      const bool upgraded = bandwidth_changed_latch.Await(kTimeout).result();
+      const absl::Duration elapsed = SystemClock::ElapsedRealtime() - start;
+      if (!upgraded || !Disconnect(advertiser, discoverer)) {
+        state.SkipWithError("Failed to upgrade the connection.");
+        break;
+      }
+      state.SetIterationTime(absl::ToDoubleSeconds(elapsed));
+    }
+    advertiser.Stop();
+    discoverer.Stop();
+  }
+  env.Stop();
+}
+BENCHMARK(BM_BandwidthUpgrade)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Sends payloads from one sender to its connected receivers.
+class PayloadRun {
+ public:
+  PayloadRun(PayloadType type, std::int64_t size, std::string source_path)
+      : type_(type), size_(size), source_path_(std::move(source_path)) {}
+
+  // Sends a payload to all |receivers| and reads it on their side. Returns the
+  // time until every receiver saw the payload succeed, or nothing if one
+  // didn't.
+  absl::optional<absl::Duration> Send(
+      OfflineSimulationUser& sender,
+      const std::vector<std::unique_ptr<OfflineSimulationUser>>& receivers,
+      const std::vector<std::string>& endpoint_ids) {
+    std::vector<std::unique_ptr<CountDownLatch>> payload_latches;
+    for (const auto& receiver : receivers) {
+      payload_latches.push_back(std::make_unique<CountDownLatch>(1));
+      receiver->ExpectPayload(*payload_latches.back());
+    }
+
+    std::shared_ptr<Pipe> pipe;
+    Payload payload = CreatePayload(pipe);
+    const Payload::Id payload_id = payload.GetId();
+    const absl::Time start = SystemClock::ElapsedRealtime();
+    sender.SendPayload(std::move(payload), endpoint_ids);
+
+    std::vector<std::thread> threads;
+    if (pipe) {
+      threads.emplace_back([this, pipe]() {
+        const ByteArray data(kWriteSize);
+        OutputStream& output_stream = pipe->GetOutputStream();
+        for (std::int64_t written = 0; written < size_;
+             written += kWriteSize) {
+          if (!output_stream.Write(data).Ok()) break;
+        }
+        output_stream.Close();
+      });
+    }
+    std::atomic_bool ok = true;
+    for (std::size_t i = 0; i < receivers.size(); ++i) {
+      threads.emplace_back([this, &ok, payload_id,
+                            receiver = receivers[i].get(),
+                            payload_latch = payload_latches[i].get()]() {
+        if (!payload_latch->Await(kTimeout).result()) {
+          ok = false;
+          return;
+        }
+        if (type_ == PayloadType::kStream) {
+          // Streams are only done once the client read them.
+          InputStream* input_stream = receiver->GetPayload().AsStream();
+          while (input_stream != nullptr) {
+            ExceptionOr<ByteArray> read_data = input_stream->Read(kWriteSize);
+            if (!read_data.ok() || read_data.result().Empty()) break;
+          }
+        }
+        if (!receiver->WaitForProgress(
+                [payload_id](const PayloadProgressInfo& info) {
+                  return info.payload_id == payload_id &&
+                         info.status == PayloadProgressInfo::Status::kSuccess;
+                },
+                kTimeout)) {
+          ok = false;
+        }
+      });
+    }
+    for (std::thread& thread : threads) thread.join();
+    const absl::Duration elapsed = SystemClock::ElapsedRealtime() - start;
+
+    if (type_ == PayloadType::kFile) {
+      for (const auto& receiver : receivers) {
+        const InputFile* file = receiver->GetPayload().AsFile();
+        if (file != nullptr) std::remove(file->GetFilePath().c_str());
+      }
+    }
+    if (!ok) return absl::nullopt;
+    return elapsed;
+  }
+
+ private:
+  // Creates the next payload. For a stream, also returns the pipe to write
+  // its data to.
+  Payload CreatePayload(std::shared_ptr<Pipe>& pipe) {
+    switch (type_) {
+      case PayloadType::kFile:
+        return Payload(
+            "", absl::StrCat("offline_simulation_benchmark_", ++files_),
+            InputFile(source_path_, size_));
+      case PayloadType::kStream:
+        pipe = std::make_shared<Pipe>();
+        return Payload([pipe]() -> InputStream& {
+          return pipe->GetInputStream();  // NOLINT
+        });
+      default:
+        return Payload(ByteArray(size_));
+    }
+  }
+
+  const PayloadType type_;
+  const std::int64_t size_;
+  const std::string source_path_;
+  int files_ = 0;
+};
+
+void BM_Payload(benchmark::State& state) {
+  const auto type = static_cast<PayloadType>(state.range(0));
+  const BooleanMediumSelector mediums = GetMediums(state.range(1));
+  const std::int64_t size = state.range(2) * 1024;
+  const int fan_out = state.range(3);
+  state.SetLabel(absl::StrCat(GetPayloadTypeName(type), "/",
+                              GetMediumName(state.range(1))));
+
+  std::string source_path;
+  if (type == PayloadType::kFile) {
+    source_path = "/tmp/offline_simulation_benchmark_source";
+    std::ofstream source(source_path, std::ios::binary | std::ios::trunc);
+    source << std::string(size, 'x');
+  }
+  PayloadRun run(type, size, source_path);
+
+  MediumEnvironment& env = MediumEnvironment::Instance();
+  RestartEnvironment(env);
+  {
+    OfflineSimulationUser sender("sender", mediums);
+    std::vector<std::unique_ptr<OfflineSimulationUser>> receivers;
+    std::vector<std::string> endpoint_ids;
+    sender.StartAdvertising(std::string(kServiceId), nullptr);
+    for (int i = 0; i < fan_out; ++i) {
+      receivers.push_back(std::make_unique<OfflineSimulationUser>(
+          absl::StrCat("receiver-", i), mediums));
+      if (!Discover(*receivers.back()) || !Connect(sender, *receivers.back())) {
+        break;
+      }
+      endpoint_ids.push_back(sender.GetDiscovered().endpoint_id);
+    }
+
+    if (endpoint_ids.size() < fan_out) {
+      state.SkipWithError("Failed to connect.");
+    } else {
+      for (auto _ : state) {
+        absl::optional<absl::Duration> elapsed =
+            run.Send(sender, receivers, endpoint_ids);
+        if (!elapsed) {
+          state.SkipWithError("Failed to send the payload.");
+          break;
+        }
+        state.SetIterationTime(absl::ToDoubleSeconds(*elapsed));
+      }
+      state.SetBytesProcessed(state.iterations() * size * fan_out);
+    }
+    sender.Stop();
+    for (auto& receiver : receivers) receiver->Stop();
+  }
+  env.Stop();
+  if (!source_path.empty()) std::remove(source_path.c_str());
+}
+
+void PayloadArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"type", "medium", "kb", "fan_out"});
+  for (PayloadType type :
+       {PayloadType::kBytes, PayloadType::kFile, PayloadType::kStream}) {
+    for (std::int64_t medium : {kBluetooth, kWifiLan, kBle}) {
+      for (std::int64_t kb : {1, 1024}) {
+        for (std::int64_t fan_out : {1, 4}) {
+          // Receivers in one process would all write the same file.
+          if (type == PayloadType::kFile && fan_out > 1) continue;
+          benchmark->Args(
+              {static_cast<std::int64_t>(type), medium, kb, fan_out});
+        }
+      }
+    }
+  }
+}
+BENCHMARK(BM_Payload)
+    ->Apply(PayloadArgs)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -16,6 +16,7 @@
 #define CORE_INTERNAL_OFFLINE_SIMULATION_USER_H_
 
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
@@ -119,6 +120,15 @@ class OfflineSimulationUser {
 
   void ExpectPayload(CountDownLatch& latch) { payload_latch_ = &latch; }
   void ExpectDisconnect(CountDownLatch& latch) { disconnect_latch_ = &latch; }
+  // Lets an advertiser synchronize on each new incoming connection;
+  // latch.CountDown() will be called in the initiated_cb callback.
+  void ExpectConnectionInitiated(CountDownLatch& latch) {
+    initiated_latch_ = &latch;
+  }
+  // latch.CountDown() will be called in the bandwidth_changed_cb callback.
+  void ExpectBandwidthChanged(CountDownLatch& latch) {
+    bandwidth_changed_latch_ = &latch;
+  }
 
   const DiscoveredInfo& GetDiscovered() const { return discovered_; }
   ByteArray GetInfo() const { return info_; }
@@ -128,8 +138,23 @@ class OfflineSimulationUser {
 
   Payload& GetPayload() { return payload_; }
   void SendPayload(Payload payload) {
+    SendPayload(std::move(payload), {discovered_.endpoint_id});
+  }
+  void SendPayload(Payload payload,
+                   const std::vector<std::string>& endpoint_ids) {
     sender_payload_id_ = payload.GetId();
-    ctrl_.SendPayload(&client_, {discovered_.endpoint_id}, std::move(payload));
+    ctrl_.SendPayload(&client_, endpoint_ids, std::move(payload));
+  }
+
+  // Must be called before StartAdvertising(); with auto upgrade off, incoming
+  // connections stay on their medium until InitiateBandwidthUpgrade().
+  void SetAutoUpgradeBandwidth(bool auto_upgrade_bandwidth) {
+    advertising_options_.auto_upgrade_bandwidth = auto_upgrade_bandwidth;
+  }
+
+  // Calls PcpManager::InitiateBandwidthUpgrade().
+  void InitiateBandwidthUpgrade() {
+    ctrl_.InitiateBandwidthUpgrade(&client_, discovered_.endpoint_id);
   }
 
   Status CancelPayload() {
@@ -164,6 +189,7 @@ class OfflineSimulationUser {
   void OnConnectionAccepted(const std::string& endpoint_id);
   void OnConnectionRejected(const std::string& endpoint_id, Status status);
   void OnEndpointDisconnect(const std::string& endpoint_id);
+  void OnBandwidthChanged(const std::string& endpoint_id, Medium medium);
 
   // DiscoveryListener callbacks
   void OnEndpointFound(const std::string& endpoint_id,
@@ -194,6 +220,7 @@ class OfflineSimulationUser {
   CountDownLatch* lost_latch_ = nullptr;
   CountDownLatch* payload_latch_ = nullptr;
   CountDownLatch* disconnect_latch_ = nullptr;
+  CountDownLatch* bandwidth_changed_latch_ = nullptr;
   Future<bool>* future_ = nullptr;
   std::function<bool(const PayloadProgressInfo&)> predicate_;
   ClientProxy client_;
@@ -28,6 +28,7 @@
 #include "internal/platform/mutex_lock.h"
 #include "internal/platform/single_thread_executor.h"
 #include "internal/platform/system_clock.h"
+#include "internal/platform/tracing.h"
 
 namespace location {
 namespace nearby {
@@ -36,11 +37,24 @@ namespace connections {
 // C++14 requires to declare this.
 // TODO(apolyudov): remove when migration to c++17 is possible.
 constexpr const absl::Duration PayloadManager::kWaitCloseTimeout;
+constexpr absl::Duration PayloadManager::kPausedPollInterval;
+
+namespace {
+
+constexpr char kTraceCategory[] = "payloads";
+
+// A payload may go to several endpoints, and ends separately for each.
+std::string GetTraceId(const std::string& endpoint_id, Payload::Id payload_id) {
+  return absl::StrCat(endpoint_id, "/", payload_id);
+}
+
+}  // namespace
 
 bool PayloadManager::SendPayloadLoop(
     ClientProxy* client, PendingPayload& pending_payload,
     PayloadTransferFrame::PayloadHeader& payload_header,
-    std::int64_t& next_chunk_offset, size_t resume_offset) {
+    std::int64_t& next_chunk_offset, size_t resume_offset,
+    ChunkReadAhead* read_ahead) {
   // in lieu of structured binding:
   auto pair = GetAvailableAndUnavailableEndpoints(pending_payload);
   const EndpointIds& available_endpoint_ids =
@@ -103,12 +117,23 @@ bool PayloadManager::SendPayloadLoop(
     pending_payload.SetOffsetForEndpoint(endpoint_id, next_chunk_offset);
   }
 
+  // A receiver that can't keep up asked us to hold off. Come back around the
+  // loop every so often, so cancellation and disconnects are still noticed.
+  if (!pending_payload.WaitWhilePaused(kPausedPollInterval)) return true;
+
   // This will block if there is no data to transfer.
   // It will resume when new data arrives, or if Close() is called.
   int chunk_size = GetOptimalChunkSize(available_endpoint_ids);
+  absl::Time detach_start_time = SystemClock::ElapsedRealtime();
   ByteArray next_chunk =
-      pending_payload.GetInternalPayload()->DetachNextChunk(chunk_size);
+      read_ahead
+          ? read_ahead->Next(chunk_size)
+          : pending_payload.GetInternalPayload()->DetachNextChunk(chunk_size);
   if (shutdown_.Get()) return false;
+  // With a stream payload, this includes waiting for the app to write.
+  endpoint_manager_->RecordTransferStage(
+      available_endpoint_ids, TransferMetrics::Stage::kDetachChunk,
+      SystemClock::ElapsedRealtime() - detach_start_time);
   // Save chunk size. We'll need it after we move next_chunk.
   auto next_chunk_size = next_chunk.size();
   if (!next_chunk_size &&
@@ -149,8 +174,9 @@ bool PayloadManager::SendPayloadLoop(
       if (std::find(failed_endpoint_ids.begin(), failed_endpoint_ids.end(),
                     endpoint_id) == failed_endpoint_ids.end()) {
         HandleSuccessfulOutgoingChunk(
-            client, endpoint_id, payload_header, payload_chunk.flags(),
-            payload_chunk.offset(), payload_chunk.body().size());
+            client, endpoint_id, pending_payload, payload_header,
+            payload_chunk.flags(), payload_chunk.offset(),
+            payload_chunk.body().size());
       }
     }
     NEARBY_LOGS(VERBOSE) << "PayloadManager done sending chunk at offset "
@@ -312,6 +338,8 @@ PayloadManager::~PayloadManager() {
   bytes_payload_executor_.Shutdown();
   stream_payload_executor_.Shutdown();
   file_payload_executor_.Shutdown();
+  stream_read_ahead_executor_.Shutdown();
+  file_read_ahead_executor_.Shutdown();
 
   CountDownLatch stop_latch(1);
   // Clear our tracked pending payloads.
@@ -394,6 +422,17 @@ void PayloadManager::SendPayload(ClientProxy* client,
 
   Payload::Id payload_id =
       CreateOutgoingPayload(std::move(payload), endpoint_ids);
+  if (Tracer::IsEnabled()) {
+    for (const auto& endpoint_id : endpoint_ids) {
+      NEARBY_TRACE_ASYNC_BEGIN(
+          kTraceCategory, "outgoing_payload",
+          GetTraceId(endpoint_id, payload_id),
+          {{"endpoint_id", endpoint_id},
+           {"payload_id", absl::StrCat(payload_id)},
+           {"type", ToString(payload_type)},
+           {"total_size", absl::StrCat(payload_total_size)}});
+    }
+  }
   executor->Execute(
       "send-payload", [this, client, endpoint_ids, payload_id, payload_type,
                        resume_offset, payload_total_size]() {
@@ -412,23 +451,48 @@ void PayloadManager::SendPayload(ClientProxy* client,
         }
         auto* internal_payload = pending_payload->GetInternalPayload();
         if (!internal_payload) return;
+        for (const auto& endpoint_id : endpoint_ids) {
+          pending_payload->SetProgressPolicy(
+              endpoint_id, client->GetPayloadProgressPolicy(endpoint_id));
+        }
 
         RecordPayloadStartedAnalytics(client, endpoint_ids, payload_id,
                                       payload_type, resume_offset,
                                       internal_payload->GetTotalSize());
+        if (FeatureFlags::GetInstance()
+                .GetFlags()
+                .enable_lock_free_payload_analytics) {
+          for (const auto& endpoint_id : endpoint_ids) {
+            pending_payload->SetChunkCounter(
+                endpoint_id,
+                client->GetAnalyticsRecorder().GetOutgoingChunkCounter(
+                    endpoint_id, payload_id));
+          }
+        }
 
         PayloadTransferFrame::PayloadHeader payload_header{
             CreatePayloadHeader(*internal_payload, resume_offset,
                                 internal_payload->GetParentFolder(),
                                 internal_payload->GetFileName())};
 
+        // Reading the next chunks from disk or from the client's stream
+        // overlaps with sending the current one; bytes payloads are already
+        // in memory and are detached inline.
+        std::unique_ptr<ChunkReadAhead> read_ahead;
+        if (auto* read_ahead_executor = GetReadAheadExecutor(payload_type)) {
+          read_ahead = absl::make_unique<ChunkReadAhead>(
+              *internal_payload, *read_ahead_executor, kMaxReadAheadChunks);
+        }
+
         bool should_continue = true;
         std::int64_t next_chunk_offset = 0;
         while (should_continue && !shutdown_.Get()) {
-          should_continue =
-              SendPayloadLoop(client, *pending_payload, payload_header,
-                              next_chunk_offset, resume_offset);
+          should_continue = SendPayloadLoop(client, *pending_payload,
+                                            payload_header, next_chunk_offset,
+                                            resume_offset, read_ahead.get());
         }
+        // The reader must be done with the payload before it is destroyed.
+        read_ahead.reset();
         RunOnStatusUpdateThread("destroy-payload",
                                 [this, payload_id]()
                                     RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
@@ -481,7 +545,9 @@ void PayloadManager::OnIncomingFrame(
       ProcessControlPacket(to_client, from_endpoint_id, frame);
       break;
     case PayloadTransferFrame::DATA:
-      ProcessDataPacket(to_client, from_endpoint_id, frame);
+      ProcessDataPacket(
+          to_client, from_endpoint_id, frame,
+          ByteArray(std::move(*frame.mutable_payload_chunk()->mutable_body())));
       break;
     default:
       NEARBY_LOGS(WARNING)
@@ -491,6 +557,14 @@ void PayloadManager::OnIncomingFrame(
   }
 }
 
+// @EndpointManagerDataPool
+void PayloadManager::OnIncomingDataFrame(
+    parser::DataFrame& data_frame, const std::string& from_endpoint_id,
+    ClientProxy* to_client, proto::connections::Medium current_medium) {
+  ProcessDataPacket(to_client, from_endpoint_id, data_frame.frame,
+                    std::move(data_frame.body));
+}
+
 void PayloadManager::OnEndpointDisconnect(ClientProxy* client,
                                           const std::string& service_id,
                                           const std::string& endpoint_id,
@@ -604,13 +678,27 @@ SingleThreadExecutor* PayloadManager::GetOutgoingPayloadExecutor(
   }
 }
 
+SingleThreadExecutor* PayloadManager::GetReadAheadExecutor(
+    PayloadType payload_type) {
+  switch (payload_type) {
+    case PayloadType::kFile:
+      return &file_read_ahead_executor_;
+    case PayloadType::kStream:
+      return &stream_read_ahead_executor_;
+    default:
+      return nullptr;
+  }
+}
+
 int PayloadManager::GetOptimalChunkSize(EndpointIds endpoint_ids) {
-  int minChunkSize = std::numeric_limits<int>::max();
+  // Read as much as the fastest endpoint takes at once; EndpointManager splits
+  // the chunk for endpoints that take smaller ones.
+  int maxChunkSize = 0;
   for (const auto& endpoint_id : endpoint_ids) {
-    minChunkSize = std::min(
-        minChunkSize, endpoint_manager_->GetMaxTransmitPacketSize(endpoint_id));
+    maxChunkSize =
+        std::max(maxChunkSize, endpoint_manager_->GetChunkSize(endpoint_id));
   }
-  return minChunkSize;
+  return maxChunkSize;
 }
 
 PayloadTransferFrame::PayloadHeader PayloadManager::CreatePayloadHeader(
@@ -652,8 +740,9 @@ PayloadTransferFrame::PayloadChunk PayloadManager::CreatePayloadChunk(
 }
 
 PayloadManager::PendingPayload* PayloadManager::CreateIncomingPayload(
-    const PayloadTransferFrame& frame, const std::string& endpoint_id) {
-  auto internal_payload = CreateIncomingInternalPayload(frame);
+    const PayloadTransferFrame& frame, const ByteArray& body,
+    const std::string& endpoint_id) {
+  auto internal_payload = CreateIncomingInternalPayload(frame, body);
   if (!internal_payload) {
     return nullptr;
   }
@@ -699,7 +788,15 @@ void PayloadManager::SendClientCallbacksForFinishedOutgoingPayload(
           // Notify the client.
           client->OnPayloadProgress(endpoint_id, update);
 
-          // Mark this payload as done for analytics.
+          // Mark this payload as done for analytics, after the chunks sent
+          // that weren't reported yet.
+          ChunkProgress progress =
+              pending_payload->TakeChunkProgress(endpoint_id);
+          if (progress.num_chunks > 0 && !progress.counted) {
+            client->GetAnalyticsRecorder().OnPayloadChunkSent(
+                endpoint_id, payload_header.id(), progress.num_bytes,
+                progress.num_chunks);
+          }
           client->GetAnalyticsRecorder().OnOutgoingPayloadDone(
               endpoint_id, payload_header.id(), status);
         }
@@ -735,9 +832,16 @@ void PayloadManager::SendClientCallbacksForFinishedIncomingPayload(
             PayloadManager::PayloadStatusToTransferUpdateStatus(status),
             payload_header.total_size(), offset_bytes};
         NotifyClientOfIncomingPayloadProgressInfo(client, endpoint_id, update);
+        ChunkProgress progress =
+            pending_payload->TakeChunkProgress(endpoint_id);
         DestroyPendingPayload(payload_header.id());
 
         // Analyze
+        if (progress.num_chunks > 0 && !progress.counted) {
+          client->GetAnalyticsRecorder().OnPayloadChunkReceived(
+              endpoint_id, payload_header.id(), progress.num_bytes,
+              progress.num_chunks);
+        }
         client->GetAnalyticsRecorder().OnIncomingPayloadDone(
             endpoint_id, payload_header.id(), status);
       });
@@ -761,6 +865,15 @@ void PayloadManager::HandleFinishedOutgoingPayload(
     const PayloadTransferFrame::PayloadHeader& payload_header,
     std::int64_t num_bytes_successfully_transferred,
     proto::connections::PayloadStatus status) {
+  if (Tracer::IsEnabled()) {
+    for (const auto& endpoint_id : finished_endpoint_ids) {
+      NEARBY_TRACE_ASYNC_END(
+          kTraceCategory, "outgoing_payload",
+          GetTraceId(endpoint_id, payload_header.id()),
+          {{"status", proto::connections::PayloadStatus_Name(status)},
+           {"bytes", absl::StrCat(num_bytes_successfully_transferred)}});
+    }
+  }
   // This call will destroy a pending payload.
   SendClientCallbacksForFinishedOutgoingPayload(
       client, finished_endpoint_ids, payload_header,
@@ -805,6 +918,11 @@ void PayloadManager::HandleFinishedIncomingPayload(
     ClientProxy* client, const std::string& endpoint_id,
     const PayloadTransferFrame::PayloadHeader& payload_header,
     std::int64_t offset_bytes, proto::connections::PayloadStatus status) {
+  NEARBY_TRACE_ASYNC_END(
+      kTraceCategory, "incoming_payload",
+      GetTraceId(endpoint_id, payload_header.id()),
+      {{"status", proto::connections::PayloadStatus_Name(status)},
+       {"bytes", absl::StrCat(offset_bytes)}});
   SendClientCallbacksForFinishedIncomingPayload(
       client, endpoint_id, payload_header, offset_bytes, status);
 
@@ -828,14 +946,24 @@ void PayloadManager::HandleFinishedIncomingPayload(
 
 void PayloadManager::HandleSuccessfulOutgoingChunk(
     ClientProxy* client, const std::string& endpoint_id,
+    PendingPayload& pending_payload,
     const PayloadTransferFrame::PayloadHeader& payload_header,
     std::int32_t payload_chunk_flags, std::int64_t payload_chunk_offset,
     std::int64_t payload_chunk_body_size) {
+  bool is_last_chunk = (payload_chunk_flags &
+                        PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
+  // Chunks are reported together, once the client is due to hear about them.
+  if (!pending_payload.AddChunkProgress(
+          endpoint_id, payload_chunk_body_size,
+          is_last_chunk ? payload_chunk_offset
+                        : payload_chunk_offset + payload_chunk_body_size,
+          is_last_chunk)) {
+    return;
+  }
   RunOnStatusUpdateThread(
       "outgoing-chunk-success",
-      [this, client, endpoint_id, payload_header, payload_chunk_flags,
-       payload_chunk_offset,
-       payload_chunk_body_size]() RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
+      [this, client, endpoint_id,
+       payload_header]() RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
         // Make sure we're still tracking this payload and its associated
         // endpoint.
         PendingPayload* pending_payload = GetPayload(payload_header.id());
@@ -847,23 +975,39 @@ void PayloadManager::HandleSuccessfulOutgoingChunk(
           return;
         }
 
-        bool is_last_chunk =
-            (payload_chunk_flags &
-             PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
+        ChunkProgress progress =
+            pending_payload->TakeChunkProgress(endpoint_id);
+        if (progress.num_chunks == 0 && !progress.finished) {
+          // Already reported along with the payload's failure.
+          return;
+        }
         PayloadProgressInfo update{
             payload_header.id(),
-            is_last_chunk ? PayloadProgressInfo::Status::kSuccess
-                          : PayloadProgressInfo::Status::kInProgress,
-            payload_header.total_size(),
-            is_last_chunk ? payload_chunk_offset
-                          : payload_chunk_offset + payload_chunk_body_size};
+            progress.finished ? PayloadProgressInfo::Status::kSuccess
+                              : PayloadProgressInfo::Status::kInProgress,
+            payload_header.total_size(), progress.offset};
 
         // Notify the client.
         client->OnPayloadProgress(endpoint_id, update);
 
-        if (is_last_chunk) {
+        if (progress.num_chunks > 0) {
+          if (!progress.counted) {
+            client->GetAnalyticsRecorder().OnPayloadChunkSent(
+                endpoint_id, payload_header.id(), progress.num_bytes,
+                progress.num_chunks);
+          }
+          client->GetAnalyticsRecorder().OnPayloadChunkSizeSelected(
+              endpoint_id, payload_header.id(),
+              endpoint_manager_->GetChunkSize(endpoint_id));
+        }
+        if (progress.finished) {
           client->GetAnalyticsRecorder().OnOutgoingPayloadDone(
               endpoint_id, payload_header.id(), proto::connections::SUCCESS);
+          NEARBY_TRACE_ASYNC_END(
+              kTraceCategory, "outgoing_payload",
+              GetTraceId(endpoint_id, payload_header.id()),
+              {{"status", "SUCCESS"},
+               {"bytes", absl::StrCat(progress.offset)}});
 
           // Stop tracking this endpoint.
           pending_payload->RemoveEndpoints({endpoint_id});
@@ -872,9 +1016,6 @@ void PayloadManager::HandleSuccessfulOutgoingChunk(
           if (pending_payload->GetEndpoints().empty()) {
             pending_payload->Close();
           }
-        } else {
-          client->GetAnalyticsRecorder().OnPayloadChunkSent(
-              endpoint_id, payload_header.id(), payload_chunk_body_size);
         }
       });
 }
@@ -899,41 +1040,59 @@ void PayloadManager::DestroyPendingPayload(Payload::Id payload_id) {
 
 void PayloadManager::HandleSuccessfulIncomingChunk(
     ClientProxy* client, const std::string& endpoint_id,
+    PendingPayload& pending_payload,
     const PayloadTransferFrame::PayloadHeader& payload_header,
     std::int32_t payload_chunk_flags, std::int64_t payload_chunk_offset,
     std::int64_t payload_chunk_body_size) {
+  bool is_last_chunk = (payload_chunk_flags &
+                        PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
+  // Chunks are reported together, once the client is due to hear about them.
+  if (!pending_payload.AddChunkProgress(
+          endpoint_id, payload_chunk_body_size,
+          is_last_chunk ? payload_chunk_offset
+                        : payload_chunk_offset + payload_chunk_body_size,
+          is_last_chunk)) {
+    return;
+  }
   RunOnStatusUpdateThread(
       "incoming-chunk-success",
-      [this, client, endpoint_id, payload_header, payload_chunk_flags,
-       payload_chunk_offset,
-       payload_chunk_body_size]() RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
+      [this, client, endpoint_id,
+       payload_header]() RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
         // Make sure we're still tracking this payload.
         PendingPayload* pending_payload = GetPayload(payload_header.id());
         if (!pending_payload) {
           return;
         }
 
-        bool is_last_chunk =
-            (payload_chunk_flags &
-             PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
+        ChunkProgress progress =
+            pending_payload->TakeChunkProgress(endpoint_id);
+        if (progress.num_chunks == 0 && !progress.finished) {
+          // Already reported along with the payload's failure.
+          return;
+        }
         PayloadProgressInfo update{
             payload_header.id(),
-            is_last_chunk ? PayloadProgressInfo::Status::kSuccess
-                          : PayloadProgressInfo::Status::kInProgress,
-            payload_header.total_size(),
-            is_last_chunk ? payload_chunk_offset
-                          : payload_chunk_offset + payload_chunk_body_size};
+            progress.finished ? PayloadProgressInfo::Status::kSuccess
+                              : PayloadProgressInfo::Status::kInProgress,
+            payload_header.total_size(), progress.offset};
 
         // Notify the client of this update.
         NotifyClientOfIncomingPayloadProgressInfo(client, endpoint_id, update);
 
         // Analyze the success.
-        if (is_last_chunk) {
+        if (progress.num_chunks > 0 && !progress.counted) {
+          client->GetAnalyticsRecorder().OnPayloadChunkReceived(
+              endpoint_id, payload_header.id(), progress.num_bytes,
+              progress.num_chunks);
+        }
+        if (progress.finished) {
           client->GetAnalyticsRecorder().OnIncomingPayloadDone(
               endpoint_id, payload_header.id(), proto::connections::SUCCESS);
-        } else {
-          client->GetAnalyticsRecorder().OnPayloadChunkReceived(
-              endpoint_id, payload_header.id(), payload_chunk_body_size);
+          NEARBY_TRACE_ASYNC_END(
+              kTraceCategory, "incoming_payload",
+              GetTraceId(endpoint_id, payload_header.id()),
+              {{"status", "SUCCESS"},
+               {"bytes", absl::StrCat(progress.offset)}});
         }
       });
 }
@@ -941,7 +1100,7 @@ void PayloadManager::HandleSuccessfulIncomingChunk(
 // @EndpointManagerDataPool
 void PayloadManager::ProcessDataPacket(
     ClientProxy* to_client, const std::string& from_endpoint_id,
-    PayloadTransferFrame& payload_transfer_frame) {
+    PayloadTransferFrame& payload_transfer_frame, ByteArray body) {
   PayloadTransferFrame::PayloadHeader& payload_header =
       *payload_transfer_frame.mutable_payload_header();
   PayloadTransferFrame::PayloadChunk& payload_chunk =
@@ -964,8 +1123,8 @@ void PayloadManager::ProcessDataPacket(
               payload_header.total_size());
         });
 
-    pending_payload =
-        CreateIncomingPayload(payload_transfer_frame, from_endpoint_id);
+    pending_payload = CreateIncomingPayload(payload_transfer_frame, body,
+                                            from_endpoint_id);
     if (!pending_payload) {
       NEARBY_LOGS(WARNING)
           << "PayloadManager failed to create InternalPayload from "
@@ -978,6 +1137,56 @@ void PayloadManager::ProcessDataPacket(
                          PayloadTransferFrame::ControlMessage::PAYLOAD_ERROR);
       return;
     }
+    NEARBY_TRACE_ASYNC_BEGIN(
+        kTraceCategory, "incoming_payload",
+        GetTraceId(from_endpoint_id, payload_header.id()),
+        {{"endpoint_id", from_endpoint_id},
+         {"payload_id", absl::StrCat(payload_header.id())},
+         {"type", ToString(FramePayloadTypeToPayloadType(
+                      payload_header.type()))},
+         {"total_size", absl::StrCat(payload_header.total_size())}});
+    pending_payload->SetProgressPolicy(
+        from_endpoint_id,
+        to_client->GetPayloadProgressPolicy(from_endpoint_id));
+    if (FeatureFlags::GetInstance()
+            .GetFlags()
+            .enable_lock_free_payload_analytics) {
+      // Runs after the analysis above started.
+      RunOnStatusUpdateThread(
+          "set-chunk-counter",
+          [this, to_client, from_endpoint_id,
+           payload_header]() RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
+            PendingPayload* pending_payload = GetPayload(payload_header.id());
+            if (!pending_payload) return;
+            pending_payload->SetChunkCounter(
+                from_endpoint_id,
+                to_client->GetAnalyticsRecorder().GetIncomingChunkCounter(
+                    from_endpoint_id, payload_header.id()));
+          });
+    }
+
+    // Ask the sender to hold off whenever the client falls behind reading
+    // the payload, instead of buffering without bound.
+    pending_payload->GetInternalPayload()->SetBackpressureListener(
+        [this, from_endpoint_id, payload_header](bool backed_up) {
+          RunOnStatusUpdateThread(
+              "payload-backpressure",
+              [this, from_endpoint_id, payload_header,
+               backed_up]() RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
+                PendingPayload* pending_payload =
+                    GetPayload(payload_header.id());
+                if (!pending_payload) return;
+                EndpointInfo* endpoint =
+                    pending_payload->GetEndpoint(from_endpoint_id);
+                SendControlMessage(
+                    {from_endpoint_id}, payload_header,
+                    endpoint ? endpoint->offset : 0,
+                    backed_up
+                        ? PayloadTransferFrame::ControlMessage::PAYLOAD_PAUSED
+                        : PayloadTransferFrame::ControlMessage::
+                              PAYLOAD_RESUMED);
+              });
+        });
 
     // Also, let the client know of this new incoming payload.
     RunOnStatusUpdateThread(
@@ -1022,11 +1231,14 @@ void PayloadManager::ProcessDataPacket(
   pending_payload->SetOffsetForEndpoint(from_endpoint_id,
                                         payload_chunk.offset());
 
-  // Save size of packet before we move it.
-  std::int64_t payload_body_size = payload_chunk.body().size();
-  if (pending_payload->GetInternalPayload()
-          ->AttachNextChunk(ByteArray(std::move(*payload_chunk.mutable_body())))
-          .Raised()) {
+  std::int64_t payload_body_size = body.size();
+  absl::Time attach_start_time = SystemClock::ElapsedRealtime();
+  Exception attach_exception =
+      pending_payload->GetInternalPayload()->AttachNextChunk(body);
+  endpoint_manager_->RecordTransferStage(
+      {from_endpoint_id}, TransferMetrics::Stage::kAttachChunk,
+      SystemClock::ElapsedRealtime() - attach_start_time);
+  if (attach_exception.Raised()) {
     NEARBY_LOGS(ERROR) << "ProcessDataPacket: [data: error] endpoint_id="
                        << from_endpoint_id
                        << "; payload_id=" << pending_payload->GetId();
@@ -1036,9 +1248,9 @@ void PayloadManager::ProcessDataPacket(
     return;
   }
 
-  HandleSuccessfulIncomingChunk(to_client, from_endpoint_id, payload_header,
-                                payload_chunk.flags(), payload_chunk.offset(),
-                                payload_body_size);
+  HandleSuccessfulIncomingChunk(to_client, from_endpoint_id, *pending_payload,
+                                payload_header, payload_chunk.flags(),
+                                payload_chunk.offset(), payload_body_size);
 }
 
 // @EndpointManagerDataPool
@@ -1093,6 +1305,23 @@ void PayloadManager::ProcessControlPacket(
                                                              control_message);
       }
       break;
+    case PayloadTransferFrame::ControlMessage::PAYLOAD_PAUSED:
+    case PayloadTransferFrame::ControlMessage::PAYLOAD_RESUMED: {
+      if (pending_payload->IsIncoming()) {
+        NEARBY_LOGS(WARNING) << "Ignoring control message "
+                             << control_message.event()
+                             << " for incoming payload_id="
+                             << payload_header.id();
+        break;
+      }
+      bool paused = control_message.event() ==
+                    PayloadTransferFrame::ControlMessage::PAYLOAD_PAUSED;
+      NEARBY_LOGS(INFO) << "Outgoing payload_id=" << payload_header.id()
+                        << (paused ? " paused" : " resumed")
+                        << " at request of endpoint_id=" << from_endpoint_id;
+      pending_payload->SetEndpointPaused(from_endpoint_id, paused);
+      break;
+    }
     default:
       NEARBY_LOGS(INFO) << "Unhandled control message "
                         << control_message.event() << " for payload_id="
@@ -1238,6 +1467,8 @@ void PayloadManager::PendingPayload::RemoveEndpoints(
   for (const auto& id : endpoint_ids) {
     endpoints_.erase(id);
   }
+  // A removed endpoint no longer holds the payload back.
+  resumed_.Notify();
 }
 
 void PayloadManager::PendingPayload::SetEndpointStatusFromControlMessage(
@@ -1261,11 +1492,112 @@ void PayloadManager::PendingPayload::SetOffsetForEndpoint(
   }
 }
 
+void PayloadManager::PendingPayload::SetProgressPolicy(
+    const std::string& endpoint_id, const PayloadProgressPolicy& policy) {
+  MutexLock lock(&mutex_);
+
+  auto item = endpoints_.find(endpoint_id);
+  if (item != endpoints_.end()) {
+    item->second.progress_policy = policy;
+  }
+}
+
+bool PayloadManager::PendingPayload::AddChunkProgress(
+    const std::string& endpoint_id, std::int64_t chunk_size,
+    std::int64_t offset, bool finished) {
+  MutexLock lock(&mutex_);
+
+  auto item = endpoints_.find(endpoint_id);
+  if (item == endpoints_.end()) {
+    return false;
+  }
+  EndpointInfo& endpoint = item->second;
+  // The empty last chunk only marks the end; it doesn't count as a chunk.
+  if (!finished) {
+    ++endpoint.progress.num_chunks;
+    endpoint.progress.num_bytes += chunk_size;
+    if (endpoint.chunk_counter) endpoint.chunk_counter->Add(chunk_size);
+  }
+  endpoint.progress.offset = offset;
+  endpoint.progress.finished = finished;
+  // A queued update reports everything up to when it runs.
+  if (endpoint.progress_update_queued) {
+    return false;
+  }
+
+  const absl::Time now = SystemClock::ElapsedRealtime();
+  const PayloadProgressPolicy& policy = endpoint.progress_policy;
+  if (!finished && (now - endpoint.reported_time < policy.min_interval ||
+                    offset - endpoint.reported_offset < policy.min_bytes)) {
+    return false;
+  }
+  endpoint.progress_update_queued = true;
+  endpoint.reported_time = now;
+  endpoint.reported_offset = offset;
+  return true;
+}
+
+void PayloadManager::PendingPayload::SetChunkCounter(
+    const std::string& endpoint_id,
+    std::shared_ptr<analytics::AnalyticsRecorder::ChunkCounter> counter) {
+  MutexLock lock(&mutex_);
+
+  auto item = endpoints_.find(endpoint_id);
+  if (item == endpoints_.end() || !counter) {
+    return;
+  }
+  EndpointInfo& endpoint = item->second;
+  if (endpoint.progress.num_chunks > 0) {
+    counter->Add(endpoint.progress.num_bytes, endpoint.progress.num_chunks);
+  }
+  endpoint.chunk_counter = std::move(counter);
+}
+
+PayloadManager::ChunkProgress PayloadManager::PendingPayload::TakeChunkProgress(
+    const std::string& endpoint_id) {
+  MutexLock lock(&mutex_);
+
+  auto item = endpoints_.find(endpoint_id);
+  if (item == endpoints_.end()) {
+    return {};
+  }
+  EndpointInfo& endpoint = item->second;
+  endpoint.progress_update_queued = false;
+  ChunkProgress progress = std::exchange(endpoint.progress, {});
+  progress.counted = endpoint.chunk_counter != nullptr;
+  return progress;
+}
+
 void PayloadManager::PendingPayload::Close() {
   if (internal_payload_) internal_payload_->Close();
   close_event_.CountDown();
 }
 
+void PayloadManager::PendingPayload::SetEndpointPaused(
+    const std::string& endpoint_id, bool paused) {
+  MutexLock lock(&mutex_);
+
+  auto item = endpoints_.find(endpoint_id);
+  if (item != endpoints_.end()) {
+    item->second.paused = paused;
+    if (!paused) resumed_.Notify();
+  }
+}
+
+bool PayloadManager::PendingPayload::WaitWhilePaused(absl::Duration timeout) {
+  MutexLock lock(&mutex_);
+
+  auto is_paused = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    for (const auto& item : endpoints_) {
+      if (item.second.paused) return true;
+    }
+    return false;
+  };
+  if (!is_paused()) return true;
+  resumed_.Wait(timeout);
+  return !is_paused();
+}
+
 bool PayloadManager::PendingPayload::WaitForClose() {
   return close_event_.Await(kWaitCloseTimeout).result();
 }
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "connections/implementation/chunk_read_ahead.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_manager.h"
 #include "connections/implementation/internal_payload.h"
@@ -30,6 +31,7 @@
 #include "internal/platform/byte_array.h"
 #include "internal/platform/atomic_boolean.h"
 #include "internal/platform/atomic_reference.h"
+#include "internal/platform/condition_variable.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/mutex.h"
 
@@ -47,6 +49,13 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   using EndpointIds = std::vector<std::string>;
   constexpr static const absl::Duration kWaitCloseTimeout =
       absl::Milliseconds(5000);
+  // Number of chunks of an outgoing file or stream payload that are read
+  // ahead of the chunk currently being sent.
+  static constexpr int kMaxReadAheadChunks = 4;
+  // How long an outgoing payload paused by a receiver waits before checking
+  // again for cancellation and disconnects.
+  static constexpr absl::Duration kPausedPollInterval =
+      absl::Milliseconds(100);
 
   explicit PayloadManager(EndpointManager& endpoint_manager);
   ~PayloadManager() override;
@@ -61,6 +70,12 @@ class PayloadManager : public EndpointManager::FrameProcessor {
                        ClientProxy* to_client,
                        proto::connections::Medium current_medium) override;
 
+  // @EndpointManagerReaderThread
+  void OnIncomingDataFrame(parser::DataFrame& data_frame,
+                           const std::string& from_endpoint_id,
+                           ClientProxy* to_client,
+                           proto::connections::Medium current_medium) override;
+
   // @EndpointManagerThread
   void OnEndpointDisconnect(ClientProxy* client, const std::string& service_id,
                             const std::string& endpoint_id,
@@ -69,6 +84,19 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   void DisconnectFromEndpointManager();
 
  private:
+  // Chunks transferred to or from an endpoint that the status update thread
+  // has yet to report, to the client and to analytics.
+  struct ChunkProgress {
+    int num_chunks = 0;
+    std::int64_t num_bytes = 0;
+    // Bytes of the payload transferred so far, and whether that's all of it.
+    std::int64_t offset = 0;
+    bool finished = false;
+    // Whether the chunks were added to the endpoint's analytics chunk counter
+    // already.
+    bool counted = false;
+  };
+
   // Information about an endpoint for a particular payload.
   struct EndpointInfo {
     // Status set for the endpoint out-of-band via a ControlMessage.
@@ -88,6 +116,20 @@ class PayloadManager : public EndpointManager::FrameProcessor {
     std::string id;
     AtomicReference<Status> status{Status::kUnknown};
     std::int64_t offset = 0;
+    // Whether the endpoint asked us to hold off sending, via a PAYLOAD_PAUSED
+    // ControlMessage. Guarded by the owning PendingPayload's mutex_.
+    bool paused = false;
+    // Progress not reported yet, whether an update reporting it is queued on
+    // the status update thread, and what the last update reported. Guarded by
+    // the owning PendingPayload's mutex_.
+    PayloadProgressPolicy progress_policy;
+    ChunkProgress progress;
+    bool progress_update_queued = false;
+    // Where chunks are counted for analytics as they are transferred, if set.
+    // Guarded by the owning PendingPayload's mutex_.
+    std::shared_ptr<analytics::AnalyticsRecorder::ChunkCounter> chunk_counter;
+    absl::Time reported_time = absl::InfinitePast();
+    std::int64_t reported_offset = 0;
   };
 
   // Tracks state for an InternalPayload and the endpoints associated with it.
@@ -131,6 +173,39 @@ class PayloadManager : public EndpointManager::FrameProcessor {
     void SetOffsetForEndpoint(const std::string& endpoint_id,
                               std::int64_t offset) ABSL_LOCKS_EXCLUDED(mutex_);
 
+    // Sets how the client wants to hear about progress to or from a particular
+    // endpoint.
+    void SetProgressPolicy(const std::string& endpoint_id,
+                           const PayloadProgressPolicy& policy)
+        ABSL_LOCKS_EXCLUDED(mutex_);
+
+    // Adds a chunk transferred to or from a particular endpoint, which brings
+    // the transfer to |offset|. Returns true if an update should be queued on
+    // the status update thread to report it: the endpoint's policy says the
+    // client is due to hear about it, and no update is queued already.
+    bool AddChunkProgress(const std::string& endpoint_id,
+                          std::int64_t chunk_size, std::int64_t offset,
+                          bool finished) ABSL_LOCKS_EXCLUDED(mutex_);
+
+    // Counts the chunks transferred to or from a particular endpoint on
+    // |counter| from now on, along with those not reported yet.
+    void SetChunkCounter(
+        const std::string& endpoint_id,
+        std::shared_ptr<analytics::AnalyticsRecorder::ChunkCounter> counter)
+        ABSL_LOCKS_EXCLUDED(mutex_);
+
+    // Takes the progress not reported yet for a particular endpoint.
+    ChunkProgress TakeChunkProgress(const std::string& endpoint_id)
+        ABSL_LOCKS_EXCLUDED(mutex_);
+
+    // Marks whether a particular endpoint asked us to hold off sending.
+    void SetEndpointPaused(const std::string& endpoint_id, bool paused)
+        ABSL_LOCKS_EXCLUDED(mutex_);
+
+    // Waits up to |timeout| for every endpoint to be resumed. Returns true if
+    // none of the endpoints is paused.
+    bool WaitWhilePaused(absl::Duration timeout) ABSL_LOCKS_EXCLUDED(mutex_);
+
     // Closes internal_payload_ and triggers close_event_.
     // Close is called when a pending peyload does not have associated
     // endpoints.
@@ -143,6 +218,7 @@ class PayloadManager : public EndpointManager::FrameProcessor {
 
    private:
     mutable Mutex mutex_;
+    ConditionVariable resumed_{&mutex_};
     bool is_incoming_;
     AtomicBoolean is_locally_canceled_{false};
     CountDownLatch close_event_{1};
@@ -188,9 +264,13 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   // Returns list of endpoint ids.
   static EndpointIds EndpointsToEndpointIds(const Endpoints& endpoints);
 
+  // Sends the next chunk of |pending_payload|. Chunks are taken from
+  // |read_ahead| when it is not null, or detached inline otherwise.
+  // Returns false once there is nothing more to send.
   bool SendPayloadLoop(ClientProxy* client, PendingPayload& pending_payload,
                        PayloadTransferFrame::PayloadHeader& payload_header,
-                       std::int64_t& next_chunk_offset, size_t resume_offset);
+                       std::int64_t& next_chunk_offset, size_t resume_offset,
+                       ChunkReadAhead* read_ahead);
   void SendClientCallbacksForFinishedIncomingPayloadRunnable(
       ClientProxy* client, const std::string& endpoint_id,
       const PayloadTransferFrame::PayloadHeader& payload_header,
@@ -219,6 +299,7 @@ class PayloadManager : public EndpointManager::FrameProcessor {
                                                         ByteArray body);
 
   PendingPayload* CreateIncomingPayload(const PayloadTransferFrame& frame,
+                                        const ByteArray& body,
                                         const std::string& endpoint_id)
       ABSL_LOCKS_EXCLUDED(mutex_);
 
@@ -257,18 +338,23 @@ class PayloadManager : public EndpointManager::FrameProcessor {
 
   void HandleSuccessfulOutgoingChunk(
       ClientProxy* client, const std::string& endpoint_id,
+      PendingPayload& pending_payload,
       const PayloadTransferFrame::PayloadHeader& payload_header,
       std::int32_t payload_chunk_flags, std::int64_t payload_chunk_offset,
       std::int64_t payload_chunk_body_size);
   void HandleSuccessfulIncomingChunk(
       ClientProxy* client, const std::string& endpoint_id,
+      PendingPayload& pending_payload,
       const PayloadTransferFrame::PayloadHeader& payload_header,
       std::int32_t payload_chunk_flags, std::int64_t payload_chunk_offset,
       std::int64_t payload_chunk_body_size);
 
+  // |body| is the body of the chunk of |payload_transfer_frame|, which may
+  // have been left out of the frame.
   void ProcessDataPacket(ClientProxy* to_client,
                          const std::string& from_endpoint_id,
-                         PayloadTransferFrame& payload_transfer_frame);
+                         PayloadTransferFrame& payload_transfer_frame,
+                         ByteArray body);
   void ProcessControlPacket(ClientProxy* to_client,
                             const std::string& from_endpoint_id,
                             PayloadTransferFrame& payload_transfer_frame);
@@ -279,6 +365,9 @@ class PayloadManager : public EndpointManager::FrameProcessor {
       RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD();
 
   SingleThreadExecutor* GetOutgoingPayloadExecutor(PayloadType payload_type);
+  // Returns the executor that reads chunks ahead for outgoing payloads of
+  // |payload_type|, or null if the payload is already in memory.
+  SingleThreadExecutor* GetReadAheadExecutor(PayloadType payload_type);
 
   void RunOnStatusUpdateThread(const std::string& name,
                                std::function<void()> runnable);
@@ -313,6 +402,8 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   SingleThreadExecutor bytes_payload_executor_;
   SingleThreadExecutor file_payload_executor_;
   SingleThreadExecutor stream_payload_executor_;
+  SingleThreadExecutor file_read_ahead_executor_;
+  SingleThreadExecutor stream_read_ahead_executor_;
   SingleThreadExecutor payload_status_update_executor_;
 
   EndpointManager* endpoint_manager_;
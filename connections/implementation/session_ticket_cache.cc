@@ -0,0 +1,165 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/session_ticket_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "securegcm/d2d_connection_context_v1.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "internal/platform/crypto.h"
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+#include "internal/platform/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr int kSha256BlockSize = 64;
+constexpr int kTicketIdLength = 16;
+// The layout of a session saved by D2DConnectionContextV1::SaveSession():
+// the protocol version, the sequence numbers for encoding and decoding, and
+// the keys for encoding and decoding.
+constexpr char kSavedSessionVersion = 1;
+constexpr int kSavedSessionHeaderLength = 1 + 2 * sizeof(std::int32_t);
+constexpr int kSavedSessionLength = kSavedSessionHeaderLength + 2 * 32;
+
+ByteArray HmacSha256(const ByteArray& key, absl::string_view message) {
+  std::string block_key(key.size() > kSha256BlockSize
+                            ? std::string(Crypto::Sha256(std::string(key)))
+                            : std::string(key));
+  block_key.resize(kSha256BlockSize, 0);
+  std::string inner_key(block_key), outer_key(block_key);
+  for (int i = 0; i < kSha256BlockSize; ++i) {
+    inner_key[i] ^= 0x36;
+    outer_key[i] ^= 0x5c;
+  }
+  ByteArray inner = Crypto::Sha256(absl::StrCat(inner_key, message));
+  return Crypto::Sha256(absl::StrCat(outer_key, std::string(inner)));
+}
+
+}  // namespace
+
+void SessionTicketCache::Issue(const std::string& endpoint_id,
+                               securegcm::D2DConnectionContextV1& context,
+                               const std::string& auth_token,
+                               const ByteArray& raw_auth_token) {
+  std::unique_ptr<std::string> session_unique = context.GetSessionUnique();
+  if (session_unique == nullptr) {
+    NEARBY_LOGS(WARNING) << "No session unique to issue a ticket for endpoint "
+                         << endpoint_id;
+    return;
+  }
+  ByteArray unique(std::move(*session_unique));
+  ByteArray id = HmacSha256(unique, "ticket id");
+  Ticket ticket{
+      .id = ByteArray(id.data(), kTicketIdLength),
+      .secret = HmacSha256(
+          unique, absl::StrCat("ticket secret", std::string(raw_auth_token))),
+      .auth_token = auth_token,
+      .raw_auth_token = raw_auth_token,
+      .expiry = SystemClock::ElapsedRealtime() + lifetime_,
+  };
+
+  MutexLock lock(&mutex_);
+  if (!tickets_.contains(endpoint_id) && tickets_.size() >= kMaxTickets) {
+    auto oldest = tickets_.begin();
+    for (auto it = tickets_.begin(); it != tickets_.end(); ++it) {
+      if (it->second.expiry < oldest->second.expiry) oldest = it;
+    }
+    tickets_.erase(oldest);
+  }
+  tickets_.insert_or_assign(endpoint_id, std::move(ticket));
+}
+
+std::optional<SessionTicketCache::Ticket> SessionTicketCache::Take(
+    const std::string& endpoint_id) {
+  MutexLock lock(&mutex_);
+  auto item = tickets_.extract(endpoint_id);
+  if (!item || item.mapped().expiry <= SystemClock::ElapsedRealtime()) {
+    return std::nullopt;
+  }
+  return std::move(item.mapped());
+}
+
+void SessionTicketCache::Revoke(const std::string& endpoint_id) {
+  MutexLock lock(&mutex_);
+  tickets_.erase(endpoint_id);
+}
+
+void SessionTicketCache::RevokeAll() {
+  MutexLock lock(&mutex_);
+  tickets_.clear();
+}
+
+int SessionTicketCache::GetSize() const {
+  MutexLock lock(&mutex_);
+  return tickets_.size();
+}
+
+ByteArray SessionTicketCache::GetRequestMac(const Ticket& ticket,
+                                            const ByteArray& client_nonce) {
+  return HmacSha256(ticket.secret,
+                    absl::StrCat("request", std::string(ticket.id),
+                                 std::string(client_nonce)));
+}
+
+ByteArray SessionTicketCache::GetAcceptMac(const Ticket& ticket,
+                                           const ByteArray& client_nonce,
+                                           const ByteArray& server_nonce) {
+  return HmacSha256(
+      ticket.secret,
+      absl::StrCat("accept", std::string(ticket.id), std::string(client_nonce),
+                   std::string(server_nonce)));
+}
+
+std::unique_ptr<securegcm::D2DConnectionContextV1> SessionTicketCache::Resume(
+    const Ticket& ticket, const ByteArray& client_nonce,
+    const ByteArray& server_nonce, bool is_client) {
+  std::string nonces =
+      absl::StrCat(std::string(client_nonce), std::string(server_nonce));
+  ByteArray client_key =
+      HmacSha256(ticket.secret, absl::StrCat("client key", nonces));
+  ByteArray server_key =
+      HmacSha256(ticket.secret, absl::StrCat("server key", nonces));
+
+  // Both sequence numbers start over at 0.
+  std::string saved_session(kSavedSessionHeaderLength, 0);
+  saved_session[0] = kSavedSessionVersion;
+  absl::StrAppend(&saved_session,
+                  std::string(is_client ? client_key : server_key),
+                  std::string(is_client ? server_key : client_key));
+  if (saved_session.size() != kSavedSessionLength) return nullptr;
+  return securegcm::D2DConnectionContextV1::FromSavedSession(saved_session);
+}
+
+bool SessionTicketCache::MacsEqual(const ByteArray& a, const ByteArray& b) {
+  if (a.size() != b.size()) return false;
+  char diff = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    diff |= a.data()[i] ^ b.data()[i];
+  }
+  return diff == 0;
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
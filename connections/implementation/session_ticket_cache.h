@@ -0,0 +1,106 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_SESSION_TICKET_CACHE_H_
+#define CORE_INTERNAL_SESSION_TICKET_CACHE_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "securegcm/d2d_connection_context_v1.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/mutex.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Keeps session tickets for endpoints we recently completed UKEY2 with, so
+// that the next connection to them can skip UKEY2 (see
+// SessionResumptionFrame).
+//
+// Both peers derive the same ticket from the session unique of an accepted
+// connection and its raw authentication token, and key it by the id of the
+// remote endpoint. A ticket is single use: it is removed when a resumption is
+// attempted with it, and the resumed session issues the next one. Tickets
+// expire after their lifetime, and may be revoked at any time.
+class SessionTicketCache {
+ public:
+  static constexpr absl::Duration kDefaultLifetime = absl::Hours(24);
+  // Tickets kept at most; the one closest to expiry is evicted first.
+  static constexpr int kMaxTickets = 64;
+  static constexpr int kNonceLength = 32;
+
+  struct Ticket {
+    ByteArray id;
+    ByteArray secret;
+    // The authentication token of the session the ticket was issued for,
+    // reported again for every session resumed with it.
+    std::string auth_token;
+    ByteArray raw_auth_token;
+    absl::Time expiry;
+  };
+
+  explicit SessionTicketCache(absl::Duration lifetime = kDefaultLifetime)
+      : lifetime_(lifetime) {}
+
+  // Issues a ticket for the session with |endpoint_id| protected by |context|,
+  // replacing the one kept for the endpoint, if any.
+  void Issue(const std::string& endpoint_id,
+             securegcm::D2DConnectionContextV1& context,
+             const std::string& auth_token, const ByteArray& raw_auth_token)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Removes the ticket kept for |endpoint_id| and returns it, unless it has
+  // expired.
+  std::optional<Ticket> Take(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  void Revoke(const std::string& endpoint_id) ABSL_LOCKS_EXCLUDED(mutex_);
+  void RevokeAll() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int GetSize() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // The MACs with which the client and the server of a resumption prove that
+  // they hold the secret of |ticket|.
+  static ByteArray GetRequestMac(const Ticket& ticket,
+                                 const ByteArray& client_nonce);
+  static ByteArray GetAcceptMac(const Ticket& ticket,
+                                const ByteArray& client_nonce,
+                                const ByteArray& server_nonce);
+
+  // Returns the connection context of a session resumed with |ticket|, with
+  // keys of its own derived from the nonces of both sides.
+  static std::unique_ptr<securegcm::D2DConnectionContextV1> Resume(
+      const Ticket& ticket, const ByteArray& client_nonce,
+      const ByteArray& server_nonce, bool is_client);
+
+  // Compares MACs in time independent of where they differ.
+  static bool MacsEqual(const ByteArray& a, const ByteArray& b);
+
+ private:
+  const absl::Duration lifetime_;
+  mutable Mutex mutex_;
+  absl::flat_hash_map<std::string, Ticket> tickets_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_SESSION_TICKET_CACHE_H_
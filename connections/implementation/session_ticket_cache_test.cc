@@ -0,0 +1,186 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/session_ticket_cache.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "securegcm/d2d_connection_context_v1.h"
+#include "securegcm/ukey2_handshake.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::securegcm::D2DConnectionContextV1;
+using ::securegcm::UKey2Handshake;
+
+constexpr char kEndpointId[] = "ABCD";
+constexpr char kAuthToken[] = "TOKEN";
+
+// Runs a UKEY2 handshake in memory and returns the contexts of the initiator
+// and the responder.
+std::pair<std::unique_ptr<D2DConnectionContextV1>,
+          std::unique_ptr<D2DConnectionContextV1>>
+Handshake() {
+  constexpr UKey2Handshake::HandshakeCipher kCipher =
+      UKey2Handshake::HandshakeCipher::P256_SHA512;
+  std::unique_ptr<UKey2Handshake> initiator =
+      UKey2Handshake::ForInitiator(kCipher);
+  std::unique_ptr<UKey2Handshake> responder =
+      UKey2Handshake::ForResponder(kCipher);
+  responder->ParseHandshakeMessage(*initiator->GetNextHandshakeMessage());
+  initiator->ParseHandshakeMessage(*responder->GetNextHandshakeMessage());
+  responder->ParseHandshakeMessage(*initiator->GetNextHandshakeMessage());
+  initiator->GetVerificationString(32);
+  responder->GetVerificationString(32);
+  initiator->VerifyHandshake();
+  responder->VerifyHandshake();
+  return {initiator->ToConnectionContext(), responder->ToConnectionContext()};
+}
+
+TEST(SessionTicketCacheTest, BothPeersIssueTheSameTicket) {
+  auto [client_context, server_context] = Handshake();
+  SessionTicketCache client_tickets;
+  SessionTicketCache server_tickets;
+  client_tickets.Issue(kEndpointId, *client_context, kAuthToken,
+                       ByteArray("raw"));
+  server_tickets.Issue(kEndpointId, *server_context, kAuthToken,
+                       ByteArray("raw"));
+
+  std::optional<SessionTicketCache::Ticket> client_ticket =
+      client_tickets.Take(kEndpointId);
+  std::optional<SessionTicketCache::Ticket> server_ticket =
+      server_tickets.Take(kEndpointId);
+  ASSERT_TRUE(client_ticket.has_value());
+  ASSERT_TRUE(server_ticket.has_value());
+  EXPECT_EQ(client_ticket->id, server_ticket->id);
+  EXPECT_EQ(client_ticket->secret, server_ticket->secret);
+  EXPECT_EQ(client_ticket->auth_token, kAuthToken);
+  EXPECT_EQ(client_ticket->raw_auth_token, ByteArray("raw"));
+}
+
+TEST(SessionTicketCacheTest, TicketIsBoundToAuthToken) {
+  auto [client_context, server_context] = Handshake();
+  SessionTicketCache client_tickets;
+  SessionTicketCache server_tickets;
+  client_tickets.Issue(kEndpointId, *client_context, kAuthToken,
+                       ByteArray("raw"));
+  server_tickets.Issue(kEndpointId, *server_context, kAuthToken,
+                       ByteArray("other"));
+
+  EXPECT_NE(client_tickets.Take(kEndpointId)->secret,
+            server_tickets.Take(kEndpointId)->secret);
+}
+
+TEST(SessionTicketCacheTest, TicketIsSingleUse) {
+  auto [context, peer_context] = Handshake();
+  SessionTicketCache tickets;
+  tickets.Issue(kEndpointId, *context, kAuthToken, ByteArray("raw"));
+
+  EXPECT_TRUE(tickets.Take(kEndpointId).has_value());
+  EXPECT_FALSE(tickets.Take(kEndpointId).has_value());
+}
+
+TEST(SessionTicketCacheTest, ExpiredTicketIsNotReturned) {
+  auto [context, peer_context] = Handshake();
+  SessionTicketCache tickets(absl::ZeroDuration());
+  tickets.Issue(kEndpointId, *context, kAuthToken, ByteArray("raw"));
+
+  EXPECT_FALSE(tickets.Take(kEndpointId).has_value());
+}
+
+TEST(SessionTicketCacheTest, RevokedTicketsAreNotReturned) {
+  auto [context, peer_context] = Handshake();
+  SessionTicketCache tickets;
+  tickets.Issue(kEndpointId, *context, kAuthToken, ByteArray("raw"));
+  tickets.Issue("WXYZ", *context, kAuthToken, ByteArray("raw"));
+
+  tickets.Revoke(kEndpointId);
+  EXPECT_FALSE(tickets.Take(kEndpointId).has_value());
+  EXPECT_EQ(tickets.GetSize(), 1);
+  tickets.RevokeAll();
+  EXPECT_EQ(tickets.GetSize(), 0);
+}
+
+TEST(SessionTicketCacheTest, EvictsTicketsBeyondMax) {
+  auto [context, peer_context] = Handshake();
+  SessionTicketCache tickets;
+  for (int i = 0; i <= SessionTicketCache::kMaxTickets; ++i) {
+    tickets.Issue(absl::StrCat(i), *context, kAuthToken, ByteArray("raw"));
+  }
+
+  EXPECT_EQ(tickets.GetSize(), SessionTicketCache::kMaxTickets);
+  EXPECT_TRUE(tickets.Take(absl::StrCat(SessionTicketCache::kMaxTickets))
+                  .has_value());
+}
+
+TEST(SessionTicketCacheTest, ResumedContextsTalkToEachOther) {
+  auto [client_context, server_context] = Handshake();
+  SessionTicketCache tickets;
+  tickets.Issue(kEndpointId, *client_context, kAuthToken, ByteArray("raw"));
+  SessionTicketCache::Ticket ticket = *tickets.Take(kEndpointId);
+  ByteArray client_nonce("client nonce");
+  ByteArray server_nonce("server nonce");
+
+  std::unique_ptr<D2DConnectionContextV1> client = SessionTicketCache::Resume(
+      ticket, client_nonce, server_nonce, /*is_client=*/true);
+  std::unique_ptr<D2DConnectionContextV1> server = SessionTicketCache::Resume(
+      ticket, client_nonce, server_nonce, /*is_client=*/false);
+  ASSERT_NE(client, nullptr);
+  ASSERT_NE(server, nullptr);
+
+  std::unique_ptr<std::string> to_server = client->EncodeMessageToPeer("ping");
+  ASSERT_NE(to_server, nullptr);
+  std::unique_ptr<std::string> received =
+      server->DecodeMessageFromPeer(*to_server);
+  ASSERT_NE(received, nullptr);
+  EXPECT_EQ(*received, "ping");
+  std::unique_ptr<std::string> to_client = server->EncodeMessageToPeer("pong");
+  ASSERT_NE(to_client, nullptr);
+  received = client->DecodeMessageFromPeer(*to_client);
+  ASSERT_NE(received, nullptr);
+  EXPECT_EQ(*received, "pong");
+  EXPECT_EQ(*client->GetSessionUnique(), *server->GetSessionUnique());
+}
+
+TEST(SessionTicketCacheTest, MacsDependOnNonces) {
+  auto [context, peer_context] = Handshake();
+  SessionTicketCache tickets;
+  tickets.Issue(kEndpointId, *context, kAuthToken, ByteArray("raw"));
+  SessionTicketCache::Ticket ticket = *tickets.Take(kEndpointId);
+
+  ByteArray mac = SessionTicketCache::GetRequestMac(ticket, ByteArray("a"));
+  EXPECT_TRUE(SessionTicketCache::MacsEqual(
+      mac, SessionTicketCache::GetRequestMac(ticket, ByteArray("a"))));
+  EXPECT_FALSE(SessionTicketCache::MacsEqual(
+      mac, SessionTicketCache::GetRequestMac(ticket, ByteArray("b"))));
+  EXPECT_FALSE(SessionTicketCache::MacsEqual(
+      SessionTicketCache::GetAcceptMac(ticket, ByteArray("a"),
+                                       ByteArray("b")),
+      SessionTicketCache::GetAcceptMac(ticket, ByteArray("a"),
+                                       ByteArray("c"))));
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,96 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/transfer_metrics.h"
+
+#include "absl/strings/str_cat.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+namespace {
+
+constexpr absl::string_view kPrefix = "connections/transfer/";
+
+}  // namespace
+
+TransferMetrics::TransferMetrics(const std::string& endpoint_id,
+                                 proto::connections::Medium medium)
+    : endpoint_labels_{{"endpoint_id", endpoint_id},
+                       {"medium", proto::connections::Medium_Name(medium)}},
+      endpoint_(GetMetrics(endpoint_labels_)),
+      medium_(
+          GetMetrics({{"medium", proto::connections::Medium_Name(medium)}})) {}
+
+TransferMetrics::~TransferMetrics() {
+  MetricsRegistry::GetInstance().RemoveMetrics(endpoint_labels_);
+}
+
+absl::string_view TransferMetrics::GetStageName(Stage stage) {
+  switch (stage) {
+    case Stage::kDetachChunk:
+      return "detach_chunk";
+    case Stage::kSerializeFrame:
+      return "serialize_frame";
+    case Stage::kEncrypt:
+      return "encrypt";
+    case Stage::kWrite:
+      return "write";
+    case Stage::kRead:
+      return "read";
+    case Stage::kDecrypt:
+      return "decrypt";
+    case Stage::kParseFrame:
+      return "parse_frame";
+    case Stage::kAttachChunk:
+      return "attach_chunk";
+  }
+  return "unknown";
+}
+
+void TransferMetrics::Record(Stage stage, absl::Duration elapsed) {
+  const std::int64_t nanos = absl::ToInt64Nanoseconds(elapsed);
+  endpoint_.stages[static_cast<int>(stage)]->Record(nanos);
+  medium_.stages[static_cast<int>(stage)]->Record(nanos);
+}
+
+void TransferMetrics::AddBytesWritten(std::int64_t size) {
+  endpoint_.bytes_written->Increment(size);
+  medium_.bytes_written->Increment(size);
+}
+
+void TransferMetrics::AddBytesRead(std::int64_t size) {
+  endpoint_.bytes_read->Increment(size);
+  medium_.bytes_read->Increment(size);
+}
+
+TransferMetrics::Metrics TransferMetrics::GetMetrics(
+    const MetricLabels& labels) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  Metrics metrics;
+  for (int i = 0; i < kStageCount; ++i) {
+    metrics.stages[i] = registry.GetHistogram(
+        absl::StrCat(kPrefix, GetStageName(static_cast<Stage>(i))), labels);
+  }
+  metrics.bytes_written =
+      registry.GetCounter(absl::StrCat(kPrefix, "bytes_written"), labels);
+  metrics.bytes_read =
+      registry.GetCounter(absl::StrCat(kPrefix, "bytes_read"), labels);
+  return metrics;
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,86 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_TRANSFER_METRICS_H_
+#define CORE_INTERNAL_TRANSFER_METRICS_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "internal/platform/metrics_registry.h"
+#include "proto/connections_enums.pb.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Times the stages a frame goes through on one endpoint's channel, for the
+// endpoint and for all endpoints over the same medium. The histograms are in
+// MetricsRegistry as "connections/transfer/<stage>" in nanoseconds, labeled
+// with the medium, and with the endpoint_id as well for the endpoint's own.
+//
+// The endpoint's metrics are removed from the registry when this goes away;
+// those of the medium stay.
+class TransferMetrics {
+ public:
+  enum class Stage {
+    // Sender.
+    kDetachChunk,
+    kSerializeFrame,
+    kEncrypt,
+    kWrite,
+    // Receiver.
+    kRead,
+    kDecrypt,
+    kParseFrame,
+    kAttachChunk,
+  };
+  static constexpr int kStageCount = static_cast<int>(Stage::kAttachChunk) + 1;
+
+  TransferMetrics(const std::string& endpoint_id,
+                  proto::connections::Medium medium);
+  ~TransferMetrics();
+  TransferMetrics(const TransferMetrics&) = delete;
+  TransferMetrics& operator=(const TransferMetrics&) = delete;
+
+  static absl::string_view GetStageName(Stage stage);
+
+  void Record(Stage stage, absl::Duration elapsed);
+  // Counts the bytes of frames, as they go over the medium.
+  void AddBytesWritten(std::int64_t size);
+  void AddBytesRead(std::int64_t size);
+
+ private:
+  struct Metrics {
+    std::array<std::shared_ptr<Histogram>, kStageCount> stages;
+    std::shared_ptr<Counter> bytes_written;
+    std::shared_ptr<Counter> bytes_read;
+  };
+
+  static Metrics GetMetrics(const MetricLabels& labels);
+
+  const MetricLabels endpoint_labels_;
+  const Metrics endpoint_;
+  const Metrics medium_;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_TRANSFER_METRICS_H_
@@ -0,0 +1,86 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/transfer_metrics.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "internal/platform/metrics_registry.h"
+#include "proto/connections_enums.pb.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::proto::connections::Medium;
+
+// Returns the count of the histogram, or -1 if there's none.
+std::int64_t GetCount(absl::string_view name, const MetricLabels& labels) {
+  for (const auto& histogram :
+       MetricsRegistry::GetInstance().GetSnapshot().histograms) {
+    if (histogram.name == name && histogram.labels == labels) {
+      return histogram.value.count;
+    }
+  }
+  return -1;
+}
+
+// The medium totals are shared by the whole process, so tests compare them
+// before and after.
+TEST(TransferMetricsTest, RecordsForEndpointAndMedium) {
+  const MetricLabels endpoint_labels{{"endpoint_id", "TRM1"},
+                                     {"medium", "WIFI_LAN"}};
+  const MetricLabels medium_labels{{"medium", "WIFI_LAN"}};
+  TransferMetrics metrics("TRM1", Medium::WIFI_LAN);
+  const std::int64_t medium_count =
+      GetCount("connections/transfer/encrypt", medium_labels);
+
+  metrics.Record(TransferMetrics::Stage::kEncrypt, absl::Microseconds(5));
+  metrics.Record(TransferMetrics::Stage::kEncrypt, absl::Microseconds(7));
+
+  EXPECT_EQ(GetCount("connections/transfer/encrypt", endpoint_labels), 2);
+  EXPECT_EQ(GetCount("connections/transfer/encrypt", medium_labels),
+            medium_count + 2);
+  EXPECT_EQ(GetCount("connections/transfer/decrypt", endpoint_labels), 0);
+}
+
+TEST(TransferMetricsTest, RemovesEndpointMetricsWhenDestroyed) {
+  const MetricLabels endpoint_labels{{"endpoint_id", "TRM2"},
+                                     {"medium", "BLE"}};
+  const MetricLabels medium_labels{{"medium", "BLE"}};
+  {
+    TransferMetrics metrics("TRM2", Medium::BLE);
+    metrics.Record(TransferMetrics::Stage::kWrite, absl::Milliseconds(1));
+    EXPECT_EQ(GetCount("connections/transfer/write", endpoint_labels), 1);
+  }
+  EXPECT_EQ(GetCount("connections/transfer/write", endpoint_labels), -1);
+  EXPECT_GE(GetCount("connections/transfer/write", medium_labels), 1);
+}
+
+TEST(TransferMetricsTest, StagesHaveNames) {
+  for (int i = 0; i < TransferMetrics::kStageCount; ++i) {
+    EXPECT_NE(TransferMetrics::GetStageName(
+                  static_cast<TransferMetrics::Stage>(i)),
+              "unknown");
+  }
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,112 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/ukey2_crypto_pool.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "securegcm/ukey2_handshake.h"
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr int kMaxParallelism = 4;
+constexpr securegcm::UKey2Handshake::HandshakeCipher kCipher =
+    securegcm::UKey2Handshake::HandshakeCipher::P256_SHA512;
+
+}  // namespace
+
+Ukey2CryptoPool& Ukey2CryptoPool::GetInstance() {
+  static Ukey2CryptoPool* instance = new Ukey2CryptoPool(std::clamp(
+      static_cast<int>(std::thread::hardware_concurrency()), 1,
+      kMaxParallelism));
+  return *instance;
+}
+
+Ukey2CryptoPool::Ukey2CryptoPool(int max_parallelism)
+    : executor_(max_parallelism) {
+  ScheduleRefill(Role::kInitiator);
+  ScheduleRefill(Role::kResponder);
+}
+
+Ukey2CryptoPool::~Ukey2CryptoPool() {
+  {
+    MutexLock lock(&mutex_);
+    shut_down_ = true;
+  }
+  // Wait for background key generation, which refers to this object.
+  executor_.Shutdown();
+}
+
+std::unique_ptr<securegcm::UKey2Handshake> Ukey2CryptoPool::Create(Role role) {
+  return role == Role::kInitiator
+             ? securegcm::UKey2Handshake::ForInitiator(kCipher)
+             : securegcm::UKey2Handshake::ForResponder(kCipher);
+}
+
+std::unique_ptr<securegcm::UKey2Handshake> Ukey2CryptoPool::Take(Role role) {
+  std::unique_ptr<securegcm::UKey2Handshake> handshake;
+  {
+    MutexLock lock(&mutex_);
+    if (!ready_[role].empty()) {
+      handshake = std::move(ready_[role].back());
+      ready_[role].pop_back();
+    }
+  }
+  ScheduleRefill(role);
+  if (handshake) return handshake;
+
+  NEARBY_LOGS(INFO) << "Ukey2CryptoPool has no handshake ready for role "
+                    << role << "; generating one.";
+  return Run([role]() { return Create(role); });
+}
+
+void Ukey2CryptoPool::ScheduleRefill(Role role) {
+  // The job is queued with mutex_ held, so that it can't race the shutdown of
+  // executor_ in the destructor.
+  MutexLock lock(&mutex_);
+  if (shut_down_ || refilling_[role] ||
+      ready_[role].size() >= static_cast<size_t>(kPrecomputedHandshakes)) {
+    return;
+  }
+  refilling_[role] = true;
+  // One handshake per job, so that handshakes in progress don't queue behind
+  // a whole refill.
+  executor_.Execute("ukey2-keygen", [this, role]() {
+    std::unique_ptr<securegcm::UKey2Handshake> handshake = Create(role);
+    {
+      MutexLock lock(&mutex_);
+      refilling_[role] = false;
+      if (!handshake) {
+        NEARBY_LOGS(WARNING)
+            << "Ukey2CryptoPool failed to generate a handshake for role "
+            << role;
+        return;
+      }
+      ready_[role].push_back(std::move(handshake));
+    }
+    ScheduleRefill(role);
+  });
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
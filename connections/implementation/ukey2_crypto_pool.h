@@ -0,0 +1,97 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_UKEY2_CRYPTO_POOL_H_
+#define CORE_INTERNAL_UKEY2_CRYPTO_POOL_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "securegcm/ukey2_handshake.h"
+#include "absl/base/thread_annotations.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Runs the elliptic curve work of UKEY2 handshakes on a bounded pool of threads
+// shared by every EncryptionRunner, so a burst of handshakes can't take more
+// CPUs than the pool has. The blocking reads and writes of a handshake stay on
+// the thread of its runner.
+//
+// The pool also keeps a few handshakes of each role whose ephemeral key pairs
+// were generated in the background, so that a handshake can send its first
+// message without waiting for key generation.
+class Ukey2CryptoPool {
+ public:
+  // Handshakes kept ready for each role.
+  static constexpr int kPrecomputedHandshakes = 4;
+
+  // Returns the pool shared by the process.
+  static Ukey2CryptoPool& GetInstance();
+
+  explicit Ukey2CryptoPool(int max_parallelism);
+  ~Ukey2CryptoPool();
+
+  // Return a new handshake, or nullptr if one could not be created. The key
+  // pair of the handshake is generated ahead of time when one is ready.
+  std::unique_ptr<securegcm::UKey2Handshake> TakeInitiator()
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    return Take(Role::kInitiator);
+  }
+  std::unique_ptr<securegcm::UKey2Handshake> TakeResponder()
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    return Take(Role::kResponder);
+  }
+
+  // Runs |work| on the pool, blocks until it is done and returns its result.
+  template <typename Work>
+  auto Run(Work&& work) -> decltype(work()) {
+    decltype(work()) result;
+    CountDownLatch latch(1);
+    executor_.Execute("ukey2-crypto", [&work, &result, &latch]() {
+      result = work();
+      latch.CountDown();
+    });
+    latch.Await();
+    return result;
+  }
+
+ private:
+  enum Role { kInitiator = 0, kResponder = 1 };
+
+  static std::unique_ptr<securegcm::UKey2Handshake> Create(Role role);
+  std::unique_ptr<securegcm::UKey2Handshake> Take(Role role)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Generates one more handshake for |role| in the background, unless enough
+  // are ready or one is being generated already.
+  void ScheduleRefill(Role role) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  Mutex mutex_;
+  std::vector<std::unique_ptr<securegcm::UKey2Handshake>> ready_[2]
+      ABSL_GUARDED_BY(mutex_);
+  bool refilling_[2] ABSL_GUARDED_BY(mutex_) = {false, false};
+  bool shut_down_ ABSL_GUARDED_BY(mutex_) = false;
+  MultiThreadExecutor executor_;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_UKEY2_CRYPTO_POOL_H_
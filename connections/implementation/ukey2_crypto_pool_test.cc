@@ -0,0 +1,94 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/ukey2_crypto_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "securegcm/ukey2_handshake.h"
+#include "gtest/gtest.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::securegcm::UKey2Handshake;
+
+TEST(Ukey2CryptoPoolTest, ConstructorDestructorWorks) {
+  Ukey2CryptoPool pool(2);
+}
+
+TEST(Ukey2CryptoPoolTest, HandshakesOfBothRolesComplete) {
+  Ukey2CryptoPool pool(2);
+  std::unique_ptr<UKey2Handshake> initiator = pool.TakeInitiator();
+  std::unique_ptr<UKey2Handshake> responder = pool.TakeResponder();
+  ASSERT_NE(initiator, nullptr);
+  ASSERT_NE(responder, nullptr);
+
+  auto client_init = pool.Run(
+      [&initiator]() { return initiator->GetNextHandshakeMessage(); });
+  ASSERT_NE(client_init, nullptr);
+  EXPECT_TRUE(responder->ParseHandshakeMessage(*client_init).success);
+  auto server_init = pool.Run(
+      [&responder]() { return responder->GetNextHandshakeMessage(); });
+  ASSERT_NE(server_init, nullptr);
+  EXPECT_TRUE(initiator->ParseHandshakeMessage(*server_init).success);
+  auto client_finish = initiator->GetNextHandshakeMessage();
+  ASSERT_NE(client_finish, nullptr);
+  EXPECT_TRUE(responder->ParseHandshakeMessage(*client_finish).success);
+
+  EXPECT_EQ(*initiator->GetVerificationString(32),
+            *responder->GetVerificationString(32));
+}
+
+TEST(Ukey2CryptoPoolTest, TakesMoreHandshakesThanArePrecomputed) {
+  Ukey2CryptoPool pool(1);
+  std::vector<std::unique_ptr<UKey2Handshake>> handshakes;
+  for (int i = 0; i < 2 * Ukey2CryptoPool::kPrecomputedHandshakes; ++i) {
+    handshakes.push_back(pool.TakeInitiator());
+    EXPECT_NE(handshakes.back(), nullptr);
+  }
+}
+
+TEST(Ukey2CryptoPoolTest, RunsWorkOffTheCallingThread) {
+  Ukey2CryptoPool pool(2);
+  std::thread::id caller = std::this_thread::get_id();
+  std::thread::id worker =
+      pool.Run([]() { return std::this_thread::get_id(); });
+  EXPECT_NE(worker, caller);
+}
+
+TEST(Ukey2CryptoPoolTest, RunsWorkFromManyThreads) {
+  Ukey2CryptoPool pool(2);
+  std::atomic<int> done = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&pool, &done, i]() {
+      EXPECT_EQ(pool.Run([i]() { return i * i; }), i * i);
+      done++;
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(done, 8);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -27,6 +27,7 @@
 //   default-initialized.
 // - callbacks may be initialized with lambdas; lambda definitions are concize.
 
+#include "absl/time/time.h"
 #include "connections/connection_options.h"
 #include "connections/payload.h"
 #include "connections/status.h"
@@ -165,6 +166,17 @@ struct DiscoveryListener {
           DefaultCallback<const std::string&, DistanceInfo>();
 };
 
+// How often PayloadListener::payload_progress_cb hears about a payload that is
+// still being transferred. An update is delivered once |min_interval| has
+// passed and |min_bytes| more bytes were transferred since the previous one;
+// updates that aren't delivered are folded into the next one. The final update
+// of a payload, whether it succeeded, failed or was canceled, is always
+// delivered.
+struct PayloadProgressPolicy {
+  absl::Duration min_interval = absl::ZeroDuration();
+  std::int64_t min_bytes = 0;
+};
+
 struct PayloadListener {
   // Called when a Payload is received from a remote endpoint. Depending
   // on the type of the Payload, all of the data may or may not have been
@@ -188,6 +200,10 @@ struct PayloadListener {
                      const PayloadProgressInfo& info)>
       payload_progress_cb =
           DefaultCallback<const std::string&, const PayloadProgressInfo&>();
+
+  // Limits how often payload_progress_cb is called. By default, it is called
+  // for every chunk, unless the client falls behind.
+  PayloadProgressPolicy progress_policy;
 };
 
 }  // namespace connections
@@ -22,14 +22,9 @@ ExceptionOr<ByteArray> BaseInputStream::Read(std::int64_t size) {
     return ExceptionOr<ByteArray>{Exception::kIo};
   }
 
-  ByteArray read_bytes{static_cast<size_t>(size)};
-  if (read_bytes.CopyAt(/*offset=*/0, buffer_,
-                        /*source_offset=*/position_)) {
-    position_ += size;
-    return ExceptionOr<ByteArray>{read_bytes};
-  } else {
-    return ExceptionOr<ByteArray>{Exception::kIo};
-  }
+  ByteArray read_bytes = buffer_.Slice(position_, size);
+  position_ += size;
+  return ExceptionOr<ByteArray>{std::move(read_bytes)};
 }
 
 std::uint8_t BaseInputStream::ReadUint8() {
@@ -14,6 +14,16 @@
 
 #include "internal/platform/base_pipe.h"
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
 #include "internal/platform/base_mutex_lock.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/output_stream.h"
@@ -21,7 +31,47 @@
 namespace location {
 namespace nearby {
 
+BasePipe::~BasePipe() {
+#ifdef __linux__
+  if (readiness_fd_ >= 0) close(readiness_fd_);
+#endif
+}
+
+void BasePipe::SetMaxBufferedBytes(size_t max_buffered_bytes) {
+  BaseMutexLock lock(mutex_.get());
+
+  max_buffered_bytes_ = max_buffered_bytes;
+  // A raised bound may let a blocked writer through.
+  cond_->Notify();
+}
+
+void BasePipe::SetBackpressureListener(size_t high_watermark,
+                                       size_t low_watermark,
+                                       BackpressureListener listener) {
+  BaseMutexLock lock(mutex_.get());
+
+  high_watermark_ = high_watermark;
+  low_watermark_ = low_watermark;
+  backpressure_listener_ = std::move(listener);
+  backed_up_ = false;
+}
+
+int BasePipe::GetReadinessFd() {
+  if (ring_) return -1;
+
+  BaseMutexLock lock(mutex_.get());
+#ifdef __linux__
+  if (readiness_fd_ < 0) {
+    readiness_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    UpdateReadinessLocked();
+  }
+#endif
+  return readiness_fd_;
+}
+
 ExceptionOr<ByteArray> BasePipe::Read(size_t size) {
+  if (ring_) return ReadFromRing(size);
+
   BaseMutexLock lock(mutex_.get());
 
   // We're done reading all the chunks that were written before the OutputStream
@@ -43,7 +93,7 @@ ExceptionOr<ByteArray> BasePipe::Read(size_t size) {
     return ExceptionOr<ByteArray>{Exception::kIo};
   }
 
-  ByteArray first_chunk{buffer_.front()};
+  ByteArray first_chunk{std::move(buffer_.front())};
   buffer_.pop_front();
 
   // If we received our sentinel chunk, mark the fact that there cannot
@@ -57,29 +107,62 @@ ExceptionOr<ByteArray> BasePipe::Read(size_t size) {
   // If first_chunk is small enough to not overshoot the requested 'size', just
   // return that.
   if (first_chunk.size() <= size) {
-    return ExceptionOr<ByteArray>{first_chunk};
+    OnReadLocked(first_chunk.size());
+    return ExceptionOr<ByteArray>{std::move(first_chunk)};
   } else {
-    // Break first_chunk into 2 parts -- the first one of which (next_chunk)
-    // will be 'size' bytes long, and will be returned, and the second one of
-    // which (overflow_chunk) will be re-inserted into buffer_, at the head of
-    // the queue, to be served up in the next call to read().
-    ByteArray next_chunk(first_chunk.data(), size);
-    buffer_.push_front(
-        ByteArray(first_chunk.data() + size, first_chunk.size() - size));
-    return ExceptionOr<ByteArray>{next_chunk};
+    // Break first_chunk into 2 parts -- the first one of which will be 'size'
+    // bytes long, and will be returned, and the second one of which will be
+    // re-inserted into buffer_, at the head of the queue, to be served up in
+    // the next call to read(). Both parts share first_chunk's storage.
+    buffer_.push_front(first_chunk.Slice(size, first_chunk.size() - size));
+    OnReadLocked(size);
+    return ExceptionOr<ByteArray>{first_chunk.Slice(0, size)};
   }
 }
 
 Exception BasePipe::Write(const ByteArray& data) {
+  if (ring_) return WriteToRing(data);
+
   BaseMutexLock lock(mutex_.get());
 
+  Exception wait_exception = WaitForRoomLocked(data.size());
+  if (wait_exception.Raised()) return wait_exception;
   return WriteLocked(data);
 }
 
+Exception BasePipe::WriteV(absl::Span<const ByteArray> data) {
+  if (ring_) {
+    // There is only one writer, so nothing can interleave with the buffers.
+    for (const ByteArray& buffer : data) {
+      Exception exception = WriteToRing(buffer);
+      if (exception.Raised()) return exception;
+    }
+    return {Exception::kSuccess};
+  }
+
+  BaseMutexLock lock(mutex_.get());
+
+  size_t total_size = 0;
+  for (const ByteArray& buffer : data) total_size += buffer.size();
+  Exception wait_exception = WaitForRoomLocked(total_size);
+  if (wait_exception.Raised()) return wait_exception;
+
+  // All buffers are queued under a single lock acquisition, so concurrent
+  // writers can not interleave with them.
+  for (const ByteArray& buffer : data) {
+    // Empty chunks are reserved as the end-of-stream sentinel.
+    if (buffer.Empty()) continue;
+    Exception exception = WriteLocked(buffer);
+    if (exception.Raised()) return exception;
+  }
+  return {Exception::kSuccess};
+}
+
 void BasePipe::MarkInputStreamClosed() {
   BaseMutexLock lock(mutex_.get());
 
   input_stream_closed_ = true;
+  UpdateReadinessLocked();
   // Trigger cond_ to unblock a potentially-blocked call to read(), and to let
   // it know to return Exception::IO.
   cond_->Notify();
@@ -89,8 +172,11 @@ void BasePipe::MarkOutputStreamClosed() {
   BaseMutexLock lock(mutex_.get());
 
   // Write a sentinel null chunk before marking output_stream_closed as true.
-  WriteLocked(ByteArray{});
+  // The ring has no chunks; its reader goes by output_stream_closed_ alone.
+  if (!ring_) WriteLocked(ByteArray{});
   output_stream_closed_ = true;
+  // Unblock a writer waiting for room; it will fail with Exception::IO.
+  cond_->Notify();
 }
 
 Exception BasePipe::WriteLocked(const ByteArray& data) {
@@ -99,11 +185,140 @@ Exception BasePipe::WriteLocked(const ByteArray& data) {
   }
 
   buffer_.push_back(data);
+  buffered_bytes_ += data.size();
+  if (backpressure_listener_ && !backed_up_ &&
+      buffered_bytes_ >= high_watermark_) {
+    backed_up_ = true;
+    backpressure_listener_(true);
+  }
+  UpdateReadinessLocked();
   // Trigger cond_ to unblock a potentially-blocked call to read(), now that
   // there's more data for it to consume.
   cond_->Notify();
   return {Exception::kSuccess};
 }
 
+Exception BasePipe::WaitForRoomLocked(size_t size) {
+  // An empty pipe always takes the write, so oversized writes can't deadlock.
+  while (max_buffered_bytes_ > 0 && buffered_bytes_ > 0 &&
+         buffered_bytes_ + size > max_buffered_bytes_ &&
+         !input_stream_closed_ && !output_stream_closed_) {
+    Exception wait_exception = cond_->Wait();
+    if (wait_exception.Raised()) return wait_exception;
+  }
+  return {Exception::kSuccess};
+}
+
+void BasePipe::OnReadLocked(size_t size) {
+  buffered_bytes_ -= size;
+  if (backed_up_ && buffered_bytes_ <= low_watermark_) {
+    backed_up_ = false;
+    backpressure_listener_(false);
+  }
+  UpdateReadinessLocked();
+  // Let a writer waiting for room know there is some.
+  if (max_buffered_bytes_ > 0) cond_->Notify();
+}
+
+void BasePipe::UpdateReadinessLocked() {
+#ifdef __linux__
+  if (readiness_fd_ < 0) return;
+  const bool ready =
+      !buffer_.empty() || input_stream_closed_ || read_all_chunks_;
+  if (ready == readiness_signaled_) return;
+
+  // The eventfd polls readable while its counter is non-zero; only the
+  // transitions cost a syscall.
+  std::uint64_t value = 1;
+  if (ready) {
+    if (write(readiness_fd_, &value, sizeof(value)) != sizeof(value)) return;
+  } else {
+    if (read(readiness_fd_, &value, sizeof(value)) != sizeof(value)) return;
+  }
+  readiness_signaled_ = ready;
+#endif
+}
+
+ExceptionOr<ByteArray> BasePipe::ReadFromRing(size_t size) {
+  if (ring_read_all_) return ExceptionOr<ByteArray>{ByteArray{}};
+
+  if (ring_->empty()) {
+    Exception wait_exception = WaitForRingData();
+    if (wait_exception.Raised()) return ExceptionOr<ByteArray>{wait_exception};
+  }
+  if (input_stream_closed_) return ExceptionOr<ByteArray>{Exception::kIo};
+
+  // Everything written before the OutputStream was closed has been read.
+  size_t available = ring_->size();
+  if (available == 0) {
+    ring_read_all_ = true;
+    return ExceptionOr<ByteArray>{ByteArray{}};
+  }
+
+  ByteArray chunk(std::min(size, available));
+  ring_->Read(chunk.data(), chunk.size());
+  WakeRingWaiter(ring_writer_waiting_);
+  return ExceptionOr<ByteArray>{std::move(chunk)};
+}
+
+Exception BasePipe::WriteToRing(const ByteArray& data) {
+  const char* next = data.data();
+  size_t remaining = data.size();
+  while (true) {
+    if (input_stream_closed_ || output_stream_closed_) {
+      return {Exception::kIo};
+    }
+    size_t written = ring_->Write(next, remaining);
+    if (written > 0) WakeRingWaiter(ring_reader_waiting_);
+    next += written;
+    remaining -= written;
+    if (remaining == 0) return {Exception::kSuccess};
+
+    Exception wait_exception = WaitForRingRoom();
+    if (wait_exception.Raised()) return wait_exception;
+  }
+}
+
+Exception BasePipe::WaitForRingData() {
+  BaseMutexLock lock(mutex_.get());
+
+  ring_reader_waiting_ = true;
+  // Pairs with the fence in WakeRingWaiter(): either the writer sees us
+  // waiting, or we see what it wrote.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  Exception result{Exception::kSuccess};
+  while (ring_->empty() && !input_stream_closed_ && !output_stream_closed_) {
+    result = cond_->Wait();
+    if (result.Raised()) break;
+  }
+  ring_reader_waiting_ = false;
+  return result;
+}
+
+Exception BasePipe::WaitForRingRoom() {
+  BaseMutexLock lock(mutex_.get());
+
+  ring_writer_waiting_ = true;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  Exception result{Exception::kSuccess};
+  while (ring_->size() == ring_->capacity() && !input_stream_closed_ &&
+         !output_stream_closed_) {
+    result = cond_->Wait();
+    if (result.Raised()) break;
+  }
+  ring_writer_waiting_ = false;
+  return result;
+}
+
+void BasePipe::WakeRingWaiter(const std::atomic<bool>& waiting) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!waiting.load(std::memory_order_relaxed)) return;
+
+  // Taking the lock makes sure the waiter is either blocked in Wait() or has
+  // yet to check the ring again.
+  BaseMutexLock lock(mutex_.get());
+  cond_->Notify();
+}
+
 }  // namespace nearby
 }  // namespace location
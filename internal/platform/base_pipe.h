@@ -15,17 +15,21 @@
 #ifndef PLATFORM_BASE_BASE_PIPE_H_
 #define PLATFORM_BASE_BASE_PIPE_H_
 
+#include <atomic>
 #include <cstdint>
 #include <deque>
+#include <functional>
 #include <memory>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/types/span.h"
 #include "internal/platform/implementation/condition_variable.h"
 #include "internal/platform/implementation/mutex.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/output_stream.h"
+#include "internal/platform/spsc_byte_ring.h"
 
 namespace location {
 namespace nearby {
@@ -49,7 +53,20 @@ namespace nearby {
 class BasePipe {
  public:
   static constexpr const size_t kChunkSize = 64 * 1024;
-  virtual ~BasePipe() = default;
+  static constexpr const size_t kDefaultRingCapacity = 256 * 1024;
+
+  // How the pipe buffers written data.
+  enum class Mode {
+    // Written ByteArrays are queued as they are, without copying. Any number
+    // of threads may read and write.
+    kChunkQueue,
+    // Written bytes are copied through a lock-free SpscByteRing. Exactly one
+    // thread may write and one thread may read. The pipe lock is only taken
+    // when the reader finds the ring empty or the writer finds it full.
+    kSpscRing,
+  };
+
+  virtual ~BasePipe();
 
   // Pipe is not copyable or movable, because copy/move will invalidate
   // references to input and output streams.
@@ -62,6 +79,33 @@ class BasePipe {
   InputStream& GetInputStream() { return input_stream_; }
   OutputStream& GetOutputStream() { return output_stream_; }
 
+  Mode GetMode() const { return ring_ ? Mode::kSpscRing : Mode::kChunkQueue; }
+
+  // Bounds the unread data held by the pipe to |max_buffered_bytes|. Once the
+  // bound is reached, writes block until the reader makes room or either
+  // stream is closed. A write larger than the bound goes through as soon as
+  // the pipe is empty. 0 (the default) leaves the pipe unbounded.
+  // Mode::kSpscRing pipes are always bounded by their ring and ignore this.
+  void SetMaxBufferedBytes(size_t max_buffered_bytes)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Called with true once the unread data reaches |high_watermark| bytes, and
+  // with false once the reader has drained it back to |low_watermark| bytes.
+  // Lets the writer ask its source to slow down before writes start blocking.
+  // The listener runs with the pipe locked, so it must be quick and must not
+  // use the pipe; a null listener unregisters it.
+  // Not supported by Mode::kSpscRing pipes.
+  using BackpressureListener = std::function<void(bool backed_up)>;
+  void SetBackpressureListener(size_t high_watermark, size_t low_watermark,
+                               BackpressureListener listener)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns an eventfd that polls readable while a read from the pipe would
+  // not block: when there is data to read, or either stream is closed. It's
+  // created on first use, so pipes nobody polls don't pay for it.
+  // Returns -1 where eventfd isn't available, and for Mode::kSpscRing pipes.
+  int GetReadinessFd() ABSL_LOCKS_EXCLUDED(mutex_);
+
  protected:
   BasePipe() = default;
 
@@ -71,6 +115,15 @@ class BasePipe {
     cond_ = std::move(cond);
   }
 
+  // Sets the pipe up in Mode::kSpscRing, with a ring of at least
+  // |ring_capacity| bytes.
+  void Setup(std::unique_ptr<api::Mutex> mutex,
+             std::unique_ptr<api::ConditionVariable> cond,
+             size_t ring_capacity) {
+    ring_ = std::make_unique<SpscByteRing>(ring_capacity);
+    Setup(std::move(mutex), std::move(cond));
+  }
+
  private:
   class BasePipeInputStream : public InputStream {
    public:
@@ -81,6 +134,7 @@ class BasePipe {
       return pipe_->Read(size);
     }
     Exception Close() override { return DoClose(); }
+    int GetReadinessFd() override { return pipe_->GetReadinessFd(); }
 
    private:
     Exception DoClose() {
@@ -97,6 +151,9 @@ class BasePipe {
     Exception Write(const ByteArray& data) override {
       return pipe_->Write(data);
     }
+    Exception WriteV(absl::Span<const ByteArray> data) override {
+      return pipe_->WriteV(data);
+    }
     Exception Flush() override { return {Exception::kSuccess}; }
     Exception Close() override { return DoClose(); }
 
@@ -110,24 +167,59 @@ class BasePipe {
 
   ExceptionOr<ByteArray> Read(size_t size) ABSL_LOCKS_EXCLUDED(mutex_);
   Exception Write(const ByteArray& data) ABSL_LOCKS_EXCLUDED(mutex_);
+  Exception WriteV(absl::Span<const ByteArray> data)
+      ABSL_LOCKS_EXCLUDED(mutex_);
 
   void MarkInputStreamClosed() ABSL_LOCKS_EXCLUDED(mutex_);
   void MarkOutputStreamClosed() ABSL_LOCKS_EXCLUDED(mutex_);
 
   Exception WriteLocked(const ByteArray& data)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Blocks until |size| more bytes fit in the pipe, or either stream closes.
+  Exception WaitForRoomLocked(size_t size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Accounts for |size| bytes taken off the pipe by the reader.
+  void OnReadLocked(size_t size) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Brings the readiness eventfd, if any, in line with the pipe's state.
+  void UpdateReadinessLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Mode::kSpscRing counterparts of Read() and Write(). They only lock to
+  // wait for data or room, and to wake up the other side from that wait.
+  ExceptionOr<ByteArray> ReadFromRing(size_t size) ABSL_LOCKS_EXCLUDED(mutex_);
+  Exception WriteToRing(const ByteArray& data) ABSL_LOCKS_EXCLUDED(mutex_);
+  Exception WaitForRingData() ABSL_LOCKS_EXCLUDED(mutex_);
+  Exception WaitForRingRoom() ABSL_LOCKS_EXCLUDED(mutex_);
+  void WakeRingWaiter(const std::atomic<bool>& waiting)
+      ABSL_LOCKS_EXCLUDED(mutex_);
 
   // Order of declaration matters:
   // - mutex must be defined before condvar;
   // - input & output streams must be after both mutex and condvar.
-  bool input_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
-  bool output_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
+  // Only written with mutex_ held, but read without it in Mode::kSpscRing.
+  std::atomic<bool> input_stream_closed_{false};
+  std::atomic<bool> output_stream_closed_{false};
   bool read_all_chunks_ ABSL_GUARDED_BY(mutex_) = false;
 
   std::deque<ByteArray> ABSL_GUARDED_BY(mutex_) buffer_;
+  size_t buffered_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t max_buffered_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t high_watermark_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t low_watermark_ ABSL_GUARDED_BY(mutex_) = 0;
+  BackpressureListener backpressure_listener_ ABSL_GUARDED_BY(mutex_);
+  bool backed_up_ ABSL_GUARDED_BY(mutex_) = false;
+  int readiness_fd_ ABSL_GUARDED_BY(mutex_) = -1;
+  bool readiness_signaled_ ABSL_GUARDED_BY(mutex_) = false;
   std::unique_ptr<api::Mutex> mutex_;
   std::unique_ptr<api::ConditionVariable> cond_;
 
+  // Only set up in Mode::kSpscRing.
+  std::unique_ptr<SpscByteRing> ring_;
+  // Whether the reader (writer) is waiting on cond_ for data (room).
+  std::atomic<bool> ring_reader_waiting_{false};
+  std::atomic<bool> ring_writer_waiting_{false};
+  // Reader-side only: whether end of stream has been returned.
+  bool ring_read_all_ = false;
+
   BasePipeInputStream input_stream_{this};
   BasePipeOutputStream output_stream_{this};
 };
@@ -19,15 +19,28 @@
 #include <array>
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
 
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 
 namespace location {
 namespace nearby {
 
+// A value type holding an immutable-by-default sequence of bytes.
+//
+// Storage is reference-counted and shared between copies, so copying a
+// ByteArray, or taking a Slice() of it, does not copy the underlying bytes.
+// The first mutable access (non-const data(), CopyAt()) to storage that is
+// shared with another ByteArray makes a private copy first (copy-on-write), so
+// ByteArray keeps value semantics. Pointers obtained from non-const data() are
+// only valid until this ByteArray is next copied or assigned to.
+//
+// A ByteArray can also view bytes it doesn't own, e.g. a memory-mapped file,
+// see FromExternal().
 class ByteArray {
  public:
   // Create an empty ByteArray
@@ -38,12 +51,28 @@ class ByteArray {
   }
   ByteArray(const ByteArray&) = default;
   ByteArray& operator=(const ByteArray&) = default;
-  ByteArray(ByteArray&&) = default;
-  ByteArray& operator=(ByteArray&&) = default;
+  ByteArray(ByteArray&& other) noexcept
+      : buffer_(std::move(other.buffer_)),
+        external_owner_(std::move(other.external_owner_)),
+        external_data_(std::exchange(other.external_data_, nullptr)),
+        offset_(std::exchange(other.offset_, 0)),
+        size_(std::exchange(other.size_, 0)) {}
+  ByteArray& operator=(ByteArray&& other) noexcept {
+    if (this != &other) {
+      buffer_ = std::move(other.buffer_);
+      external_owner_ = std::move(other.external_owner_);
+      external_data_ = std::exchange(other.external_data_, nullptr);
+      offset_ = std::exchange(other.offset_, 0);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
 
   // Moves string out of temporary, allowing for a zero-copy constructions.
   // This is an optimization for very large strings.
-  explicit ByteArray(std::string&& source) : data_(std::move(source)) {}
+  explicit ByteArray(std::string&& source)
+      : buffer_(std::make_shared<std::string>(std::move(source))),
+        size_(buffer_->size()) {}
 
   // Create ByteArray by copy of a std::string. This can't be a string_view,
   // because it will conflict with std::string&& version of constructor.
@@ -57,42 +86,102 @@ class ByteArray {
   // Create value-initialized ByteArray of a given size.
   ByteArray(const char* data, size_t size) { SetData(data, size); }
 
+  // Creates a ByteArray viewing |size| bytes at |data| without copying them.
+  // |owner| is shared by the ByteArray, its copies and slices, and must keep
+  // the bytes alive and unchanged while it is. The first mutable access makes
+  // a private copy, as for shared storage.
+  static ByteArray FromExternal(std::shared_ptr<const void> owner,
+                                const char* data, size_t size) {
+    ByteArray result;
+    if (data == nullptr || size == 0) return result;
+    result.external_owner_ = std::move(owner);
+    result.external_data_ = data;
+    result.size_ = size;
+    return result;
+  }
+
   // Assign a new value to this ByteArray, as a copy of data, with a given size.
   void SetData(const char* data, size_t size) {
     if (data == nullptr) {
       size = 0;
     }
-    data_.assign(data, size);
+    buffer_ = std::make_shared<std::string>(data, size);
+    ResetExternal();
+    offset_ = 0;
+    size_ = size;
   }
 
   // Assign a new value of a given size to this ByteArray
   // (as a repeated char value).
-  void SetData(size_t size, char value = 0) { data_.assign(size, value); }
+  void SetData(size_t size, char value = 0) {
+    buffer_ = std::make_shared<std::string>(size, value);
+    ResetExternal();
+    offset_ = 0;
+    size_ = size;
+  }
 
   // Returns true, if changes were performed to container, false otherwise.
   bool CopyAt(size_t offset, const ByteArray& from, size_t source_offset = 0) {
     if (offset >= size()) return false;
     if (source_offset >= from.size()) return false;
-    memcpy(data() + offset, from.data() + source_offset,
-           std::min(size() - offset, from.size() - source_offset));
+    memmove(data() + offset, from.data() + source_offset,
+            std::min(size() - offset, from.size() - source_offset));
     return true;
   }
 
-  char* data() { return &data_[0]; }
-  const char* data() const { return data_.data(); }
-  size_t size() const { return data_.size(); }
-  bool Empty() const { return data_.empty(); }
+  // Returns a ByteArray that views [offset, offset + length) of this one,
+  // without copying. Out-of-range values are clamped to the current size.
+  ByteArray Slice(size_t offset, size_t length) const {
+    ByteArray slice;
+    if (offset >= size_) return slice;
+    slice.buffer_ = buffer_;
+    slice.external_owner_ = external_owner_;
+    slice.external_data_ = external_data_;
+    slice.offset_ = offset_ + offset;
+    slice.size_ = std::min(length, size_ - offset);
+    return slice;
+  }
+
+  char* data() {
+    Detach();
+    return &(*buffer_)[offset_];
+  }
+  const char* data() const {
+    if (external_data_) return external_data_ + offset_;
+    return buffer_ ? buffer_->data() + offset_ : "";
+  }
+  size_t size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
 
   friend bool operator==(const ByteArray& lhs, const ByteArray& rhs);
   friend bool operator!=(const ByteArray& lhs, const ByteArray& rhs);
   friend bool operator<(const ByteArray& lhs, const ByteArray& rhs);
 
   // Returns a copy of internal representation as std::string.
-  explicit operator std::string() const& { return data_; }
+  explicit operator std::string() const& { return std::string(data(), size_); }
 
   // Moves string out of temporary ByteArray, allowing for a zero-copy
-  // operation.
-  explicit operator std::string() && { return std::move(data_); }
+  // operation when the storage is neither shared nor sliced.
+  explicit operator std::string() && {
+    if (buffer_ && buffer_.use_count() == 1 && offset_ == 0 &&
+        size_ == buffer_->size()) {
+      std::string result = std::move(*buffer_);
+      buffer_.reset();
+      size_ = 0;
+      return result;
+    }
+    return std::string(data(), size_);
+  }
+
+  // Returns the string holding exactly this ByteArray's bytes, or nullptr if
+  // it is a slice of a larger one. Lets APIs taking std::string read it
+  // without a copy.
+  const std::string* GetWholeString() const {
+    if (buffer_ && offset_ == 0 && size_ == buffer_->size()) {
+      return buffer_.get();
+    }
+    return nullptr;
+  }
 
   // Returns the representation of the underlying data as a string view.
   absl::string_view AsStringView() const {
@@ -102,15 +191,43 @@ class ByteArray {
   // Hashable
   template <typename H>
   friend H AbslHashValue(H h, const ByteArray& m) {
-    return H::combine(std::move(h), m.data_);
+    return H::combine(std::move(h), m.AsStringView());
   }
 
  private:
-  std::string data_;
+  // Makes sure this ByteArray is the only owner of its storage, so that it can
+  // be safely written to.
+  void Detach() {
+    if (external_data_) {
+      buffer_ = std::make_shared<std::string>(external_data_ + offset_, size_);
+      ResetExternal();
+      offset_ = 0;
+    } else if (!buffer_) {
+      buffer_ = std::make_shared<std::string>();
+      offset_ = 0;
+      size_ = 0;
+    } else if (buffer_.use_count() > 1) {
+      buffer_ = std::make_shared<std::string>(buffer_->data() + offset_, size_);
+      offset_ = 0;
+    }
+  }
+
+  void ResetExternal() {
+    external_owner_.reset();
+    external_data_ = nullptr;
+  }
+
+  // Owned storage; null when empty or viewing external storage.
+  std::shared_ptr<std::string> buffer_;
+  // External storage, see FromExternal().
+  std::shared_ptr<const void> external_owner_;
+  const char* external_data_ = nullptr;
+  size_t offset_ = 0;
+  size_t size_ = 0;
 };
 
 inline bool operator==(const ByteArray& lhs, const ByteArray& rhs) {
-  return lhs.data_ == rhs.data_;
+  return lhs.AsStringView() == rhs.AsStringView();
 }
 
 inline bool operator!=(const ByteArray& lhs, const ByteArray& rhs) {
@@ -118,7 +235,7 @@ inline bool operator!=(const ByteArray& lhs, const ByteArray& rhs) {
 }
 
 inline bool operator<(const ByteArray& lhs, const ByteArray& rhs) {
-  return lhs.data_ < rhs.data_;
+  return lhs.AsStringView() < rhs.AsStringView();
 }
 
 }  // namespace nearby
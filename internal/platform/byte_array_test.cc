@@ -15,6 +15,8 @@
 #include "internal/platform/byte_array.h"
 
 #include <cstring>
+#include <memory>
+#include <string>
 
 #include "gtest/gtest.h"
 #include "absl/hash/hash_testing.h"
@@ -96,12 +98,91 @@ TEST(ByteArrayTest, CreateFromAbslStringReturnsTheSame) {
   EXPECT_EQ(bytes.AsStringView(), kTestString);
 }
 
+TEST(ByteArrayTest, CopySharesStorage) {
+  const ByteArray original("shared_data");
+  const ByteArray copy = original;
+  EXPECT_EQ(copy, original);
+  EXPECT_EQ(copy.data(), original.data());
+}
+
+TEST(ByteArrayTest, SliceSharesStorage) {
+  const ByteArray bytes("0123456789");
+  const ByteArray slice = bytes.Slice(/*offset=*/3, /*length=*/4);
+  EXPECT_EQ(slice.size(), 4);
+  EXPECT_EQ(slice.data(), bytes.data() + 3);
+  EXPECT_EQ(slice, ByteArray("3456"));
+}
+
+TEST(ByteArrayTest, SliceIsClampedToSize) {
+  const ByteArray bytes("0123456789");
+  EXPECT_EQ(bytes.Slice(/*offset=*/8, /*length=*/10), ByteArray("89"));
+  EXPECT_TRUE(bytes.Slice(/*offset=*/10, /*length=*/1).Empty());
+}
+
+TEST(ByteArrayTest, SliceOfSlice) {
+  const ByteArray bytes("0123456789");
+  const ByteArray slice = bytes.Slice(2, 6).Slice(1, 3);
+  EXPECT_EQ(slice, ByteArray("345"));
+  EXPECT_EQ(slice.data(), bytes.data() + 3);
+}
+
+TEST(ByteArrayTest, WriteToCopyDoesNotAffectOriginal) {
+  const ByteArray original("ABCDEFGH");
+  ByteArray copy = original;
+  copy.data()[0] = 'Z';
+  EXPECT_EQ(original, ByteArray("ABCDEFGH"));
+  EXPECT_EQ(copy, ByteArray("ZBCDEFGH"));
+}
+
+TEST(ByteArrayTest, WriteToSliceDoesNotAffectOriginal) {
+  const ByteArray original("ABCDEFGH");
+  ByteArray slice = original.Slice(/*offset=*/2, /*length=*/3);
+  EXPECT_TRUE(slice.CopyAt(/*offset=*/0, ByteArray("xy")));
+  EXPECT_EQ(original, ByteArray("ABCDEFGH"));
+  EXPECT_EQ(slice, ByteArray("xyE"));
+}
+
+TEST(ByteArrayTest, MoveToStringFromSlice) {
+  ByteArray bytes("0123456789");
+  std::string str = std::string(bytes.Slice(/*offset=*/5, /*length=*/5));
+  EXPECT_EQ(str, "56789");
+  EXPECT_EQ(bytes, ByteArray("0123456789"));
+}
+
+TEST(ByteArrayTest, ExternalStorageIsViewedWithoutCopy) {
+  auto storage = std::make_shared<std::string>("0123456789");
+  std::weak_ptr<std::string> weak_storage = storage;
+  ByteArray bytes =
+      ByteArray::FromExternal(storage, storage->data(), storage->size());
+  ByteArray slice = bytes.Slice(/*offset=*/5, /*length=*/5);
+  storage.reset();
+
+  EXPECT_EQ(static_cast<const ByteArray&>(slice).data(),
+            weak_storage.lock()->data() + 5);
+  EXPECT_EQ(slice, ByteArray("56789"));
+  bytes = ByteArray();
+  EXPECT_FALSE(weak_storage.expired());
+  slice = ByteArray();
+  EXPECT_TRUE(weak_storage.expired());
+}
+
+TEST(ByteArrayTest, WriteToExternalStorageCopiesIt) {
+  const std::string storage = "ABCDEFGH";
+  ByteArray bytes =
+      ByteArray::FromExternal(nullptr, storage.data(), storage.size());
+
+  EXPECT_TRUE(bytes.CopyAt(/*offset=*/0, ByteArray("Z")));
+  EXPECT_EQ(bytes, ByteArray("ZBCDEFGH"));
+  EXPECT_EQ(storage, "ABCDEFGH");
+}
+
 TEST(ByteArrayTest, Hash) {
   EXPECT_TRUE(absl::VerifyTypeImplementsAbslHashCorrectly({
       ByteArray(),
       ByteArray("12345"),
       ByteArray("ABCDE"),
       ByteArray("A1B2Z"),
+      ByteArray("xA1B2Zx").Slice(1, 5),
   }));
 }
 
@@ -48,6 +48,28 @@ class FeatureFlags {
     bool support_multiple_bwu_mediums = true;
     // Ble v2/v1 switch flag: the flag will be removed once v2 refactor is done.
     bool support_ble_v2 = false;
+    // Write payload chunks sent to several endpoints through per-endpoint
+    // queues, so every endpoint drains at its own speed. An endpoint that falls
+    // more than the given number of chunks behind fails the payload.
+    bool enable_concurrent_payload_fan_out = true;
+    std::int32_t payload_fan_out_max_lag_chunks = 64;
+    // Read from endpoints whose channels can report readiness on a shared
+    // IoReactor of the given number of threads, and send KeepAlive frames to
+    // all endpoints from one timer, instead of using two threads per endpoint.
+    bool enable_endpoint_reactor = false;
+    std::int32_t endpoint_reactor_threads = 2;
+    // Run the platform's executors on one shared work-stealing pool, single
+    // thread ones as strands, instead of giving every executor threads of its
+    // own.
+    bool enable_work_stealing_executors = false;
+    // Count the chunks of a payload for analytics on the transfer path, with
+    // counters the AnalyticsRecorder reads when the payload is done, instead of
+    // reporting them through the recorder's lock with every progress update.
+    bool enable_lock_free_payload_analytics = false;
+    // Keep a session ticket for every endpoint we connect to over UKEY2, and
+    // resume the session with it in one round trip when we connect to the
+    // endpoint again, instead of running UKEY2 again.
+    bool enable_session_resumption = false;
   };
 
   static const FeatureFlags& GetInstance() {
@@ -62,6 +62,11 @@ OutputFile::~OutputFile() = default;
 OutputFile::OutputFile(OutputFile&&) noexcept = default;
 OutputFile& OutputFile::operator=(OutputFile&&) = default;
 
+// Reserves disk space for |size| bytes, where the platform supports it.
+Exception OutputFile::Preallocate(std::int64_t size) {
+  return impl_->Preallocate(size);
+}
+
 // Writes all data from ByteArray object to the underlying stream.
 // Returns Exception::kIo on error, Exception::kSuccess otherwise.
 Exception OutputFile::Write(const ByteArray& data) {
@@ -55,6 +55,9 @@ class InputFile final {
   // Returns total size of this file in bytes.
   std::int64_t GetTotalSize() const;
 
+  // Skips |offset| bytes forward, seeking where the platform supports it.
+  // Returns the number of bytes actually skipped, which is less than |offset|
+  // only when the end of the file was reached.
   ExceptionOr<size_t> Skip(size_t offset);
 
   // Disallows further reads from the file and frees system resources,
@@ -87,6 +90,9 @@ class OutputFile final {
   OutputFile(OutputFile&&) noexcept;
   OutputFile& operator=(OutputFile&&);
 
+  // Reserves disk space for |size| bytes, where the platform supports it.
+  Exception Preallocate(std::int64_t size);
+
   // Writes all data from ByteArray object to the underlying stream.
   // Returns Exception::kIo on error, Exception::kSuccess otherwise.
   Exception Write(const ByteArray& data);
@@ -77,7 +77,7 @@ BlePeripheral* BleSocket::GetRemotePeripheral() {
 void BleSocket::DoClose() {
   if (!closed_) {
     remote_socket_ = nullptr;
-    output_->GetOutputStream().Close();
+    link_output_.Close();
     output_->GetInputStream().Close();
     if (IsConnectedLocked()) {
       input_->GetOutputStream().Close();
@@ -96,7 +96,7 @@ InputStream& BleSocket::GetLocalInputStream() {
 
 OutputStream& BleSocket::GetLocalOutputStream() {
   absl::MutexLock lock(&mutex_);
-  return output_->GetOutputStream();
+  return link_output_;
 }
 
 std::unique_ptr<api::BleSocket> BleServerSocket::Accept(
@@ -28,6 +28,7 @@
 #include "internal/platform/output_stream.h"
 #include "internal/platform/implementation/g3/bluetooth_adapter.h"
 #include "internal/platform/implementation/g3/bluetooth_classic.h"
+#include "internal/platform/implementation/g3/link_output_stream.h"
 #include "internal/platform/implementation/g3/multi_thread_executor.h"
 #include "internal/platform/implementation/g3/pipe.h"
 
@@ -90,6 +91,8 @@ class BleSocket : public api::BleSocket {
   // it is closed. it represents output part of a local socket. Input part of a
   // local socket comes from the peer socket, after connection.
   std::shared_ptr<Pipe> output_{new Pipe};
+  // Writes to output_, shaped like a BLE link.
+  LinkOutputStream link_output_{proto::connections::BLE, output_};
   std::shared_ptr<Pipe> input_;
   mutable absl::Mutex mutex_;
   BlePeripheral* peripheral_;
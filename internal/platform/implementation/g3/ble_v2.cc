@@ -109,7 +109,7 @@ BleV2Peripheral* BleV2Socket::GetRemotePeripheral() {
 void BleV2Socket::DoClose() {
   if (!closed_) {
     remote_socket_ = nullptr;
-    output_->GetOutputStream().Close();
+    link_output_.Close();
     output_->GetInputStream().Close();
     input_->GetOutputStream().Close();
     input_->GetInputStream().Close();
@@ -126,7 +126,7 @@ InputStream& BleV2Socket::GetLocalInputStream() {
 
 OutputStream& BleV2Socket::GetLocalOutputStream() {
   absl::MutexLock lock(&mutex_);
-  return output_->GetOutputStream();
+  return link_output_;
 }
 
 std::unique_ptr<api::ble_v2::BleSocket> BleV2ServerSocket::Accept() {
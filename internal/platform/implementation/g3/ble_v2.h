@@ -24,6 +24,7 @@
 #include "internal/platform/byte_array.h"
 #include "internal/platform/implementation/ble_v2.h"
 #include "internal/platform/implementation/g3/bluetooth_adapter.h"
+#include "internal/platform/implementation/g3/link_output_stream.h"
 #include "internal/platform/implementation/g3/pipe.h"
 #include "internal/platform/uuid.h"
 
@@ -89,6 +90,8 @@ class BleV2Socket : public api::ble_v2::BleSocket {
   // it is closed. it represents output part of a local socket. Input part of a
   // local socket comes from the peer socket, after connection.
   std::shared_ptr<Pipe> output_{new Pipe};
+  // Writes to output_, shaped like a BLE link.
+  LinkOutputStream link_output_{proto::connections::BLE, output_};
   std::shared_ptr<Pipe> input_;
   mutable absl::Mutex mutex_;
   BluetoothAdapter* adapter_ = nullptr;  // Our Adapter. Read only.
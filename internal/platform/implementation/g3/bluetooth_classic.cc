@@ -68,7 +68,7 @@ InputStream& BluetoothSocket::GetLocalInputStream() {
 
 OutputStream& BluetoothSocket::GetLocalOutputStream() {
   absl::MutexLock lock(&mutex_);
-  return output_->GetOutputStream();
+  return link_output_;
 }
 
 Exception BluetoothSocket::Close() {
@@ -80,7 +80,7 @@ Exception BluetoothSocket::Close() {
 void BluetoothSocket::DoClose() {
   if (!closed_) {
     remote_socket_ = nullptr;
-    output_->GetOutputStream().Close();
+    link_output_.Close();
     output_->GetInputStream().Close();
     input_->GetOutputStream().Close();
     input_->GetInputStream().Close();
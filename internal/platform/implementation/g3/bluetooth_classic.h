@@ -28,6 +28,7 @@
 #include "internal/platform/listeners.h"
 #include "internal/platform/output_stream.h"
 #include "internal/platform/implementation/g3/bluetooth_adapter.h"
+#include "internal/platform/implementation/g3/link_output_stream.h"
 #include "internal/platform/implementation/g3/pipe.h"
 
 namespace location {
@@ -97,6 +98,8 @@ class BluetoothSocket : public api::BluetoothSocket {
   // it is closed. it represents output part of a local socket. Input part of a
   // local socket comes from the peer socket, after connection.
   std::shared_ptr<Pipe> output_{new Pipe};
+  // Writes to output_, shaped like a Bluetooth link.
+  LinkOutputStream link_output_{proto::connections::BLUETOOTH, output_};
   std::shared_ptr<Pipe> input_;
   mutable absl::Mutex mutex_;
   BluetoothAdapter* adapter_ = nullptr;  // Our Adapter. Read only.
@@ -0,0 +1,140 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/g3/link_output_stream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "internal/platform/logging.h"
+
+namespace location {
+namespace nearby {
+namespace g3 {
+
+LinkOutputStream::LinkOutputStream(proto::connections::Medium medium,
+                                   std::shared_ptr<Pipe> pipe)
+    : profile_(MediumEnvironment::Instance().GetLinkProfile(medium)),
+      ideal_(profile_.IsIdeal()),
+      pipe_(std::move(pipe)),
+      tokens_(profile_.burst),
+      refilled_(absl::Now()),
+      last_delivery_(absl::InfinitePast()) {
+  if (profile_.latency > absl::ZeroDuration() ||
+      profile_.jitter > absl::ZeroDuration() || profile_.loss > 0) {
+    delivery_ = std::make_unique<SingleThreadExecutor>();
+  }
+}
+
+LinkOutputStream::~LinkOutputStream() {
+  Close();
+  // Pending deliveries return at once, now that the stream is closed.
+  delivery_.reset();
+}
+
+Exception LinkOutputStream::Write(const ByteArray& data) {
+  return WriteV(absl::MakeConstSpan(&data, 1));
+}
+
+Exception LinkOutputStream::WriteV(absl::Span<const ByteArray> data) {
+  if (ideal_) return pipe_->GetOutputStream().WriteV(data);
+  {
+    absl::MutexLock lock(&mutex_);
+    if (closed_) return {Exception::kIo};
+  }
+  std::int64_t size = 0;
+  for (const ByteArray& buffer : data) size += buffer.size();
+
+  absl::MutexLock lock(&write_mutex_);
+  Throttle(size);
+  if (Chance(profile_.disconnect)) {
+    NEARBY_LOGS(INFO) << "LinkOutputStream: breaking the link; stream="
+                      << this;
+    Close();
+    return {Exception::kIo};
+  }
+  if (!delivery_) return pipe_->GetOutputStream().WriteV(data);
+
+  const absl::Time deliver_at =
+      std::max(absl::Now() + NextDelay(), last_delivery_);
+  last_delivery_ = deliver_at;
+  delivery_->Execute(
+      [this, data = std::vector<ByteArray>(data.begin(), data.end()),
+       deliver_at]() { Deliver(data, deliver_at); });
+  return {Exception::kSuccess};
+}
+
+Exception LinkOutputStream::Flush() { return pipe_->GetOutputStream().Flush(); }
+
+Exception LinkOutputStream::Close() {
+  if (!ideal_) {
+    absl::MutexLock lock(&mutex_);
+    if (closed_) return {Exception::kSuccess};
+    closed_ = true;
+  }
+  return pipe_->GetOutputStream().Close();
+}
+
+void LinkOutputStream::Throttle(std::int64_t size) {
+  if (profile_.bandwidth <= 0) return;
+  const absl::Time now = absl::Now();
+  tokens_ = std::min<double>(
+      profile_.burst,
+      tokens_ + absl::ToDoubleSeconds(now - refilled_) * profile_.bandwidth);
+  refilled_ = now;
+  tokens_ -= size;
+  if (tokens_ < 0) {
+    absl::SleepFor(absl::Seconds(-tokens_ / profile_.bandwidth));
+  }
+}
+
+bool LinkOutputStream::Chance(double probability) {
+  if (probability <= 0) return false;
+  return prng_.NextUint32() <
+         probability * std::numeric_limits<std::uint32_t>::max();
+}
+
+absl::Duration LinkOutputStream::NextDelay() {
+  absl::Duration delay = profile_.latency;
+  if (profile_.jitter > absl::ZeroDuration()) {
+    delay += profile_.jitter * (static_cast<double>(prng_.NextUint32()) /
+                                std::numeric_limits<std::uint32_t>::max());
+  }
+  // A lost write is only sent again once its loss is noticed.
+  if (Chance(profile_.loss)) delay += 2 * delay;
+  return delay;
+}
+
+void LinkOutputStream::Deliver(const std::vector<ByteArray>& data,
+                               absl::Time deliver_at) {
+  {
+    absl::MutexLock lock(&mutex_);
+    // Wakes up early only when the stream is closed.
+    mutex_.AwaitWithDeadline(absl::Condition(&closed_), deliver_at);
+    if (closed_) return;
+  }
+  pipe_->GetOutputStream().WriteV(absl::MakeConstSpan(data));
+}
+
+}  // namespace g3
+}  // namespace nearby
+}  // namespace location
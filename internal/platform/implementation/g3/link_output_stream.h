@@ -0,0 +1,98 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_G3_LINK_OUTPUT_STREAM_H_
+#define PLATFORM_IMPL_G3_LINK_OUTPUT_STREAM_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/medium_environment.h"
+#include "internal/platform/output_stream.h"
+#include "internal/platform/implementation/g3/pipe.h"
+#include "internal/platform/implementation/g3/single_thread_executor.h"
+#include "internal/platform/prng.h"
+#include "proto/connections_enums.pb.h"
+
+namespace location {
+namespace nearby {
+namespace g3 {
+
+// The OutputStream of one side of a simulated socket. It writes to the pipe
+// the other side reads from, shaped by the LinkProfile MediumEnvironment has
+// for the socket's medium when the stream is created. With an ideal profile,
+// writes go straight to the pipe.
+class LinkOutputStream : public OutputStream {
+ public:
+  LinkOutputStream(proto::connections::Medium medium,
+                   std::shared_ptr<Pipe> pipe);
+  ~LinkOutputStream() override;
+
+  // Blocks while the bandwidth of the link is used up. Returns before the
+  // data can be read if the link has latency.
+  Exception Write(const ByteArray& data) override;
+  Exception WriteV(absl::Span<const ByteArray> data) override;
+  Exception Flush() override;
+
+  // Closes the output of the pipe; data still in flight is lost.
+  Exception Close() override;
+
+ private:
+  // Sleeps until the bandwidth of the link allows |size| more bytes.
+  void Throttle(std::int64_t size) ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mutex_);
+
+  // Returns true with the given probability.
+  bool Chance(double probability) ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mutex_);
+
+  // Returns the delay of the next write, before it is ordered after the
+  // earlier ones.
+  absl::Duration NextDelay() ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mutex_);
+
+  // Writes |data| to the pipe at |deliver_at|, unless the stream is closed
+  // before that.
+  void Deliver(const std::vector<ByteArray>& data, absl::Time deliver_at)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const MediumEnvironment::LinkProfile profile_;
+  const bool ideal_;
+  const std::shared_ptr<Pipe> pipe_;
+
+  // Serializes writes, so they keep their order and share one bandwidth.
+  absl::Mutex write_mutex_;
+  Prng prng_ ABSL_GUARDED_BY(write_mutex_);
+  // Token bucket of the bandwidth limit; negative while writes are ahead.
+  double tokens_ ABSL_GUARDED_BY(write_mutex_);
+  absl::Time refilled_ ABSL_GUARDED_BY(write_mutex_);
+  absl::Time last_delivery_ ABSL_GUARDED_BY(write_mutex_);
+
+  mutable absl::Mutex mutex_;
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // Delivers delayed writes in order; only created for links with latency,
+  // jitter or loss.
+  std::unique_ptr<SingleThreadExecutor> delivery_;
+};
+
+}  // namespace g3
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_IMPL_G3_LINK_OUTPUT_STREAM_H_
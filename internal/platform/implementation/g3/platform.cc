@@ -52,7 +52,11 @@
 #include "internal/platform/implementation/g3/wifi_lan.h"
 #include "internal/platform/implementation/g3/wifi_hotspot.h"
 #include "internal/platform/implementation/shared/file.h"
+#include "internal/platform/implementation/shared/mmap_input_file.h"
+#include "internal/platform/implementation/shared/positional_output_file.h"
+#include "internal/platform/implementation/shared/work_stealing_executor.h"
 #include "internal/platform/implementation/wifi.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/medium_environment.h"
 
 namespace location {
@@ -73,18 +77,40 @@ int GetCurrentTid() {
   return LiveThread_Pthread_TID(my);
 }
 
+namespace {
+
+// Whether executors share the process' WorkStealingPool, instead of owning
+// their threads.
+bool UseWorkStealingPool() {
+  return FeatureFlags::GetInstance().GetFlags().enable_work_stealing_executors;
+}
+
+}  // namespace
+
 std::unique_ptr<SubmittableExecutor>
 ImplementationPlatform::CreateSingleThreadExecutor() {
+  if (UseWorkStealingPool()) {
+    return std::make_unique<shared::PooledExecutor>(
+        &shared::WorkStealingPool::GetDefault(), /*max_parallelism=*/1);
+  }
   return std::make_unique<g3::SingleThreadExecutor>();
 }
 
 std::unique_ptr<SubmittableExecutor>
 ImplementationPlatform::CreateMultiThreadExecutor(int max_concurrency) {
+  if (UseWorkStealingPool()) {
+    return std::make_unique<shared::PooledExecutor>(
+        &shared::WorkStealingPool::GetDefault(), max_concurrency);
+  }
   return std::make_unique<g3::MultiThreadExecutor>(max_concurrency);
 }
 
 std::unique_ptr<ScheduledExecutor>
 ImplementationPlatform::CreateScheduledExecutor() {
+  if (UseWorkStealingPool()) {
+    return std::make_unique<shared::PooledScheduledExecutor>(
+        &shared::WorkStealingPool::GetDefault());
+  }
   return std::make_unique<g3::ScheduledExecutor>();
 }
 
@@ -119,6 +145,10 @@ std::unique_ptr<InputFile> ImplementationPlatform::CreateInputFile(
 
 std::unique_ptr<InputFile> ImplementationPlatform::CreateInputFile(
     absl::string_view file_path, size_t size) {
+  // Map regular files, so outgoing chunks are sent without copying.
+  std::unique_ptr<InputFile> file =
+      shared::MmapInputFile::Create(file_path, size);
+  if (file) return file;
   return shared::IOFile::CreateInputFile(file_path, size);
 }
 
@@ -134,7 +164,7 @@ std::unique_ptr<OutputFile> ImplementationPlatform::CreateOutputFile(
 
 std::unique_ptr<OutputFile> ImplementationPlatform::CreateOutputFile(
     absl::string_view file_path) {
-  return shared::IOFile::CreateOutputFile(file_path);
+  return shared::PositionalOutputFile::Create(file_path);
 }
 
 std::unique_ptr<LogMessage> ImplementationPlatform::CreateLogMessage(
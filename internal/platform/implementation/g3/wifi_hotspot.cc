@@ -78,7 +78,7 @@ Exception WifiHotspotSocket::Close() {
 void WifiHotspotSocket::DoClose() {
   if (!closed_) {
     remote_socket_ = nullptr;
-    output_->GetOutputStream().Close();
+    link_output_.Close();
     output_->GetInputStream().Close();
     input_->GetOutputStream().Close();
     input_->GetInputStream().Close();
@@ -95,7 +95,7 @@ InputStream& WifiHotspotSocket::GetLocalInputStream() {
 
 OutputStream& WifiHotspotSocket::GetLocalOutputStream() {
   absl::MutexLock lock(&mutex_);
-  return output_->GetOutputStream();
+  return link_output_;
 }
 
 // Code for WifiHotspotServerSocket
@@ -26,6 +26,7 @@
 #include "internal/platform/byte_array.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/output_stream.h"
+#include "internal/platform/implementation/g3/link_output_stream.h"
 #include "internal/platform/implementation/g3/multi_thread_executor.h"
 #include "internal/platform/implementation/g3/pipe.h"
 
@@ -94,6 +95,8 @@ class WifiHotspotSocket : public api::WifiHotspotSocket {
   // it is closed. it represents output part of a local socket. Input part of a
   // local socket comes from the peer socket, after connection.
   std::shared_ptr<Pipe> output_{new Pipe};
+  // Writes to output_, shaped like a WiFi Hotspot link.
+  LinkOutputStream link_output_{proto::connections::WIFI_HOTSPOT, output_};
   std::shared_ptr<Pipe> input_;
   mutable absl::Mutex mutex_;
   WifiHotspotSocket* remote_socket_ ABSL_GUARDED_BY(mutex_) = nullptr;
@@ -77,7 +77,7 @@ Exception WifiLanSocket::Close() {
 void WifiLanSocket::DoClose() {
   if (!closed_) {
     remote_socket_ = nullptr;
-    output_->GetOutputStream().Close();
+    link_output_.Close();
     output_->GetInputStream().Close();
     input_->GetOutputStream().Close();
     input_->GetInputStream().Close();
@@ -94,7 +94,7 @@ InputStream& WifiLanSocket::GetLocalInputStream() {
 
 OutputStream& WifiLanSocket::GetLocalOutputStream() {
   absl::MutexLock lock(&mutex_);
-  return output_->GetOutputStream();
+  return link_output_;
 }
 
 std::string WifiLanServerSocket::GetName(const std::string& ip_address,
@@ -355,14 +355,25 @@ std::unique_ptr<api::WifiLanServerSocket> WifiLanMedium::ListenForService(
   server_socket->SetPort(port == 0 ? env.GetFakePort() : port);
   std::string socket_name = WifiLanServerSocket::GetName(
       server_socket->GetIPAddress(), server_socket->GetPort());
-  server_socket->SetCloseNotifier([this, socket_name]() {
-    absl::MutexLock lock(&mutex_);
-    server_sockets_.erase(socket_name);
-  });
+  server_socket->SetCloseNotifier(
+      [this, socket_name, ip_address = server_socket->GetIPAddress(),
+       port = server_socket->GetPort()]() {
+        {
+          absl::MutexLock lock(&mutex_);
+          server_sockets_.erase(socket_name);
+        }
+        MediumEnvironment::Instance().UpdateWifiLanMediumForServerSocket(
+            *this, ip_address, port, /*enabled=*/false);
+      });
   NEARBY_LOGS(INFO) << "G3 WifiLan Adding server socket: medium=" << this
                     << ", socket_name=" << socket_name;
-  absl::MutexLock lock(&mutex_);
-  server_sockets_.insert({socket_name, server_socket.get()});
+  {
+    absl::MutexLock lock(&mutex_);
+    server_sockets_.insert({socket_name, server_socket.get()});
+  }
+  env.UpdateWifiLanMediumForServerSocket(*this, server_socket->GetIPAddress(),
+                                         server_socket->GetPort(),
+                                         /*enabled=*/true);
   return server_socket;
 }
 
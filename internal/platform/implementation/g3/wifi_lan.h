@@ -27,6 +27,7 @@
 #include "internal/platform/input_stream.h"
 #include "internal/platform/nsd_service_info.h"
 #include "internal/platform/output_stream.h"
+#include "internal/platform/implementation/g3/link_output_stream.h"
 #include "internal/platform/implementation/g3/multi_thread_executor.h"
 #include "internal/platform/implementation/g3/pipe.h"
 
@@ -84,6 +85,8 @@ class WifiLanSocket : public api::WifiLanSocket {
   // it is closed. it represents output part of a local socket. Input part of a
   // local socket comes from the peer socket, after connection.
   std::shared_ptr<Pipe> output_{new Pipe};
+  // Writes to output_, shaped like a WiFi LAN link.
+  LinkOutputStream link_output_{proto::connections::WIFI_LAN, output_};
   std::shared_ptr<Pipe> input_;
   mutable absl::Mutex mutex_;
   WifiLanSocket* remote_socket_ ABSL_GUARDED_BY(mutex_) = nullptr;
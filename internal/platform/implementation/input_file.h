@@ -26,6 +26,10 @@ namespace nearby {
 namespace api {
 
 // An InputFile represents a readable file on the system.
+//
+// Implementations should override InputStream::Skip() with a seek: outgoing
+// file payloads Skip() to the resume offset, and the default implementation
+// reads and discards everything up to it.
 class InputFile : public InputStream {
  public:
   ~InputFile() override = default;
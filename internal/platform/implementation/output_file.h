@@ -15,6 +15,8 @@
 #ifndef PLATFORM_API_OUTPUT_FILE_H_
 #define PLATFORM_API_OUTPUT_FILE_H_
 
+#include <cstdint>
+
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/output_stream.h"
@@ -27,6 +29,12 @@ namespace api {
 class OutputFile : public OutputStream {
  public:
   ~OutputFile() override = default;
+
+  // Reserves disk space for |size| bytes up front, so the file doesn't grow
+  // one write at a time. Optional; the default does nothing.
+  virtual Exception Preallocate(std::int64_t size) {
+    return {Exception::kSuccess};
+  }
 };
 
 }  // namespace api
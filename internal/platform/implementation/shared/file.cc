@@ -61,15 +61,42 @@ ExceptionOr<ByteArray> IOFile::Read(std::int64_t size) {
     return ExceptionOr<ByteArray>{Exception::kIo};
   }
 
+  // Read straight into the returned buffer; a short read at the end of the
+  // file is returned as a slice rather than copied out.
   ByteArray bytes(size);
-  std::unique_ptr<char[]> read_bytes{new char[size]};
-  file_.read(read_bytes.get(), static_cast<ptrdiff_t>(size));
+  file_.read(bytes.data(), static_cast<ptrdiff_t>(size));
   auto num_bytes_read = file_.gcount();
   if (num_bytes_read == 0) {
     return ExceptionOr<ByteArray>{Exception::kIo};
   }
 
-  return ExceptionOr<ByteArray>(ByteArray(read_bytes.get(), num_bytes_read));
+  if (num_bytes_read < size) {
+    return ExceptionOr<ByteArray>(bytes.Slice(0, num_bytes_read));
+  }
+  return ExceptionOr<ByteArray>(std::move(bytes));
+}
+
+ExceptionOr<size_t> IOFile::Skip(size_t offset) {
+  if (!file_.is_open()) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
+
+  // A previous Read() may have hit the end of the file, which fails the
+  // stream; positioning works regardless.
+  file_.clear();
+  std::streampos position = file_.tellg();
+  file_.seekg(0, std::ios::end);
+  std::streampos end = file_.tellg();
+  if (position < 0 || end < 0) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
+
+  size_t skipped = std::min(offset, static_cast<size_t>(end - position));
+  file_.seekg(position + static_cast<std::streamoff>(skipped));
+  if (!file_.good()) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
+  return ExceptionOr<size_t>{skipped};
 }
 
 Exception IOFile::Close() {
@@ -37,6 +37,11 @@ class IOFile final : public api::InputFile, public api::OutputFile {
 
   ExceptionOr<ByteArray> Read(std::int64_t size) override;
 
+  // Seeks forward instead of reading, so resuming deep into a large file
+  // doesn't read everything before the resume point. Skipping stops at the
+  // end of the file; returns the number of bytes actually skipped.
+  ExceptionOr<size_t> Skip(size_t offset) override;
+
   std::string GetFilePath() const override { return path_; }
 
   std::int64_t GetTotalSize() const override { return total_size_; }
@@ -14,6 +14,7 @@
 
 #include "internal/platform/implementation/shared/file.h"
 
+#include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <memory>
@@ -23,6 +24,8 @@
 #include "file/util/temp_path.h"
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "internal/platform/byte_array.h"
 
 namespace location {
@@ -113,6 +116,45 @@ TEST_F(FileTest, IOFile_GetTotalSize) {
   EXPECT_EQ(io_file->GetTotalSize(), 3);
 }
 
+TEST_F(FileTest, IOFile_SkipThenRead) {
+  WriteToFile("abcdef");
+  auto io_file = shared::IOFile::CreateInputFile(path_, GetSize());
+  AssertEquals(io_file->Read(1), "a");
+
+  ExceptionOr<size_t> skipped = io_file->Skip(2);
+  EXPECT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), 2);
+  AssertEquals(io_file->Read(2), "de");
+}
+
+TEST_F(FileTest, IOFile_SkipStopsAtEOF) {
+  WriteToFile("abc");
+  auto io_file = shared::IOFile::CreateInputFile(path_, GetSize());
+  AssertEquals(io_file->Read(1), "a");
+
+  ExceptionOr<size_t> skipped = io_file->Skip(10);
+  EXPECT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), 2);
+  AssertEmpty(io_file->Read(kMaxSize));
+}
+
+TEST_F(FileTest, IOFile_SkipDoesNotReadSkippedData) {
+  // A sparse 4 GB file; reading and discarding it takes seconds.
+  constexpr std::int64_t kSkipSize = std::int64_t{4} << 30;
+  file_.seekp(kSkipSize);
+  WriteToFile("xyz");
+  auto io_file = shared::IOFile::CreateInputFile(path_, kSkipSize + 3);
+
+  absl::Time start = absl::Now();
+  ExceptionOr<size_t> skipped = io_file->Skip(kSkipSize);
+  absl::Duration elapsed = absl::Now() - start;
+
+  EXPECT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), kSkipSize);
+  EXPECT_LT(elapsed, absl::Milliseconds(100));
+  AssertEquals(io_file->Read(kMaxSize), "xyz");
+}
+
 TEST_F(FileTest, IOFile_CloseInput) {
   WriteToFile("abc");
   auto io_file = shared::IOFile::CreateInputFile(path_, GetSize());
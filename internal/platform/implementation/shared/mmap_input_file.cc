@@ -0,0 +1,153 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/mmap_input_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/memory/memory.h"
+
+namespace location {
+namespace nearby {
+namespace shared {
+
+constexpr size_t MmapInputFile::kDefaultWindowSize;
+
+// One mapped range of the file, unmapped once the last chunk referencing it is
+// gone.
+class MmapInputFile::Window {
+ public:
+  Window(const char* data, size_t length, std::int64_t offset)
+      : data_(data), length_(length), offset_(offset) {}
+  ~Window() { munmap(const_cast<char*>(data_), length_); }
+  Window(const Window&) = delete;
+  Window& operator=(const Window&) = delete;
+
+  // Whether [position, position + size) of the file lies in this window.
+  bool Contains(std::int64_t position, size_t size) const {
+    return position >= offset_ &&
+           position + static_cast<std::int64_t>(size) <=
+               offset_ + static_cast<std::int64_t>(length_);
+  }
+  const char* At(std::int64_t position) const {
+    return data_ + (position - offset_);
+  }
+
+ private:
+  const char* const data_;
+  const size_t length_;
+  const std::int64_t offset_;
+};
+
+std::unique_ptr<MmapInputFile> MmapInputFile::Create(
+    absl::string_view file_path, std::int64_t size, size_t window_size) {
+  std::string path(file_path);
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullptr;
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+    close(fd);
+    return nullptr;
+  }
+#ifdef POSIX_FADV_SEQUENTIAL
+  // Let the kernel read ahead aggressively; payloads are read front to back.
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  return absl::WrapUnique(new MmapInputFile(fd, file_path, size,
+                                            file_stat.st_size, window_size));
+}
+
+MmapInputFile::MmapInputFile(int fd, absl::string_view file_path,
+                             std::int64_t total_size, std::int64_t file_size,
+                             size_t window_size)
+    : fd_(fd),
+      path_(file_path),
+      total_size_(total_size),
+      file_size_(file_size),
+      window_size_(window_size) {}
+
+MmapInputFile::~MmapInputFile() { Close(); }
+
+ExceptionOr<ByteArray> MmapInputFile::Read(std::int64_t size) {
+  if (fd_ < 0 || size < 0) {
+    return ExceptionOr<ByteArray>{Exception::kIo};
+  }
+  if (position_ >= file_size_) {
+    return ExceptionOr<ByteArray>{ByteArray{}};
+  }
+
+  size_t length = static_cast<size_t>(std::min(size, file_size_ - position_));
+  if (!window_ || !window_->Contains(position_, length)) {
+    if (!MapWindow(position_, length)) {
+      return ExceptionOr<ByteArray>{Exception::kIo};
+    }
+  }
+  ByteArray chunk =
+      ByteArray::FromExternal(window_, window_->At(position_), length);
+  position_ += length;
+  return ExceptionOr<ByteArray>{std::move(chunk)};
+}
+
+ExceptionOr<size_t> MmapInputFile::Skip(size_t offset) {
+  if (fd_ < 0) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
+  size_t skipped = static_cast<size_t>(std::min<std::int64_t>(
+      offset, std::max<std::int64_t>(file_size_ - position_, 0)));
+  position_ += skipped;
+  return ExceptionOr<size_t>{skipped};
+}
+
+Exception MmapInputFile::Close() {
+  // Chunks already handed out keep their window mapped.
+  window_.reset();
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  return {Exception::kSuccess};
+}
+
+bool MmapInputFile::MapWindow(std::int64_t position, size_t size) {
+  static const std::int64_t page_size = sysconf(_SC_PAGESIZE);
+  const std::int64_t offset = position - position % page_size;
+  const size_t length = static_cast<size_t>(
+      std::min<std::int64_t>(std::max(window_size_, position - offset + size),
+                             file_size_ - offset));
+
+  // Let go of the previous window first, so that a finished window is
+  // unmapped right away when no chunks of it are alive anymore.
+  window_.reset();
+  void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd_, offset);
+  if (data == MAP_FAILED) return false;
+  madvise(data, length, MADV_SEQUENTIAL);
+#ifdef POSIX_FADV_WILLNEED
+  // Start reading the next window while this one is being sent.
+  posix_fadvise(fd_, offset + length, window_size_, POSIX_FADV_WILLNEED);
+#endif
+  window_ = std::make_shared<const Window>(static_cast<const char*>(data),
+                                           length, offset);
+  return true;
+}
+
+}  // namespace shared
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,83 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_SHARED_MMAP_INPUT_FILE_H_
+#define PLATFORM_IMPL_SHARED_MMAP_INPUT_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/implementation/input_file.h"
+
+namespace location {
+namespace nearby {
+namespace shared {
+
+// InputFile that serves reads straight out of a memory mapping of the file.
+//
+// Read() returns slices of the mapping instead of copies, so sending a chunk
+// costs neither a copy nor an allocation. The file is mapped one window at a
+// time; a window stays mapped for as long as chunks sliced from it are alive,
+// and the kernel is told to read ahead sequentially.
+//
+// The file must not be truncated while it's being read: touching a mapped
+// page past the new end of the file raises SIGBUS.
+class MmapInputFile final : public api::InputFile {
+ public:
+  static constexpr size_t kDefaultWindowSize = 64 * 1024 * 1024;  // 64 MB
+
+  // Returns nullptr if |file_path| can't be opened or isn't a regular file,
+  // so the caller can fall back to a stream-based InputFile.
+  static std::unique_ptr<MmapInputFile> Create(
+      absl::string_view file_path, std::int64_t size,
+      size_t window_size = kDefaultWindowSize);
+  ~MmapInputFile() override;
+
+  ExceptionOr<ByteArray> Read(std::int64_t size) override;
+  // Only moves the read position; returns the number of bytes skipped, which
+  // is less than |offset| only at the end of the file.
+  ExceptionOr<size_t> Skip(size_t offset) override;
+  Exception Close() override;
+
+  std::string GetFilePath() const override { return path_; }
+  std::int64_t GetTotalSize() const override { return total_size_; }
+
+ private:
+  class Window;
+
+  MmapInputFile(int fd, absl::string_view file_path, std::int64_t total_size,
+                std::int64_t file_size, size_t window_size);
+
+  // Maps a window holding at least [position, position + size).
+  bool MapWindow(std::int64_t position, size_t size);
+
+  int fd_;
+  const std::string path_;
+  const std::int64_t total_size_;
+  const std::int64_t file_size_;
+  const size_t window_size_;
+  std::int64_t position_ = 0;
+  std::shared_ptr<const Window> window_;
+};
+
+}  // namespace shared
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_IMPL_SHARED_MMAP_INPUT_FILE_H_
@@ -0,0 +1,161 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/mmap_input_file.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file/util/temp_path.h"
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "internal/platform/byte_array.h"
+
+namespace location {
+namespace nearby {
+namespace shared {
+namespace {
+
+class MmapInputFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    temp_path_ = std::make_unique<TempPath>(TempPath::Local);
+    path_ = temp_path_->path() + "/file.txt";
+  }
+
+  void WriteToFile(absl::string_view text) {
+    std::ofstream file(path_, std::ios::binary);
+    file << text;
+  }
+
+  std::string ReadString(MmapInputFile& file, std::int64_t size) {
+    ExceptionOr<ByteArray> bytes = file.Read(size);
+    EXPECT_TRUE(bytes.ok());
+    return std::string(bytes.result());
+  }
+
+  std::unique_ptr<TempPath> temp_path_;
+  std::string path_;
+};
+
+TEST_F(MmapInputFileTest, NonExistentPathReturnsNull) {
+  EXPECT_EQ(MmapInputFile::Create("/not/a/valid/path.txt", 0), nullptr);
+}
+
+TEST_F(MmapInputFileTest, DirectoryReturnsNull) {
+  EXPECT_EQ(MmapInputFile::Create(temp_path_->path(), 0), nullptr);
+}
+
+TEST_F(MmapInputFileTest, ReadsUntilEOF) {
+  WriteToFile("abcde");
+  auto file = MmapInputFile::Create(path_, 5);
+  ASSERT_NE(file, nullptr);
+
+  EXPECT_EQ(file->GetFilePath(), path_);
+  EXPECT_EQ(file->GetTotalSize(), 5);
+  EXPECT_EQ(ReadString(*file, 3), "abc");
+  EXPECT_EQ(ReadString(*file, 3), "de");
+  EXPECT_EQ(ReadString(*file, 3), "");
+}
+
+TEST_F(MmapInputFileTest, EmptyFileEOF) {
+  WriteToFile("");
+  auto file = MmapInputFile::Create(path_, 0);
+  ASSERT_NE(file, nullptr);
+
+  EXPECT_EQ(ReadString(*file, 3), "");
+}
+
+TEST_F(MmapInputFileTest, ChunksAreSlicesOfTheMapping) {
+  WriteToFile("abcdef");
+  auto file = MmapInputFile::Create(path_, 6);
+  ASSERT_NE(file, nullptr);
+
+  const ByteArray first = file->Read(3).result();
+  const ByteArray second = file->Read(3).result();
+
+  EXPECT_EQ(first.data() + first.size(), second.data());
+}
+
+TEST_F(MmapInputFileTest, ReadsAcrossWindows) {
+  // Windows are rounded to pages, so use a few pages' worth of data.
+  const std::int64_t page_size = sysconf(_SC_PAGESIZE);
+  std::string contents;
+  for (int i = 0; i < 5 * page_size; ++i) contents += 'a' + i % 26;
+  WriteToFile(contents);
+  auto file = MmapInputFile::Create(path_, contents.size(),
+                                    /*window_size=*/page_size);
+  ASSERT_NE(file, nullptr);
+
+  // Chunks that straddle window boundaries, and outlive their window.
+  std::vector<ByteArray> chunks;
+  while (true) {
+    ExceptionOr<ByteArray> bytes = file->Read(page_size / 3 + 1);
+    ASSERT_TRUE(bytes.ok());
+    if (bytes.result().Empty()) break;
+    chunks.push_back(bytes.result());
+  }
+  std::string actual;
+  for (const ByteArray& chunk : chunks) actual += std::string(chunk);
+  EXPECT_EQ(actual, contents);
+}
+
+TEST_F(MmapInputFileTest, SkipMovesReadPosition) {
+  WriteToFile("abcdef");
+  auto file = MmapInputFile::Create(path_, 6);
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(ReadString(*file, 1), "a");
+
+  ExceptionOr<size_t> skipped = file->Skip(2);
+  EXPECT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), 2);
+  EXPECT_EQ(ReadString(*file, 2), "de");
+
+  skipped = file->Skip(10);
+  EXPECT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), 1);
+  EXPECT_EQ(ReadString(*file, 2), "");
+}
+
+TEST_F(MmapInputFileTest, ChunksOutliveClose) {
+  WriteToFile("abc");
+  auto file = MmapInputFile::Create(path_, 3);
+  ASSERT_NE(file, nullptr);
+
+  ByteArray chunk = file->Read(3).result();
+  EXPECT_TRUE(file->Close().Ok());
+  file.reset();
+
+  EXPECT_EQ(std::string(chunk), "abc");
+}
+
+TEST_F(MmapInputFileTest, ReadAfterCloseFails) {
+  WriteToFile("abc");
+  auto file = MmapInputFile::Create(path_, 3);
+  ASSERT_NE(file, nullptr);
+  file->Close();
+
+  ExceptionOr<ByteArray> bytes = file->Read(3);
+  EXPECT_FALSE(bytes.ok());
+  EXPECT_TRUE(bytes.GetException().Raised(Exception::kIo));
+}
+
+}  // namespace
+}  // namespace shared
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,83 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/positional_output_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "absl/memory/memory.h"
+
+namespace location {
+namespace nearby {
+namespace shared {
+
+std::unique_ptr<PositionalOutputFile> PositionalOutputFile::Create(
+    absl::string_view file_path) {
+  std::string path(file_path);
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  return absl::WrapUnique(new PositionalOutputFile(fd));
+}
+
+PositionalOutputFile::~PositionalOutputFile() { Close(); }
+
+Exception PositionalOutputFile::Preallocate(std::int64_t size) {
+  if (fd_ < 0) return {Exception::kIo};
+#ifdef FALLOC_FL_KEEP_SIZE
+  if (size > offset_ &&
+      fallocate(fd_, FALLOC_FL_KEEP_SIZE, offset_, size - offset_) != 0 &&
+      errno != EOPNOTSUPP) {
+    return {Exception::kIo};
+  }
+#endif
+  return {Exception::kSuccess};
+}
+
+Exception PositionalOutputFile::Write(const ByteArray& data) {
+  if (fd_ < 0) return {Exception::kIo};
+
+  const char* next = data.data();
+  size_t remaining = data.size();
+  while (remaining > 0) {
+    ssize_t written = pwrite(fd_, next, remaining, offset_);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return {Exception::kIo};
+    }
+    next += written;
+    remaining -= written;
+    offset_ += written;
+  }
+  return {Exception::kSuccess};
+}
+
+Exception PositionalOutputFile::Flush() {
+  return {fd_ >= 0 ? Exception::kSuccess : Exception::kIo};
+}
+
+Exception PositionalOutputFile::Close() {
+  if (fd_ < 0) return {Exception::kSuccess};
+
+  bool synced = fsync(fd_) == 0;
+  close(fd_);
+  fd_ = -1;
+  return {synced ? Exception::kSuccess : Exception::kIo};
+}
+
+}  // namespace shared
+}  // namespace nearby
+}  // namespace location
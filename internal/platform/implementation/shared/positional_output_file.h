@@ -0,0 +1,60 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_SHARED_POSITIONAL_OUTPUT_FILE_H_
+#define PLATFORM_IMPL_SHARED_POSITIONAL_OUTPUT_FILE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "absl/strings/string_view.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/implementation/output_file.h"
+
+namespace location {
+namespace nearby {
+namespace shared {
+
+// OutputFile that writes with pwrite() at the offset it has written up to.
+//
+// Preallocate() reserves the disk space for the whole file up front, without
+// changing the file's size, so it doesn't fragment while it grows. Data is
+// synced to disk once, on Close(); Flush() only hands data to the kernel,
+// which every Write() already does.
+class PositionalOutputFile final : public api::OutputFile {
+ public:
+  // If |file_path| can't be opened, every operation fails with
+  // Exception::kIo.
+  static std::unique_ptr<PositionalOutputFile> Create(
+      absl::string_view file_path);
+  ~PositionalOutputFile() override;
+
+  Exception Preallocate(std::int64_t size) override;
+  Exception Write(const ByteArray& data) override;
+  Exception Flush() override;
+  Exception Close() override;
+
+ private:
+  explicit PositionalOutputFile(int fd) : fd_(fd) {}
+
+  int fd_;
+  std::int64_t offset_ = 0;
+};
+
+}  // namespace shared
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_IMPL_SHARED_POSITIONAL_OUTPUT_FILE_H_
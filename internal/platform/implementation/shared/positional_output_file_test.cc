@@ -0,0 +1,92 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/positional_output_file.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "file/util/temp_path.h"
+#include "gtest/gtest.h"
+#include "internal/platform/byte_array.h"
+
+namespace location {
+namespace nearby {
+namespace shared {
+namespace {
+
+class PositionalOutputFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    temp_path_ = std::make_unique<TempPath>(TempPath::Local);
+    path_ = temp_path_->path() + "/file.txt";
+  }
+
+  std::string ReadFile() {
+    std::ifstream file(path_, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+  }
+
+  std::unique_ptr<TempPath> temp_path_;
+  std::string path_;
+};
+
+TEST_F(PositionalOutputFileTest, NonExistentPathFails) {
+  auto file = PositionalOutputFile::Create("/not/a/valid/path.txt");
+
+  EXPECT_EQ(file->Preallocate(10), Exception{Exception::kIo});
+  EXPECT_EQ(file->Write(ByteArray("a")), Exception{Exception::kIo});
+}
+
+TEST_F(PositionalOutputFileTest, WritesInOrder) {
+  auto file = PositionalOutputFile::Create(path_);
+
+  EXPECT_EQ(file->Write(ByteArray("ab")), Exception{Exception::kSuccess});
+  EXPECT_EQ(file->Write(ByteArray("cde")), Exception{Exception::kSuccess});
+  EXPECT_EQ(file->Flush(), Exception{Exception::kSuccess});
+  EXPECT_EQ(file->Close(), Exception{Exception::kSuccess});
+
+  EXPECT_EQ(ReadFile(), "abcde");
+}
+
+TEST_F(PositionalOutputFileTest, PreallocateKeepsFileSize) {
+  auto file = PositionalOutputFile::Create(path_);
+
+  EXPECT_EQ(file->Preallocate(1024 * 1024), Exception{Exception::kSuccess});
+  EXPECT_EQ(file->Write(ByteArray("abc")), Exception{Exception::kSuccess});
+  EXPECT_EQ(file->Close(), Exception{Exception::kSuccess});
+
+  struct stat file_stat;
+  ASSERT_EQ(stat(path_.c_str(), &file_stat), 0);
+  EXPECT_EQ(file_stat.st_size, 3);
+  EXPECT_EQ(ReadFile(), "abc");
+}
+
+TEST_F(PositionalOutputFileTest, WriteAfterCloseFails) {
+  auto file = PositionalOutputFile::Create(path_);
+  file->Close();
+
+  EXPECT_EQ(file->Write(ByteArray("a")), Exception{Exception::kIo});
+}
+
+}  // namespace
+}  // namespace shared
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,356 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/work_stealing_executor.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+
+namespace location {
+namespace nearby {
+namespace shared {
+
+constexpr absl::Duration WorkStealingPool::kStallTimeout;
+constexpr absl::Duration WorkStealingPool::kIdleTimeout;
+constexpr int WorkStealingPool::kDefaultMaxThreads;
+constexpr int PooledExecutor::kBatchSize;
+
+struct WorkStealingPool::Worker {
+  Worker(WorkStealingPool* pool, int index) : pool(pool), index(index) {}
+
+  WorkStealingPool* const pool;
+  const int index;
+
+  // The worker takes tasks from the front, thieves from the back.
+  absl::Mutex mutex;
+  std::deque<Runnable> tasks ABSL_GUARDED_BY(mutex);
+  // Lets thieves skip empty queues without locking them.
+  std::atomic<std::int64_t> size = 0;
+
+  // Guarded by the pool's |mutex_|.
+  bool active = false;
+  std::thread thread;
+};
+
+WorkStealingPool& WorkStealingPool::GetDefault() {
+  static WorkStealingPool* const pool = new WorkStealingPool(
+      std::max(2, static_cast<int>(std::thread::hardware_concurrency())));
+  return *pool;
+}
+
+WorkStealingPool::WorkStealingPool(int min_threads, int max_threads)
+    : min_threads_(std::max(min_threads, 1)),
+      max_threads_(std::max(max_threads, min_threads_)),
+      workers_(std::make_unique<std::unique_ptr<Worker>[]>(max_threads_)) {}
+
+WorkStealingPool::~WorkStealingPool() {
+  std::multimap<absl::Time, Runnable> delayed;
+  std::vector<std::thread> threads;
+  {
+    absl::MutexLock lock(&mutex_);
+    shut_down_ = true;
+    delayed.swap(delayed_);
+    work_cond_.SignalAll();
+    supervisor_cond_.Signal();
+    // No thread is started anymore; workers stop once the queues are empty.
+    threads.push_back(std::move(supervisor_));
+    for (int i = 0; i < worker_slots_; ++i) {
+      threads.push_back(std::move(workers_[i]->thread));
+    }
+  }
+  for (std::thread& thread : threads) {
+    if (thread.joinable()) thread.join();
+  }
+}
+
+WorkStealingPool::Worker*& WorkStealingPool::CurrentWorker() {
+  static thread_local Worker* worker = nullptr;
+  return worker;
+}
+
+void WorkStealingPool::Submit(Runnable&& runnable) {
+  Worker* self = CurrentWorker();
+  if (self != nullptr && self->pool == this) {
+    absl::MutexLock lock(&self->mutex);
+    self->tasks.push_back(std::move(runnable));
+    ++self->size;
+  } else {
+    absl::MutexLock lock(&shared_mutex_);
+    shared_tasks_.push_back(std::move(runnable));
+    ++shared_size_;
+  }
+  // Workers count themselves idle before they look at |queued_| one last
+  // time, so either they see the task or we see them.
+  ++queued_;
+  if (idle_ > 0) {
+    absl::MutexLock lock(&mutex_);
+    work_cond_.Signal();
+  } else if (threads_ < min_threads_) {
+    absl::MutexLock lock(&mutex_);
+    if (threads_ < min_threads_) StartWorker();
+  } else if (!watching_.exchange(true)) {
+    absl::MutexLock lock(&mutex_);
+    supervisor_cond_.Signal();
+  }
+}
+
+void WorkStealingPool::SubmitAfter(absl::Duration delay, Runnable&& runnable) {
+  absl::MutexLock lock(&mutex_);
+  if (shut_down_) return;
+  const absl::Time due = absl::Now() + delay;
+  const bool earliest = delayed_.empty() || due < delayed_.begin()->first;
+  delayed_.emplace(due, std::move(runnable));
+  if (!supervisor_.joinable()) {
+    supervisor_ = std::thread([this]() { RunSupervisor(); });
+  } else if (earliest) {
+    supervisor_cond_.Signal();
+  }
+}
+
+int WorkStealingPool::GetThreadCount() const { return threads_; }
+
+Runnable WorkStealingPool::Take(Worker* self) {
+  Runnable task;
+  if (self->size > 0) {
+    absl::MutexLock lock(&self->mutex);
+    if (!self->tasks.empty()) {
+      task = std::move(self->tasks.front());
+      self->tasks.pop_front();
+      --self->size;
+    }
+  }
+  if (!task && shared_size_ > 0) {
+    absl::MutexLock lock(&shared_mutex_);
+    if (!shared_tasks_.empty()) {
+      task = std::move(shared_tasks_.front());
+      shared_tasks_.pop_front();
+      --shared_size_;
+    }
+  }
+  const int slots = worker_slots_.load(std::memory_order_acquire);
+  for (int i = 1; !task && i < slots; ++i) {
+    Worker* victim = workers_[(self->index + i) % slots].get();
+    if (victim->size == 0) continue;
+    absl::MutexLock lock(&victim->mutex);
+    if (!victim->tasks.empty()) {
+      task = std::move(victim->tasks.back());
+      victim->tasks.pop_back();
+      --victim->size;
+    }
+  }
+  if (task) {
+    --queued_;
+    ++dispatched_;
+  }
+  return task;
+}
+
+void WorkStealingPool::StartWorker() {
+  if (shut_down_ || threads_ >= max_threads_) return;
+  Worker* worker = nullptr;
+  const int slots = worker_slots_;
+  for (int i = 0; i < slots && worker == nullptr; ++i) {
+    if (!workers_[i]->active) worker = workers_[i].get();
+  }
+  if (worker == nullptr) {
+    workers_[slots] = std::make_unique<Worker>(this, slots);
+    worker = workers_[slots].get();
+    worker_slots_.store(slots + 1, std::memory_order_release);
+  }
+  // A stopped worker's thread is done with |mutex_| already.
+  if (worker->thread.joinable()) worker->thread.join();
+  worker->active = true;
+  ++threads_;
+  worker->thread = std::thread([this, worker]() { RunWorker(worker); });
+  if (!supervisor_.joinable()) {
+    supervisor_ = std::thread([this]() { RunSupervisor(); });
+  }
+}
+
+void WorkStealingPool::RunWorker(Worker* self) {
+  CurrentWorker() = self;
+  while (true) {
+    if (Runnable task = Take(self)) {
+      task();
+      continue;
+    }
+    absl::MutexLock lock(&mutex_);
+    ++idle_;
+    bool timed_out = false;
+    while (queued_ == 0 && !shut_down_ && !timed_out) {
+      if (threads_ > min_threads_) {
+        timed_out = work_cond_.WaitWithTimeout(&mutex_, kIdleTimeout);
+      } else {
+        work_cond_.Wait(&mutex_);
+      }
+    }
+    --idle_;
+    if (queued_ == 0 &&
+        (shut_down_ || (timed_out && threads_ > min_threads_))) {
+      --threads_;
+      self->active = false;
+      return;
+    }
+  }
+}
+
+void WorkStealingPool::RunSupervisor() {
+  std::int64_t last_dispatched = -1;
+  absl::MutexLock lock(&mutex_);
+  while (!shut_down_) {
+    const absl::Time now = absl::Now();
+    if (!delayed_.empty() && delayed_.begin()->first <= now) {
+      std::vector<Runnable> due;
+      while (!delayed_.empty() && delayed_.begin()->first <= now) {
+        due.push_back(std::move(delayed_.begin()->second));
+        delayed_.erase(delayed_.begin());
+      }
+      mutex_.Unlock();
+      for (Runnable& runnable : due) Submit(std::move(runnable));
+      due.clear();
+      mutex_.Lock();
+      continue;
+    }
+
+    absl::Time deadline =
+        delayed_.empty() ? absl::InfiniteFuture() : delayed_.begin()->first;
+    watching_ = true;
+    if (queued_ > 0) {
+      // If nothing was taken since the last look, the workers are all busy,
+      // maybe blocked, and the work needs one more.
+      const std::int64_t dispatched = dispatched_;
+      if (dispatched == last_dispatched) StartWorker();
+      last_dispatched = dispatched;
+      deadline = std::min(deadline, now + kStallTimeout);
+    } else {
+      // Submit() wakes us up again when it finds the workers busy.
+      watching_ = false;
+      if (queued_ > 0) continue;
+      last_dispatched = -1;
+    }
+    supervisor_cond_.WaitWithDeadline(&mutex_, deadline);
+  }
+}
+
+PooledExecutor::PooledExecutor(WorkStealingPool* pool, int max_parallelism)
+    : pool_(pool), max_parallelism_(std::max(max_parallelism, 1)) {}
+
+PooledExecutor::~PooledExecutor() {
+  absl::MutexLock lock(&mutex_);
+  shut_down_ = true;
+  mutex_.Await(absl::Condition(
+      +[](int* drainers) { return *drainers == 0; }, &drainers_));
+}
+
+void PooledExecutor::Execute(Runnable&& runnable) {
+  DoSubmit(std::move(runnable));
+}
+
+bool PooledExecutor::DoSubmit(Runnable&& runnable) {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (shut_down_) return false;
+    tasks_.push_back(std::move(runnable));
+    if (drainers_ >= max_parallelism_) return true;
+    ++drainers_;
+  }
+  pool_->Submit([this]() { Drain(); });
+  return true;
+}
+
+void PooledExecutor::Shutdown() {
+  absl::MutexLock lock(&mutex_);
+  shut_down_ = true;
+}
+
+bool PooledExecutor::InShutdown() const {
+  absl::MutexLock lock(&mutex_);
+  return shut_down_;
+}
+
+void PooledExecutor::Drain() {
+  for (int i = 0; i < kBatchSize; ++i) {
+    Runnable task;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (tasks_.empty()) {
+        // The executor may be gone as soon as the lock is released.
+        --drainers_;
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+  pool_->Submit([this]() { Drain(); });
+}
+
+namespace {
+
+class ScheduledCancelable : public api::Cancelable {
+ public:
+  bool Cancel() override { return Finish(kCanceled); }
+  bool MarkExecuted() { return Finish(kExecuted); }
+
+ private:
+  enum Status {
+    kNotRun,
+    kExecuted,
+    kCanceled,
+  };
+
+  bool Finish(Status status) {
+    Status expected = kNotRun;
+    return status_.compare_exchange_strong(expected, status);
+  }
+
+  std::atomic<Status> status_ = kNotRun;
+};
+
+}  // namespace
+
+PooledScheduledExecutor::PooledScheduledExecutor(WorkStealingPool* pool)
+    : pool_(pool), executor_(std::make_shared<PooledExecutor>(pool, 1)) {}
+
+PooledScheduledExecutor::~PooledScheduledExecutor() { executor_->Shutdown(); }
+
+void PooledScheduledExecutor::Execute(Runnable&& runnable) {
+  executor_->Execute(std::move(runnable));
+}
+
+std::shared_ptr<api::Cancelable> PooledScheduledExecutor::Schedule(
+    Runnable&& runnable, absl::Duration delay) {
+  auto cancelable = std::make_shared<ScheduledCancelable>();
+  if (executor_->InShutdown()) return cancelable;
+  pool_->SubmitAfter(
+      delay, [executor = std::weak_ptr<PooledExecutor>(executor_), cancelable,
+              runnable = std::move(runnable)]() {
+        std::shared_ptr<PooledExecutor> strand = executor.lock();
+        if (strand == nullptr) return;
+        strand->Execute([strand = strand.get(), cancelable, runnable]() {
+          if (!strand->InShutdown() && cancelable->MarkExecuted()) runnable();
+        });
+      });
+  return cancelable;
+}
+
+void PooledScheduledExecutor::Shutdown() { executor_->Shutdown(); }
+
+}  // namespace shared
+}  // namespace nearby
+}  // namespace location
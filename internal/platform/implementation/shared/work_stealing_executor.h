@@ -0,0 +1,172 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_SHARED_WORK_STEALING_EXECUTOR_H_
+#define PLATFORM_IMPL_SHARED_WORK_STEALING_EXECUTOR_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "internal/platform/implementation/cancelable.h"
+#include "internal/platform/implementation/scheduled_executor.h"
+#include "internal/platform/implementation/submittable_executor.h"
+#include "internal/platform/runnable.h"
+
+namespace location {
+namespace nearby {
+namespace shared {
+
+// A pool of threads that executors share, built on nothing but std::thread.
+//
+// Every worker has a queue of its own: tasks submitted by a worker go to its
+// queue, tasks submitted by any other thread to one queue shared by all. A
+// worker runs its own tasks first, then shared ones, and steals from the other
+// workers once it has nothing left to do.
+//
+// Tasks may block. Workers are started as work comes in, up to |min_threads|;
+// after that, one more is started whenever queued work has waited for
+// kStallTimeout without any worker picking up a task, up to |max_threads|.
+// Workers beyond |min_threads| stop after kIdleTimeout without work.
+class WorkStealingPool {
+ public:
+  static constexpr absl::Duration kStallTimeout = absl::Milliseconds(10);
+  static constexpr absl::Duration kIdleTimeout = absl::Seconds(10);
+  static constexpr int kDefaultMaxThreads = 1024;
+
+  // The pool of the process, which keeps a worker per core.
+  static WorkStealingPool& GetDefault();
+
+  explicit WorkStealingPool(int min_threads,
+                            int max_threads = kDefaultMaxThreads);
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+  // Runs the queued tasks, drops the delayed ones, and waits for the workers.
+  // Executors using the pool must be gone by then.
+  ~WorkStealingPool();
+
+  void Submit(Runnable&& runnable);
+  // Submits |runnable| once |delay| has passed.
+  void SubmitAfter(absl::Duration delay, Runnable&& runnable)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Number of workers currently started.
+  int GetThreadCount() const;
+
+ private:
+  struct Worker;
+
+  // The worker running on this thread, if any.
+  static Worker*& CurrentWorker();
+
+  // Takes the next task for |self|, from wherever there is one.
+  Runnable Take(Worker* self);
+  void StartWorker() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void RunWorker(Worker* self) ABSL_LOCKS_EXCLUDED(mutex_);
+  // Starts delayed tasks when they're due, and workers when the others stall.
+  void RunSupervisor() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const int min_threads_;
+  const int max_threads_;
+
+  // Workers are never deleted; a stopped worker's slot is reused by the next
+  // one. Slots below |worker_slots_| are safe to read without |mutex_|.
+  const std::unique_ptr<std::unique_ptr<Worker>[]> workers_;
+  std::atomic<int> worker_slots_ = 0;
+
+  absl::Mutex shared_mutex_;
+  std::deque<Runnable> shared_tasks_ ABSL_GUARDED_BY(shared_mutex_);
+  std::atomic<std::int64_t> shared_size_ = 0;
+
+  // Tasks in all queues, and tasks taken so far.
+  std::atomic<std::int64_t> queued_ = 0;
+  std::atomic<std::int64_t> dispatched_ = 0;
+  std::atomic<int> idle_ = 0;
+  std::atomic<int> threads_ = 0;
+  // Whether the supervisor is awake, looking for stalls.
+  std::atomic<bool> watching_ = false;
+
+  mutable absl::Mutex mutex_;
+  absl::CondVar work_cond_;
+  absl::CondVar supervisor_cond_;
+  bool shut_down_ ABSL_GUARDED_BY(mutex_) = false;
+  std::multimap<absl::Time, Runnable> delayed_ ABSL_GUARDED_BY(mutex_);
+  std::thread supervisor_ ABSL_GUARDED_BY(mutex_);
+};
+
+// An Executor that runs its tasks on a WorkStealingPool, at most
+// |max_parallelism| of them at a time.
+//
+// With a parallelism of 1 it is a strand: tasks run one after another, in the
+// order they were submitted, each one seeing everything the previous one did.
+// That is all the single-thread executors of the other platforms promise,
+// without keeping a thread around while there is nothing to do. Tasks don't
+// always run on the same thread, though.
+class PooledExecutor : public api::SubmittableExecutor {
+ public:
+  // Tasks taken off the queue in a row, before the executor goes to the back
+  // of the pool's queue to let others run.
+  static constexpr int kBatchSize = 16;
+
+  PooledExecutor(WorkStealingPool* pool, int max_parallelism);
+  // Waits for all the queued tasks to finish.
+  ~PooledExecutor() override ABSL_LOCKS_EXCLUDED(mutex_);
+
+  void Execute(Runnable&& runnable) override ABSL_LOCKS_EXCLUDED(mutex_);
+  bool DoSubmit(Runnable&& runnable) override ABSL_LOCKS_EXCLUDED(mutex_);
+  // Tasks submitted after this are dropped; queued ones still run.
+  void Shutdown() override ABSL_LOCKS_EXCLUDED(mutex_);
+  bool InShutdown() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void Drain() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  WorkStealingPool* const pool_;
+  const int max_parallelism_;
+  mutable absl::Mutex mutex_;
+  std::deque<Runnable> tasks_ ABSL_GUARDED_BY(mutex_);
+  // Tasks of the pool draining |tasks_|.
+  int drainers_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool shut_down_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// A ScheduledExecutor that runs its tasks one at a time on a WorkStealingPool.
+class PooledScheduledExecutor final : public api::ScheduledExecutor {
+ public:
+  explicit PooledScheduledExecutor(WorkStealingPool* pool);
+  ~PooledScheduledExecutor() override;
+
+  void Execute(Runnable&& runnable) override;
+  std::shared_ptr<api::Cancelable> Schedule(Runnable&& runnable,
+                                            absl::Duration delay) override;
+  void Shutdown() override;
+
+ private:
+  WorkStealingPool* const pool_;
+  // Shared with the delayed tasks, which hand their runnable over only while
+  // the executor is around.
+  std::shared_ptr<PooledExecutor> executor_;
+};
+
+}  // namespace shared
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_IMPL_SHARED_WORK_STEALING_EXECUTOR_H_
@@ -0,0 +1,243 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/work_stealing_executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "internal/platform/implementation/shared/count_down_latch.h"
+
+namespace location {
+namespace nearby {
+namespace shared {
+namespace {
+
+constexpr absl::Duration kWaitTimeout = absl::Seconds(10);
+
+TEST(WorkStealingPoolTest, RunsTasksFromAnyThread) {
+  constexpr int kThreads = 4;
+  constexpr int kTasksPerThread = 1000;
+  WorkStealingPool pool(/*min_threads=*/4);
+  std::atomic_int runs = 0;
+  CountDownLatch latch(kThreads * kTasksPerThread);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&pool, &runs, &latch]() {
+      for (int j = 0; j < kTasksPerThread; ++j) {
+        pool.Submit([&runs, &latch]() {
+          ++runs;
+          latch.CountDown();
+        });
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  ASSERT_TRUE(latch.Await(kWaitTimeout).result());
+  EXPECT_EQ(runs, kThreads * kTasksPerThread);
+}
+
+TEST(WorkStealingPoolTest, IdleWorkerStealsFromBusyOne) {
+  WorkStealingPool pool(/*min_threads=*/2);
+  absl::Notification stolen;
+  // Goes to the queue of the worker that then blocks until another one took
+  // the task off it.
+  pool.Submit([&pool, &stolen]() {
+    pool.Submit([&stolen]() { stolen.Notify(); });
+    EXPECT_TRUE(stolen.WaitForNotificationWithTimeout(kWaitTimeout));
+  });
+
+  EXPECT_TRUE(stolen.WaitForNotificationWithTimeout(kWaitTimeout));
+}
+
+TEST(WorkStealingPoolTest, AddsWorkersWhenTasksBlock) {
+  constexpr int kTasks = 5;
+  WorkStealingPool pool(/*min_threads=*/1);
+  // Every task waits for all the others to start.
+  CountDownLatch started(kTasks);
+  CountDownLatch done(kTasks);
+  for (int i = 0; i < kTasks; ++i) {
+    pool.Submit([&started, &done]() {
+      started.CountDown();
+      EXPECT_TRUE(started.Await(kWaitTimeout).result());
+      done.CountDown();
+    });
+  }
+
+  EXPECT_TRUE(done.Await(kWaitTimeout).result());
+  EXPECT_GE(pool.GetThreadCount(), kTasks);
+}
+
+TEST(WorkStealingPoolTest, RunsDelayedTask) {
+  WorkStealingPool pool(/*min_threads=*/1);
+  CountDownLatch latch(1);
+  const absl::Duration delay = absl::Milliseconds(50);
+  const absl::Time start = absl::Now();
+  absl::Time ran;
+  pool.SubmitAfter(delay, [&latch, &ran]() {
+    ran = absl::Now();
+    latch.CountDown();
+  });
+
+  ASSERT_TRUE(latch.Await(kWaitTimeout).result());
+  EXPECT_GE(ran - start, delay);
+}
+
+TEST(WorkStealingPoolTest, DestructorRunsQueuedTasks) {
+  std::atomic_int runs = 0;
+  {
+    WorkStealingPool pool(/*min_threads=*/2);
+    for (int i = 0; i < 100; ++i) {
+      pool.Submit([&runs]() {
+        absl::SleepFor(absl::Milliseconds(1));
+        ++runs;
+      });
+    }
+  }
+  EXPECT_EQ(runs, 100);
+}
+
+TEST(PooledExecutorTest, StrandRunsTasksInOrderOneAtATime) {
+  constexpr int kStrands = 8;
+  constexpr int kTasks = 1000;
+  WorkStealingPool pool(/*min_threads=*/4);
+  std::vector<std::vector<int>> order(kStrands);
+  std::vector<std::atomic_int> running(kStrands);
+  std::atomic_bool overlapped = false;
+  {
+    std::vector<std::unique_ptr<PooledExecutor>> strands;
+    for (int i = 0; i < kStrands; ++i) {
+      strands.push_back(std::make_unique<PooledExecutor>(&pool, 1));
+    }
+    for (int j = 0; j < kTasks; ++j) {
+      for (int i = 0; i < kStrands; ++i) {
+        strands[i]->Execute([&order, &running, &overlapped, i, j]() {
+          if (++running[i] > 1) overlapped = true;
+          order[i].push_back(j);
+          --running[i];
+        });
+      }
+    }
+  }
+
+  EXPECT_FALSE(overlapped);
+  for (const std::vector<int>& tasks : order) {
+    ASSERT_EQ(tasks.size(), kTasks);
+    EXPECT_TRUE(std::is_sorted(tasks.begin(), tasks.end()));
+  }
+}
+
+TEST(PooledExecutorTest, RunsAtMostMaxParallelismTasks) {
+  constexpr int kMaxParallelism = 3;
+  WorkStealingPool pool(/*min_threads=*/8);
+  std::atomic_int running = 0;
+  std::atomic_int most_running = 0;
+  {
+    PooledExecutor executor(&pool, kMaxParallelism);
+    for (int i = 0; i < 100; ++i) {
+      executor.Execute([&running, &most_running]() {
+        const int now_running = ++running;
+        int most = most_running;
+        while (now_running > most &&
+               !most_running.compare_exchange_weak(most, now_running)) {
+        }
+        absl::SleepFor(absl::Milliseconds(1));
+        --running;
+      });
+    }
+  }
+
+  EXPECT_GT(most_running, 1);
+  EXPECT_LE(most_running, kMaxParallelism);
+}
+
+TEST(PooledExecutorTest, ManyStrandsShareFewThreads) {
+  constexpr int kStrands = 100;
+  WorkStealingPool pool(/*min_threads=*/2);
+  std::vector<std::unique_ptr<PooledExecutor>> strands;
+  CountDownLatch latch(kStrands * 10);
+  for (int i = 0; i < kStrands; ++i) {
+    strands.push_back(std::make_unique<PooledExecutor>(&pool, 1));
+    for (int j = 0; j < 10; ++j) {
+      strands.back()->Execute([&latch]() { latch.CountDown(); });
+    }
+  }
+
+  ASSERT_TRUE(latch.Await(kWaitTimeout).result());
+  EXPECT_LT(pool.GetThreadCount(), kStrands / 10);
+}
+
+TEST(PooledExecutorTest, DropsTasksAfterShutdown) {
+  WorkStealingPool pool(/*min_threads=*/1);
+  std::atomic_int runs = 0;
+  {
+    PooledExecutor executor(&pool, 1);
+    EXPECT_TRUE(executor.DoSubmit([&runs]() { ++runs; }));
+    executor.Shutdown();
+    EXPECT_TRUE(executor.InShutdown());
+    EXPECT_FALSE(executor.DoSubmit([&runs]() { ++runs; }));
+    executor.Execute([&runs]() { ++runs; });
+  }
+  EXPECT_EQ(runs, 1);
+}
+
+TEST(PooledScheduledExecutorTest, RunsScheduledTaskOnce) {
+  WorkStealingPool pool(/*min_threads=*/1);
+  PooledScheduledExecutor executor(&pool);
+  CountDownLatch latch(1);
+  std::shared_ptr<api::Cancelable> cancelable = executor.Schedule(
+      [&latch]() { latch.CountDown(); }, absl::Milliseconds(10));
+
+  ASSERT_TRUE(latch.Await(kWaitTimeout).result());
+  EXPECT_FALSE(cancelable->Cancel());
+}
+
+TEST(PooledScheduledExecutorTest, CancelledTaskDoesNotRun) {
+  WorkStealingPool pool(/*min_threads=*/1);
+  PooledScheduledExecutor executor(&pool);
+  std::atomic_int runs = 0;
+  std::shared_ptr<api::Cancelable> cancelable =
+      executor.Schedule([&runs]() { ++runs; }, absl::Milliseconds(50));
+
+  EXPECT_TRUE(cancelable->Cancel());
+  absl::SleepFor(absl::Milliseconds(200));
+  EXPECT_EQ(runs, 0);
+}
+
+TEST(PooledScheduledExecutorTest, NothingRunsAfterShutdown) {
+  WorkStealingPool pool(/*min_threads=*/1);
+  std::atomic_int runs = 0;
+  {
+    PooledScheduledExecutor executor(&pool);
+    executor.Schedule([&runs]() { ++runs; }, absl::Milliseconds(50));
+    executor.Shutdown();
+    executor.Schedule([&runs]() { ++runs; }, absl::ZeroDuration());
+  }
+  absl::SleepFor(absl::Milliseconds(200));
+  EXPECT_EQ(runs, 0);
+}
+
+}  // namespace
+}  // namespace shared
+}  // namespace nearby
+}  // namespace location
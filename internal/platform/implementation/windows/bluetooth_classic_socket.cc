@@ -186,6 +186,34 @@ Exception BluetoothSocket::BluetoothOutputStream::Write(const ByteArray& data) {
   }
 }
 
+Exception BluetoothSocket::BluetoothOutputStream::WriteV(
+    absl::Span<const ByteArray> data) {
+  try {
+    if (winrt_stream_ == nullptr) {
+      return {Exception::kIo};
+    }
+
+    // Gather everything into one buffer so the frame goes out in one write.
+    size_t total_size = 0;
+    for (const ByteArray& item : data) total_size += item.size();
+    Buffer buffer = Buffer(total_size);
+    size_t position = 0;
+    for (const ByteArray& item : data) {
+      std::memcpy(buffer.data() + position, item.data(), item.size());
+      position += item.size();
+    }
+    buffer.Length(total_size);
+
+    winrt::hresult hresult = winrt_stream_.WriteAsync(buffer).get();
+    return {Exception::kSuccess};
+  } catch (winrt::hresult_error const& ex) {
+    NEARBY_LOGS(ERROR) << __func__ << ": winrt exception: " << ex.code() << ": "
+                       << winrt::to_string(ex.message());
+
+    return {Exception::kIo};
+  }
+}
+
 Exception BluetoothSocket::BluetoothOutputStream::Flush() {
   try {
     if (winrt_stream_ == nullptr) {
@@ -25,6 +25,7 @@
 
 // WinRT headers
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "internal/platform/implementation/windows/generated/winrt/Windows.Devices.Enumeration.h"
 #include "internal/platform/implementation/windows/generated/winrt/Windows.Devices.WiFi.h"
 #include "internal/platform/implementation/windows/generated/winrt/Windows.Devices.WiFiDirect.h"
@@ -134,6 +135,7 @@ class WifiHotspotSocket : public api::WifiHotspotSocket {
     ~SocketOutputStream() override = default;
 
     Exception Write(const ByteArray& data) override;
+    Exception WriteV(absl::Span<const ByteArray> data) override;
     Exception Flush() override;
     Exception Close() override;
 
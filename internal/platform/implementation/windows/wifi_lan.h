@@ -31,6 +31,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/implementation/wifi_lan.h"
@@ -131,6 +132,7 @@ class WifiLanSocket : public api::WifiLanSocket {
     ~SocketOutputStream() = default;
 
     Exception Write(const ByteArray& data) override;
+    Exception WriteV(absl::Span<const ByteArray> data) override;
     Exception Flush() override;
     Exception Close() override;
 
@@ -117,6 +117,27 @@ Exception WifiLanSocket::SocketOutputStream::Write(const ByteArray& data) {
   return {Exception::kSuccess};
 }
 
+Exception WifiLanSocket::SocketOutputStream::WriteV(absl::Span<const ByteArray> data) {
+  // Gather everything into one buffer so the frame goes out in one write.
+  size_t total_size = 0;
+  for (const ByteArray& item : data) total_size += item.size();
+  Buffer buffer = Buffer(total_size);
+  size_t position = 0;
+  for (const ByteArray& item : data) {
+    std::memcpy(buffer.data() + position, item.data(), item.size());
+    position += item.size();
+  }
+  buffer.Length(total_size);
+
+  try {
+    output_stream_.WriteAsync(buffer).get();
+  } catch (...) {
+    return {Exception::kIo};
+  }
+
+  return {Exception::kSuccess};
+}
+
 Exception WifiLanSocket::SocketOutputStream::Flush() {
   try {
     output_stream_.FlushAsync().get();
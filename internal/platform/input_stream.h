@@ -38,6 +38,11 @@ class InputStream {
 
   // throws Exception::kIo
   virtual Exception Close() = 0;
+
+  // Returns a file descriptor that polls readable (e.g. with epoll) while
+  // Read() would return without blocking, or -1 if the stream can't tell.
+  // The descriptor belongs to the stream, and is only valid while it is.
+  virtual int GetReadinessFd() { return -1; }
 };
 
 }  // namespace nearby
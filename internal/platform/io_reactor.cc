@@ -0,0 +1,189 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/io_reactor.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdint>
+#include <utility>
+
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace location {
+namespace nearby {
+
+namespace {
+
+// The watcher whose callback this thread is running, if any.
+thread_local const void* current_watcher = nullptr;
+
+#ifdef __linux__
+bool Arm(int epoll_fd, int op, int fd) {
+  epoll_event event{};
+  // One-shot, so that only one thread gets to handle an event, and a callback
+  // never runs concurrently with itself; it's re-armed once it returns.
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.fd = fd;
+  return epoll_ctl(epoll_fd, op, fd, &event) == 0;
+}
+
+int CreateEpollFd(int num_threads) {
+  return num_threads > 0 ? epoll_create1(EPOLL_CLOEXEC) : -1;
+}
+#else
+int CreateEpollFd(int num_threads) { return -1; }
+#endif
+
+}  // namespace
+
+bool IoReactor::IsSupported() {
+#ifdef __linux__
+  return true;
+#else
+  return false;
+#endif
+}
+
+IoReactor::IoReactor(int num_threads)
+    : epoll_fd_(CreateEpollFd(num_threads)),
+      loops_done_(epoll_fd_ >= 0 ? num_threads : 0) {
+#ifdef __linux__
+  if (epoll_fd_ < 0) return;
+  shutdown_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = shutdown_fd_;
+  if (shutdown_fd_ < 0 ||
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, shutdown_fd_, &event) != 0) {
+    NEARBY_LOGS(ERROR) << "IoReactor failed to set up; errno=" << errno;
+    return;
+  }
+  threads_ = std::make_unique<MultiThreadExecutor>(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    threads_->Execute("io-reactor", [this]() { Loop(); });
+  }
+#endif
+}
+
+IoReactor::~IoReactor() {
+  Shutdown();
+  threads_.reset();
+#ifdef __linux__
+  if (shutdown_fd_ >= 0) close(shutdown_fd_);
+  if (epoll_fd_ >= 0) close(epoll_fd_);
+#endif
+}
+
+bool IoReactor::Watch(int fd, ReadableCallback callback) {
+#ifdef __linux__
+  MutexLock lock(&mutex_);
+  if (shut_down_ || !threads_ || fd < 0 || watchers_.contains(fd)) {
+    return false;
+  }
+  if (!Arm(epoll_fd_, EPOLL_CTL_ADD, fd)) {
+    NEARBY_LOGS(WARNING) << "IoReactor can't watch fd " << fd
+                         << "; errno=" << errno;
+    return false;
+  }
+  watchers_.emplace(fd, std::make_shared<Watcher>(std::move(callback)));
+  return true;
+#else
+  return false;
+#endif
+}
+
+void IoReactor::Unwatch(int fd) {
+#ifdef __linux__
+  MutexLock lock(&mutex_);
+  auto item = watchers_.find(fd);
+  if (item == watchers_.end()) return;
+  std::shared_ptr<Watcher> watcher = std::move(item->second);
+  watchers_.erase(item);
+  watcher->unwatched = true;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  if (current_watcher == watcher.get()) return;
+  while (watcher->running) {
+    cond_.Wait();
+  }
+#endif
+}
+
+void IoReactor::Shutdown() {
+#ifdef __linux__
+  {
+    MutexLock lock(&mutex_);
+    if (shut_down_ || !threads_) return;
+    shut_down_ = true;
+    std::uint64_t one = 1;
+    if (write(shutdown_fd_, &one, sizeof(one)) != sizeof(one)) {
+      NEARBY_LOGS(ERROR) << "IoReactor failed to shut down; errno=" << errno;
+      return;
+    }
+  }
+  loops_done_.Await();
+#endif
+}
+
+void IoReactor::Loop() {
+#ifdef __linux__
+  while (true) {
+    epoll_event event;
+    int count = epoll_wait(epoll_fd_, &event, 1, /*timeout=*/-1);
+    if (count < 0 && errno == EINTR) continue;
+    if (count < 0) {
+      NEARBY_LOGS(ERROR) << "IoReactor failed to wait; errno=" << errno;
+      break;
+    }
+    if (count == 0) continue;
+    const int fd = event.data.fd;
+    // Level-triggered, so it wakes up every thread.
+    if (fd == shutdown_fd_) break;
+
+    std::shared_ptr<Watcher> watcher;
+    {
+      MutexLock lock(&mutex_);
+      auto item = watchers_.find(fd);
+      if (item == watchers_.end()) continue;
+      watcher = item->second;
+      watcher->running = true;
+    }
+
+    current_watcher = watcher.get();
+    const bool keep_watching = watcher->callback();
+    current_watcher = nullptr;
+
+    MutexLock lock(&mutex_);
+    watcher->running = false;
+    if (!watcher->unwatched) {
+      if (!keep_watching || !Arm(epoll_fd_, EPOLL_CTL_MOD, fd)) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        watchers_.erase(fd);
+      }
+    }
+    // Let Unwatch() know the callback is done.
+    cond_.Notify();
+  }
+  loops_done_.CountDown();
+#endif
+}
+
+}  // namespace nearby
+}  // namespace location
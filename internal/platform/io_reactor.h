@@ -0,0 +1,97 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_IO_REACTOR_H_
+#define PLATFORM_PUBLIC_IO_REACTOR_H_
+
+#include <functional>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "internal/platform/condition_variable.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
+
+namespace location {
+namespace nearby {
+
+// Waits for any number of file descriptors to become readable on a small,
+// fixed pool of threads, and runs a callback for each one that does.
+//
+// Lets many mostly idle streams share a few threads instead of each blocking
+// one in Read(). Only available where epoll is (see IsSupported()); callers
+// fall back to a thread of their own elsewhere.
+class IoReactor {
+ public:
+  // Runs on a reactor thread when the descriptor is readable. Returns whether
+  // to keep watching it. Readiness is level-triggered: a callback that leaves
+  // data unread runs again.
+  using ReadableCallback = std::function<bool()>;
+
+  static bool IsSupported();
+
+  explicit IoReactor(int num_threads);
+  ~IoReactor();
+
+  IoReactor(const IoReactor&) = delete;
+  IoReactor& operator=(const IoReactor&) = delete;
+
+  // Runs |callback| whenever |fd| is readable, until it returns false or
+  // Unwatch(fd) is called. A callback never runs concurrently with itself,
+  // but may run on a different thread each time, and should not block for
+  // long: it holds up one of the pool's threads meanwhile.
+  // Returns false if |fd| can't be watched or is watched already.
+  bool Watch(int fd, ReadableCallback callback) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Stops watching |fd|. Unless called from the callback of |fd| itself, waits
+  // for that callback to return if it's running, so |fd| may be closed
+  // afterwards, but not before.
+  void Unwatch(int fd) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Stops the reactor threads; callbacks don't run anymore after this
+  // returns. Called by the destructor.
+  void Shutdown() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Watcher {
+    explicit Watcher(ReadableCallback callback)
+        : callback(std::move(callback)) {}
+    const ReadableCallback callback;
+    bool running = false;
+    bool unwatched = false;
+  };
+
+  // Body of each reactor thread.
+  void Loop() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int epoll_fd_ = -1;
+  // Becomes readable, and stays so, on Shutdown().
+  int shutdown_fd_ = -1;
+
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  bool shut_down_ ABSL_GUARDED_BY(mutex_) = false;
+  absl::flat_hash_map<int, std::shared_ptr<Watcher>> watchers_
+      ABSL_GUARDED_BY(mutex_);
+
+  CountDownLatch loops_done_;
+  std::unique_ptr<MultiThreadExecutor> threads_;
+};
+
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_PUBLIC_IO_REACTOR_H_
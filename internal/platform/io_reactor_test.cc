@@ -0,0 +1,144 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/io_reactor.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/pipe.h"
+#include "internal/platform/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+class IoReactorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!IoReactor::IsSupported()) GTEST_SKIP();
+  }
+};
+
+TEST_F(IoReactorTest, CallsBackWhileReadable) {
+  IoReactor reactor(2);
+  Pipe pipe;
+  InputStream& input = pipe.GetInputStream();
+  std::string received;
+  CountDownLatch done(1);
+  ASSERT_TRUE(reactor.Watch(input.GetReadinessFd(), [&]() {
+    ExceptionOr<ByteArray> bytes = input.Read(2);
+    if (!bytes.ok() || bytes.result().Empty()) {
+      done.CountDown();
+      return false;
+    }
+    received += std::string(bytes.result());
+    return true;
+  }));
+
+  OutputStream& output = pipe.GetOutputStream();
+  EXPECT_TRUE(output.Write(ByteArray("ABCDE")).Ok());
+  EXPECT_TRUE(output.Write(ByteArray("FG")).Ok());
+  output.Close();
+
+  EXPECT_TRUE(done.Await(absl::Seconds(1)).result());
+  EXPECT_EQ(received, "ABCDEFG");
+}
+
+TEST_F(IoReactorTest, StopsWatchingWhenCallbackReturnsFalse) {
+  IoReactor reactor(1);
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  std::atomic_int calls = 0;
+  ASSERT_TRUE(reactor.Watch(fds[0], [&calls]() {
+    ++calls;
+    return false;
+  }));
+  // Can't be watched twice.
+  EXPECT_FALSE(reactor.Watch(fds[0], []() { return true; }));
+
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  SystemClock::Sleep(absl::Milliseconds(100));
+  EXPECT_EQ(calls, 1);
+  // It's free to be watched again.
+  EXPECT_TRUE(reactor.Watch(fds[0], []() { return false; }));
+
+  reactor.Shutdown();
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_F(IoReactorTest, UnwatchWaitsForRunningCallback) {
+  IoReactor reactor(1);
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  CountDownLatch started(1);
+  std::atomic_bool finished = false;
+  ASSERT_TRUE(reactor.Watch(fds[0], [&]() {
+    started.CountDown();
+    SystemClock::Sleep(absl::Milliseconds(100));
+    finished = true;
+    return true;
+  }));
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  ASSERT_TRUE(started.Await(absl::Seconds(1)).result());
+
+  reactor.Unwatch(fds[0]);
+
+  EXPECT_TRUE(finished);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_F(IoReactorTest, CallbackCanUnwatchItself) {
+  IoReactor reactor(1);
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  CountDownLatch done(1);
+  const int fd = fds[0];
+  ASSERT_TRUE(reactor.Watch(fd, [&reactor, &done, fd]() {
+    reactor.Unwatch(fd);
+    done.CountDown();
+    return true;
+  }));
+
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  EXPECT_TRUE(done.Await(absl::Seconds(1)).result());
+  EXPECT_TRUE(reactor.Watch(fd, []() { return false; }));
+
+  reactor.Shutdown();
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_F(IoReactorTest, WatchFailsAfterShutdown) {
+  IoReactor reactor(1);
+  reactor.Shutdown();
+  Pipe pipe;
+
+  EXPECT_FALSE(
+      reactor.Watch(pipe.GetInputStream().GetReadinessFd(), []() {
+        return true;
+      }));
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
@@ -70,6 +70,7 @@ void MediumEnvironment::Reset() {
     {
       MutexLock lock(&mutex_);
       wifi_hotspot_mediums_.clear();
+      link_profiles_.clear();
     }
     use_valid_peer_connection_ = true;
     peer_connection_latency_ = absl::ZeroDuration();
@@ -757,6 +758,24 @@ absl::Duration MediumEnvironment::GetPeerConnectionLatency() {
   return peer_connection_latency_;
 }
 
+bool MediumEnvironment::LinkProfile::IsIdeal() const {
+  return bandwidth <= 0 && latency <= absl::ZeroDuration() &&
+         jitter <= absl::ZeroDuration() && loss <= 0 && disconnect <= 0;
+}
+
+void MediumEnvironment::SetLinkProfile(proto::connections::Medium medium,
+                                       const LinkProfile& profile) {
+  MutexLock lock(&mutex_);
+  link_profiles_[medium] = profile;
+}
+
+MediumEnvironment::LinkProfile MediumEnvironment::GetLinkProfile(
+    proto::connections::Medium medium) {
+  MutexLock lock(&mutex_);
+  auto item = link_profiles_.find(medium);
+  return item != link_profiles_.end() ? item->second : LinkProfile{};
+}
+
 std::string MediumEnvironment::GetFakeIPAddress() const {
   std::string ip_address;
   ip_address.resize(4);
@@ -846,6 +865,27 @@ void MediumEnvironment::UpdateWifiLanMediumForDiscovery(
   });
 }
 
+void MediumEnvironment::UpdateWifiLanMediumForServerSocket(
+    api::WifiLanMedium& medium, const std::string& ip_address, int port,
+    bool enabled) {
+  if (!enabled_) return;
+  CountDownLatch latch(1);
+  RunOnMediumEnvironmentThread(
+      [this, &medium, ip_address, port, enabled, &latch]() {
+        auto item = wifi_lan_mediums_.find(&medium);
+        if (item != wifi_lan_mediums_.end()) {
+          auto& context = item->second;
+          if (enabled) {
+            context.server_sockets.insert({ip_address, port});
+          } else {
+            context.server_sockets.erase({ip_address, port});
+          }
+        }
+        latch.CountDown();
+      });
+  latch.Await();
+}
+
 void MediumEnvironment::UnregisterWifiLanMedium(api::WifiLanMedium& medium) {
   if (!enabled_) return;
   RunOnMediumEnvironmentThread([this, &medium]() {
@@ -867,6 +907,9 @@ api::WifiLanMedium* MediumEnvironment::GetWifiLanMedium(
         return medium_found;
       }
     }
+    if (info.server_sockets.contains({ip_address, port})) {
+      return medium_found;
+    }
   }
   return nullptr;
 }
@@ -16,11 +16,14 @@
 #define PLATFORM_BASE_MEDIUM_ENVIRONMENT_H_
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
 #include "internal/platform/implementation/ble.h"
 #include "internal/platform/implementation/ble_v2.h"
@@ -37,6 +40,7 @@
 #include "internal/platform/nsd_service_info.h"
 #include "internal/platform/single_thread_executor.h"
 #include "internal/platform/wifi_hotspot_credential.h"
+#include "proto/connections_enums.pb.h"
 
 namespace location {
 namespace nearby {
@@ -168,6 +172,36 @@ class MediumEnvironment {
 
   absl::Duration GetPeerConnectionLatency();
 
+  // Shapes the traffic of simulated links. Each side of every link gets its
+  // own copy of the profile of its medium, applied to what that side writes.
+  struct LinkProfile {
+    // Bytes per second a link carries, or 0 for no limit.
+    std::int64_t bandwidth = 0;
+    // Bytes a link may send at once before the bandwidth limit applies.
+    std::int64_t burst = 16 * 1024;
+    // Time until written data can be read on the other side.
+    absl::Duration latency = absl::ZeroDuration();
+    // Upper bound of extra latency, picked uniformly for every write. Data is
+    // still read in the order it was written.
+    absl::Duration jitter = absl::ZeroDuration();
+    // Chance that a write is lost and sent again a round trip later.
+    double loss = 0;
+    // Chance that a write breaks the link, as if the peer went out of range.
+    double disconnect = 0;
+
+    // Returns true if the profile leaves links unshaped.
+    bool IsIdeal() const;
+  };
+
+  // Sets the profile of links over |medium| that are connected from now on,
+  // until the environment is started again. A default LinkProfile makes them
+  // ideal again.
+  void SetLinkProfile(proto::connections::Medium medium,
+                      const LinkProfile& profile);
+
+  // Returns the profile of links over |medium|.
+  LinkProfile GetLinkProfile(proto::connections::Medium medium);
+
   // Adds medium-related info to allow for scanning/advertising to work.
   // This provides access to this medium from other mediums, when protocol
   // expects they should communicate.
@@ -281,6 +315,13 @@ class MediumEnvironment {
       api::WifiLanMedium& medium, WifiLanDiscoveredServiceCallback callback,
       const std::string& service_type, bool enabled);
 
+  // Updates the server sockets the current medium listens on. Sockets that
+  // are not advertised, like those of a bandwidth upgrade, can only be
+  // reached through GetWifiLanMedium() once they are added here.
+  void UpdateWifiLanMediumForServerSocket(api::WifiLanMedium& medium,
+                                          const std::string& ip_address,
+                                          int port, bool enabled);
+
   // Gets Fake IP address for WifiLan medium.
   std::string GetFakeIPAddress() const;
 
@@ -290,8 +331,8 @@ class MediumEnvironment {
   // Removes medium-related info. This should correspond to device power off.
   void UnregisterWifiLanMedium(api::WifiLanMedium& medium);
 
-  // Returns WifiLan medium whose advertising service matching IP address and
-  // port, or nullptr.
+  // Returns WifiLan medium whose advertising service or server socket matches
+  // IP address and port, or nullptr.
   api::WifiLanMedium* GetWifiLanMedium(const std::string& ip_address, int port);
 
   // Adds medium-related info to allow for start/connect Hotspot to work.
@@ -348,6 +389,8 @@ class MediumEnvironment {
         discovered_callbacks;
     // discovered service vs service type map.
     absl::flat_hash_map<std::string, NsdServiceInfo> discovered_services;
+    // IP address and port of each listening server socket.
+    absl::flat_hash_set<std::pair<std::string, int>> server_sockets;
   };
 
   struct WifiHotspotMediumContext {
@@ -429,6 +472,8 @@ class MediumEnvironment {
 
   bool use_valid_peer_connection_ = true;
   absl::Duration peer_connection_latency_ = absl::ZeroDuration();
+  absl::flat_hash_map<proto::connections::Medium, LinkProfile> link_profiles_
+      ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace nearby
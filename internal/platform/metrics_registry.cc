@@ -0,0 +1,210 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/metrics_registry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <tuple>
+
+#include "absl/numeric/bits.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace location {
+namespace nearby {
+
+namespace {
+
+std::string GetKey(absl::string_view name, const MetricLabels& labels) {
+  if (labels.empty()) return std::string(name);
+  return absl::StrCat(name, "{",
+                      absl::StrJoin(labels, ",", absl::PairFormatter("=")),
+                      "}");
+}
+
+bool HasLabels(const MetricLabels& labels, const MetricLabels& wanted) {
+  for (const auto& label : wanted) {
+    if (std::find(labels.begin(), labels.end(), label) == labels.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+double HistogramSnapshot::Mean() const {
+  return count > 0 ? static_cast<double>(sum) / count : 0;
+}
+
+std::int64_t HistogramSnapshot::Percentile(double percentile) const {
+  if (count == 0) return 0;
+  const std::int64_t rank = std::max<std::int64_t>(
+      1, static_cast<std::int64_t>(std::ceil(percentile / 100 * count)));
+  std::int64_t seen = 0;
+  for (const auto& bucket : buckets) {
+    seen += bucket.second;
+    if (seen >= rank) return std::min(bucket.first, max);
+  }
+  return max;
+}
+
+void Histogram::Record(std::int64_t value) {
+  if (value < 0) value = 0;
+  buckets_[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+
+  std::int64_t min = min_.load(std::memory_order_relaxed);
+  while (value < min && !min_.compare_exchange_weak(
+                            min, value, std::memory_order_relaxed)) {
+  }
+  std::int64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max && !max_.compare_exchange_weak(
+                            max, value, std::memory_order_relaxed)) {
+  }
+}
+
+HistogramSnapshot Histogram::GetSnapshot() const {
+  // The fields are read one by one, so values recorded meanwhile may show in
+  // some but not others.
+  HistogramSnapshot snapshot;
+  for (int i = 0; i < kBucketCount; ++i) {
+    std::int64_t count = buckets_[i].load(std::memory_order_relaxed);
+    if (count == 0) continue;
+    snapshot.buckets.emplace_back(GetBucketMax(i), count);
+    snapshot.count += count;
+  }
+  if (snapshot.count == 0) return snapshot;
+  snapshot.sum = sum_.load(std::memory_order_relaxed);
+  snapshot.min = min_.load(std::memory_order_relaxed);
+  snapshot.max = max_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+int Histogram::GetBucketIndex(std::int64_t value) {
+  if (value < kSubBucketCount) return value;
+  const int bits = std::min<int>(
+      kMaxBits, std::numeric_limits<std::uint64_t>::digits -
+                    absl::countl_zero(static_cast<std::uint64_t>(value)));
+  if (bits == kMaxBits && value >= (std::int64_t{1} << kMaxBits)) {
+    return kBucketCount - 1;
+  }
+  // The top kSubBucketBits + 1 bits of |value| pick the bucket.
+  const int shift = bits - kSubBucketBits - 1;
+  return kSubBucketCount * (shift + 1) +
+         static_cast<int>(value >> shift) - kSubBucketCount;
+}
+
+std::int64_t Histogram::GetBucketMax(int index) {
+  if (index < kSubBucketCount) return index;
+  // The last bucket takes every value past the range as well.
+  if (index == kBucketCount - 1) {
+    return std::numeric_limits<std::int64_t>::max();
+  }
+  const int shift = index / kSubBucketCount - 1;
+  const std::int64_t first =
+      static_cast<std::int64_t>(index % kSubBucketCount + kSubBucketCount)
+      << shift;
+  return first + (std::int64_t{1} << shift) - 1;
+}
+
+MetricsRegistry& MetricsRegistry::GetInstance() {
+  static MetricsRegistry* instance = new MetricsRegistry();
+  return *instance;
+}
+
+std::shared_ptr<Counter> MetricsRegistry::GetCounter(absl::string_view name,
+                                                     MetricLabels labels) {
+  MutexLock lock(&mutex_);
+  Entry& entry = GetEntryLocked(name, labels);
+  if (!entry.counter) entry.counter = std::make_shared<Counter>();
+  return entry.counter;
+}
+
+std::shared_ptr<Histogram> MetricsRegistry::GetHistogram(
+    absl::string_view name, MetricLabels labels) {
+  MutexLock lock(&mutex_);
+  Entry& entry = GetEntryLocked(name, labels);
+  if (!entry.histogram) entry.histogram = std::make_shared<Histogram>();
+  return entry.histogram;
+}
+
+void MetricsRegistry::RemoveMetrics(const MetricLabels& labels) {
+  MutexLock lock(&mutex_);
+  absl::erase_if(entries_, [&labels](const auto& item) {
+    return HasLabels(item.second.labels, labels);
+  });
+}
+
+MetricsSnapshot MetricsRegistry::GetSnapshot() const {
+  std::vector<const Entry*> entries;
+  MetricsSnapshot snapshot;
+  MutexLock lock(&mutex_);
+  entries.reserve(entries_.size());
+  for (const auto& item : entries_) entries.push_back(&item.second);
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry* a, const Entry* b) {
+              return std::tie(a->name, a->labels) <
+                     std::tie(b->name, b->labels);
+            });
+  for (const Entry* entry : entries) {
+    if (entry->counter) {
+      snapshot.counters.push_back(
+          {entry->name, entry->labels, entry->counter->Get()});
+    }
+    if (entry->histogram) {
+      snapshot.histograms.push_back(
+          {entry->name, entry->labels, entry->histogram->GetSnapshot()});
+    }
+  }
+  return snapshot;
+}
+
+std::string MetricsRegistry::Dump() const {
+  MetricsSnapshot snapshot = GetSnapshot();
+  std::stringstream sstream;
+  sstream << "Metrics" << std::endl;
+  for (const auto& counter : snapshot.counters) {
+    sstream << "  " << GetKey(counter.name, counter.labels) << ": "
+            << counter.value << std::endl;
+  }
+  for (const auto& histogram : snapshot.histograms) {
+    const HistogramSnapshot& value = histogram.value;
+    sstream << "  " << GetKey(histogram.name, histogram.labels)
+            << ": count=" << value.count << " mean=" << value.Mean()
+            << " min=" << value.min << " p50=" << value.Percentile(50)
+            << " p90=" << value.Percentile(90)
+            << " p99=" << value.Percentile(99) << " max=" << value.max
+            << std::endl;
+  }
+  return sstream.str();
+}
+
+MetricsRegistry::Entry& MetricsRegistry::GetEntryLocked(absl::string_view name,
+                                                        MetricLabels& labels) {
+  std::sort(labels.begin(), labels.end());
+  std::string key = GetKey(name, labels);
+  auto item = entries_.find(key);
+  if (item != entries_.end()) return item->second;
+  Entry& entry = entries_[std::move(key)];
+  entry.name = std::string(name);
+  entry.labels = std::move(labels);
+  return entry;
+}
+
+}  // namespace nearby
+}  // namespace location
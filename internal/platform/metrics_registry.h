@@ -0,0 +1,154 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_METRICS_REGISTRY_H_
+#define PLATFORM_PUBLIC_METRICS_REGISTRY_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "internal/platform/mutex.h"
+
+namespace location {
+namespace nearby {
+
+// Names the instance of a metric, e.g. {{"medium", "BLUETOOTH"}}.
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+// A count that only goes up. Lock-free.
+class Counter {
+ public:
+  void Increment(std::int64_t n = 1) {
+    value_.fetch_add(n, std::memory_order_relaxed);
+  }
+  std::int64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<std::int64_t> value_{0};
+};
+
+// The values a Histogram recorded up to some point.
+struct HistogramSnapshot {
+  std::int64_t count = 0;
+  std::int64_t sum = 0;
+  std::int64_t min = 0;
+  std::int64_t max = 0;
+  // The highest value and the count of each non-empty bucket, in order.
+  std::vector<std::pair<std::int64_t, std::int64_t>> buckets;
+
+  double Mean() const;
+  // Returns the value that |percentile| percent of the values are at or
+  // below, to the precision of the buckets.
+  std::int64_t Percentile(double percentile) const;
+};
+
+// Counts non-negative values in log-linear buckets, like HdrHistogram: each
+// power of two is split in 16 buckets, so a value is reported at most 1/16
+// off. Values from 2^44 on (about 4.9 hours in nanoseconds) share the last
+// bucket. Recording is lock-free and never allocates.
+class Histogram {
+ public:
+  void Record(std::int64_t value);
+  HistogramSnapshot GetSnapshot() const;
+
+ private:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+  static constexpr int kMaxBits = 44;
+  static constexpr int kBucketCount =
+      kSubBucketCount * (kMaxBits - kSubBucketBits + 1);
+
+  static int GetBucketIndex(std::int64_t value);
+  static std::int64_t GetBucketMax(int index);
+
+  std::array<std::atomic<std::int64_t>, kBucketCount> buckets_{};
+  std::atomic<std::int64_t> sum_{0};
+  std::atomic<std::int64_t> min_{std::numeric_limits<std::int64_t>::max()};
+  std::atomic<std::int64_t> max_{0};
+};
+
+// Every metric in the registry at some point, sorted by name and labels.
+struct MetricsSnapshot {
+  struct CounterValue {
+    std::string name;
+    MetricLabels labels;
+    std::int64_t value;
+  };
+  struct HistogramValue {
+    std::string name;
+    MetricLabels labels;
+    HistogramSnapshot value;
+  };
+
+  std::vector<CounterValue> counters;
+  std::vector<HistogramValue> histograms;
+};
+
+// A process-wide registry of named counters and histograms.
+//
+// Looking a metric up takes a lock, so hot paths look theirs up once and keep
+// the pointer; updating it is lock-free. Metrics stay in the registry until
+// they are removed, and live on for as long as someone holds a pointer.
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& GetInstance();
+
+  // Returns the metric with |name| and |labels|, adding it on the first call.
+  // The order of |labels| doesn't matter.
+  std::shared_ptr<Counter> GetCounter(absl::string_view name,
+                                      MetricLabels labels = {});
+  std::shared_ptr<Histogram> GetHistogram(absl::string_view name,
+                                          MetricLabels labels = {});
+
+  // Removes the metrics that have all of |labels|, e.g. those of an endpoint
+  // that went away.
+  void RemoveMetrics(const MetricLabels& labels);
+
+  MetricsSnapshot GetSnapshot() const;
+
+  // Returns a summary of every metric, one per line.
+  std::string Dump() const;
+
+ private:
+  struct Entry {
+    std::string name;
+    MetricLabels labels;
+    std::shared_ptr<Counter> counter;
+    std::shared_ptr<Histogram> histogram;
+  };
+
+  MetricsRegistry() = default;
+
+  // Returns the entry of |name| and |labels|; |labels| are sorted first.
+  Entry& GetEntryLocked(absl::string_view name, MetricLabels& labels)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable Mutex mutex_;
+  // Keyed by name and sorted labels, as Dump() prints them.
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_PUBLIC_METRICS_REGISTRY_H_
@@ -0,0 +1,148 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/metrics_registry.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+using ::testing::HasSubstr;
+
+// The registry is shared by the whole process, so tests use metric names of
+// their own.
+const MetricsSnapshot::HistogramValue* FindHistogram(
+    const MetricsSnapshot& snapshot, absl::string_view name) {
+  for (const auto& histogram : snapshot.histograms) {
+    if (histogram.name == name) return &histogram;
+  }
+  return nullptr;
+}
+
+TEST(HistogramTest, EmptyHistogramIsAllZeros) {
+  Histogram histogram;
+  HistogramSnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 0);
+  EXPECT_EQ(snapshot.min, 0);
+  EXPECT_EQ(snapshot.max, 0);
+  EXPECT_EQ(snapshot.Mean(), 0);
+  EXPECT_EQ(snapshot.Percentile(50), 0);
+}
+
+TEST(HistogramTest, SmallValuesAreExact) {
+  Histogram histogram;
+  for (int i = 0; i < 16; ++i) histogram.Record(i);
+  HistogramSnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 16);
+  EXPECT_EQ(snapshot.sum, 120);
+  EXPECT_EQ(snapshot.min, 0);
+  EXPECT_EQ(snapshot.max, 15);
+  EXPECT_EQ(snapshot.buckets.size(), 16);
+  EXPECT_EQ(snapshot.Percentile(50), 7);
+}
+
+TEST(HistogramTest, PercentilesAreWithinBucketPrecision) {
+  Histogram histogram;
+  for (std::int64_t i = 1; i <= 1000; ++i) histogram.Record(i * 1000);
+  HistogramSnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 1000);
+  EXPECT_EQ(snapshot.min, 1000);
+  EXPECT_EQ(snapshot.max, 1000000);
+  EXPECT_DOUBLE_EQ(snapshot.Mean(), 500500);
+  EXPECT_NEAR(snapshot.Percentile(50), 500000, 500000 / 16);
+  EXPECT_NEAR(snapshot.Percentile(99), 990000, 990000 / 16);
+  EXPECT_EQ(snapshot.Percentile(100), 1000000);
+}
+
+TEST(HistogramTest, ClampsOutOfRangeValues) {
+  Histogram histogram;
+  histogram.Record(-5);
+  histogram.Record(std::int64_t{1} << 60);
+  HistogramSnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 2);
+  EXPECT_EQ(snapshot.min, 0);
+  EXPECT_EQ(snapshot.max, std::int64_t{1} << 60);
+  EXPECT_EQ(snapshot.Percentile(100), std::int64_t{1} << 60);
+}
+
+TEST(HistogramTest, CountsConcurrentRecords) {
+  Histogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram]() {
+      for (int i = 0; i < 10000; ++i) histogram.Record(i);
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  HistogramSnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 40000);
+  EXPECT_EQ(snapshot.max, 9999);
+}
+
+TEST(MetricsRegistryTest, ReturnsSameMetricForSameLabels) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  std::shared_ptr<Counter> counter =
+      registry.GetCounter("test/same", {{"a", "1"}, {"b", "2"}});
+  counter->Increment(3);
+  EXPECT_EQ(registry.GetCounter("test/same", {{"b", "2"}, {"a", "1"}}),
+            counter);
+  EXPECT_NE(registry.GetCounter("test/same", {{"a", "1"}}), counter);
+}
+
+TEST(MetricsRegistryTest, SnapshotHasMetrics) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  registry.GetHistogram("test/snapshot", {{"medium", "BLE"}})->Record(42);
+
+  MetricsSnapshot snapshot = registry.GetSnapshot();
+  const MetricsSnapshot::HistogramValue* histogram =
+      FindHistogram(snapshot, "test/snapshot");
+  ASSERT_NE(histogram, nullptr);
+  EXPECT_EQ(histogram->labels, (MetricLabels{{"medium", "BLE"}}));
+  EXPECT_EQ(histogram->value.count, 1);
+  EXPECT_EQ(histogram->value.max, 42);
+  EXPECT_THAT(registry.Dump(),
+              HasSubstr("test/snapshot{medium=BLE}: count=1 mean=42"));
+}
+
+TEST(MetricsRegistryTest, RemovesMetricsByLabels) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  std::shared_ptr<Histogram> removed = registry.GetHistogram(
+      "test/remove", {{"endpoint_id", "ABCD"}, {"medium", "BLE"}});
+  registry.GetHistogram("test/remove", {{"medium", "BLE"}});
+
+  registry.RemoveMetrics({{"endpoint_id", "ABCD"}});
+  removed->Record(1);
+
+  int count = 0;
+  for (const auto& histogram : registry.GetSnapshot().histograms) {
+    if (histogram.name != "test/remove") continue;
+    EXPECT_EQ(histogram.labels, (MetricLabels{{"medium", "BLE"}}));
+    ++count;
+  }
+  EXPECT_EQ(count, 1);
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
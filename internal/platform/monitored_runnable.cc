@@ -14,8 +14,9 @@
 
 #include "internal/platform/monitored_runnable.h"
 
+#include <utility>
+
 #include "internal/platform/logging.h"
-#include "internal/platform/pending_job_registry.h"
 
 namespace location {
 namespace nearby {
@@ -26,15 +27,26 @@ absl::Duration kMinReportedTaskDuration = absl::Seconds(10);
 }  // namespace
 
 MonitoredRunnable::MonitoredRunnable(Runnable&& runnable)
-    : runnable_{runnable} {}
+    : runnable_{std::move(runnable)} {}
 
 MonitoredRunnable::MonitoredRunnable(const std::string& name,
                                      Runnable&& runnable)
-    : name_{name}, runnable_{runnable} {
-  PendingJobRegistry::GetInstance().AddPendingJob(name_, post_time_);
-}
+    : name_{name},
+      runnable_{std::move(runnable)},
+      job_{PendingJobRegistry::GetInstance().AddPendingJob(name_,
+                                                           post_time_)} {}
+
+MonitoredRunnable::MonitoredRunnable(MonitoredRunnable&& other)
+    : name_{std::move(other.name_)},
+      runnable_{std::move(other.runnable_)},
+      post_time_{other.post_time_},
+      job_{std::exchange(other.job_, PendingJobRegistry::kUntracked)} {}
 
-MonitoredRunnable::~MonitoredRunnable() = default;
+MonitoredRunnable::~MonitoredRunnable() {
+  if (job_ != PendingJobRegistry::kUntracked) {
+    PendingJobRegistry::GetInstance().RemovePendingJob(job_);
+  }
+}
 
 void MonitoredRunnable::operator()() const {
   auto start_time = SystemClock::ElapsedRealtime();
@@ -43,16 +55,17 @@ void MonitoredRunnable::operator()() const {
     NEARBY_LOGS(INFO) << "Task: \"" << name_ << "\" started after "
                       << absl::ToInt64Seconds(start_delay) << " seconds";
   }
-  PendingJobRegistry::GetInstance().RemovePendingJob(name_, post_time_);
-  PendingJobRegistry::GetInstance().AddRunningJob(name_, post_time_);
+  PendingJobRegistry& registry = PendingJobRegistry::GetInstance();
+  registry.AddRunningJob(job_, start_time);
   runnable_();
-  auto task_duration = SystemClock::ElapsedRealtime() - start_time;
+  auto end_time = SystemClock::ElapsedRealtime();
+  auto task_duration = end_time - start_time;
   if (task_duration >= kMinReportedTaskDuration) {
     NEARBY_LOGS(INFO) << "Task: \"" << name_ << "\" finished after "
                       << absl::ToInt64Seconds(task_duration) << " seconds";
   }
-  PendingJobRegistry::GetInstance().RemoveRunningJob(name_, post_time_);
-  PendingJobRegistry::GetInstance().ListJobs();
+  registry.RemoveRunningJob(job_);
+  registry.ListJobs(end_time);
 }
 
 }  // namespace nearby
@@ -18,6 +18,7 @@
 #include <string>
 
 #include "absl/time/time.h"
+#include "internal/platform/pending_job_registry.h"
 #include "internal/platform/runnable.h"
 #include "internal/platform/system_clock.h"
 
@@ -32,14 +33,20 @@ class MonitoredRunnable {
  public:
   explicit MonitoredRunnable(Runnable&& runnable);
   MonitoredRunnable(const std::string& name, Runnable&& runnable);
+  MonitoredRunnable(const MonitoredRunnable&) = default;
+  // Takes over the job in the PendingJobRegistry.
+  MonitoredRunnable(MonitoredRunnable&& other);
+  // Drops the job from the PendingJobRegistry if it never ran, e.g. because
+  // its executor was shut down.
   ~MonitoredRunnable();
 
   void operator()() const;
 
  private:
-  const std::string name_;
+  std::string name_;
   Runnable runnable_;
   absl::Time post_time_ = SystemClock::ElapsedRealtime();
+  PendingJobRegistry::JobId job_ = PendingJobRegistry::kUntracked;
 };
 
 }  // namespace nearby
@@ -0,0 +1,34 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/output_stream.h"
+
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+
+namespace location {
+namespace nearby {
+
+Exception OutputStream::WriteV(absl::Span<const ByteArray> data) {
+  for (const ByteArray& buffer : data) {
+    Exception exception = Write(buffer);
+    if (exception.Raised()) {
+      return exception;
+    }
+  }
+  return {Exception::kSuccess};
+}
+
+}  // namespace nearby
+}  // namespace location
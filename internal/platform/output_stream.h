@@ -15,6 +15,7 @@
 #ifndef PLATFORM_BASE_OUTPUT_STREAM_H_
 #define PLATFORM_BASE_OUTPUT_STREAM_H_
 
+#include "absl/types/span.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 
@@ -29,6 +30,11 @@ class OutputStream {
   virtual ~OutputStream() = default;
 
   virtual Exception Write(const ByteArray& data) = 0;  // throws Exception::kIo
+
+  // Writes all buffers, in order, as if they were a single contiguous buffer.
+  // The default implementation calls Write() once per buffer; streams that can
+  // gather several buffers into one IO operation should override it.
+  virtual Exception WriteV(absl::Span<const ByteArray> data);  // throws kIo
   virtual Exception Flush() = 0;                       // throws Exception::kIo
   virtual Exception Close() = 0;                       // throws Exception::kIo
 };
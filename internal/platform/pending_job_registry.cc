@@ -14,17 +14,57 @@
 
 #include "internal/platform/pending_job_registry.h"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
 #include "internal/platform/logging.h"
-#include "internal/platform/mutex_lock.h"
-#include "internal/platform/system_clock.h"
 
 namespace location {
 namespace nearby {
 
+constexpr PendingJobRegistry::JobId PendingJobRegistry::kUntracked;
+constexpr int PendingJobRegistry::kCapacity;
+constexpr int PendingJobRegistry::kMaxNameLength;
+constexpr int PendingJobRegistry::kNameWords;
+
 namespace {
 absl::Duration kMinReportInterval = absl::Seconds(60);
 absl::Duration kReportPendingJobsOlderThan = absl::Seconds(40);
 absl::Duration kReportRunningJobsOlderThan = absl::Seconds(60);
+
+// How many slots a thread looks at for a free one before giving up.
+constexpr int kMaxProbes = 64;
+
+// The states of a slot.
+enum : std::uint64_t {
+  kFree = 0,
+  // Being written by the thread that claimed it.
+  kClaimed = 1,
+  kPending = 2,
+  kRunning = 3,
+};
+constexpr std::uint64_t kStateMask = 3;
+
+std::uint64_t Pack(std::uint32_t generation, std::uint64_t state) {
+  return (static_cast<std::uint64_t>(generation) << 2) | state;
+}
+
+std::uint32_t GetGeneration(PendingJobRegistry::JobId job) {
+  return static_cast<std::uint32_t>(job >> 16);
+}
+
+int GetIndex(PendingJobRegistry::JobId job) { return job & 0xffff; }
+
+// Where the calling thread starts looking for a free slot. Threads start far
+// apart, and move on past the slots they take.
+int& GetCursor() {
+  static std::atomic<int> threads{0};
+  thread_local int cursor =
+      (threads.fetch_add(1, std::memory_order_relaxed) * 257) %
+      PendingJobRegistry::kCapacity;
+  return cursor;
+}
 }  // namespace
 
 PendingJobRegistry& PendingJobRegistry::GetInstance() {
@@ -36,55 +76,129 @@ PendingJobRegistry::PendingJobRegistry() = default;
 
 PendingJobRegistry::~PendingJobRegistry() = default;
 
-void PendingJobRegistry::AddPendingJob(const std::string& name,
-                                       absl::Time post_time) {
-  MutexLock lock(&mutex_);
-  pending_jobs_.emplace(CreateKey(name, post_time), post_time);
+PendingJobRegistry::JobId PendingJobRegistry::AddPendingJob(
+    absl::string_view name, absl::Time post_time) {
+  int& cursor = GetCursor();
+  for (int probe = 0; probe < kMaxProbes; ++probe) {
+    const int index = (cursor + probe) % kCapacity;
+    Slot& slot = slots_[index];
+    std::uint64_t state = slot.state.load(std::memory_order_relaxed);
+    if ((state & kStateMask) != kFree) continue;
+    const std::uint32_t generation = static_cast<std::uint32_t>(state >> 2) + 1;
+    if (!slot.state.compare_exchange_strong(state, Pack(generation, kClaimed),
+                                            std::memory_order_acquire)) {
+      continue;
+    }
+
+    slot.post_nanos.store(absl::ToUnixNanos(post_time),
+                          std::memory_order_relaxed);
+    char buffer[kMaxNameLength] = {};
+    std::memcpy(buffer, name.data(),
+                std::min<std::size_t>(name.size(), kMaxNameLength));
+    for (int i = 0; i < kNameWords; ++i) {
+      std::uint64_t word;
+      std::memcpy(&word, buffer + i * sizeof(word), sizeof(word));
+      slot.name[i].store(word, std::memory_order_relaxed);
+    }
+    slot.state.store(Pack(generation, kPending), std::memory_order_release);
+
+    cursor = (index + 1) % kCapacity;
+    return (static_cast<JobId>(generation) << 16) | index;
+  }
+  return kUntracked;
 }
 
-void PendingJobRegistry::RemovePendingJob(const std::string& name,
-                                          absl::Time post_time) {
-  MutexLock lock(&mutex_);
-  pending_jobs_.erase(CreateKey(name, post_time));
+void PendingJobRegistry::RemovePendingJob(JobId job) {
+  Transition(job, kPending, kFree);
 }
 
-void PendingJobRegistry::AddRunningJob(const std::string& name,
-                                       absl::Time post_time) {
-  MutexLock lock(&mutex_);
-  running_jobs_.emplace(CreateKey(name, post_time),
-                        SystemClock::ElapsedRealtime());
+void PendingJobRegistry::AddRunningJob(JobId job, absl::Time start_time) {
+  if (!Transition(job, kPending, kClaimed)) return;
+  Slot& slot = slots_[GetIndex(job)];
+  slot.start_nanos.store(absl::ToUnixNanos(start_time),
+                         std::memory_order_relaxed);
+  slot.state.store(Pack(GetGeneration(job), kRunning),
+                   std::memory_order_release);
 }
 
-void PendingJobRegistry::RemoveRunningJob(const std::string& name,
-                                          absl::Time post_time) {
-  MutexLock lock(&mutex_);
-  running_jobs_.erase(CreateKey(name, post_time));
+void PendingJobRegistry::RemoveRunningJob(JobId job) {
+  Transition(job, kRunning, kFree);
 }
 
-void PendingJobRegistry::ListJobs() {
-  auto current_time = SystemClock::ElapsedRealtime();
-  MutexLock lock(&mutex_);
-  if (current_time - list_jobs_time_ < kMinReportInterval) return;
-  for (auto& job : pending_jobs_) {
-    auto age = current_time - job.second;
-    if (age >= kReportPendingJobsOlderThan) {
-      NEARBY_LOGS(INFO) << "Task \"" << job.first << "\" is waiting for "
-                        << absl::ToInt64Seconds(age) << " s";
-    }
+void PendingJobRegistry::ListJobs(absl::Time now) {
+  const std::int64_t now_nanos = absl::ToUnixNanos(now);
+  std::int64_t report_nanos =
+      next_report_nanos_.load(std::memory_order_relaxed);
+  if (now_nanos < report_nanos) return;
+  // Only one of the threads getting here reports.
+  if (!next_report_nanos_.compare_exchange_strong(
+          report_nanos,
+          now_nanos + absl::ToInt64Nanoseconds(kMinReportInterval),
+          std::memory_order_relaxed)) {
+    return;
   }
-  for (auto& job : running_jobs_) {
-    auto age = current_time - job.second;
-    if (age >= kReportRunningJobsOlderThan) {
-      NEARBY_LOGS(INFO) << "Task \"" << job.first << "\" is running for "
-                        << absl::ToInt64Seconds(age) << " s";
+  for (const Job& job : GetJobs()) {
+    if (job.start_time.has_value()) {
+      auto age = now - *job.start_time;
+      if (age >= kReportRunningJobsOlderThan) {
+        NEARBY_LOGS(INFO) << "Task \"" << job.name << "\" is running for "
+                          << absl::ToInt64Seconds(age) << " s";
+      }
+    } else {
+      auto age = now - job.post_time;
+      if (age >= kReportPendingJobsOlderThan) {
+        NEARBY_LOGS(INFO) << "Task \"" << job.name << "\" is waiting for "
+                          << absl::ToInt64Seconds(age) << " s";
+      }
     }
   }
-  list_jobs_time_ = current_time;
 }
 
-std::string PendingJobRegistry::CreateKey(const std::string& name,
-                                          absl::Time post_time) {
-  return name + "." + std::to_string(absl::ToUnixNanos(post_time));
+std::vector<PendingJobRegistry::Job> PendingJobRegistry::GetJobs() const {
+  std::vector<Job> jobs;
+  for (const Slot& slot : slots_) {
+    absl::optional<Job> job = ReadSlot(slot);
+    if (job.has_value()) jobs.push_back(std::move(*job));
+  }
+  return jobs;
+}
+
+bool PendingJobRegistry::Transition(JobId job, int from, int to) {
+  if (job == kUntracked) return false;
+  std::uint64_t expected = Pack(GetGeneration(job), from);
+  return slots_[GetIndex(job)].state.compare_exchange_strong(
+      expected, Pack(GetGeneration(job), to), std::memory_order_acq_rel);
+}
+
+absl::optional<PendingJobRegistry::Job> PendingJobRegistry::ReadSlot(
+    const Slot& slot) const {
+  const std::uint64_t state = slot.state.load(std::memory_order_acquire);
+  if ((state & kStateMask) != kPending && (state & kStateMask) != kRunning) {
+    return absl::nullopt;
+  }
+  const std::int64_t post_nanos =
+      slot.post_nanos.load(std::memory_order_relaxed);
+  const std::int64_t start_nanos =
+      slot.start_nanos.load(std::memory_order_relaxed);
+  char buffer[kMaxNameLength];
+  for (int i = 0; i < kNameWords; ++i) {
+    const std::uint64_t word = slot.name[i].load(std::memory_order_relaxed);
+    std::memcpy(buffer + i * sizeof(word), &word, sizeof(word));
+  }
+  // The fields belong to the job read above only if the slot hasn't moved on
+  // meanwhile.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.state.load(std::memory_order_relaxed) != state) {
+    return absl::nullopt;
+  }
+
+  Job job;
+  job.name.assign(buffer, strnlen(buffer, kMaxNameLength));
+  job.post_time = absl::FromUnixNanos(post_nanos);
+  if ((state & kStateMask) == kRunning) {
+    job.start_time = absl::FromUnixNanos(start_nanos);
+  }
+  return job;
 }
 
 }  // namespace nearby
@@ -15,38 +15,87 @@
 #ifndef PLATFORM_PUBLIC_PENDING_JOB_REGISTRY_H_
 #define PLATFORM_PUBLIC_PENDING_JOB_REGISTRY_H_
 
-#include "absl/base/thread_annotations.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
-#include "internal/platform/mutex.h"
+#include "absl/types/optional.h"
 
 namespace location {
 namespace nearby {
 
 // A global registry of running tasks. The goal is to help us monitor
 // tasks that are either waiting too long for their turn or they never finish
+//
+// Every task posted to an executor goes through here, so jobs live in a fixed
+// array of slots that threads claim and release with atomics alone: posting,
+// starting and finishing a job neither lock nor allocate. Each thread starts
+// looking for a free slot where it found its last one, so threads posting
+// concurrently mostly stay out of each other's way. Jobs that find no free
+// slot nearby go untracked.
 class PendingJobRegistry {
  public:
+  // Identifies a job; only valid until the job is removed.
+  using JobId = std::int64_t;
+  static constexpr JobId kUntracked = -1;
+
+  static constexpr int kCapacity = 2048;
+  // Longer job names are truncated.
+  static constexpr int kMaxNameLength = 32;
+
+  struct Job {
+    std::string name;
+    absl::Time post_time;
+    // Set once the job is running.
+    absl::optional<absl::Time> start_time;
+  };
+
   static PendingJobRegistry& GetInstance();
 
   ~PendingJobRegistry();
 
-  void AddPendingJob(const std::string& name, absl::Time post_time);
-  void RemovePendingJob(const std::string& name, absl::Time post_time);
-  void AddRunningJob(const std::string& name, absl::Time post_time);
-  void RemoveRunningJob(const std::string& name, absl::Time post_time);
-  void ListJobs();
+  JobId AddPendingJob(absl::string_view name, absl::Time post_time);
+  // Only removes the job if it hasn't started running.
+  void RemovePendingJob(JobId job);
+  // Moves a pending job to the running ones.
+  void AddRunningJob(JobId job, absl::Time start_time);
+  void RemoveRunningJob(JobId job);
+
+  // Logs the jobs that have been waiting or running for too long, at most once
+  // a minute; in between, costs a single atomic load.
+  void ListJobs(absl::Time now);
+
+  // Returns the jobs pending or running right now.
+  std::vector<Job> GetJobs() const;
 
  private:
+  static constexpr int kNameWords = kMaxNameLength / sizeof(std::uint64_t);
+
+  // One cache line, so that threads working on neighbouring slots don't
+  // contend. |state| packs a generation, bumped whenever the slot is claimed,
+  // with one of the states below; readers check it's unchanged after reading
+  // the other fields.
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> state{0};
+    std::atomic<std::int64_t> post_nanos{0};
+    std::atomic<std::int64_t> start_nanos{0};
+    std::array<std::atomic<std::uint64_t>, kNameWords> name{};
+  };
+
   PendingJobRegistry();
 
-  std::string CreateKey(const std::string& name, absl::Time post_time);
+  // Moves |job| from |from| to |to|, if it's still in the state and
+  // generation it names.
+  bool Transition(JobId job, int from, int to);
+  // Reads the job in |slot|, if there's one.
+  absl::optional<Job> ReadSlot(const Slot& slot) const;
 
-  Mutex mutex_;
-  absl::flat_hash_map<const std::string, absl::Time> pending_jobs_
-      ABSL_GUARDED_BY(mutex_);
-  absl::flat_hash_map<const std::string, absl::Time> running_jobs_
-      ABSL_GUARDED_BY(mutex_);
-  absl::Time list_jobs_time_ ABSL_GUARDED_BY(mutex_) = absl::UnixEpoch();
+  std::array<Slot, kCapacity> slots_;
+  std::atomic<std::int64_t> next_report_nanos_{0};
 };
 
 }  // namespace nearby
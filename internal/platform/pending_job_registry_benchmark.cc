@@ -0,0 +1,121 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures what monitoring costs each task. Run with:
+//   bazel run -c opt //internal/platform:pending_job_registry_benchmark
+//
+// BM_MonitoredRunnable posts and runs one named task on each thread; the time
+// per iteration is the registry's overhead per task. BM_LockedMapRegistry does
+// the same with the registry's previous design, one mutex around two maps
+// keyed by "name.nanos" strings, as a baseline. BM_ExecutorDispatch is the
+// end-to-end cost of a named task on a SingleThreadExecutor.
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/monitored_runnable.h"
+#include "internal/platform/single_thread_executor.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+void BM_MonitoredRunnable(benchmark::State& state) {
+  int runs = 0;
+  for (auto _ : state) {
+    MonitoredRunnable runnable("benchmark", [&runs]() { ++runs; });
+    runnable();
+  }
+  benchmark::DoNotOptimize(runs);
+}
+BENCHMARK(BM_MonitoredRunnable)->ThreadRange(1, 8)->UseRealTime();
+
+// The registry as it was: every step takes the one lock, and builds a key.
+class LockedMapRegistry {
+ public:
+  void AddPendingJob(const std::string& name, absl::Time post_time) {
+    absl::MutexLock lock(&mutex_);
+    pending_jobs_.emplace(CreateKey(name, post_time), post_time);
+  }
+  void RemovePendingJob(const std::string& name, absl::Time post_time) {
+    absl::MutexLock lock(&mutex_);
+    pending_jobs_.erase(CreateKey(name, post_time));
+  }
+  void AddRunningJob(const std::string& name, absl::Time post_time) {
+    absl::MutexLock lock(&mutex_);
+    running_jobs_.emplace(CreateKey(name, post_time), absl::Now());
+  }
+  void RemoveRunningJob(const std::string& name, absl::Time post_time) {
+    absl::MutexLock lock(&mutex_);
+    running_jobs_.erase(CreateKey(name, post_time));
+  }
+  void ListJobs() {
+    auto current_time = absl::Now();
+    absl::MutexLock lock(&mutex_);
+    if (current_time - list_jobs_time_ < absl::Seconds(60)) return;
+    list_jobs_time_ = current_time;
+  }
+
+ private:
+  static std::string CreateKey(const std::string& name, absl::Time post_time) {
+    return name + "." + std::to_string(absl::ToUnixNanos(post_time));
+  }
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, absl::Time> pending_jobs_;
+  absl::flat_hash_map<std::string, absl::Time> running_jobs_;
+  absl::Time list_jobs_time_ = absl::UnixEpoch();
+};
+
+void BM_LockedMapRegistry(benchmark::State& state) {
+  static LockedMapRegistry* registry = new LockedMapRegistry();
+  const std::string name = "benchmark";
+  int runs = 0;
+  for (auto _ : state) {
+    const absl::Time post_time = absl::Now();
+    registry->AddPendingJob(name, post_time);
+    absl::Time start_time = absl::Now();
+    registry->RemovePendingJob(name, post_time);
+    registry->AddRunningJob(name, post_time);
+    ++runs;
+    benchmark::DoNotOptimize(absl::Now() - start_time);
+    registry->RemoveRunningJob(name, post_time);
+    registry->ListJobs();
+  }
+  benchmark::DoNotOptimize(runs);
+}
+BENCHMARK(BM_LockedMapRegistry)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_ExecutorDispatch(benchmark::State& state) {
+  constexpr int kTasks = 1000;
+  SingleThreadExecutor executor;
+  for (auto _ : state) {
+    CountDownLatch latch(kTasks);
+    for (int i = 0; i < kTasks; ++i) {
+      executor.Execute("benchmark", [latch]() mutable { latch.CountDown(); });
+    }
+    latch.Await();
+  }
+  state.SetItemsProcessed(state.iterations() * kTasks);
+}
+BENCHMARK(BM_ExecutorDispatch)->UseRealTime();
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
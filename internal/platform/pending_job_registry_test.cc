@@ -0,0 +1,146 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/pending_job_registry.h"
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/types/optional.h"
+#include "internal/platform/monitored_runnable.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+// The registry is shared by the whole process, so tests look for their own
+// jobs by name.
+std::vector<PendingJobRegistry::Job> GetJobs(absl::string_view name) {
+  std::vector<PendingJobRegistry::Job> jobs;
+  for (PendingJobRegistry::Job& job :
+       PendingJobRegistry::GetInstance().GetJobs()) {
+    if (job.name == name) jobs.push_back(std::move(job));
+  }
+  return jobs;
+}
+
+TEST(PendingJobRegistryTest, TracksJobUntilItFinishes) {
+  PendingJobRegistry& registry = PendingJobRegistry::GetInstance();
+  const absl::Time post_time = absl::FromUnixSeconds(1000);
+  const absl::Time start_time = absl::FromUnixSeconds(1001);
+
+  PendingJobRegistry::JobId job = registry.AddPendingJob("lifetime", post_time);
+  ASSERT_NE(job, PendingJobRegistry::kUntracked);
+  std::vector<PendingJobRegistry::Job> jobs = GetJobs("lifetime");
+  ASSERT_EQ(jobs.size(), 1);
+  EXPECT_EQ(jobs[0].post_time, post_time);
+  EXPECT_FALSE(jobs[0].start_time.has_value());
+
+  registry.AddRunningJob(job, start_time);
+  jobs = GetJobs("lifetime");
+  ASSERT_EQ(jobs.size(), 1);
+  EXPECT_EQ(jobs[0].start_time, start_time);
+
+  registry.RemoveRunningJob(job);
+  EXPECT_TRUE(GetJobs("lifetime").empty());
+}
+
+TEST(PendingJobRegistryTest, RemovePendingJobKeepsRunningJob) {
+  PendingJobRegistry& registry = PendingJobRegistry::GetInstance();
+  PendingJobRegistry::JobId job =
+      registry.AddPendingJob("running", absl::Now());
+  registry.AddRunningJob(job, absl::Now());
+
+  registry.RemovePendingJob(job);
+  EXPECT_EQ(GetJobs("running").size(), 1);
+
+  registry.RemoveRunningJob(job);
+  EXPECT_TRUE(GetJobs("running").empty());
+}
+
+TEST(PendingJobRegistryTest, IgnoresRemovedJob) {
+  PendingJobRegistry& registry = PendingJobRegistry::GetInstance();
+  PendingJobRegistry::JobId removed =
+      registry.AddPendingJob("removed", absl::Now());
+  registry.RemovePendingJob(removed);
+  // Likely gets the slot |removed| had.
+  PendingJobRegistry::JobId job = registry.AddPendingJob("reused", absl::Now());
+
+  registry.AddRunningJob(removed, absl::Now());
+  registry.RemovePendingJob(removed);
+  std::vector<PendingJobRegistry::Job> jobs = GetJobs("reused");
+  ASSERT_EQ(jobs.size(), 1);
+  EXPECT_FALSE(jobs[0].start_time.has_value());
+
+  registry.RemovePendingJob(job);
+}
+
+TEST(PendingJobRegistryTest, TruncatesLongNames) {
+  PendingJobRegistry& registry = PendingJobRegistry::GetInstance();
+  const std::string name(PendingJobRegistry::kMaxNameLength + 10, 'x');
+  PendingJobRegistry::JobId job = registry.AddPendingJob(name, absl::Now());
+
+  EXPECT_EQ(
+      GetJobs(name.substr(0, PendingJobRegistry::kMaxNameLength)).size(), 1);
+  registry.RemovePendingJob(job);
+}
+
+TEST(PendingJobRegistryTest, TracksJobsOfConcurrentThreads) {
+  constexpr int kThreads = 8;
+  constexpr int kJobsPerThread = 1000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([i]() {
+      PendingJobRegistry& registry = PendingJobRegistry::GetInstance();
+      const std::string name = absl::StrCat("concurrent-", i);
+      for (int j = 0; j < kJobsPerThread; ++j) {
+        PendingJobRegistry::JobId job =
+            registry.AddPendingJob(name, absl::Now());
+        EXPECT_EQ(GetJobs(name).size(), 1);
+        registry.AddRunningJob(job, absl::Now());
+        registry.RemoveRunningJob(job);
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  for (int i = 0; i < kThreads; ++i) {
+    EXPECT_TRUE(GetJobs(absl::StrCat("concurrent-", i)).empty());
+  }
+}
+
+TEST(PendingJobRegistryTest, MonitoredRunnableRemovesItsJob) {
+  bool ran = false;
+  {
+    MonitoredRunnable runnable("monitored", [&ran]() { ran = true; });
+    EXPECT_EQ(GetJobs("monitored").size(), 1);
+    MonitoredRunnable moved(std::move(runnable));
+    moved();
+    EXPECT_TRUE(GetJobs("monitored").empty());
+  }
+  EXPECT_TRUE(ran);
+
+  // A runnable that never runs doesn't stay behind either.
+  { MonitoredRunnable runnable("dropped", []() {}); }
+  EXPECT_TRUE(GetJobs("dropped").empty());
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
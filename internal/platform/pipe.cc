@@ -31,5 +31,15 @@ Pipe::Pipe() {
   Setup(std::move(mutex), std::move(cond));
 }
 
+Pipe::Pipe(Mode mode, size_t ring_capacity) {
+  auto mutex = Platform::CreateMutex(api::Mutex::Mode::kRegular);
+  auto cond = Platform::CreateConditionVariable(mutex.get());
+  if (mode == Mode::kSpscRing) {
+    Setup(std::move(mutex), std::move(cond), ring_capacity);
+  } else {
+    Setup(std::move(mutex), std::move(cond));
+  }
+}
+
 }  // namespace nearby
 }  // namespace location
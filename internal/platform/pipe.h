@@ -25,6 +25,9 @@ namespace nearby {
 class Pipe final : public BasePipe {
  public:
   Pipe();
+  // Mode::kSpscRing pipes buffer up to |ring_capacity| bytes, rounded up to a
+  // power of two.
+  explicit Pipe(Mode mode, size_t ring_capacity = kDefaultRingCapacity);
   ~Pipe() override = default;
   Pipe(Pipe&&) = delete;
   Pipe& operator=(Pipe&&) = delete;
@@ -0,0 +1,104 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the Pipe modes. Run with:
+//   bazel run -c opt //internal/platform:pipe_benchmark
+//
+// BM_PipeThroughput streams data from a writer thread to a reader thread;
+// bytes_per_second is the throughput. BM_PipeRoundTrip bounces one chunk
+// between two threads over a pair of pipes; the time per iteration is the
+// round-trip latency of two pipe hand-offs.
+
+#include <cstdint>
+#include <thread>  // NOLINT
+
+#include "benchmark/benchmark.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/pipe.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+constexpr std::int64_t kBytesPerIteration = 16 * 1024 * 1024;
+
+Pipe::Mode GetMode(const benchmark::State& state) {
+  return state.range(0) ? Pipe::Mode::kSpscRing : Pipe::Mode::kChunkQueue;
+}
+
+void BM_PipeThroughput(benchmark::State& state) {
+  const std::int64_t chunk_size = state.range(1);
+  const ByteArray chunk(chunk_size);
+  for (auto _ : state) {
+    Pipe pipe(GetMode(state));
+    std::thread writer([&pipe, &chunk, chunk_size]() {
+      OutputStream& output_stream = pipe.GetOutputStream();
+      for (std::int64_t written = 0; written < kBytesPerIteration;
+           written += chunk_size) {
+        output_stream.Write(chunk);
+      }
+      output_stream.Close();
+    });
+    InputStream& input_stream = pipe.GetInputStream();
+    while (true) {
+      ExceptionOr<ByteArray> read_data = input_stream.Read(chunk_size);
+      if (!read_data.ok() || read_data.result().Empty()) break;
+      benchmark::DoNotOptimize(read_data.result().data());
+    }
+    writer.join();
+  }
+  state.SetBytesProcessed(state.iterations() * kBytesPerIteration);
+}
+BENCHMARK(BM_PipeThroughput)
+    ->ArgNames({"ring", "chunk"})
+    ->ArgsProduct({{0, 1}, {64, 1024, 64 * 1024}})
+    ->UseRealTime();
+
+// Reads exactly |size| bytes, which the ring may hand out in several pieces.
+bool ReadFully(InputStream& input_stream, std::int64_t size) {
+  while (size > 0) {
+    ExceptionOr<ByteArray> read_data = input_stream.Read(size);
+    if (!read_data.ok() || read_data.result().Empty()) return false;
+    size -= read_data.result().size();
+  }
+  return true;
+}
+
+void BM_PipeRoundTrip(benchmark::State& state) {
+  const std::int64_t chunk_size = state.range(1);
+  const ByteArray chunk(chunk_size);
+  Pipe ping(GetMode(state));
+  Pipe pong(GetMode(state));
+  std::thread echo([&ping, &pong, &chunk, chunk_size]() {
+    while (ReadFully(ping.GetInputStream(), chunk_size)) {
+      pong.GetOutputStream().Write(chunk);
+    }
+    pong.GetOutputStream().Close();
+  });
+  for (auto _ : state) {
+    ping.GetOutputStream().Write(chunk);
+    ReadFully(pong.GetInputStream(), chunk_size);
+  }
+  ping.GetOutputStream().Close();
+  echo.join();
+}
+BENCHMARK(BM_PipeRoundTrip)
+    ->ArgNames({"ring", "chunk"})
+    ->ArgsProduct({{0, 1}, {64, 4096}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
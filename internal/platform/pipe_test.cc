@@ -14,11 +14,13 @@
 
 #include "internal/platform/pipe.h"
 
+#include <poll.h>
 #include <pthread.h>
 
 #include <atomic>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "internal/platform/prng.h"
@@ -119,6 +121,27 @@ TEST(PipeTest, SizedReadLessThanFirstChunkSize) {
   EXPECT_EQ(data_second_part, std::string(second_read_data.result()));
 }
 
+TEST(PipeTest, SizedReadSharesWrittenStorage) {
+  Pipe pipe;
+  InputStream& input_stream{pipe.GetInputStream()};
+  OutputStream& output_stream{pipe.GetOutputStream()};
+
+  const ByteArray data("ABCDEFGHIJ");
+  EXPECT_TRUE(output_stream.Write(data).Ok());
+
+  // Splitting a chunk hands out views of the written bytes, not copies.
+  ExceptionOr<ByteArray> first_read_data = input_stream.Read(4);
+  EXPECT_TRUE(first_read_data.ok());
+  const ByteArray& first = first_read_data.result();
+  EXPECT_EQ(first.data(), data.data());
+
+  ExceptionOr<ByteArray> second_read_data = input_stream.Read(Pipe::kChunkSize);
+  EXPECT_TRUE(second_read_data.ok());
+  const ByteArray& second = second_read_data.result();
+  EXPECT_EQ(second.data(), data.data() + 4);
+  EXPECT_EQ(std::string(second), "EFGHIJ");
+}
+
 TEST(PipeTest, ReadAfterInputStreamClosed) {
   Pipe pipe;
   InputStream& input_stream{pipe.GetInputStream()};
@@ -181,6 +204,233 @@ class Thread {
   Runnable runnable_;
 };
 
+TEST(PipeTest, WriteVKeepsBuffersInOrder) {
+  Pipe pipe;
+  InputStream& input_stream{pipe.GetInputStream()};
+  OutputStream& output_stream{pipe.GetOutputStream()};
+
+  // Empty buffers are skipped rather than treated as end-of-stream.
+  const ByteArray buffers[] = {ByteArray("ABC"), ByteArray(), ByteArray("DEF")};
+  EXPECT_TRUE(output_stream.WriteV(buffers).Ok());
+
+  ExceptionOr<ByteArray> read_data = input_stream.Read(Pipe::kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(std::string(read_data.result()), "ABC");
+
+  read_data = input_stream.Read(Pipe::kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(std::string(read_data.result()), "DEF");
+}
+
+TEST(PipeTest, BoundedWriteBlockedUntilRead) {
+  Pipe pipe;
+  pipe.SetMaxBufferedBytes(4);
+  InputStream& input_stream{pipe.GetInputStream()};
+  OutputStream& output_stream{pipe.GetOutputStream()};
+  EXPECT_TRUE(output_stream.Write(ByteArray("ABC")).Ok());
+
+  std::atomic_bool written = false;
+  Thread writer_thread;
+  writer_thread.Start([&output_stream, &written]() {
+    EXPECT_TRUE(output_stream.Write(ByteArray("DEF")).Ok());
+    written = true;
+  });
+  absl::SleepFor(absl::Milliseconds(200));
+  EXPECT_FALSE(written);
+
+  ExceptionOr<ByteArray> read_data = input_stream.Read(Pipe::kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(std::string(read_data.result()), "ABC");
+  writer_thread.Join();
+  EXPECT_TRUE(written);
+  read_data = input_stream.Read(Pipe::kChunkSize);
+  EXPECT_EQ(std::string(read_data.result()), "DEF");
+}
+
+TEST(PipeTest, BoundedWriteUnblockedByClose) {
+  Pipe pipe;
+  pipe.SetMaxBufferedBytes(4);
+  OutputStream& output_stream{pipe.GetOutputStream()};
+  EXPECT_TRUE(output_stream.Write(ByteArray("ABC")).Ok());
+
+  Thread writer_thread;
+  writer_thread.Start([&output_stream]() {
+    EXPECT_EQ(output_stream.Write(ByteArray("DEF")), Exception{Exception::kIo});
+  });
+  absl::SleepFor(absl::Milliseconds(200));
+  pipe.GetInputStream().Close();
+  writer_thread.Join();
+}
+
+TEST(PipeTest, OversizedWriteGoesThroughWhenEmpty) {
+  Pipe pipe;
+  pipe.SetMaxBufferedBytes(2);
+
+  EXPECT_TRUE(pipe.GetOutputStream().Write(ByteArray("ABCD")).Ok());
+  ExceptionOr<ByteArray> read_data = pipe.GetInputStream().Read(2);
+  EXPECT_EQ(std::string(read_data.result()), "AB");
+}
+
+TEST(PipeTest, BackpressureListenerFollowsWatermarks) {
+  Pipe pipe;
+  std::vector<bool> events;
+  pipe.SetBackpressureListener(
+      /*high_watermark=*/6, /*low_watermark=*/2,
+      [&events](bool backed_up) { events.push_back(backed_up); });
+  InputStream& input_stream{pipe.GetInputStream()};
+  OutputStream& output_stream{pipe.GetOutputStream()};
+
+  EXPECT_TRUE(output_stream.Write(ByteArray("ABC")).Ok());
+  EXPECT_TRUE(events.empty());
+  EXPECT_TRUE(output_stream.Write(ByteArray("DEF")).Ok());
+  EXPECT_TRUE(output_stream.Write(ByteArray("GHI")).Ok());
+  EXPECT_EQ(events, std::vector<bool>{true});
+
+  EXPECT_TRUE(input_stream.Read(3).ok());
+  EXPECT_TRUE(input_stream.Read(3).ok());
+  EXPECT_EQ(events, std::vector<bool>{true});
+  EXPECT_TRUE(input_stream.Read(1).ok());
+  EXPECT_EQ(events, (std::vector<bool>{true, false}));
+}
+
+TEST(PipeTest, SpscRingWriteRead) {
+  Pipe pipe(Pipe::Mode::kSpscRing, /*ring_capacity=*/8);
+  InputStream& input_stream{pipe.GetInputStream()};
+  OutputStream& output_stream{pipe.GetOutputStream()};
+  EXPECT_EQ(pipe.GetMode(), Pipe::Mode::kSpscRing);
+
+  // Enough rounds to wrap around the ring a few times.
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(output_stream.Write(ByteArray("ABCDE")).Ok());
+    ExceptionOr<ByteArray> read_data = input_stream.Read(3);
+    EXPECT_EQ(std::string(read_data.result()), "ABC");
+    read_data = input_stream.Read(Pipe::kChunkSize);
+    EXPECT_EQ(std::string(read_data.result()), "DE");
+  }
+}
+
+TEST(PipeTest, SpscRingReadsToEndAfterClose) {
+  Pipe pipe(Pipe::Mode::kSpscRing, /*ring_capacity=*/8);
+  InputStream& input_stream{pipe.GetInputStream()};
+  OutputStream& output_stream{pipe.GetOutputStream()};
+
+  EXPECT_TRUE(output_stream.WriteV({ByteArray("AB"), ByteArray("CD")}).Ok());
+  EXPECT_TRUE(output_stream.Close().Ok());
+  EXPECT_EQ(output_stream.Write(ByteArray("EF")), Exception{Exception::kIo});
+
+  ExceptionOr<ByteArray> read_data = input_stream.Read(Pipe::kChunkSize);
+  EXPECT_EQ(std::string(read_data.result()), "ABCD");
+  read_data = input_stream.Read(Pipe::kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_TRUE(read_data.result().Empty());
+  read_data = input_stream.Read(Pipe::kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_TRUE(read_data.result().Empty());
+}
+
+TEST(PipeTest, SpscRingWriteLargerThanRingWaitsForReader) {
+  Pipe pipe(Pipe::Mode::kSpscRing, /*ring_capacity=*/4);
+  InputStream& input_stream{pipe.GetInputStream()};
+  OutputStream& output_stream{pipe.GetOutputStream()};
+
+  std::atomic_bool written = false;
+  Thread writer_thread;
+  writer_thread.Start([&output_stream, &written]() {
+    EXPECT_TRUE(output_stream.Write(ByteArray("ABCDEFGH")).Ok());
+    written = true;
+  });
+  absl::SleepFor(absl::Milliseconds(200));
+  EXPECT_FALSE(written);
+
+  std::string data;
+  while (data.size() < 8) {
+    ExceptionOr<ByteArray> read_data = input_stream.Read(Pipe::kChunkSize);
+    ASSERT_TRUE(read_data.ok());
+    data += std::string(read_data.result());
+  }
+  writer_thread.Join();
+  EXPECT_TRUE(written);
+  EXPECT_EQ(data, "ABCDEFGH");
+}
+
+TEST(PipeTest, SpscRingWriteUnblockedByClose) {
+  Pipe pipe(Pipe::Mode::kSpscRing, /*ring_capacity=*/4);
+  OutputStream& output_stream{pipe.GetOutputStream()};
+
+  Thread writer_thread;
+  writer_thread.Start([&output_stream]() {
+    EXPECT_EQ(output_stream.Write(ByteArray("ABCDEFGH")),
+              Exception{Exception::kIo});
+  });
+  absl::SleepFor(absl::Milliseconds(200));
+  pipe.GetInputStream().Close();
+  writer_thread.Join();
+}
+
+TEST(PipeTest, SpscRingStreamsLargeTransfer) {
+  Pipe pipe(Pipe::Mode::kSpscRing, /*ring_capacity=*/1024);
+  InputStream& input_stream{pipe.GetInputStream()};
+  OutputStream& output_stream{pipe.GetOutputStream()};
+  std::string expected_data;
+  for (int i = 0; i < 1024 * 1024; ++i) expected_data += 'a' + i % 26;
+
+  Thread writer_thread;
+  writer_thread.Start([&output_stream, &expected_data]() {
+    for (size_t offset = 0; offset < expected_data.size(); offset += 3000) {
+      EXPECT_TRUE(
+          output_stream.Write(ByteArray(expected_data.substr(offset, 3000)))
+              .Ok());
+    }
+    EXPECT_TRUE(output_stream.Close().Ok());
+  });
+  std::string actual_data;
+  while (true) {
+    ExceptionOr<ByteArray> read_data = input_stream.Read(777);
+    ASSERT_TRUE(read_data.ok());
+    if (read_data.result().Empty()) break;
+    actual_data += std::string(read_data.result());
+  }
+  writer_thread.Join();
+  EXPECT_EQ(actual_data, expected_data);
+}
+
+bool IsReadable(int fd) {
+  pollfd poll_fd = {fd, POLLIN, 0};
+  return poll(&poll_fd, 1, /*timeout=*/0) == 1;
+}
+
+TEST(PipeTest, ReadinessFdFollowsBufferedData) {
+#ifndef __linux__
+  GTEST_SKIP();
+#endif
+  Pipe pipe;
+  InputStream& input_stream{pipe.GetInputStream()};
+  OutputStream& output_stream{pipe.GetOutputStream()};
+  const int fd = input_stream.GetReadinessFd();
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(input_stream.GetReadinessFd(), fd);
+  EXPECT_FALSE(IsReadable(fd));
+
+  EXPECT_TRUE(output_stream.Write(ByteArray("ABCD")).Ok());
+  EXPECT_TRUE(IsReadable(fd));
+  EXPECT_EQ(std::string(input_stream.Read(2).result()), "AB");
+  EXPECT_TRUE(IsReadable(fd));
+  EXPECT_EQ(std::string(input_stream.Read(2).result()), "CD");
+  EXPECT_FALSE(IsReadable(fd));
+
+  // The end of the stream is there to read too.
+  output_stream.Close();
+  EXPECT_TRUE(IsReadable(fd));
+  EXPECT_TRUE(input_stream.Read(2).result().Empty());
+  EXPECT_TRUE(IsReadable(fd));
+}
+
+TEST(PipeTest, SpscRingHasNoReadinessFd) {
+  Pipe pipe(Pipe::Mode::kSpscRing);
+
+  EXPECT_EQ(pipe.GetInputStream().GetReadinessFd(), -1);
+}
+
 TEST(PipeTest, ReadBlockedUntilWrite) {
   using CrossThreadBool = std::atomic_bool;
 
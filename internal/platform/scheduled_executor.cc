@@ -0,0 +1,151 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/scheduled_executor.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "internal/platform/timer_wheel.h"
+
+namespace location {
+namespace nearby {
+
+// Keeps track of the timers of an executor, so that they can be dropped when
+// it shuts down, and hands their tasks over to it as they become due.
+class ScheduledExecutor::Dispatcher
+    : public std::enable_shared_from_this<Dispatcher> {
+ public:
+  explicit Dispatcher(api::ScheduledExecutor* executor)
+      : executor_(executor) {}
+
+  std::shared_ptr<api::Cancelable> Schedule(Runnable&& runnable,
+                                            absl::Duration delay)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    auto task = std::make_shared<Task>(weak_from_this(), std::move(runnable));
+    MutexLock lock(&mutex_);
+    if (executor_ == nullptr) return task;
+    // Runs on the timer thread, which must not be held up by the task.
+    task->timer = TimerService::GetInstance().Schedule(
+        [dispatcher = weak_from_this(), task]() {
+          if (auto self = dispatcher.lock()) self->Dispatch(task);
+        },
+        delay);
+    pending_.insert(task);
+    return task;
+  }
+
+  // Drops the pending timers; tasks don't run anymore after this returns.
+  void Shutdown() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::flat_hash_set<std::shared_ptr<Task>> pending;
+    {
+      MutexLock lock(&mutex_);
+      executor_ = nullptr;
+      pending.swap(pending_);
+    }
+    for (const std::shared_ptr<Task>& task : pending) {
+      task->timer->Cancel();
+    }
+  }
+
+ private:
+  // A task waiting for its timer, or for |executor_| to run it. Like the
+  // platform's own, it can be cancelled until it starts running.
+  class Task : public api::Cancelable {
+   public:
+    Task(std::weak_ptr<Dispatcher> dispatcher, Runnable&& runnable)
+        : dispatcher_(std::move(dispatcher)), runnable_(std::move(runnable)) {}
+
+    bool Cancel() override {
+      Status expected = kNotRun;
+      if (!status_.compare_exchange_strong(expected, kCanceled)) return false;
+      if (auto dispatcher = dispatcher_.lock()) dispatcher->Forget(this);
+      return true;
+    }
+
+    void Run() {
+      Status expected = kNotRun;
+      if (status_.compare_exchange_strong(expected, kExecuted)) runnable_();
+    }
+
+    // Set once, before the timer can run.
+    std::shared_ptr<api::Cancelable> timer;
+
+   private:
+    enum Status {
+      kNotRun,
+      kExecuted,
+      kCanceled,
+    };
+
+    const std::weak_ptr<Dispatcher> dispatcher_;
+    const Runnable runnable_;
+    std::atomic<Status> status_ = kNotRun;
+  };
+
+  void Dispatch(const std::shared_ptr<Task>& task)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    if (!pending_.erase(task) || executor_ == nullptr) return;
+    executor_->Execute([task]() { task->Run(); });
+  }
+
+  void Forget(Task* task) ABSL_LOCKS_EXCLUDED(mutex_) {
+    std::shared_ptr<api::Cancelable> timer;
+    {
+      MutexLock lock(&mutex_);
+      auto item = pending_.find(task);
+      if (item == pending_.end()) return;
+      timer = (*item)->timer;
+      pending_.erase(item);
+    }
+    // Frees the timer's slot, and the task's runnable, right away.
+    timer->Cancel();
+  }
+
+  Mutex mutex_;
+  api::ScheduledExecutor* executor_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_set<std::shared_ptr<Task>> pending_ ABSL_GUARDED_BY(mutex_);
+};
+
+ScheduledExecutor::ScheduledExecutor()
+    : impl_(Platform::CreateScheduledExecutor()),
+      dispatcher_(std::make_shared<Dispatcher>(impl_.get())) {}
+
+Cancelable ScheduledExecutor::Schedule(Runnable&& runnable,
+                                       absl::Duration duration) {
+  MutexLock lock(&mutex_);
+  if (impl_) {
+    auto task = std::make_shared<CancellableTask>(
+        ThreadCheckRunnable(this, std::move(runnable)));
+    return Cancelable(
+        task, dispatcher_->Schedule([task]() { (*task)(); }, duration));
+  } else {
+    return Cancelable();
+  }
+}
+
+void ScheduledExecutor::DoShutdown() {
+  if (impl_) {
+    // Before the executor goes, so that timers don't hand tasks to it anymore.
+    dispatcher_->Shutdown();
+    impl_->Shutdown();
+    impl_.reset();
+  }
+}
+
+}  // namespace nearby
+}  // namespace location
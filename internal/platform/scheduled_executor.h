@@ -39,12 +39,15 @@ namespace nearby {
 // An Executor that can schedule commands to run after a given delay, or to
 // execute periodically.
 //
+// Delays are kept by the process-wide TimerService rather than by each
+// executor, which only runs the commands once they're due.
+//
 // https://docs.oracle.com/javase/8/docs/api/java/util/concurrent/ScheduledExecutorService.html
 class ABSL_LOCKABLE ScheduledExecutor final : public Lockable {
  public:
   using Platform = api::ImplementationPlatform;
 
-  ScheduledExecutor() : impl_(Platform::CreateScheduledExecutor()) {}
+  ScheduledExecutor();
   ScheduledExecutor(ScheduledExecutor&& other) { *this = std::move(other); }
   ~ScheduledExecutor() {
     MutexLock lock(&mutex_);
@@ -57,6 +60,7 @@ class ABSL_LOCKABLE ScheduledExecutor final : public Lockable {
     {
       MutexLock other_lock(&other.mutex_);
       impl_ = std::move(other.impl_);
+      dispatcher_ = std::move(other.dispatcher_);
     }
     return *this;
   }
@@ -79,28 +83,17 @@ class ABSL_LOCKABLE ScheduledExecutor final : public Lockable {
   }
 
   Cancelable Schedule(Runnable&& runnable, absl::Duration duration)
-      ABSL_LOCKS_EXCLUDED(mutex_) {
-    MutexLock lock(&mutex_);
-    if (impl_) {
-      auto task = std::make_shared<CancellableTask>(
-          ThreadCheckRunnable(this, std::move(runnable)));
-      return Cancelable(task,
-                        impl_->Schedule([task]() { (*task)(); }, duration));
-    } else {
-      return Cancelable();
-    }
-  }
+      ABSL_LOCKS_EXCLUDED(mutex_);
 
  private:
-  void DoShutdown() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
-    if (impl_) {
-      impl_->Shutdown();
-      impl_.reset();
-    }
-  }
+  // Hands due tasks over to impl_; shared with the timers in flight.
+  class Dispatcher;
+
+  void DoShutdown() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   mutable Mutex mutex_;
   std::unique_ptr<api::ScheduledExecutor> ABSL_GUARDED_BY(mutex_) impl_;
+  std::shared_ptr<Dispatcher> ABSL_GUARDED_BY(mutex_) dispatcher_;
 };
 
 }  // namespace nearby
@@ -0,0 +1,78 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/spsc_byte_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace location {
+namespace nearby {
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) result <<= 1;
+  return result;
+}
+
+}  // namespace
+
+SpscByteRing::SpscByteRing(size_t capacity)
+    : mask_(RoundUpToPowerOfTwo(std::max<size_t>(capacity, 1)) - 1),
+      buffer_(new char[mask_ + 1]) {}
+
+size_t SpscByteRing::size() const {
+  // Load the read index first, so the difference can never be negative.
+  size_t read_index = read_index_.load(std::memory_order_acquire);
+  size_t write_index = write_index_.load(std::memory_order_acquire);
+  return write_index - read_index;
+}
+
+size_t SpscByteRing::Write(const char* data, size_t size) {
+  const size_t write_index = write_index_.load(std::memory_order_relaxed);
+  if (capacity() - (write_index - cached_read_index_) < size) {
+    cached_read_index_ = read_index_.load(std::memory_order_acquire);
+  }
+  size = std::min(size, capacity() - (write_index - cached_read_index_));
+  if (size == 0) return 0;
+
+  // Copy in up to two parts, wrapping around the end of the buffer.
+  const size_t offset = write_index & mask_;
+  const size_t first_part = std::min(size, capacity() - offset);
+  std::memcpy(buffer_.get() + offset, data, first_part);
+  std::memcpy(buffer_.get(), data + first_part, size - first_part);
+  write_index_.store(write_index + size, std::memory_order_release);
+  return size;
+}
+
+size_t SpscByteRing::Read(char* data, size_t size) {
+  const size_t read_index = read_index_.load(std::memory_order_relaxed);
+  if (cached_write_index_ - read_index < size) {
+    cached_write_index_ = write_index_.load(std::memory_order_acquire);
+  }
+  size = std::min(size, cached_write_index_ - read_index);
+  if (size == 0) return 0;
+
+  const size_t offset = read_index & mask_;
+  const size_t first_part = std::min(size, capacity() - offset);
+  std::memcpy(data, buffer_.get() + offset, first_part);
+  std::memcpy(data + first_part, buffer_.get(), size - first_part);
+  read_index_.store(read_index + size, std::memory_order_release);
+  return size;
+}
+
+}  // namespace nearby
+}  // namespace location
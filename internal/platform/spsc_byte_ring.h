@@ -0,0 +1,73 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_BASE_SPSC_BYTE_RING_H_
+#define PLATFORM_BASE_SPSC_BYTE_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "absl/base/optimization.h"
+
+namespace location {
+namespace nearby {
+
+// Fixed-size, lock-free byte ring for exactly one producer thread and one
+// consumer thread.
+//
+// Write() must only ever be called by the producer and Read() only by the
+// consumer; neither blocks. Waiting for data or room is left to the caller,
+// see BasePipe.
+class SpscByteRing {
+ public:
+  // |capacity| is rounded up to a power of two.
+  explicit SpscByteRing(size_t capacity);
+  SpscByteRing(const SpscByteRing&) = delete;
+  SpscByteRing& operator=(const SpscByteRing&) = delete;
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Number of bytes held. Exact when called from the producer or consumer
+  // thread with respect to that side's own calls.
+  size_t size() const;
+  bool empty() const { return size() == 0; }
+
+  // Producer only. Copies as many of the |size| bytes at |data| as fit and
+  // returns how many were copied.
+  size_t Write(const char* data, size_t size);
+
+  // Consumer only. Copies up to |size| bytes into |data| and returns how many
+  // were copied.
+  size_t Read(char* data, size_t size);
+
+ private:
+  const size_t mask_;
+  const std::unique_ptr<char[]> buffer_;
+
+  // Total bytes ever read and written; each is only advanced by its own side.
+  // Each side also caches the other side's index and only reloads it when the
+  // ring looks empty (full), so the two cache lines are not bounced between
+  // cores on every call.
+  ABSL_CACHELINE_ALIGNED std::atomic<size_t> read_index_{0};
+  size_t cached_write_index_ = 0;
+
+  ABSL_CACHELINE_ALIGNED std::atomic<size_t> write_index_{0};
+  size_t cached_read_index_ = 0;
+};
+
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_BASE_SPSC_BYTE_RING_H_
@@ -0,0 +1,82 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/spsc_byte_ring.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+TEST(SpscByteRingTest, RoundsCapacityUpToPowerOfTwo) {
+  EXPECT_EQ(SpscByteRing(5).capacity(), 8);
+  EXPECT_EQ(SpscByteRing(8).capacity(), 8);
+  EXPECT_EQ(SpscByteRing(0).capacity(), 1);
+}
+
+TEST(SpscByteRingTest, WritesOnlyWhatFits) {
+  SpscByteRing ring(4);
+
+  EXPECT_EQ(ring.Write("ABCDEF", 6), 4);
+  EXPECT_EQ(ring.size(), 4);
+  EXPECT_EQ(ring.Write("G", 1), 0);
+
+  char data[8] = {};
+  EXPECT_EQ(ring.Read(data, sizeof(data)), 4);
+  EXPECT_EQ(std::string(data, 4), "ABCD");
+  EXPECT_TRUE(ring.empty());
+  EXPECT_EQ(ring.Read(data, sizeof(data)), 0);
+}
+
+TEST(SpscByteRingTest, WrapsAroundEndOfBuffer) {
+  SpscByteRing ring(4);
+  char data[4] = {};
+  ASSERT_EQ(ring.Write("ABC", 3), 3);
+  ASSERT_EQ(ring.Read(data, 2), 2);
+
+  EXPECT_EQ(ring.Write("DEF", 3), 3);
+  EXPECT_EQ(ring.Read(data, sizeof(data)), 4);
+  EXPECT_EQ(std::string(data, 4), "CDEF");
+}
+
+TEST(SpscByteRingTest, TransfersAcrossThreads) {
+  SpscByteRing ring(64);
+  std::string expected;
+  for (int i = 0; i < 100000; ++i) expected += 'a' + i % 26;
+
+  std::thread producer([&ring, &expected]() {
+    size_t offset = 0;
+    while (offset < expected.size()) {
+      offset += ring.Write(expected.data() + offset,
+                           std::min<size_t>(37, expected.size() - offset));
+    }
+  });
+  std::string actual;
+  char data[29];
+  while (actual.size() < expected.size()) {
+    actual.append(data, ring.Read(data, sizeof(data)));
+  }
+  producer.join();
+
+  EXPECT_EQ(actual, expected);
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
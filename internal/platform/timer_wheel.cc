@@ -0,0 +1,302 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/timer_wheel.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/numeric/bits.h"
+#include "internal/platform/mutex_lock.h"
+#include "internal/platform/system_clock.h"
+
+namespace location {
+namespace nearby {
+
+constexpr int TimerWheel::kSlotBits;
+constexpr int TimerWheel::kSlots;
+constexpr int TimerWheel::kLevels;
+constexpr absl::Duration TimerService::kDefaultTick;
+
+namespace {
+
+// Ticks spanned by one slot of |level|, as a shift.
+constexpr int LevelShift(int level) { return TimerWheel::kSlotBits * level; }
+
+// Ticks spanned by the whole wheel.
+constexpr std::int64_t kWheelSpan = std::int64_t{1}
+                                    << LevelShift(TimerWheel::kLevels);
+
+}  // namespace
+
+class TimerWheel::Timer {
+ public:
+  Timer(std::int64_t tick, Runnable&& runnable)
+      : tick(tick), runnable(std::move(runnable)) {}
+
+  const std::int64_t tick;
+  Runnable runnable;
+
+  // Position in the wheel; |slot| is -1 while the timer isn't in it.
+  int slot = -1;
+  Timer* prev = nullptr;
+  Timer* next = nullptr;
+  // Keeps the timer alive while it's in the wheel.
+  std::shared_ptr<Timer> self;
+};
+
+TimerWheel::TimerWheel(std::int64_t now_tick) : now_tick_(now_tick) {}
+
+TimerWheel::~TimerWheel() {
+  for (Timer* head : slots_) {
+    while (head != nullptr) {
+      Timer* next = head->next;
+      head->slot = -1;
+      head->prev = head->next = nullptr;
+      head->self.reset();
+      head = next;
+    }
+  }
+}
+
+std::shared_ptr<TimerWheel::Timer> TimerWheel::Add(std::int64_t tick,
+                                                   Runnable&& runnable) {
+  auto timer = std::make_shared<Timer>(std::max(tick, now_tick_ + 1),
+                                       std::move(runnable));
+  timer->self = timer;
+  Insert(timer.get());
+  ++size_;
+  return timer;
+}
+
+Runnable TimerWheel::Cancel(Timer& timer) {
+  if (timer.slot < 0) return nullptr;
+  Unlink(&timer);
+  --size_;
+  Runnable runnable = std::move(timer.runnable);
+  // May be the last reference to the timer.
+  std::shared_ptr<Timer> self = std::move(timer.self);
+  return runnable;
+}
+
+std::vector<Runnable> TimerWheel::Advance(std::int64_t now_tick) {
+  std::vector<Runnable> expired;
+  for (absl::optional<std::int64_t> next = NextEventTick();
+       next.has_value() && *next <= now_tick; next = NextEventTick()) {
+    now_tick_ = *next;
+    // Slots of the higher levels are due when all the levels below them have
+    // come full circle.
+    for (int level = kLevels - 1; level > 0; --level) {
+      const int shift = LevelShift(level);
+      if ((now_tick_ & ((std::int64_t{1} << shift) - 1)) == 0) {
+        Cascade(level, (now_tick_ >> shift) & (kSlots - 1));
+      }
+    }
+    // Everything in the current slot of the lowest level expires now.
+    const std::size_t first = expired.size();
+    const int slot = now_tick_ & (kSlots - 1);
+    while (Timer* timer = slots_[slot]) {
+      Unlink(timer);
+      --size_;
+      expired.push_back(std::move(timer->runnable));
+      timer->self.reset();
+    }
+    // Slots are filled at the front; oldest first.
+    std::reverse(expired.begin() + first, expired.end());
+  }
+  now_tick_ = std::max(now_tick_, now_tick);
+  return expired;
+}
+
+absl::optional<std::int64_t> TimerWheel::NextEventTick() const {
+  absl::optional<std::int64_t> next;
+  for (int level = 0; level < kLevels; ++level) {
+    const std::uint64_t occupied = occupied_[level];
+    if (occupied == 0) continue;
+    const int shift = LevelShift(level);
+    const std::int64_t position = now_tick_ >> shift;
+    const int current = position & (kSlots - 1);
+    // Rotates the slot after the current one into bit 0; the current slot
+    // itself is a full turn away.
+    const std::uint64_t rotated =
+        current == kSlots - 1 ? occupied
+                              : (occupied >> (current + 1)) |
+                                    (occupied << (kSlots - 1 - current));
+    const std::int64_t tick = (position + absl::countr_zero(rotated) + 1)
+                              << shift;
+    if (!next.has_value() || tick < *next) next = tick;
+  }
+  return next;
+}
+
+void TimerWheel::Insert(Timer* timer) {
+  const std::int64_t delta = timer->tick - now_tick_;
+  int level = 0;
+  while (level < kLevels - 1 &&
+         delta >= (std::int64_t{1} << LevelShift(level + 1))) {
+    ++level;
+  }
+  // Timers beyond the top level are re-hashed as late as possible, and moved
+  // down once they're within reach.
+  const std::int64_t tick = std::min(timer->tick, now_tick_ + kWheelSpan - 1);
+  const int slot =
+      level * kSlots + ((tick >> LevelShift(level)) & (kSlots - 1));
+
+  timer->slot = slot;
+  timer->prev = nullptr;
+  timer->next = slots_[slot];
+  if (timer->next != nullptr) timer->next->prev = timer;
+  slots_[slot] = timer;
+  occupied_[level] |= std::uint64_t{1} << (slot % kSlots);
+}
+
+void TimerWheel::Unlink(Timer* timer) {
+  const int slot = timer->slot;
+  if (timer->prev != nullptr) {
+    timer->prev->next = timer->next;
+  } else {
+    slots_[slot] = timer->next;
+  }
+  if (timer->next != nullptr) timer->next->prev = timer->prev;
+  if (slots_[slot] == nullptr) {
+    occupied_[slot / kSlots] &= ~(std::uint64_t{1} << (slot % kSlots));
+  }
+  timer->slot = -1;
+  timer->prev = timer->next = nullptr;
+}
+
+void TimerWheel::Cascade(int level, int slot) {
+  Timer* timer = slots_[level * kSlots + slot];
+  slots_[level * kSlots + slot] = nullptr;
+  occupied_[level] &= ~(std::uint64_t{1} << slot);
+  if (timer == nullptr) return;
+  // Oldest first, so that the slots below stay ordered newest first.
+  while (timer->next != nullptr) timer = timer->next;
+  while (timer != nullptr) {
+    Timer* prev = timer->prev;
+    Insert(timer);
+    timer = prev;
+  }
+}
+
+// Cancels a timer of a TimerService.
+class TimerService::ScheduledTimer : public api::Cancelable {
+ public:
+  ScheduledTimer(TimerService* service,
+                 std::shared_ptr<TimerWheel::Timer> timer)
+      : service_(service), timer_(std::move(timer)) {}
+
+  bool Cancel() override {
+    if (timer_ == nullptr) return false;
+    // Destroyed here, outside of the service's lock.
+    Runnable runnable = service_->Cancel(*timer_);
+    return runnable != nullptr;
+  }
+
+ private:
+  TimerService* const service_;
+  const std::shared_ptr<TimerWheel::Timer> timer_;
+};
+
+TimerService& TimerService::GetInstance() {
+  static TimerService* const instance = new TimerService();
+  return *instance;
+}
+
+TimerService::TimerService(absl::Duration tick)
+    : tick_(tick), epoch_(SystemClock::ElapsedRealtime()) {}
+
+TimerService::~TimerService() {
+  Shutdown();
+  MutexLock lock(&mutex_);
+  thread_.reset();
+}
+
+std::shared_ptr<api::Cancelable> TimerService::Schedule(Runnable&& runnable,
+                                                        absl::Duration delay) {
+  MutexLock lock(&mutex_);
+  if (shut_down_) return std::make_shared<ScheduledTimer>(this, nullptr);
+
+  // The first tick that starts no earlier than the deadline.
+  const absl::Time deadline =
+      SystemClock::ElapsedRealtime() + std::max(delay, absl::ZeroDuration());
+  std::int64_t tick = TickAt(deadline);
+  if (TimeOf(tick) < deadline) ++tick;
+
+  auto timer = std::make_shared<ScheduledTimer>(
+      this, wheel_.Add(tick, std::move(runnable)));
+  if (thread_ == nullptr) {
+    thread_ = std::make_unique<SingleThreadExecutor>();
+    thread_->Execute("timer-wheel", [this]() { Loop(); });
+  } else if (!wake_tick_.has_value() || tick < *wake_tick_) {
+    cond_.Notify();
+  }
+  return timer;
+}
+
+void TimerService::Shutdown() {
+  {
+    MutexLock lock(&mutex_);
+    if (shut_down_) return;
+    shut_down_ = true;
+    if (thread_ == nullptr) return;
+    cond_.Notify();
+  }
+  loop_done_.Await();
+}
+
+Runnable TimerService::Cancel(TimerWheel::Timer& timer) {
+  MutexLock lock(&mutex_);
+  return wheel_.Cancel(timer);
+}
+
+void TimerService::Loop() {
+  while (true) {
+    std::vector<Runnable> expired;
+    {
+      MutexLock lock(&mutex_);
+      while (!shut_down_) {
+        absl::Time now = SystemClock::ElapsedRealtime();
+        expired = wheel_.Advance(TickAt(now));
+        if (!expired.empty()) break;
+
+        wake_tick_ = wheel_.NextEventTick();
+        if (wake_tick_.has_value()) {
+          cond_.Wait(TimeOf(*wake_tick_) - now);
+        } else {
+          cond_.Wait();
+        }
+        wake_tick_.reset();
+      }
+      if (shut_down_) break;
+    }
+    for (Runnable& runnable : expired) {
+      runnable();
+    }
+  }
+  loop_done_.CountDown();
+}
+
+std::int64_t TimerService::TickAt(absl::Time time) const {
+  absl::Duration remainder;
+  return absl::IDivDuration(std::max(time - epoch_, absl::ZeroDuration()),
+                            tick_, &remainder);
+}
+
+absl::Time TimerService::TimeOf(std::int64_t tick) const {
+  return epoch_ + tick * tick_;
+}
+
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,155 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_TIMER_WHEEL_H_
+#define PLATFORM_PUBLIC_TIMER_WHEEL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "internal/platform/condition_variable.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/implementation/cancelable.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/runnable.h"
+#include "internal/platform/single_thread_executor.h"
+
+namespace location {
+namespace nearby {
+
+// A hierarchical timing wheel: timers are hashed by their expiry tick into one
+// of kLevels wheels of kSlots slots each, where a slot of level N spans
+// kSlots^N ticks. Adding and cancelling a timer take constant time, however
+// many there are; a timer moves down a level at most kLevels - 1 times before
+// it expires.
+//
+// Timers due more than kSlots^kLevels ticks ahead are parked in the top level
+// and re-hashed until they're close enough.
+//
+// Not thread-safe; TimerService drives one from a thread of its own.
+class TimerWheel {
+ public:
+  class Timer;
+
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlots = 1 << kSlotBits;
+  static constexpr int kLevels = 4;
+
+  explicit TimerWheel(std::int64_t now_tick = 0);
+  ~TimerWheel();
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Adds a timer running |runnable| once the wheel gets to |tick|. A |tick|
+  // that isn't after the current one expires on the next tick.
+  std::shared_ptr<Timer> Add(std::int64_t tick, Runnable&& runnable);
+
+  // Removes |timer| from the wheel. Returns its runnable if it was still
+  // pending, and an empty one otherwise; like Advance(), so that the caller
+  // may destroy it without holding its locks.
+  Runnable Cancel(Timer& timer);
+
+  // Moves the wheel forward to |now_tick|, and returns the runnables of the
+  // timers that expired on the way, in expiry order. Doesn't run them, so that
+  // the caller may do so without holding its locks.
+  std::vector<Runnable> Advance(std::int64_t now_tick);
+
+  // Returns the next tick at which Advance() has something to do, if any.
+  absl::optional<std::int64_t> NextEventTick() const;
+
+  std::int64_t now_tick() const { return now_tick_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  // Hashes |timer| into its slot, relative to now_tick_.
+  void Insert(Timer* timer);
+  void Unlink(Timer* timer);
+  // Re-hashes the timers of a slot of a higher level, which is now due.
+  void Cascade(int level, int slot);
+
+  std::int64_t now_tick_;
+  std::size_t size_ = 0;
+  std::array<Timer*, kLevels * kSlots> slots_{};
+  // Bit N of occupied_[level] is set if slot N of that level has timers.
+  std::array<std::uint64_t, kLevels> occupied_{};
+};
+
+// Runs timers for the whole process from a single thread, on a TimerWheel
+// with a resolution of one tick.
+//
+// Timers run on the timer thread itself, so their runnables should only hand
+// work off, e.g. to an executor; ScheduledExecutor does so for its tasks.
+// Timers never run early, and late by at most about one tick plus scheduling
+// delay.
+class TimerService {
+ public:
+  static constexpr absl::Duration kDefaultTick = absl::Milliseconds(1);
+
+  // The instance shared by the whole process; never destroyed.
+  static TimerService& GetInstance();
+
+  explicit TimerService(absl::Duration tick = kDefaultTick);
+  ~TimerService();
+
+  TimerService(const TimerService&) = delete;
+  TimerService& operator=(const TimerService&) = delete;
+
+  // Runs |runnable| on the timer thread after |delay|. Cancelling the returned
+  // Cancelable removes the timer in constant time, and returns false if it
+  // has run already. Cancelables must not outlive this service.
+  // The timer thread is started on first use.
+  std::shared_ptr<api::Cancelable> Schedule(Runnable&& runnable,
+                                            absl::Duration delay)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Stops the timer thread; pending timers don't run anymore. Must not be
+  // called from a timer. Called by the destructor.
+  void Shutdown() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  class ScheduledTimer;
+
+  // Body of the timer thread.
+  void Loop() ABSL_LOCKS_EXCLUDED(mutex_);
+  Runnable Cancel(TimerWheel::Timer& timer) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // The tick that |time| falls in.
+  std::int64_t TickAt(absl::Time time) const;
+  absl::Time TimeOf(std::int64_t tick) const;
+
+  const absl::Duration tick_;
+  const absl::Time epoch_;
+
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  bool shut_down_ ABSL_GUARDED_BY(mutex_) = false;
+  TimerWheel wheel_ ABSL_GUARDED_BY(mutex_);
+  // The tick the timer thread sleeps until, if it's sleeping on a timer.
+  absl::optional<std::int64_t> wake_tick_ ABSL_GUARDED_BY(mutex_);
+  CountDownLatch loop_done_{1};
+  std::unique_ptr<SingleThreadExecutor> thread_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_PUBLIC_TIMER_WHEEL_H_
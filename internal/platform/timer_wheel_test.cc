@@ -0,0 +1,229 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/timer_wheel.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "internal/platform/count_down_latch.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+using ::testing::ElementsAre;
+
+// Advances |wheel| to |tick| and runs what expired.
+void AdvanceAndRun(TimerWheel& wheel, std::int64_t tick) {
+  for (Runnable& runnable : wheel.Advance(tick)) runnable();
+}
+
+TEST(TimerWheelTest, ExpiresOnItsTick) {
+  TimerWheel wheel;
+  int runs = 0;
+  wheel.Add(5, [&runs]() { ++runs; });
+  EXPECT_EQ(wheel.NextEventTick(), 5);
+
+  AdvanceAndRun(wheel, 4);
+  EXPECT_EQ(runs, 0);
+  AdvanceAndRun(wheel, 5);
+  EXPECT_EQ(runs, 1);
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_EQ(wheel.NextEventTick(), absl::nullopt);
+}
+
+TEST(TimerWheelTest, PastTickExpiresOnNextTick) {
+  TimerWheel wheel(/*now_tick=*/100);
+  int runs = 0;
+  wheel.Add(10, [&runs]() { ++runs; });
+
+  AdvanceAndRun(wheel, 100);
+  EXPECT_EQ(runs, 0);
+  AdvanceAndRun(wheel, 101);
+  EXPECT_EQ(runs, 1);
+}
+
+TEST(TimerWheelTest, ExpiresInOrder) {
+  TimerWheel wheel;
+  std::vector<int> order;
+  wheel.Add(70, [&order]() { order.push_back(3); });
+  wheel.Add(3, [&order]() { order.push_back(1); });
+  wheel.Add(70, [&order]() { order.push_back(4); });
+  wheel.Add(3, [&order]() { order.push_back(2); });
+
+  AdvanceAndRun(wheel, 1000);
+  EXPECT_THAT(order, ElementsAre(1, 2, 3, 4));
+}
+
+TEST(TimerWheelTest, CascadesFromEveryLevel) {
+  // One timer per level, and one past the end of the wheel.
+  const std::vector<std::int64_t> ticks = {
+      50, 3000, 200000, 10000000, 123456789};
+  TimerWheel wheel(/*now_tick=*/7);
+  std::vector<std::int64_t> expired;
+  for (std::int64_t tick : ticks) {
+    wheel.Add(tick, [&wheel, &expired]() {
+      expired.push_back(wheel.now_tick());
+    });
+  }
+
+  for (int i = 0; i < ticks.size(); ++i) {
+    AdvanceAndRun(wheel, ticks[i] - 1);
+    EXPECT_EQ(expired.size(), i);
+    AdvanceAndRun(wheel, ticks[i]);
+    ASSERT_EQ(expired.size(), i + 1);
+    EXPECT_EQ(expired.back(), ticks[i]);
+  }
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, CancelRemovesTimer) {
+  TimerWheel wheel;
+  int runs = 0;
+  std::shared_ptr<TimerWheel::Timer> timer =
+      wheel.Add(100000, [&runs]() { ++runs; });
+  EXPECT_EQ(wheel.size(), 1);
+
+  EXPECT_NE(wheel.Cancel(*timer), nullptr);
+  EXPECT_EQ(wheel.Cancel(*timer), nullptr);
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_EQ(wheel.NextEventTick(), absl::nullopt);
+  AdvanceAndRun(wheel, 1000000);
+  EXPECT_EQ(runs, 0);
+}
+
+TEST(TimerWheelTest, CancelAfterExpiryFails) {
+  TimerWheel wheel;
+  std::shared_ptr<TimerWheel::Timer> timer = wheel.Add(1, []() {});
+  EXPECT_THAT(wheel.Advance(1), ::testing::SizeIs(1));
+
+  EXPECT_EQ(wheel.Cancel(*timer), nullptr);
+}
+
+TEST(TimerWheelTest, NeverExpiresEarlyOrLate) {
+  std::mt19937_64 random(/*seed=*/42);
+  TimerWheel wheel;
+  // The ticks the wheel was advanced from and to when a timer expired.
+  std::int64_t from = 0;
+  struct Expiry {
+    std::int64_t due;
+    std::int64_t from = -1;
+    std::int64_t to = -1;
+  };
+  std::vector<Expiry> expiries(2000);
+  std::vector<std::shared_ptr<TimerWheel::Timer>> timers;
+  for (Expiry& expiry : expiries) {
+    // Mostly short timers, some of them far out.
+    const std::int64_t range = random() % 4 == 0 ? 50000000 : 5000;
+    expiry.due = 1 + random() % range;
+    timers.push_back(wheel.Add(expiry.due, [&wheel, &from, &expiry]() {
+      expiry.from = from;
+      expiry.to = wheel.now_tick();
+    }));
+  }
+  // Cancels every tenth timer.
+  for (int i = 0; i < expiries.size(); i += 10) {
+    wheel.Cancel(*timers[i]);
+  }
+
+  while (!wheel.empty()) {
+    // Small steps, and the occasional big one.
+    const std::int64_t step =
+        random() % 8 == 0 ? random() % 1000000 : random() % 700;
+    AdvanceAndRun(wheel, from + 1 + step);
+    from = wheel.now_tick();
+  }
+
+  for (int i = 0; i < expiries.size(); ++i) {
+    if (i % 10 == 0) {
+      EXPECT_EQ(expiries[i].to, -1);
+    } else {
+      EXPECT_LT(expiries[i].from, expiries[i].due);
+      EXPECT_GE(expiries[i].to, expiries[i].due);
+    }
+  }
+}
+
+TEST(TimerServiceTest, RunsAfterDelay) {
+  TimerService service;
+  CountDownLatch latch(1);
+  const absl::Duration delay = absl::Milliseconds(50);
+  const absl::Time start = absl::Now();
+  absl::Time ran;
+  service.Schedule(
+      [&latch, &ran]() {
+        ran = absl::Now();
+        latch.CountDown();
+      },
+      delay);
+
+  ASSERT_TRUE(latch.Await(absl::Seconds(5)).result());
+  EXPECT_GE(ran - start, delay);
+}
+
+TEST(TimerServiceTest, EarlierTimerWakesTheThread) {
+  TimerService service;
+  CountDownLatch latch(1);
+  service.Schedule([]() {}, absl::Hours(1));
+  service.Schedule([&latch]() { latch.CountDown(); }, absl::Milliseconds(10));
+
+  EXPECT_TRUE(latch.Await(absl::Seconds(5)).result());
+}
+
+TEST(TimerServiceTest, CancelledTimerDoesNotRun) {
+  TimerService service;
+  std::atomic_int runs = 0;
+  std::shared_ptr<api::Cancelable> timer =
+      service.Schedule([&runs]() { ++runs; }, absl::Milliseconds(50));
+
+  EXPECT_TRUE(timer->Cancel());
+  EXPECT_FALSE(timer->Cancel());
+  absl::SleepFor(absl::Milliseconds(200));
+  EXPECT_EQ(runs, 0);
+}
+
+TEST(TimerServiceTest, CancelAfterRunFails) {
+  TimerService service;
+  CountDownLatch latch(1);
+  std::shared_ptr<api::Cancelable> timer =
+      service.Schedule([&latch]() { latch.CountDown(); }, absl::ZeroDuration());
+
+  ASSERT_TRUE(latch.Await(absl::Seconds(5)).result());
+  EXPECT_FALSE(timer->Cancel());
+}
+
+TEST(TimerServiceTest, NothingRunsAfterShutdown) {
+  TimerService service;
+  std::atomic_int runs = 0;
+  service.Schedule([&runs]() { ++runs; }, absl::Milliseconds(50));
+
+  service.Shutdown();
+  std::shared_ptr<api::Cancelable> timer =
+      service.Schedule([&runs]() { ++runs; }, absl::ZeroDuration());
+  absl::SleepFor(absl::Milliseconds(200));
+  EXPECT_EQ(runs, 0);
+  EXPECT_FALSE(timer->Cancel());
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,206 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/tracing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+#include "absl/time/clock.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace location {
+namespace nearby {
+
+namespace {
+
+// Writes |value| as a JSON string.
+void WriteJsonString(std::ostream& out, absl::string_view value) {
+  out << '"';
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        out << "\\\"";
+        break;
+      case '\\':
+        out << "\\\\";
+        break;
+      case '\n':
+        out << "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out << escaped;
+        } else {
+          out << c;
+        }
+    }
+  }
+  out << '"';
+}
+
+}  // namespace
+
+std::atomic<bool> Tracer::enabled_{false};
+
+// Hands the ring of a thread back to the tracer when the thread exits.
+class Tracer::ThreadRing {
+ public:
+  explicit ThreadRing(Tracer& tracer) : tracer_(tracer), ring_(nullptr) {}
+  ~ThreadRing() {
+    if (ring_ != nullptr) tracer_.ReleaseRing(*ring_);
+  }
+
+  Ring& Get() {
+    if (ring_ == nullptr) ring_ = &tracer_.GetRing();
+    return *ring_;
+  }
+
+ private:
+  Tracer& tracer_;
+  Ring* ring_;
+};
+
+Tracer& Tracer::GetInstance() {
+  static Tracer* instance = new Tracer();
+  return *instance;
+}
+
+void Tracer::Enable() { enabled_.store(true, std::memory_order_relaxed); }
+
+void Tracer::Disable() { enabled_.store(false, std::memory_order_relaxed); }
+
+void Tracer::Clear() {
+  MutexLock lock(&mutex_);
+  for (const auto& ring : rings_) {
+    MutexLock ring_lock(&ring->mutex);
+    ring->events.clear();
+    ring->next = 0;
+  }
+}
+
+void Tracer::Begin(absl::string_view category, absl::string_view name,
+                   TraceArgs args) {
+  Add('B', category, name, {}, std::move(args));
+}
+
+void Tracer::End(absl::string_view category, absl::string_view name) {
+  Add('E', category, name, {}, {});
+}
+
+void Tracer::AsyncBegin(absl::string_view category, absl::string_view name,
+                        absl::string_view id, TraceArgs args) {
+  Add('b', category, name, id, std::move(args));
+}
+
+void Tracer::AsyncEnd(absl::string_view category, absl::string_view name,
+                      absl::string_view id, TraceArgs args) {
+  Add('e', category, name, id, std::move(args));
+}
+
+void Tracer::Instant(absl::string_view category, absl::string_view name,
+                     TraceArgs args) {
+  Add('i', category, name, {}, std::move(args));
+}
+
+std::string Tracer::DumpChromeTrace() const {
+  std::vector<Event> events;
+  {
+    MutexLock lock(&mutex_);
+    for (const auto& ring : rings_) {
+      MutexLock ring_lock(&ring->mutex);
+      events.insert(events.end(), ring->events.begin(), ring->events.end());
+    }
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const Event& a, const Event& b) {
+                     return a.micros < b.micros;
+                   });
+
+  std::stringstream out;
+  out << "{\"traceEvents\":[";
+  for (size_t i = 0; i < events.size(); ++i) {
+    const Event& event = events[i];
+    if (i > 0) out << ",";
+    out << "\n{\"ph\":\"" << event.phase << "\",\"ts\":" << event.micros
+        << ",\"pid\":1,\"tid\":" << event.tid << ",\"cat\":";
+    WriteJsonString(out, event.category);
+    out << ",\"name\":";
+    WriteJsonString(out, event.name);
+    if (!event.id.empty()) {
+      out << ",\"id\":";
+      WriteJsonString(out, event.id);
+    }
+    // Instant events are drawn on their thread's track.
+    if (event.phase == 'i') out << ",\"s\":\"t\"";
+    if (!event.args.empty()) {
+      out << ",\"args\":{";
+      for (size_t j = 0; j < event.args.size(); ++j) {
+        if (j > 0) out << ",";
+        WriteJsonString(out, event.args[j].first);
+        out << ":";
+        WriteJsonString(out, event.args[j].second);
+      }
+      out << "}";
+    }
+    out << "}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return out.str();
+}
+
+void Tracer::Add(char phase, absl::string_view category,
+                 absl::string_view name, absl::string_view id,
+                 TraceArgs args) {
+  thread_local ThreadRing thread_ring(*this);
+  Ring& ring = thread_ring.Get();
+  Event event{phase,
+              absl::GetCurrentTimeNanos() / 1000,
+              ring.tid,
+              std::string(category),
+              std::string(name),
+              std::string(id),
+              std::move(args)};
+
+  MutexLock lock(&ring.mutex);
+  if (static_cast<int>(ring.events.size()) < kRingCapacity) {
+    ring.events.push_back(std::move(event));
+    return;
+  }
+  ring.events[ring.next] = std::move(event);
+  ring.next = (ring.next + 1) % kRingCapacity;
+}
+
+Tracer::Ring& Tracer::GetRing() {
+  MutexLock lock(&mutex_);
+  for (const auto& ring : rings_) {
+    if (!ring->in_use) {
+      ring->in_use = true;
+      return *ring;
+    }
+  }
+  rings_.push_back(std::make_unique<Ring>(rings_.size() + 1));
+  return *rings_.back();
+}
+
+void Tracer::ReleaseRing(Ring& ring) {
+  MutexLock lock(&mutex_);
+  ring.in_use = false;
+}
+
+}  // namespace nearby
+}  // namespace location
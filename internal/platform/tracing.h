@@ -0,0 +1,162 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_TRACING_H_
+#define PLATFORM_PUBLIC_TRACING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "internal/platform/mutex.h"
+
+namespace location {
+namespace nearby {
+
+// Key-value pairs shown with a trace event, e.g. {{"medium", "BLE"}}.
+using TraceArgs = std::vector<std::pair<std::string, std::string>>;
+
+// Records trace events in the Chrome trace event format, which
+// chrome://tracing and Perfetto open.
+//
+// Each thread writes to a ring of its own, keeping its last kRingCapacity
+// events. Rings outlive their threads; a new thread takes over the ring of
+// one that exited. Tracing is off until Enable(); while off, the NEARBY_TRACE
+// macros below cost a relaxed atomic load and build no arguments.
+class Tracer {
+ public:
+  static constexpr int kRingCapacity = 4096;
+
+  static Tracer& GetInstance();
+
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+  // Starts or stops recording; events already recorded are kept.
+  void Enable();
+  void Disable();
+  // Drops every recorded event.
+  void Clear() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Spans that begin and end on the same thread.
+  void Begin(absl::string_view category, absl::string_view name,
+             TraceArgs args = {});
+  void End(absl::string_view category, absl::string_view name);
+
+  // Spans that may end on another thread. Spans with the same category,
+  // name and |id| pair up.
+  void AsyncBegin(absl::string_view category, absl::string_view name,
+                  absl::string_view id, TraceArgs args = {});
+  void AsyncEnd(absl::string_view category, absl::string_view name,
+                absl::string_view id, TraceArgs args = {});
+
+  void Instant(absl::string_view category, absl::string_view name,
+               TraceArgs args = {});
+
+  // Returns the recorded events as a JSON trace, oldest first.
+  std::string DumpChromeTrace() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Event {
+    char phase;
+    std::int64_t micros;
+    int tid;
+    std::string category;
+    std::string name;
+    std::string id;
+    TraceArgs args;
+  };
+
+  struct Ring {
+    explicit Ring(int tid) : tid(tid) {}
+
+    const int tid;
+    Mutex mutex;
+    std::vector<Event> events ABSL_GUARDED_BY(mutex);
+    // Where the next event goes, once |events| is full.
+    int next ABSL_GUARDED_BY(mutex) = 0;
+    // Whether a thread is writing to the ring; guarded by Tracer::mutex_.
+    bool in_use = true;
+  };
+  class ThreadRing;
+
+  Tracer() = default;
+
+  void Add(char phase, absl::string_view category, absl::string_view name,
+           absl::string_view id, TraceArgs args);
+  // Returns the ring of the calling thread.
+  Ring& GetRing() ABSL_LOCKS_EXCLUDED(mutex_);
+  void ReleaseRing(Ring& ring) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  static std::atomic<bool> enabled_;
+
+  mutable Mutex mutex_;
+  std::vector<std::unique_ptr<Ring>> rings_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Traces a span for the rest of the enclosing scope, if tracing is enabled
+// when it starts.
+class TraceScope {
+ public:
+  TraceScope(absl::string_view category, absl::string_view name)
+      : category_(category), name_(name), enabled_(Tracer::IsEnabled()) {
+    if (enabled_) Tracer::GetInstance().Begin(category_, name_);
+  }
+  ~TraceScope() {
+    if (enabled_) Tracer::GetInstance().End(category_, name_);
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const absl::string_view category_;
+  const absl::string_view name_;
+  const bool enabled_;
+};
+
+}  // namespace nearby
+}  // namespace location
+
+// The arguments after |id| are TraceArgs, e.g. {{"medium", medium_name}};
+// they are only evaluated while tracing is enabled.
+#define NEARBY_TRACE_ASYNC_BEGIN(category, name, id, ...)   \
+  do {                                                      \
+    if (::location::nearby::Tracer::IsEnabled()) {          \
+      ::location::nearby::Tracer::GetInstance().AsyncBegin( \
+          category, name, id, ##__VA_ARGS__);               \
+    }                                                       \
+  } while (0)
+
+#define NEARBY_TRACE_ASYNC_END(category, name, id, ...)   \
+  do {                                                    \
+    if (::location::nearby::Tracer::IsEnabled()) {        \
+      ::location::nearby::Tracer::GetInstance().AsyncEnd( \
+          category, name, id, ##__VA_ARGS__);             \
+    }                                                     \
+  } while (0)
+
+#define NEARBY_TRACE_INSTANT(category, name, ...)        \
+  do {                                                   \
+    if (::location::nearby::Tracer::IsEnabled()) {       \
+      ::location::nearby::Tracer::GetInstance().Instant( \
+          category, name, ##__VA_ARGS__);                \
+    }                                                    \
+  } while (0)
+
+#endif  // PLATFORM_PUBLIC_TRACING_H_
@@ -0,0 +1,166 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/tracing.h"
+
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+int CountOccurrences(absl::string_view text, absl::string_view pattern) {
+  int count = 0;
+  for (size_t pos = text.find(pattern); pos != absl::string_view::npos;
+       pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+// The tracer is shared by the whole process, so each test starts afresh.
+class TracingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Tracer::GetInstance().Disable();
+    Tracer::GetInstance().Clear();
+  }
+  void TearDown() override {
+    Tracer::GetInstance().Disable();
+    Tracer::GetInstance().Clear();
+  }
+};
+
+TEST_F(TracingTest, RecordsNothingWhenDisabled) {
+  bool evaluated = false;
+  auto args = [&evaluated]() {
+    evaluated = true;
+    return TraceArgs{{"medium", "BLE"}};
+  };
+
+  NEARBY_TRACE_ASYNC_BEGIN("test", "span", "ABCD", args());
+  NEARBY_TRACE_ASYNC_END("test", "span", "ABCD");
+  NEARBY_TRACE_INSTANT("test", "event");
+  { TraceScope scope("test", "scope"); }
+
+  EXPECT_FALSE(evaluated);
+  EXPECT_EQ(CountOccurrences(Tracer::GetInstance().DumpChromeTrace(),
+                             "\"ph\""),
+            0);
+}
+
+TEST_F(TracingTest, DumpsAsyncSpansWithArgs) {
+  Tracer::GetInstance().Enable();
+
+  NEARBY_TRACE_ASYNC_BEGIN("connections", "connect", "ABCD",
+                           {{"endpoint_id", "ABCD"}, {"medium", "BLE"}});
+  NEARBY_TRACE_ASYNC_END("connections", "connect", "ABCD",
+                         {{"status", "kSuccess"}});
+
+  std::string trace = Tracer::GetInstance().DumpChromeTrace();
+  EXPECT_TRUE(absl::StartsWith(trace, "{\"traceEvents\":["));
+  EXPECT_THAT(trace, HasSubstr("\"ph\":\"b\""));
+  EXPECT_THAT(trace, HasSubstr("\"ph\":\"e\""));
+  EXPECT_THAT(trace, HasSubstr("\"cat\":\"connections\""));
+  EXPECT_THAT(trace, HasSubstr("\"name\":\"connect\""));
+  EXPECT_THAT(trace, HasSubstr("\"id\":\"ABCD\""));
+  EXPECT_THAT(trace,
+              HasSubstr("\"args\":{\"endpoint_id\":\"ABCD\","
+                        "\"medium\":\"BLE\"}"));
+  EXPECT_THAT(trace, HasSubstr("\"args\":{\"status\":\"kSuccess\"}"));
+  EXPECT_LT(trace.find("\"ph\":\"b\""), trace.find("\"ph\":\"e\""));
+}
+
+TEST_F(TracingTest, DumpsScopesAndInstants) {
+  Tracer::GetInstance().Enable();
+
+  {
+    TraceScope scope("test", "scope");
+    NEARBY_TRACE_INSTANT("test", "event", {{"size", "42"}});
+  }
+
+  std::string trace = Tracer::GetInstance().DumpChromeTrace();
+  EXPECT_THAT(trace, HasSubstr("\"ph\":\"B\""));
+  EXPECT_THAT(trace, HasSubstr("\"ph\":\"E\""));
+  EXPECT_THAT(trace, HasSubstr("\"ph\":\"i\""));
+  EXPECT_THAT(trace, HasSubstr("\"s\":\"t\""));
+}
+
+TEST_F(TracingTest, EscapesStrings) {
+  Tracer::GetInstance().Enable();
+
+  NEARBY_TRACE_INSTANT("test", "quote\"back\\slash\nline");
+
+  std::string trace = Tracer::GetInstance().DumpChromeTrace();
+  EXPECT_THAT(trace, HasSubstr("quote\\\"back\\\\slash\\nline"));
+}
+
+TEST_F(TracingTest, DisableKeepsRecordedEvents) {
+  Tracer::GetInstance().Enable();
+  NEARBY_TRACE_INSTANT("test", "kept");
+  Tracer::GetInstance().Disable();
+  NEARBY_TRACE_INSTANT("test", "dropped");
+
+  std::string trace = Tracer::GetInstance().DumpChromeTrace();
+  EXPECT_THAT(trace, HasSubstr("\"kept\""));
+  EXPECT_THAT(trace, Not(HasSubstr("\"dropped\"")));
+}
+
+TEST_F(TracingTest, RingKeepsLatestEvents) {
+  Tracer::GetInstance().Enable();
+
+  for (int i = 0; i < Tracer::kRingCapacity + 10; ++i) {
+    NEARBY_TRACE_INSTANT("test", absl::StrCat("event", i));
+  }
+
+  std::string trace = Tracer::GetInstance().DumpChromeTrace();
+  EXPECT_EQ(CountOccurrences(trace, "\"ph\""), Tracer::kRingCapacity);
+  EXPECT_THAT(trace, Not(HasSubstr("\"event9\"")));
+  EXPECT_THAT(trace, HasSubstr("\"event10\""));
+  EXPECT_THAT(trace,
+              HasSubstr(absl::StrCat("\"event", Tracer::kRingCapacity + 9,
+                                     "\"")));
+}
+
+TEST_F(TracingTest, ThreadsRecordToRingsOfTheirOwn) {
+  Tracer::GetInstance().Enable();
+
+  NEARBY_TRACE_ASYNC_BEGIN("test", "handoff", "1");
+  std::thread thread(
+      []() { NEARBY_TRACE_ASYNC_END("test", "handoff", "1"); });
+  thread.join();
+
+  std::string trace = Tracer::GetInstance().DumpChromeTrace();
+  size_t begin = trace.find("\"ph\":\"b\"");
+  size_t end = trace.find("\"ph\":\"e\"");
+  ASSERT_NE(begin, std::string::npos);
+  ASSERT_NE(end, std::string::npos);
+  std::string begin_tid = trace.substr(trace.find("\"tid\":", begin), 10);
+  std::string end_tid = trace.substr(trace.find("\"tid\":", end), 10);
+  EXPECT_NE(begin_tid, end_tid);
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
@@ -14,15 +14,22 @@
 
 #include "internal/platform/wifi_lan.h"
 
+#include <cstdint>
 #include <memory>
 
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/cancellation_flag.h"
 #include "internal/platform/medium_environment.h"
 #include "internal/platform/count_down_latch.h"
+#include "internal/platform/exception.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/single_thread_executor.h"
+#include "proto/connections_enums.pb.h"
 
 namespace location {
 namespace nearby {
@@ -52,6 +59,29 @@ class WifiLanMediumTest : public ::testing::TestWithParam<FeatureFlags> {
 
   WifiLanMediumTest() { env_.Stop(); }
 
+  // Connects |socket_a| of |wifi_lan_a| to a service of |wifi_lan_b|.
+  void Connect(WifiLanMedium& wifi_lan_a, WifiLanMedium& wifi_lan_b,
+               WifiLanSocket& socket_a, WifiLanSocket& socket_b) {
+    WifiLanServerSocket server_socket = wifi_lan_b.ListenForService();
+    ASSERT_TRUE(server_socket.IsValid());
+    NsdServiceInfo nsd_service_info;
+    nsd_service_info.SetServiceType(std::string(kServiceType));
+    nsd_service_info.SetIPAddress(server_socket.GetIPAddress());
+    nsd_service_info.SetPort(server_socket.GetPort());
+    {
+      CancellationFlag flag;
+      SingleThreadExecutor server_executor;
+      server_executor.Execute([&socket_b, &server_socket]() {
+        socket_b = server_socket.Accept();
+      });
+      socket_a = wifi_lan_a.ConnectToService(nsd_service_info, &flag);
+      if (!socket_a.IsValid()) server_socket.Close();
+    }
+    server_socket.Close();
+    ASSERT_TRUE(socket_a.IsValid());
+    ASSERT_TRUE(socket_b.IsValid());
+  }
+
   MediumEnvironment& env_{MediumEnvironment::Instance()};
 };
 
@@ -386,6 +416,100 @@ TEST_F(WifiLanMediumTest, CanDiscoverThatOtherMediumAdvertise) {
   env_.Stop();
 }
 
+TEST_F(WifiLanMediumTest, LinkProfileDelaysWrites) {
+  env_.Start();
+  MediumEnvironment::LinkProfile profile;
+  profile.latency = absl::Milliseconds(200);
+  env_.SetLinkProfile(proto::connections::WIFI_LAN, profile);
+  WifiLanMedium wifi_lan_a;
+  WifiLanMedium wifi_lan_b;
+  WifiLanSocket socket_a;
+  WifiLanSocket socket_b;
+  Connect(wifi_lan_a, wifi_lan_b, socket_a, socket_b);
+
+  const ByteArray data("data");
+  absl::Time start = absl::Now();
+  EXPECT_TRUE(socket_a.GetOutputStream().Write(data).Ok());
+  EXPECT_LT(absl::Now() - start, profile.latency);
+  ExceptionOr<ByteArray> read = socket_b.GetInputStream().Read(data.size());
+  EXPECT_GE(absl::Now() - start, profile.latency);
+  ASSERT_TRUE(read.ok());
+  EXPECT_EQ(read.result(), data);
+  socket_a.Close();
+  socket_b.Close();
+  env_.Stop();
+}
+
+TEST_F(WifiLanMediumTest, LinkProfileLimitsBandwidth) {
+  env_.Start();
+  MediumEnvironment::LinkProfile profile;
+  profile.bandwidth = 64 * 1024;
+  profile.burst = 16 * 1024;
+  env_.SetLinkProfile(proto::connections::WIFI_LAN, profile);
+  WifiLanMedium wifi_lan_a;
+  WifiLanMedium wifi_lan_b;
+  WifiLanSocket socket_a;
+  WifiLanSocket socket_b;
+  Connect(wifi_lan_a, wifi_lan_b, socket_a, socket_b);
+
+  constexpr int kChunks = 12;
+  const ByteArray chunk(4 * 1024);
+  std::int64_t received = 0;
+  absl::Time start = absl::Now();
+  {
+    SingleThreadExecutor reader;
+    reader.Execute([&socket_b, &received]() {
+      while (received < kChunks * 4 * 1024) {
+        ExceptionOr<ByteArray> read = socket_b.GetInputStream().Read(4096);
+        if (!read.ok() || read.result().Empty()) break;
+        received += read.result().size();
+      }
+    });
+    for (int i = 0; i < kChunks; ++i) {
+      EXPECT_TRUE(socket_a.GetOutputStream().Write(chunk).Ok());
+    }
+  }
+  // 32KB over the burst take half a second at 64KB/s.
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(450));
+  EXPECT_EQ(received, kChunks * 4 * 1024);
+  socket_a.Close();
+  socket_b.Close();
+  env_.Stop();
+}
+
+TEST_F(WifiLanMediumTest, LinkProfileCanBreakLink) {
+  env_.Start();
+  MediumEnvironment::LinkProfile profile;
+  profile.disconnect = 1;
+  env_.SetLinkProfile(proto::connections::WIFI_LAN, profile);
+  WifiLanMedium wifi_lan_a;
+  WifiLanMedium wifi_lan_b;
+  WifiLanSocket socket_a;
+  WifiLanSocket socket_b;
+  Connect(wifi_lan_a, wifi_lan_b, socket_a, socket_b);
+
+  EXPECT_EQ(socket_a.GetOutputStream().Write(ByteArray("data")),
+            Exception{Exception::kIo});
+  ExceptionOr<ByteArray> read = socket_b.GetInputStream().Read(4);
+  EXPECT_TRUE(!read.ok() || read.result().Empty());
+  socket_a.Close();
+  socket_b.Close();
+  env_.Stop();
+}
+
+TEST_F(WifiLanMediumTest, StartResetsLinkProfile) {
+  env_.Start();
+  EXPECT_TRUE(env_.GetLinkProfile(proto::connections::WIFI_LAN).IsIdeal());
+  MediumEnvironment::LinkProfile profile;
+  profile.latency = absl::Milliseconds(10);
+  env_.SetLinkProfile(proto::connections::WIFI_LAN, profile);
+  EXPECT_FALSE(env_.GetLinkProfile(proto::connections::WIFI_LAN).IsIdeal());
+  env_.Stop();
+  env_.Start();
+  EXPECT_TRUE(env_.GetLinkProfile(proto::connections::WIFI_LAN).IsIdeal());
+  env_.Stop();
+}
+
 }  // namespace
 }  // namespace nearby
 }  // namespace location
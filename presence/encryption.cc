@@ -16,6 +16,8 @@
 
 #include <algorithm>
 #include <cstring>
+#include <functional>
+#include <memory>
 #include <string>
 
 #include "absl/status/status.h"
@@ -40,6 +42,20 @@ constexpr int kMetadataKeyMaxSize = 16;
 constexpr int kAesCtrIvSize = 16;
 constexpr int kSaltSize = 2;
 
+namespace {
+
+// An AES-CTR context kept by each thread between calls. Reusing it saves
+// allocating a context per call and, while the key stays the same, expanding
+// the key again.
+struct CachedCipherContext {
+  std::unique_ptr<EVP_CIPHER_CTX, std::function<void(EVP_CIPHER_CTX*)>> ctx{
+      EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free};
+  // The key |ctx| was set up with; empty if it holds none.
+  std::string key;
+};
+
+}  // namespace
+
 std::string Encryption::CustomizeBytesSize(absl::string_view bytes,
                                            size_t len) {
   auto result =
@@ -75,11 +91,20 @@ absl::StatusOr<std::string> Encryption::RunMetadataEncryption(
   std::string iv = CustomizeBytesSize(salt, kAesCtrIvSize);
 
   // AES-CTR is used without authentication because it's used as a PRF.
-  auto ctx =
-      std::unique_ptr<EVP_CIPHER_CTX, std::function<void(EVP_CIPHER_CTX*)>>(
-          EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
-  if (1 != EVP_CipherInit_ex(ctx.get(), EVP_aes_128_ctr(), nullptr,
-                             reinterpret_cast<const uint8_t*>(key.data()),
+  thread_local CachedCipherContext cached;
+  EVP_CIPHER_CTX* ctx = cached.ctx.get();
+  if (ctx == nullptr) {
+    return absl::InternalError("Failed to allocate AES context.");
+  }
+  // With the key unchanged only the IV is set, which also resets the counter.
+  const EVP_CIPHER* cipher = nullptr;
+  const uint8_t* key_bytes = nullptr;
+  if (cached.key.empty() || cached.key != key) {
+    cipher = EVP_aes_128_ctr();
+    key_bytes = reinterpret_cast<const uint8_t*>(key.data());
+  }
+  cached.key.clear();
+  if (1 != EVP_CipherInit_ex(ctx, cipher, nullptr, key_bytes,
                              reinterpret_cast<const uint8_t*>(iv.data()),
                              encrypt ? 1 : 0)) {
     return absl::InvalidArgumentError("Failed to initialize AES encryption.");
@@ -87,19 +112,18 @@ absl::StatusOr<std::string> Encryption::RunMetadataEncryption(
 
   int input_size = metadata.size();
   if (1 != EVP_CipherUpdate(
-               ctx.get(), reinterpret_cast<uint8_t*>(output.data()),
-               &output_size, reinterpret_cast<const uint8_t*>(metadata.data()),
-               input_size)) {
+               ctx, reinterpret_cast<uint8_t*>(output.data()), &output_size,
+               reinterpret_cast<const uint8_t*>(metadata.data()), input_size)) {
     return absl::InvalidArgumentError("AES error in EVP_CipherUpdate");
   }
   int tmp_size = 0;
   if (1 != EVP_EncryptFinal_ex(
-               ctx.get(),
-               reinterpret_cast<uint8_t*>(output.data() + output_size),
+               ctx, reinterpret_cast<uint8_t*>(output.data() + output_size),
                &tmp_size)) {
     return absl::InvalidArgumentError("AES errorin EVP_EncryptFinal_ex");
   }
   output_size += tmp_size;
+  cached.key = std::string(key);
   if (output_size != input_size) {
     return absl::InvalidArgumentError(absl::StrFormat(
         "Invalid output size %d. Expected %d", output_size, input_size));